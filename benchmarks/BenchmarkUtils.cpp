@@ -0,0 +1,166 @@
+#include "BenchmarkUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+std::size_t getPeakResidentSetSize()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss);           // Bytes on macOS
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;    // Kilobytes on Linux
+#endif
+#endif
+}
+
+int getMaxThreads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+void setNumThreads(int numThreads)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+#else
+    (void) numThreads;
+#endif
+}
+
+double percentile(std::vector<double>& values, double p)
+{
+    if (values.empty())
+        return 0;
+
+    std::sort(values.begin(), values.end());
+
+    double rank = std::clamp(p, 0.0, 100.0) / 100.0 * (values.size() - 1);
+    std::size_t lower = static_cast<std::size_t>(std::floor(rank));
+    std::size_t upper = std::min(lower + 1, values.size() - 1);
+
+    return values[lower] + (rank - lower) * (values[upper] - values[lower]);
+}
+
+JsonWriter::JsonWriter(std::ostream& stream) :
+    _stream(stream),
+    _firstInScope({ true })
+{
+    _stream << std::setprecision(9);
+}
+
+void JsonWriter::beginObject(const std::string& key)
+{
+    writeKey(key);
+    _stream << "{";
+    _firstInScope.push_back(true);
+}
+
+void JsonWriter::endObject()
+{
+    _firstInScope.pop_back();
+    _stream << "\n";
+    indent();
+    _stream << "}";
+
+    if (_firstInScope.size() == 1)
+        _stream << "\n";
+}
+
+void JsonWriter::beginArray(const std::string& key)
+{
+    writeKey(key);
+    _stream << "[";
+    _firstInScope.push_back(true);
+}
+
+void JsonWriter::endArray()
+{
+    _firstInScope.pop_back();
+    _stream << "\n";
+    indent();
+    _stream << "]";
+}
+
+void JsonWriter::value(const std::string& key, double value)
+{
+    writeKey(key);
+
+    // JSON has no representation for infinities and NaN
+    if (std::isfinite(value))
+        _stream << value;
+    else
+        _stream << "null";
+}
+
+void JsonWriter::value(const std::string& key, long long value)
+{
+    writeKey(key);
+    _stream << value;
+}
+
+void JsonWriter::value(const std::string& key, const std::string& value)
+{
+    writeKey(key);
+    _stream << "\"";
+    for (const char c : value)
+    {
+        if (c == '"' || c == '\\')
+            _stream << '\\';
+        _stream << c;
+    }
+    _stream << "\"";
+}
+
+void JsonWriter::value(const std::string& key, bool value)
+{
+    writeKey(key);
+    _stream << (value ? "true" : "false");
+}
+
+void JsonWriter::writeKey(const std::string& key)
+{
+    // The root value is not preceded by a separator
+    if (_firstInScope.size() > 1)
+    {
+        if (!_firstInScope.back())
+            _stream << ",";
+        _stream << "\n";
+        _firstInScope.back() = false;
+        indent();
+    }
+
+    if (!key.empty())
+        _stream << "\"" << key << "\": ";
+}
+
+void JsonWriter::indent()
+{
+    for (std::size_t i = 1; i < _firstInScope.size(); i++)
+        _stream << "  ";
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/** Peak resident set size of the process in bytes, or 0 if it is unavailable on the platform */
+std::size_t getPeakResidentSetSize();
+
+/** Number of threads OpenMP uses for parallel regions, 1 without OpenMP */
+int getMaxThreads();
+
+/** Set the number of threads OpenMP uses for parallel regions, no-op without OpenMP */
+void setNumThreads(int numThreads);
+
+/**
+ * Get the \p p-th percentile (0-100) of \p values using linear interpolation
+ * @param values Samples, they are sorted in place
+ */
+double percentile(std::vector<double>& values, double p);
+
+/**
+ * Minimal streaming JSON writer, takes care of separators and nesting
+ */
+class JsonWriter
+{
+public:
+    JsonWriter(std::ostream& stream);
+
+    void beginObject(const std::string& key = "");
+    void endObject();
+    void beginArray(const std::string& key = "");
+    void endArray();
+
+    void value(const std::string& key, double value);
+    void value(const std::string& key, long long value);
+    void value(const std::string& key, int value) { this->value(key, static_cast<long long>(value)); }
+    void value(const std::string& key, std::size_t value) { this->value(key, static_cast<long long>(value)); }
+    void value(const std::string& key, const std::string& value);
+    void value(const std::string& key, const char* value) { this->value(key, std::string(value)); }
+    void value(const std::string& key, bool value);
+
+private:
+    void writeKey(const std::string& key);
+    void indent();
+
+private:
+    std::ostream&       _stream;
+    std::vector<bool>   _firstInScope;      /** Whether the next element is the first of its enclosing scope */
+};
@@ -0,0 +1,594 @@
+#include "SyntheticData.h"
+#include "BenchmarkUtils.h"
+
+#include "Explanation/ExplanationCore.h"
+#include "Explanation/Neighbourhood.h"
+#include "Explanation/Parallel.h"
+#include "Explanation/PointOrder.h"
+#include "Explanation/Tracing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Micro-benchmark of the explanation kernels
+ *
+ * Generates a synthetic Gaussian mixture with a 2D embedding and times the neighbourhood,
+ * local statistics, ranking, confidence and color mapping kernels of the explanation core
+ * for a range of thread counts. Results are written as JSON, optionally together with a
+ * Chrome trace of all runs.
+ *
+ * Usage: ExplanationBenchmark [--points N] [--dims D] [--clusters K] [--skew S] [--spread W]
+ *                             [--radius R] [--repetitions R] [--threads 1,2,4] [--seed S] [--output file]
+ *                             [--memory-budget MB] [--neighbour-cap K] [--landmarks M] [--adaptive-neighbours K]
+ *                             [--moved-fraction F] [--density F] [--top-k K] [--point-order original|morton]
+ *                             [--trace-output file]
+ */
+namespace
+{
+    struct Options
+    {
+        SyntheticDataParameters data;
+        float                   radius          = 0.05f;
+        int                     repetitions     = 5;
+        std::vector<int>        threadCounts;
+        std::string             outputPath;
+        std::string             traceOutputPath;
+        int                     memoryBudget    = 0;
+        int                     neighbourCap    = 0;
+        int                     numLandmarks    = 1000;
+        int                     adaptiveNeighbours = 30;
+        float                   movedFraction   = 0.01f;
+        float                   density         = 1.0f;
+        int                     topK            = 16;
+        bool                    mortonOrder     = false;
+    };
+
+    /** Zero all but a \p density fraction of the values, like a count matrix, and store them sparse */
+    SparseDataMatrix sparsify(DataMatrix& data, float density, std::uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> uniform(0, 1);
+
+        for (int j = 0; j < data.cols(); j++)
+            for (int i = 0; i < data.rows(); i++)
+                if (uniform(rng) > density) data(i, j) = 0;
+
+        return data.matrix().sparseView();
+    }
+
+    /**
+     * Move a fraction of the points onto other points, like an iteration of an embedding; the points
+     * on the bounds of the projection stay, so its diameter and with it the radius do not change
+     */
+    DataMatrix movePoints(const DataMatrix& projection, float movedFraction, std::uint32_t seed)
+    {
+        const int numPoints = static_cast<int>(projection.rows());
+
+        std::vector<bool> extreme(numPoints, false);
+        for (int d = 0; d < 2; d++)
+        {
+            Eigen::Index index;
+            projection.col(d).minCoeff(&index); extreme[index] = true;
+            projection.col(d).maxCoeff(&index); extreme[index] = true;
+        }
+
+        DataMatrix movedProjection = projection;
+
+        std::mt19937 rng(seed);
+        for (int m = 0; m < static_cast<int>(movedFraction * numPoints); m++)
+        {
+            const int i = rng() % numPoints;
+
+            if (!extreme[i])
+                movedProjection.row(i) = projection.row(rng() % numPoints);
+        }
+
+        return movedProjection;
+    }
+
+    /** Mean and largest size of the neighbourhoods of a neighbourhood matrix */
+    struct NeighbourhoodSizes
+    {
+        double                  mean            = 0;
+        std::size_t             max             = 0;
+    };
+
+    NeighbourhoodSizes measureNeighbourhoods(const NeighbourhoodMatrix& neighbourhoodMatrix)
+    {
+        NeighbourhoodSizes sizes;
+
+        for (const Neighbourhood& neighbourhood : neighbourhoodMatrix)
+        {
+            sizes.mean += neighbourhood.size();
+            sizes.max = std::max(sizes.max, neighbourhood.size());
+        }
+
+        sizes.mean /= std::max<std::size_t>(1, neighbourhoodMatrix.size());
+
+        return sizes;
+    }
+
+    /**
+     * Simulate a dynamic schedule of the chunks of the points over \p numThreads threads, every chunk goes to
+     * the thread that finishes first, and get the cost of the busiest thread over the mean cost per thread
+     * (1 is a perfect balance); the cost of a point is the size of its neighbourhood plus one
+     */
+    double measureImbalance(const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& chunks, int numThreads)
+    {
+        std::priority_queue<double, std::vector<double>, std::greater<double>> loads;
+        for (int t = 0; t < numThreads; t++)
+            loads.push(0);
+
+        double totalCost = 0;
+        double maxLoad = 0;
+        for (std::size_t c = 0; c + 1 < chunks.size(); c++)
+        {
+            double cost = 0;
+            for (int i = chunks[c]; i < chunks[c + 1]; i++)
+                cost += neighbourhoodMatrix[i].size() + 1;
+
+            const double load = loads.top() + cost;
+            loads.pop();
+            loads.push(load);
+
+            totalCost += cost;
+            maxLoad = std::max(maxLoad, load);
+        }
+
+        return totalCost > 0 ? maxLoad * numThreads / totalCost : 1;
+    }
+
+    struct KernelResult
+    {
+        std::string             kernel;
+        int                     numThreads;
+        std::vector<double>     times;
+        std::size_t             peakRss;
+    };
+
+    std::vector<int> parseList(const std::string& text)
+    {
+        std::vector<int> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            values.push_back(std::atoi(item.c_str()));
+        return values;
+    }
+
+    bool parseArguments(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << argument << std::endl;
+                return false;
+            }
+
+            std::string value = argv[++i];
+
+            if (argument == "--points")             options.data.numPoints = std::atoi(value.c_str());
+            else if (argument == "--dims")          options.data.numDimensions = std::atoi(value.c_str());
+            else if (argument == "--clusters")      options.data.numClusters = std::atoi(value.c_str());
+            else if (argument == "--skew")          options.data.densitySkew = std::atof(value.c_str());
+            else if (argument == "--spread")        options.data.clusterSpread = std::atof(value.c_str());
+            else if (argument == "--seed")          options.data.seed = std::atoi(value.c_str());
+            else if (argument == "--radius")        options.radius = std::atof(value.c_str());
+            else if (argument == "--repetitions")   options.repetitions = std::max(1, std::atoi(value.c_str()));
+            else if (argument == "--threads")       options.threadCounts = parseList(value);
+            else if (argument == "--output")        options.outputPath = value;
+            else if (argument == "--trace-output")  options.traceOutputPath = value;
+            else if (argument == "--memory-budget") options.memoryBudget = std::max(0, std::atoi(value.c_str()));
+            else if (argument == "--neighbour-cap") options.neighbourCap = std::max(0, std::atoi(value.c_str()));
+            else if (argument == "--landmarks")     options.numLandmarks = std::max(1, std::atoi(value.c_str()));
+            else if (argument == "--adaptive-neighbours") options.adaptiveNeighbours = std::max(1, std::atoi(value.c_str()));
+            else if (argument == "--moved-fraction") options.movedFraction = std::clamp(static_cast<float>(std::atof(value.c_str())), 0.0f, 1.0f);
+            else if (argument == "--density")       options.density = std::clamp(static_cast<float>(std::atof(value.c_str())), 0.0f, 1.0f);
+            else if (argument == "--top-k")         options.topK = std::max(1, std::atoi(value.c_str()));
+            else if (argument == "--point-order")   options.mortonOrder = value == "morton";
+            else
+            {
+                std::cerr << "Unknown argument " << argument << std::endl;
+                return false;
+            }
+        }
+
+        // By default scale from one thread up to all threads in powers of two
+        if (options.threadCounts.empty())
+        {
+            for (int t = 1; t < getMaxThreads(); t *= 2)
+                options.threadCounts.push_back(t);
+            options.threadCounts.push_back(getMaxThreads());
+        }
+
+        return true;
+    }
+
+    KernelResult timeKernel(const std::string& name, int numThreads, int repetitions, const std::function<void()>& kernel)
+    {
+        KernelResult result{ name, numThreads, {}, 0 };
+
+        for (int r = 0; r < repetitions; r++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+
+            kernel();
+
+            auto finish = std::chrono::high_resolution_clock::now();
+            result.times.push_back(std::chrono::duration<double>(finish - start).count());
+        }
+
+        result.peakRss = getPeakResidentSetSize();
+
+        return result;
+    }
+
+    void writeReport(std::ostream& stream, const Options& options, const ExplanationCore& core, const NeighbourhoodSizes& fixedSizes, const NeighbourhoodSizes& adaptiveSizes, const StreamingUpdate& streamingUpdate, std::size_t topRanksBytes, float prunedFraction, std::vector<KernelResult>& results)
+    {
+        // Single threaded (or lowest thread count) median per kernel as baseline for the speedup
+        std::map<std::string, double> baselines;
+        for (KernelResult& result : results)
+        {
+            double median = percentile(result.times, 50);
+            if (baselines.find(result.kernel) == baselines.end())
+                baselines[result.kernel] = median;
+        }
+
+        JsonWriter json(stream);
+
+        json.beginObject();
+        json.value("benchmark", "explanation-kernels");
+
+        json.beginObject("parameters");
+        json.value("numPoints", options.data.numPoints);
+        json.value("numDimensions", options.data.numDimensions);
+        json.value("numClusters", options.data.numClusters);
+        json.value("densitySkew", options.data.densitySkew);
+        json.value("clusterSpread", options.data.clusterSpread);
+        json.value("radius", options.radius);
+        json.value("repetitions", options.repetitions);
+        json.value("seed", static_cast<long long>(options.data.seed));
+        json.value("density", options.density);
+        json.value("pointOrder", options.mortonOrder ? "morton" : "original");
+        json.value("sparse", core.getDataset().isSparse());
+        json.value("nonZeros", static_cast<long long>(core.getDataset().numNonZeros()));
+        json.endObject();
+
+        json.value("maxThreads", getMaxThreads());
+        json.value("meanNeighbourhoodSize", fixedSizes.mean);
+        json.value("maxNeighbourhoodSize", fixedSizes.max);
+
+        // Neighbourhoods with the radius of every point at its k-th nearest neighbour distance
+        json.beginObject("adaptive");
+        json.value("neighbours", options.adaptiveNeighbours);
+        json.value("meanNeighbourhoodSize", adaptiveSizes.mean);
+        json.value("maxNeighbourhoodSize", adaptiveSizes.max);
+        json.endObject();
+
+        const MemoryUsage memoryUsage = core.getMemoryUsage();
+
+        json.beginObject("memory");
+        json.value("budgetBytes", core.getMemoryBudget());
+        json.value("neighbourhoodStride", core.getNeighbourhoodStride());
+        json.value("neighbourCap", core.getNeighbourCap());
+        json.value("sampledPoints", core.getSamplingError().numSampledPoints);
+        json.value("meanSamplingError", core.getSamplingError().meanError);
+        json.value("maxSamplingError", core.getSamplingError().maxError);
+        json.value("estimatedExactNeighbourhoodBytes", core.getEstimatedNeighbourhoodMemory());
+        json.value("datasetBytes", memoryUsage.dataset);
+        json.value("neighbourhoodBytes", memoryUsage.neighbourhoods);
+        json.value("confidenceNeighbourhoodBytes", memoryUsage.confidenceNeighbourhoods);
+        json.value("localStatisticsBytes", memoryUsage.localStatistics);
+        json.value("rankMatrixBytes", memoryUsage.rankMatrix);
+        json.value("topK", options.topK);
+        json.value("topRanksBytes", topRanksBytes);
+        json.value("totalBytes", memoryUsage.total());
+        json.endObject();
+
+        // Share of the statistics skipped by the pruned top ranks
+        json.beginObject("pruning");
+        json.value("topK", options.topK);
+        json.value("prunedFraction", prunedFraction);
+        json.endObject();
+
+        // Balance of the per-point loops over the neighbourhoods, independent of the cores of this machine
+        const NeighbourhoodMatrix& neighbourhoodMatrix = core.getNeighbourhoodMatrix();
+        const int numPoints = static_cast<int>(neighbourhoodMatrix.size());
+
+        json.beginArray("scheduling");
+        for (const int numThreads : { 8, 64 })
+        {
+            // The static schedule gives every thread one range of equally many points
+            std::vector<int> staticChunks(numThreads + 1);
+            for (int t = 0; t <= numThreads; t++)
+                staticChunks[t] = static_cast<int>(static_cast<std::int64_t>(numPoints) * t / numThreads);
+
+            const std::vector<int> balancedChunks = parallel::partitionByCost(neighbourhoodMatrix, numThreads * parallel::CHUNKS_PER_THREAD);
+
+            json.beginObject();
+            json.value("threads", numThreads);
+            json.value("staticImbalance", measureImbalance(neighbourhoodMatrix, staticChunks, numThreads));
+            json.value("balancedImbalance", measureImbalance(neighbourhoodMatrix, balancedChunks, numThreads));
+            json.endObject();
+        }
+        json.endArray();
+
+        // Approximation quality of the landmark explanation of the last run
+        const std::vector<float>& quality = core.getLandmarkExplanation().getQuality();
+
+        json.beginObject("landmarks");
+        json.value("numLandmarks", core.getLandmarkExplanation().numLandmarks());
+        json.value("meanQuality", quality.empty() ? 0.0 : std::accumulate(quality.begin(), quality.end(), 0.0) / quality.size());
+        json.value("bytes", memoryUsage.landmarks);
+        json.endObject();
+
+        // Extent of the last streaming update
+        json.beginObject("streaming");
+        json.value("movedFraction", options.movedFraction);
+        json.value("movedPoints", streamingUpdate.numMoved);
+        json.value("affectedPoints", streamingUpdate.numAffected);
+        json.value("fullRecompute", streamingUpdate.fullRecompute);
+        json.endObject();
+
+        json.beginArray("results");
+        for (KernelResult& result : results)
+        {
+            double median = percentile(result.times, 50);
+
+            json.beginObject();
+            json.value("kernel", result.kernel);
+            json.value("threads", result.numThreads);
+            json.value("medianSeconds", median);
+            json.value("minSeconds", percentile(result.times, 0));
+            json.value("maxSeconds", percentile(result.times, 100));
+            json.value("pointsPerSecond", median > 0 ? options.data.numPoints / median : 0.0);
+            json.value("speedup", median > 0 ? baselines[result.kernel] / median : 0.0);
+            json.value("peakRssBytes", result.peakRss);
+            json.endObject();
+        }
+        json.endArray();
+
+        json.endObject();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseArguments(argc, argv, options))
+        return EXIT_FAILURE;
+
+    DataMatrix data;
+    DataMatrix projection;
+    std::vector<int> labels;
+    generateGaussianMixture(options.data, data, projection, &labels);
+
+    // The plugin stores the points in the Morton order of the projection, the generated points are in random order
+    if (options.mortonOrder)
+    {
+        PointOrder pointOrder;
+        pointOrder.computeMorton(projection, 0, 1);
+
+        data = pointOrder.permuteRows(data);
+        projection = pointOrder.permuteRows(projection);
+        labels = pointOrder.toInternalOrder(labels);
+    }
+
+    tracing::setEnabled(!options.traceOutputPath.empty());
+
+    ExplanationCore core;
+    core.setMemoryBudget(static_cast<std::size_t>(options.memoryBudget) * 1024 * 1024);
+    core.setNeighbourCap(options.neighbourCap, options.data.seed);
+    // Below full density the data is stored sparse, so the statistics kernels only visit the non-zeros
+    if (options.density < 1)
+    {
+        SparseDataMatrix sparseData = sparsify(data, options.density, options.data.seed);
+        core.setData(sparseData, projection);
+    }
+    else
+    {
+        core.setData(data, projection);
+    }
+
+    core.recomputeNeighbourhood(options.radius, 0, 1);
+
+    const NeighbourhoodMatrix& neighbourhoodMatrix = core.getNeighbourhoodMatrix();
+
+    const NeighbourhoodSizes fixedSizes = measureNeighbourhoods(neighbourhoodMatrix);
+
+    // The grid and the nearest neighbour distances of the adaptive radii are built once
+    SpatialGrid grid;
+    grid.build(core.getProjection(), 0, 1);
+
+    std::vector<float> nearestDistances;
+    computeNearestNeighbourDistances(core.getProjection(), grid, options.adaptiveNeighbours, 0, 1, nearestDistances);
+
+    NeighbourhoodMatrix adaptiveNeighbourhoods;
+    computeNeighbourhoodMatrix(core.getProjection(), grid, adaptiveNeighbourhoods, nearestDistances, 1.0f, 0, 1);
+
+    const NeighbourhoodSizes adaptiveSizes = measureNeighbourhoods(adaptiveNeighbourhoods);
+
+    adaptiveNeighbourhoods = NeighbourhoodMatrix();
+
+    // The lens selection used for ranking a selection is the neighbourhood of the first point
+    const std::vector<unsigned int> selection(neighbourhoodMatrix[0].begin(), neighbourhoodMatrix[0].end());
+
+    const float radius = computeProjectionDiameter(core.getProjection(), 0, 1) * options.radius;
+
+    // Multi-scale ladder of ten radii up to the benchmark radius
+    std::vector<float> scaleRadii(10);
+    for (int l = 0; l < static_cast<int>(scaleRadii.size()); l++)
+        scaleRadii[l] = options.radius * (l + 1) / scaleRadii.size();
+
+    const DataMatrix movedProjection = movePoints(projection, options.movedFraction, options.data.seed);
+
+    StreamingUpdate streamingUpdate;
+
+    std::size_t topRanksBytes = 0;
+    float prunedFraction = 0;
+
+    std::vector<KernelResult> results;
+
+    for (const int numThreads : options.threadCounts)
+    {
+        setNumThreads(numThreads);
+
+        NeighbourhoodMatrix scratchNeighbourhoods;
+        DataMatrix dimRanks;
+        std::vector<float> selectionRanking(core.getDataset().numDimensions());
+
+        results.push_back(timeKernel("computeNeighbourhoodMatrix", numThreads, options.repetitions, [&]() {
+            computeNeighbourhoodMatrix(core.getProjection(), scratchNeighbourhoods, radius, 0, 1);
+        }));
+
+        results.push_back(timeKernel("computeNearestNeighbourDistances", numThreads, options.repetitions, [&]() {
+            computeNearestNeighbourDistances(core.getProjection(), grid, options.adaptiveNeighbours, 0, 1, nearestDistances);
+        }));
+
+        results.push_back(timeKernel("computeNeighbourhoodMatrix (adaptive)", numThreads, options.repetitions, [&]() {
+            computeNeighbourhoodMatrix(core.getProjection(), grid, scratchNeighbourhoods, nearestDistances, 1.0f, 0, 1);
+        }));
+
+        core.setExplanationMetric(Explanation::Metric::VARIANCE);
+
+        results.push_back(timeKernel("precomputeLocalVariances", numThreads, options.repetitions, [&]() {
+            core.recomputeMetrics();
+        }));
+
+        // Streaming updates alternate between the two projections, so every run moves the same points; the
+        // neighbourhoods are recomputed first to restart the count of incremental updates
+        core.recomputeNeighbourhood(options.radius, 0, 1);
+        core.recomputeMetrics();
+
+        bool moved = false;
+
+        results.push_back(timeKernel("ExplanationCore::updateProjection", numThreads, options.repetitions, [&]() {
+            moved = !moved;
+            core.updateProjection(moved ? movedProjection : projection);
+        }));
+
+        streamingUpdate = core.getLastStreamingUpdate();
+
+        if (moved)
+            core.updateProjection(projection);
+
+        results.push_back(timeKernel("computeDimensionRanks", numThreads, options.repetitions, [&]() {
+            core.computeDimensionRanks(dimRanks);
+        }));
+
+        results.push_back(timeKernel("computeConfidences", numThreads, options.repetitions, [&]() {
+            core.computeConfidences(dimRanks);
+        }));
+
+        results.push_back(timeKernel("ColorMapping::recompute", numThreads, options.repetitions, [&]() {
+            core.recomputeColorMapping(dimRanks);
+        }));
+
+        results.push_back(timeKernel("computeSelectionRanks", numThreads, options.repetitions, [&]() {
+            core.computeDimensionRanks(selectionRanking, selection);
+        }));
+
+        results.push_back(timeKernel("computeLocalPCARanks (cold)", numThreads, options.repetitions, [&]() {
+            core.computeLocalPCARanks(selectionRanking, selection, false);
+        }));
+
+        // Warm started from the components of the previous repetition, like a lens that moves a little
+        results.push_back(timeKernel("computeLocalPCARanks (warm)", numThreads, options.repetitions, [&]() {
+            core.computeLocalPCARanks(selectionRanking, selection, true);
+        }));
+
+        results.push_back(timeKernel("MultiScaleExplanation::compute", numThreads, options.repetitions, [&]() {
+            core.recomputeMultiScale(scaleRadii, 0, 1);
+        }));
+
+        core.clearMultiScale();
+
+        // Cluster mode explains the mixture components, the statistics pass is timed by resetting the clusters
+        results.push_back(timeKernel("ClusterExplanation::compute", numThreads, options.repetitions, [&]() {
+            core.setClusters(labels, options.data.numClusters);
+            core.recomputeClusterExplanation();
+        }));
+
+        core.clearClusters();
+
+        // The landmarks are chosen by the first run and kept, the timing is that of a radius change
+        LandmarkParameters landmarkParameters;
+        landmarkParameters.numLandmarks = options.numLandmarks;
+        landmarkParameters.seed = options.data.seed;
+        core.setLandmarkParameters(landmarkParameters);
+
+        results.push_back(timeKernel("LandmarkExplanation::compute", numThreads, options.repetitions, [&]() {
+            core.recomputeLandmarkExplanation(options.radius, 0, 1);
+        }));
+
+        // Only the top ranked dimensions of every point are kept, instead of the local variances and the rank matrix
+        core.setExplanationMetric(Explanation::Metric::VARIANCE);
+        core.setTopK(options.topK);
+
+        results.push_back(timeKernel("TopRanks::compute", numThreads, options.repetitions, [&]() {
+            core.recomputeMetrics();
+        }));
+
+        results.push_back(timeKernel("computeConfidences (top ranks)", numThreads, options.repetitions, [&]() {
+            core.computeConfidences(core.getTopRanks());
+        }));
+
+        topRanksBytes = core.getMemoryUsage().topRanks;
+
+        // The same top ranks, skipping the dimensions that cannot enter the top K of any point of their cell
+        core.setDimensionPruning(true);
+
+        results.push_back(timeKernel("TopRanks::computePruned", numThreads, options.repetitions, [&]() {
+            core.recomputeMetrics();
+        }));
+
+        prunedFraction = core.getTopRanks().getPrunedFraction();
+
+        core.setDimensionPruning(false);
+        core.setTopK(0);
+
+        core.setExplanationMetric(Explanation::Metric::VALUE);
+
+        results.push_back(timeKernel("precomputeLocalValues", numThreads, options.repetitions, [&]() {
+            core.recomputeMetrics();
+        }));
+    }
+
+    if (options.outputPath.empty())
+    {
+        writeReport(std::cout, options, core, fixedSizes, adaptiveSizes, streamingUpdate, topRanksBytes, prunedFraction, results);
+    }
+    else
+    {
+        std::ofstream file(options.outputPath);
+        if (!file)
+        {
+            std::cerr << "Could not open " << options.outputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        writeReport(file, options, core, fixedSizes, adaptiveSizes, streamingUpdate, topRanksBytes, prunedFraction, results);
+    }
+
+    if (!options.traceOutputPath.empty() && !tracing::writeChromeTrace(options.traceOutputPath))
+    {
+        std::cerr << "Could not write trace " << options.traceOutputPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
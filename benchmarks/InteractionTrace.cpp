@@ -0,0 +1,139 @@
+#include "InteractionTrace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+const char* getEventTypeName(InteractionEvent::Type type)
+{
+    switch (type)
+    {
+    case InteractionEvent::Type::LENS: return "lens";
+    case InteractionEvent::Type::WHEEL: return "wheel";
+    case InteractionEvent::Type::SLIDER: return "slider";
+    }
+
+    return "unknown";
+}
+
+bool readTrace(std::istream& stream, InteractionTrace& trace, std::string& error)
+{
+    trace.clear();
+
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+
+        std::istringstream lineStream(line);
+
+        InteractionEvent event{ 0, InteractionEvent::Type::LENS, 0, 0 };
+        std::string type;
+
+        if (!(lineStream >> event.time))
+        {
+            // Skip empty lines and comments
+            std::string rest;
+            std::istringstream(line) >> rest;
+            if (rest.empty() || rest[0] == '#')
+                continue;
+
+            error = "line " + std::to_string(lineNumber) + ": expected a time stamp";
+            return false;
+        }
+
+        lineStream >> type;
+
+        bool valid = false;
+        if (type == "lens")
+        {
+            event.type = InteractionEvent::Type::LENS;
+            valid = static_cast<bool>(lineStream >> event.x >> event.y);
+        }
+        else if (type == "wheel")
+        {
+            event.type = InteractionEvent::Type::WHEEL;
+            valid = static_cast<bool>(lineStream >> event.x);
+        }
+        else if (type == "slider")
+        {
+            event.type = InteractionEvent::Type::SLIDER;
+            valid = static_cast<bool>(lineStream >> event.x);
+        }
+
+        if (!valid)
+        {
+            error = "line " + std::to_string(lineNumber) + ": malformed event '" + line + "'";
+            return false;
+        }
+
+        trace.push_back(event);
+    }
+
+    std::stable_sort(trace.begin(), trace.end(), [](const InteractionEvent& a, const InteractionEvent& b) { return a.time < b.time; });
+
+    return true;
+}
+
+void writeTrace(std::ostream& stream, const InteractionTrace& trace)
+{
+    stream << "# time(ms) type values\n";
+
+    for (const InteractionEvent& event : trace)
+    {
+        stream << event.time << " " << getEventTypeName(event.type) << " " << event.x;
+
+        if (event.type == InteractionEvent::Type::LENS)
+            stream << " " << event.y;
+
+        stream << "\n";
+    }
+}
+
+InteractionTrace generateTrace(double duration, std::uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> jitter(-1.0, 1.0);
+
+    InteractionTrace trace;
+
+    const double pi = 3.14159265358979323846;
+
+    // Lens drag sampled by a 120 Hz mouse
+    const double mouseInterval = 1000.0 / 120.0;
+    for (double t = 0; t < duration; t += mouseInterval)
+    {
+        double phase = 2 * pi * t / duration;
+
+        float x = static_cast<float>(0.5 + 0.4 * std::sin(2 * phase));
+        float y = static_cast<float>(0.5 + 0.4 * std::sin(3 * phase));
+
+        trace.push_back({ std::max(0.0, t + jitter(rng)), InteractionEvent::Type::LENS, x, y });
+    }
+
+    // Bursts of wheel steps, first enlarging then shrinking the lens
+    for (int burst = 0; burst < 4; burst++)
+    {
+        double start = duration * (burst + 0.5) / 4;
+        float steps = burst % 2 == 0 ? 1.0f : -1.0f;
+
+        for (int step = 0; step < 5; step++)
+            trace.push_back({ start + step * 20 + jitter(rng), InteractionEvent::Type::WHEEL, steps, 0 });
+    }
+
+    // Slider sweep from 10 up to 20 and back after the drag, ticking at 60 Hz
+    const double sliderInterval = 1000.0 / 60.0;
+    double t = duration + 100;
+    for (int value = 11; value <= 20; value++, t += sliderInterval)
+        trace.push_back({ t, InteractionEvent::Type::SLIDER, static_cast<float>(value), 0 });
+    for (int value = 19; value >= 10; value--, t += sliderInterval)
+        trace.push_back({ t, InteractionEvent::Type::SLIDER, static_cast<float>(value), 0 });
+
+    std::stable_sort(trace.begin(), trace.end(), [](const InteractionEvent& a, const InteractionEvent& b) { return a.time < b.time; });
+
+    return trace;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/**
+ * Recorded user interaction with the projection explorer
+ *
+ * A trace is a text file with one event per line, ordered by time:
+ *
+ *     <time ms> lens <x> <y>       Lens moved to (x, y), normalized to the projection bounds
+ *     <time ms> wheel <steps>      Mouse wheel turned by a number of steps (positive enlarges the lens)
+ *     <time ms> slider <value>     Neighbourhood radius slider set to value (0-50)
+ *
+ * Empty lines and lines starting with # are ignored.
+ */
+struct InteractionEvent
+{
+    enum class Type
+    {
+        LENS,
+        WHEEL,
+        SLIDER
+    };
+
+    double  time;   /** Time at which the event arrives (ms) */
+    Type    type;   /** Type of the event */
+    float   x;      /** Lens x-coordinate, wheel steps or slider value */
+    float   y;      /** Lens y-coordinate */
+};
+
+using InteractionTrace = std::vector<InteractionEvent>;
+
+/** Get the name of an event type as used in traces and reports */
+const char* getEventTypeName(InteractionEvent::Type type);
+
+/**
+ * Read a trace from \p stream
+ * @return Whether the trace could be parsed, on failure \p error describes the offending line
+ */
+bool readTrace(std::istream& stream, InteractionTrace& trace, std::string& error);
+
+/** Write \p trace to \p stream in the text format */
+void writeTrace(std::ostream& stream, const InteractionTrace& trace);
+
+/**
+ * Generate a representative trace: a lens dragged along a Lissajous path with a 120 Hz mouse,
+ * bursts of wheel steps while dragging, and a radius slider sweep at 60 Hz
+ * @param duration Length of the drag in milliseconds
+ * @param seed Seed of the random jitter
+ */
+InteractionTrace generateTrace(double duration, std::uint32_t seed);
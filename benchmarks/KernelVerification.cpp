@@ -0,0 +1,1304 @@
+#include "SyntheticData.h"
+#include "ReferenceKernels.h"
+
+#include "Explanation/ExplanationCore.h"
+#include "Explanation/Neighbourhood.h"
+#include "Explanation/PointOrder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Correctness oracle for the explanation kernels
+ *
+ * Runs the production kernels of the explanation core on randomised datasets (varying size,
+ * dimensionality, cluster skew and radius, with constant dimensions, duplicate points and
+ * excluded dimensions mixed in) and compares them against the reference implementations.
+ * Exact kernels must agree up to a tolerance for floating-point reassociation, approximate
+ * modes must stay within their stated error bounds. Exits with a non-zero status on failure,
+ * needs no display or GPU.
+ *
+ * Usage: KernelVerification [--datasets N] [--seed S] [--verbose]
+ */
+namespace
+{
+    /** Relative tolerance for kernels that only differ in the order of floating-point operations */
+    constexpr double REASSOCIATION_TOLERANCE = 1e-4;
+
+    /** Absolute tolerance for values close to zero */
+    constexpr double ABSOLUTE_TOLERANCE = 1e-6;
+
+    /** Bound on the ratio between estimated and exact neighbourhood entries */
+    constexpr double ESTIMATE_RATIO_BOUND = 2.0;
+
+    /** Sampled local means must lie within this many estimated standard errors of the exact means... */
+    constexpr double SAMPLING_ERROR_BOUND = 4.0;
+
+    /** ...except for this fraction of the points and dimensions (a 4 sigma deviation is rare but not impossible) */
+    constexpr double SAMPLING_OUTLIER_FRACTION = 0.005;
+
+    /** Fraction of the points whose multi-scale top dimension must match the per-radius explanation (prefix sums reassociate the statistics, which can flip near-ties) */
+    constexpr double MULTI_SCALE_AGREEMENT = 0.99;
+
+    /** Bound on the mean difference between multi-scale (quantized) and per-radius confidences */
+    constexpr double MULTI_SCALE_CONFIDENCE_ERROR = 0.01;
+
+    /**
+     * Relative tolerance of the cluster ranks: the reference sums hundreds of members in single precision,
+     * and the value ranks subtract the global mean from the cluster mean, which amplifies that rounding
+     */
+    constexpr double CLUSTER_RANK_TOLERANCE = 1e-2;
+
+    /** Fraction of the clustered points whose cluster top dimension must match the reference (the statistics are reassociated as for the multi-scale levels) */
+    constexpr double CLUSTER_AGREEMENT = 0.99;
+
+    /**
+     * Tolerances of the landmark ranks, accumulated in double precision against the single-precision reference like the
+     * cluster ranks; the absolute tolerance covers the near-zero value ranks, where the rounding of the reference dominates
+     */
+    constexpr double LANDMARK_RANK_TOLERANCE = 1e-2;
+    constexpr double LANDMARK_RANK_ABSOLUTE_TOLERANCE = 1e-4;
+
+    /** Fraction of the points whose top dimension must match the reference when every point is a landmark */
+    constexpr double LANDMARK_AGREEMENT = 0.99;
+
+    /**
+     * Tolerances of the ranks after streaming updates: the downdated and updated statistics are accumulated in a
+     * different order than the recomputed ones, and the downdates cancel, which costs precision on small variances;
+     * the value ranks subtract the global mean, which amplifies the difference as for the clusters, and the absolute
+     * tolerance covers the near-zero value ranks, as for the landmarks
+     */
+    constexpr double STREAMING_RANK_TOLERANCE = 1e-3;
+    constexpr double STREAMING_VALUE_RANK_TOLERANCE = 1e-2;
+    constexpr double STREAMING_RANK_ABSOLUTE_TOLERANCE = 1e-4;
+
+    /** Number of successive streaming updates, the rounding of the statistics accumulates over them */
+    constexpr int NUM_STREAMING_UPDATES = 3;
+
+    /**
+     * Tolerances of the local PCA eigenvalues: the subspace iteration stops once the residuals of the components are
+     * below 1e-3 of the largest variance, the absolute tolerance (relative to the largest eigenvalue) covers the small
+     * trailing components
+     */
+    constexpr double LOCAL_PCA_TOLERANCE = 1e-2;
+    constexpr double LOCAL_PCA_ABSOLUTE_TOLERANCE = 1e-3;
+
+    /** Tolerance of the sparse value ranks, accumulated in double precision against the single-precision reference like the cluster ranks */
+    constexpr double SPARSE_VALUE_RANK_TOLERANCE = 1e-2;
+
+    /** Tolerances of the top ranks, accumulated in double precision against the single-precision reference like the landmark ranks */
+    constexpr double TOP_RANK_TOLERANCE = 1e-2;
+    constexpr double TOP_RANK_ABSOLUTE_TOLERANCE = 1e-4;
+
+    /** Number of top ranked dimensions kept per point, and the block size, smaller than most dimensionalities so the blocks are merged */
+    constexpr int TOP_RANK_K = 3;
+    constexpr int TOP_RANK_BLOCK_SIZE = 5;
+
+    /** Fraction of the points whose top dimension must match the reference (the statistics are reassociated, which can flip near-ties) */
+    constexpr double TOP_RANK_AGREEMENT = 0.99;
+
+    /** Bound on the mean difference between the confidences from the top ranks and from the full rank matrix */
+    constexpr double TOP_RANK_CONFIDENCE_ERROR = 0.01;
+
+    /** Tolerance of the pruned top scores, the same statistics as the unpruned ones up to the rounding of their normalization */
+    constexpr double PRUNED_SCORE_TOLERANCE = 1e-5;
+
+    struct Options
+    {
+        int             numDatasets = 12;
+        std::uint32_t   seed        = 1;
+        bool            verbose     = false;
+    };
+
+    class Verifier
+    {
+    public:
+        Verifier(bool verbose) : _verbose(verbose), _numChecks(0), _numFailures(0) { }
+
+        void check(const std::string& name, bool passed, const std::string& detail = "")
+        {
+            _numChecks++;
+
+            if (!passed)
+                _numFailures++;
+
+            if (!passed || _verbose)
+                std::cout << (passed ? "  PASS " : "  FAIL ") << name << (detail.empty() ? "" : ": " + detail) << std::endl;
+        }
+
+        /** Compare two arrays element-wise, NaN only matches NaN */
+        template<typename A, typename B>
+        void compare(const std::string& name, const A& actual, const B& expected, std::size_t size, double relativeTolerance, double absoluteTolerance = ABSOLUTE_TOLERANCE)
+        {
+            double maxError = 0;
+            std::size_t numMismatches = 0;
+            std::size_t firstMismatch = 0;
+
+            for (std::size_t i = 0; i < size; i++)
+            {
+                const double a = actual[i];
+                const double e = expected[i];
+
+                if (std::isnan(a) || std::isnan(e))
+                {
+                    if (std::isnan(a) != std::isnan(e) && numMismatches++ == 0)
+                        firstMismatch = i;
+                    continue;
+                }
+
+                const double error = std::abs(a - e);
+                maxError = std::max(maxError, error / std::max(1e-30, std::max(std::abs(a), std::abs(e))));
+
+                if (error > absoluteTolerance + relativeTolerance * std::max(std::abs(a), std::abs(e)) && numMismatches++ == 0)
+                    firstMismatch = i;
+            }
+
+            std::ostringstream detail;
+            detail << "max relative error " << maxError;
+            if (numMismatches > 0)
+                detail << ", " << numMismatches << " mismatches, first at " << firstMismatch << " (" << actual[firstMismatch] << " vs " << expected[firstMismatch] << ")";
+
+            check(name, numMismatches == 0, detail.str());
+        }
+
+        int getNumChecks() const { return _numChecks; }
+        int getNumFailures() const { return _numFailures; }
+
+    private:
+        bool    _verbose;
+        int     _numChecks;
+        int     _numFailures;
+    };
+
+    bool parseArguments(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+
+            if (argument == "--verbose")
+            {
+                options.verbose = true;
+                continue;
+            }
+
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << argument << std::endl;
+                return false;
+            }
+
+            std::string value = argv[++i];
+
+            if (argument == "--datasets")   options.numDatasets = std::max(1, std::atoi(value.c_str()));
+            else if (argument == "--seed")  options.seed = std::atoi(value.c_str());
+            else
+            {
+                std::cerr << "Unknown argument " << argument << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /** Flatten the per-point ranks of the core and the reference in the same order */
+    std::vector<float> flatten(const DataMatrix& matrix)
+    {
+        return std::vector<float>(matrix.data(), matrix.data() + matrix.size());
+    }
+
+    /** Verify the capped neighbourhoods against the exact ones and their local means against the sampling error estimate */
+    void verifyReservoirSampling(Verifier& verifier, const DataMatrix& data, const DataMatrix& projection, float radius, const NeighbourhoodMatrix& neighbourhoodMatrix, int maxNeighbours)
+    {
+        NeighbourhoodSampling sampling;
+        sampling.maxNeighbours = maxNeighbours;
+        sampling.seed = 7;
+
+        NeighbourhoodMatrix sampled;
+        std::vector<int> numCandidates;
+        computeNeighbourhoodMatrix(projection, sampled, radius, 0, 1, sampling, &numCandidates);
+
+        NeighbourhoodMatrix resampled;
+        computeNeighbourhoodMatrix(projection, resampled, radius, 0, 1, sampling);
+
+        int numInvalid = 0;
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            const Neighbourhood& exact = neighbourhoodMatrix[i];
+            const Neighbourhood& neighbourhood = sampled[i];
+
+            const bool validSize = neighbourhood.size() == std::min<std::size_t>(maxNeighbours, exact.size()) && numCandidates[i] == static_cast<int>(exact.size());
+            const bool validSubset = std::is_sorted(neighbourhood.begin(), neighbourhood.end()) && std::includes(exact.begin(), exact.end(), neighbourhood.begin(), neighbourhood.end());
+            const bool hasCenter = std::binary_search(neighbourhood.begin(), neighbourhood.end(), i);
+
+            if (!validSize || !validSubset || !hasCenter)
+                numInvalid++;
+        }
+
+        verifier.check("capped neighbourhoods (cap " + std::to_string(maxNeighbours) + ")", numInvalid == 0, std::to_string(numInvalid) + " invalid neighbourhoods");
+        verifier.check("capped neighbourhoods are reproducible", sampled == resampled);
+
+        // Local means of the sampled neighbourhoods against the exact ones, in units of the estimated standard error
+        std::size_t numComparisons = 0;
+        std::size_t numOutliers = 0;
+        double maxDeviation = 0;
+
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            const Neighbourhood& exact = neighbourhoodMatrix[i];
+            const Neighbourhood& neighbourhood = sampled[i];
+
+            const float samplingError = computeSamplingError(static_cast<int>(exact.size()), static_cast<int>(neighbourhood.size()));
+
+            if (samplingError <= 0)
+                continue;
+
+            for (int j = 0; j < data.cols(); j++)
+            {
+                double exactMean = 0, exactSquares = 0, sampledMean = 0;
+                for (const int n : exact) { exactMean += data(n, j); exactSquares += data(n, j) * data(n, j); }
+                for (const int n : neighbourhood) sampledMean += data(n, j);
+
+                exactMean /= exact.size();
+                sampledMean /= neighbourhood.size();
+
+                const double deviation = std::sqrt(std::max(0.0, exactSquares / exact.size() - exactMean * exactMean));
+                const double error = std::abs(sampledMean - exactMean);
+
+                numComparisons++;
+
+                if (deviation == 0)
+                {
+                    numOutliers += error > ABSOLUTE_TOLERANCE ? 1 : 0;
+                    continue;
+                }
+
+                maxDeviation = std::max(maxDeviation, error / (samplingError * deviation));
+
+                if (error > SAMPLING_ERROR_BOUND * samplingError * deviation + ABSOLUTE_TOLERANCE)
+                    numOutliers++;
+            }
+        }
+
+        const double outlierFraction = numComparisons > 0 ? static_cast<double>(numOutliers) / numComparisons : 0.0;
+
+        verifier.check("sampled local means within the error estimate", outlierFraction <= SAMPLING_OUTLIER_FRACTION, std::to_string(numOutliers) + "/" + std::to_string(numComparisons) + " beyond " + std::to_string(SAMPLING_ERROR_BOUND) + " standard errors, largest " + std::to_string(maxDeviation));
+    }
+
+    void verifyNeighbourhoods(Verifier& verifier, const DataMatrix& projection, float radius, const NeighbourhoodMatrix& neighbourhoodMatrix)
+    {
+        int numMismatches = 0;
+        double exactEntries = 0;
+
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            const Neighbourhood expected = reference::findNeighbourhood(projection, i, radius);
+
+            exactEntries += expected.size();
+
+            if (neighbourhoodMatrix[i] != expected)
+                numMismatches++;
+        }
+
+        verifier.check("neighbourhoods", numMismatches == 0, std::to_string(numMismatches) + " points differ");
+
+        // Sampled neighbourhoods are the exact neighbourhoods restricted to the residue class of the center
+        for (const int stride : { 2, 7 })
+        {
+            NeighbourhoodSampling sampling;
+            sampling.stride = stride;
+
+            NeighbourhoodMatrix sampled;
+            computeNeighbourhoodMatrix(projection, sampled, radius, 0, 1, sampling);
+
+            int numSampledMismatches = 0;
+            for (int i = 0; i < projection.rows(); i++)
+            {
+                Neighbourhood expected;
+                for (const int n : neighbourhoodMatrix[i])
+                    if (n % stride == i % stride)
+                        expected.push_back(n);
+
+                if (sampled[i] != expected)
+                    numSampledMismatches++;
+            }
+
+            verifier.check("sampled neighbourhoods (stride " + std::to_string(stride) + ")", numSampledMismatches == 0, std::to_string(numSampledMismatches) + " points differ");
+        }
+
+        const double estimatedEntries = estimateNeighbourhoodEntries(projection, radius, 0, 1);
+        const double ratio = estimatedEntries / exactEntries;
+
+        verifier.check("neighbourhood size estimate", ratio <= ESTIMATE_RATIO_BOUND && ratio >= 1.0 / ESTIMATE_RATIO_BOUND, "estimated/exact " + std::to_string(ratio));
+    }
+
+    /** Verify the nearest neighbour distances and the adaptive neighbourhoods against brute force searches */
+    void verifyAdaptiveRadii(Verifier& verifier, const DataMatrix& projection, int k, int maxNeighbours)
+    {
+        ExplanationCore core;
+        DataMatrix data = DataMatrix::Zero(projection.rows(), 1);
+        DataMatrix coreProjection = projection;
+        core.setData(data, coreProjection);
+        core.setAdaptiveRadius(k, 1.5f);
+        core.recomputeNeighbourhood(0, 0, 1);
+
+        const std::vector<float>& distances = core.getNearestNeighbourDistances();
+        const NeighbourhoodMatrix& neighbourhoodMatrix = core.getNeighbourhoodMatrix();
+
+        std::vector<float> expectedDistances(projection.rows());
+        int numMismatches = 0, numSmall = 0;
+
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            expectedDistances[i] = reference::findKthNearestDistance(projection, i, k);
+
+            if (neighbourhoodMatrix[i] != reference::findNeighbourhood(projection, i, expectedDistances[i] * 1.5f))
+                numMismatches++;
+
+            // The neighbourhood holds at least the k nearest neighbours and the center
+            if (neighbourhoodMatrix[i].size() < std::min<std::size_t>(k + 1, projection.rows()))
+                numSmall++;
+        }
+
+        verifier.compare("nearest neighbour distances (k " + std::to_string(k) + ")", distances, expectedDistances, distances.size(), 0);
+        verifier.check("adaptive neighbourhoods", numMismatches == 0, std::to_string(numMismatches) + " points differ");
+        verifier.check("adaptive neighbourhood sizes", numSmall == 0, std::to_string(numSmall) + " smaller than k + 1");
+
+        // Grid searches draw the same sample as the exhaustive search
+        NeighbourhoodSampling sampling;
+        sampling.maxNeighbours = maxNeighbours;
+        sampling.seed = 11;
+        sampling.stride = 3;
+
+        SpatialGrid grid;
+        grid.build(projection, 0, 1);
+
+        int numSampledMismatches = 0;
+        Neighbourhood neighbourhood, expected;
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            const int count = findNeighbourhood(projection, grid, i, distances[i] * 3, neighbourhood, 0, 1, sampling);
+            const int expectedCount = findNeighbourhood(projection, i, distances[i] * 3, expected, 0, 1, sampling);
+
+            if (neighbourhood != expected || count != expectedCount)
+                numSampledMismatches++;
+        }
+
+        verifier.check("sampled grid neighbourhoods", numSampledMismatches == 0, std::to_string(numSampledMismatches) + " points differ");
+    }
+
+    /**
+     * Verify streaming updates of the projection: after moving a few points the neighbourhoods must equal the ones of
+     * the moved projection and the downdated and updated ranks must match a recompute on the moved projection
+     */
+    void verifyStreaming(Verifier& verifier, const DataMatrix& data, const DataMatrix& projection, float radius, int maxNeighbours, std::mt19937& rng)
+    {
+        const int numPoints = static_cast<int>(projection.rows());
+
+        // Moving the extreme points would change the diameter and with it the radius, which recomputes everything
+        std::vector<bool> extreme(numPoints, false);
+        for (int d = 0; d < 2; d++)
+        {
+            Eigen::Index index;
+            projection.col(d).minCoeff(&index); extreme[index] = true;
+            projection.col(d).maxCoeff(&index); extreme[index] = true;
+        }
+
+        const float tolerance = 0.1f;
+        const float projectionRadius = computeProjectionDiameter(projection, 0, 1) * radius;
+
+        for (const Explanation::Metric metric : { Explanation::Metric::VARIANCE, Explanation::Metric::VALUE, Explanation::Metric::EUCLIDEAN })
+        {
+            const std::string metricName = metric == Explanation::Metric::VARIANCE ? "variance" : metric == Explanation::Metric::VALUE ? "value" : "euclidean";
+
+            if (metric == Explanation::Metric::EUCLIDEAN && data.rows() * data.cols() > 8000)
+                continue;
+
+            DataMatrix coreData = data;
+            DataMatrix streamedProjection = projection;
+
+            ExplanationCore core;
+            core.setData(coreData, streamedProjection);
+            core.setNeighbourCap(maxNeighbours, 5);
+            core.setStreamingTolerance(tolerance);
+            core.setExplanationMetric(metric);
+            core.recomputeNeighbourhood(radius, 0, 1);
+            core.recomputeMetrics();
+
+            int numIncremental = 0, numMovedMismatches = 0;
+
+            for (int u = 0; u < NUM_STREAMING_UPDATES; u++)
+            {
+                // Move a few points onto (near) other points, so the bounds of the projection stay the same
+                const int numMoved = std::max(1, numPoints / 50);
+                int expectedMoved = 0;
+
+                for (int m = 0; m < numMoved; m++)
+                {
+                    const int i = rng() % numPoints;
+                    const int target = rng() % numPoints;
+
+                    if (extreme[i])
+                        continue;
+
+                    const float t = std::uniform_real_distribution<float>(0.5f, 1.0f)(rng);
+                    streamedProjection.row(i) = (1 - t) * streamedProjection.row(i) + t * streamedProjection.row(target);
+                }
+
+                for (int i = 0; i < numPoints; i++)
+                {
+                    const float xd = streamedProjection(i, 0) - core.getProjection()(i, 0);
+                    const float yd = streamedProjection(i, 1) - core.getProjection()(i, 1);
+
+                    if (xd * xd + yd * yd > tolerance * projectionRadius * tolerance * projectionRadius)
+                        expectedMoved++;
+                }
+
+                core.updateProjection(streamedProjection);
+
+                if (!core.getLastStreamingUpdate().fullRecompute)
+                    numIncremental++;
+
+                if (core.getLastStreamingUpdate().numMoved != expectedMoved)
+                    numMovedMismatches++;
+            }
+
+            verifier.check(metricName + " streaming updates are incremental", numIncremental == NUM_STREAMING_UPDATES, std::to_string(numIncremental) + "/" + std::to_string(NUM_STREAMING_UPDATES));
+            verifier.check(metricName + " streaming moved points", numMovedMismatches == 0, std::to_string(numMovedMismatches) + " updates differ");
+
+            // Points that moved less than the tolerance keep their previous position in the core
+            DataMatrix expectedProjection = core.getProjection();
+
+            ExplanationCore expectedCore;
+            expectedCore.setData(coreData, expectedProjection);
+            expectedCore.setNeighbourCap(maxNeighbours, 5);
+            expectedCore.setExplanationMetric(metric);
+            expectedCore.recomputeNeighbourhood(radius, 0, 1);
+            expectedCore.recomputeMetrics();
+
+            verifier.check(metricName + " streamed neighbourhoods", core.getNeighbourhoodMatrix() == expectedCore.getNeighbourhoodMatrix());
+            verifier.check(metricName + " streamed confidence neighbourhoods", *core.getConfidenceModel()._confidenceNeighbourhoodMatrix == *expectedCore.getConfidenceModel()._confidenceNeighbourhoodMatrix);
+
+            DataMatrix ranks, expectedRanks;
+            core.computeDimensionRanks(ranks);
+            expectedCore.computeDimensionRanks(expectedRanks);
+
+            verifier.compare(metricName + " streamed ranks", flatten(ranks), flatten(expectedRanks), ranks.size(), metric == Explanation::Metric::VALUE ? STREAMING_VALUE_RANK_TOLERANCE : STREAMING_RANK_TOLERANCE, STREAMING_RANK_ABSOLUTE_TOLERANCE);
+        }
+
+        // Moving most of the points recomputes everything
+        DataMatrix coreData = data;
+        DataMatrix streamedProjection = projection;
+
+        ExplanationCore core;
+        core.setData(coreData, streamedProjection);
+        core.recomputeNeighbourhood(radius, 0, 1);
+        core.recomputeMetrics();
+
+        streamedProjection.col(0) = projection.col(1);
+        streamedProjection.col(1) = projection.col(0);
+
+        core.updateProjection(streamedProjection);
+
+        verifier.check("streaming falls back to a full recompute", core.getLastStreamingUpdate().fullRecompute && core.getNeighbourhoodMatrix().size() == projection.rows());
+    }
+
+    /** Verify every level of the multi-scale explanation against the reference explanation at the radius of the level */
+    void verifyMultiScale(Verifier& verifier, ExplanationCore& core, const DataMatrix& data, const DataMatrix& projection, float radius, const std::vector<bool>& excluded, Explanation::Metric metric, const std::string& metricName)
+    {
+        const std::vector<float> radii = { radius * 0.5f, radius, radius * 1.5f };
+
+        if (!core.recomputeMultiScale(radii, 0, 1))
+        {
+            verifier.check(metricName + " multi-scale levels", false, "not computed");
+            return;
+        }
+
+        const MultiScaleExplanation& multiScale = core.getMultiScale();
+
+        verifier.check(metricName + " multi-scale levels", multiScale.numLevels() == static_cast<int>(radii.size()));
+
+        const float diameter = computeProjectionDiameter(projection, 0, 1);
+
+        for (int l = 0; l < multiScale.numLevels(); l++)
+        {
+            const ScaleLevel& level = multiScale.getLevel(l);
+
+            NeighbourhoodMatrix neighbourhoods;
+            NeighbourhoodMatrix confidenceNeighbourhoods;
+            computeNeighbourhoodMatrix(projection, neighbourhoods, diameter * level.radius, 0, 1);
+            computeNeighbourhoodMatrix(projection, confidenceNeighbourhoods, diameter * level.radius * 0.25f, 0, 1);
+
+            DataMatrix expectedRanks;
+            if (metric == Explanation::Metric::VARIANCE)    reference::computeVarianceRanks(data, neighbourhoods, expectedRanks);
+            if (metric == Explanation::Metric::VALUE)       reference::computeValueRanks(data, neighbourhoods, expectedRanks);
+
+            std::vector<int> expectedTopDimensions;
+            reference::computeTopRankedDimensions(metric, expectedRanks, excluded, expectedTopDimensions);
+
+            std::vector<float> expectedConfidences;
+            reference::computeConfidences(ConfidenceMethod::SIMPLIFIED, metric, expectedRanks, excluded, confidenceNeighbourhoods, expectedConfidences);
+
+            int numAgreeing = 0;
+            double confidenceError = 0;
+            for (int i = 0; i < data.rows(); i++)
+            {
+                numAgreeing += level.topDimensions[i] == expectedTopDimensions[i] ? 1 : 0;
+                confidenceError += std::isnan(expectedConfidences[i]) ? 0.0 : std::abs(level.getConfidence(i) - expectedConfidences[i]);
+            }
+
+            const double agreement = static_cast<double>(numAgreeing) / data.rows();
+            confidenceError /= data.rows();
+
+            const std::string levelName = metricName + " multi-scale level " + std::to_string(l);
+
+            verifier.check(levelName + " top-ranked dimensions", agreement >= MULTI_SCALE_AGREEMENT, std::to_string(numAgreeing) + "/" + std::to_string(data.rows()) + " agree");
+            verifier.check(levelName + " confidences", confidenceError <= MULTI_SCALE_CONFIDENCE_ERROR, "mean error " + std::to_string(confidenceError));
+        }
+    }
+
+    /** Assign the points to the cells of a 3x3 grid over the projection, leaving some points unclustered and the last cluster empty */
+    int generateClusters(const DataMatrix& projection, std::mt19937& rng, std::vector<int>& clusterIds)
+    {
+        constexpr int GRID_SIZE = 3;
+
+        const float minX = projection.col(0).minCoeff(), maxX = projection.col(0).maxCoeff();
+        const float minY = projection.col(1).minCoeff(), maxY = projection.col(1).maxCoeff();
+
+        clusterIds.resize(projection.rows());
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            const int cx = std::min(GRID_SIZE - 1, static_cast<int>(GRID_SIZE * (projection(i, 0) - minX) / std::max(maxX - minX, 1e-6f)));
+            const int cy = std::min(GRID_SIZE - 1, static_cast<int>(GRID_SIZE * (projection(i, 1) - minY) / std::max(maxY - minY, 1e-6f)));
+
+            clusterIds[i] = rng() % 20 == 0 ? -1 : cy * GRID_SIZE + cx;
+        }
+
+        return GRID_SIZE * GRID_SIZE + 1;
+    }
+
+    /** Verify the cluster explanation against the reference explanation with the cluster members as neighbourhood of every member */
+    void verifyClusters(Verifier& verifier, ExplanationCore& core, const DataMatrix& data, const std::vector<int>& clusterIds, int numClusters, const std::vector<bool>& excluded, Explanation::Metric metric, const std::string& metricName)
+    {
+        if (!core.recomputeClusterExplanation())
+        {
+            verifier.check(metricName + " cluster explanation", false, "not computed");
+            return;
+        }
+
+        const ClusterExplanation& clusterExplanation = core.getClusterExplanation();
+
+        NeighbourhoodMatrix members(numClusters);
+        for (int i = 0; i < data.rows(); i++)
+            if (clusterIds[i] >= 0) members[clusterIds[i]].push_back(i);
+
+        NeighbourhoodMatrix neighbourhoods(data.rows());
+        for (int i = 0; i < data.rows(); i++)
+            neighbourhoods[i] = clusterIds[i] >= 0 ? members[clusterIds[i]] : Neighbourhood{ i };
+
+        DataMatrix expectedRanks;
+        if (metric == Explanation::Metric::VARIANCE)    reference::computeVarianceRanks(data, neighbourhoods, expectedRanks);
+        if (metric == Explanation::Metric::VALUE)       reference::computeValueRanks(data, neighbourhoods, expectedRanks);
+
+        std::vector<int> expectedTopDimensions;
+        reference::computeTopRankedDimensions(metric, expectedRanks, excluded, expectedTopDimensions);
+
+        std::vector<int> topRankedDims;
+        std::vector<float> confidences;
+        clusterExplanation.broadcast(topRankedDims, confidences);
+
+        // Compare the broadcast explanation on the clustered points only
+        std::vector<float> ranks, clusteredExpectedRanks;
+        int numClustered = 0, numAgreeing = 0, numInvalid = 0;
+        for (int i = 0; i < data.rows(); i++)
+        {
+            const int c = clusterIds[i];
+
+            if (c < 0)
+            {
+                numInvalid += topRankedDims[i] == -1 && confidences[i] == 0 ? 0 : 1;
+                continue;
+            }
+
+            // The methods give NaN ranks without any spread (0 / 0), the cluster explanation ranks such clusters 0
+            for (int j = 0; j < data.cols(); j++)
+            {
+                if (std::isnan(expectedRanks(i, j)))
+                    continue;
+
+                ranks.push_back(clusterExplanation.getRanks()(c, j));
+                clusteredExpectedRanks.push_back(expectedRanks(i, j));
+            }
+
+            numClustered++;
+            numAgreeing += topRankedDims[i] == expectedTopDimensions[i] ? 1 : 0;
+            numInvalid += confidences[i] >= 0 && confidences[i] <= 1 ? 0 : 1;
+        }
+
+        verifier.compare(metricName + " cluster ranks", ranks, clusteredExpectedRanks, ranks.size(), CLUSTER_RANK_TOLERANCE);
+        verifier.check(metricName + " cluster top-ranked dimensions", numAgreeing >= CLUSTER_AGREEMENT * numClustered, std::to_string(numAgreeing) + "/" + std::to_string(numClustered) + " agree");
+        verifier.check(metricName + " cluster broadcast", numInvalid == 0, std::to_string(numInvalid) + " invalid points");
+    }
+
+    /**
+     * Verify the landmark explanation: the landmark ranks against the reference ranks of the landmarks, the
+     * interpolation bounds, and the exact explanation when every point is its own landmark
+     */
+    void verifyLandmarks(Verifier& verifier, ExplanationCore& core, const DataMatrix& data, float radius, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<bool>& excluded, Explanation::Metric metric, const std::string& metricName)
+    {
+        DataMatrix expectedRanks;
+        if (metric == Explanation::Metric::VARIANCE)    reference::computeVarianceRanks(data, neighbourhoodMatrix, expectedRanks);
+        if (metric == Explanation::Metric::VALUE)       reference::computeValueRanks(data, neighbourhoodMatrix, expectedRanks);
+
+        std::vector<int> expectedTopDimensions;
+        reference::computeTopRankedDimensions(metric, expectedRanks, excluded, expectedTopDimensions);
+
+        const int numPoints = static_cast<int>(data.rows());
+
+        for (const LandmarkSelection selection : { LandmarkSelection::RANDOM, LandmarkSelection::FARTHEST_POINT })
+        {
+            LandmarkParameters parameters;
+            parameters.numLandmarks = std::max(1, numPoints / 8);
+            parameters.selection = selection;
+            parameters.interpolation = LandmarkInterpolation::INVERSE_DISTANCE;
+            parameters.seed = 3;
+
+            const std::string name = metricName + (selection == LandmarkSelection::RANDOM ? " random" : " farthest-point") + " landmarks";
+
+            core.setLandmarkParameters(parameters);
+
+            if (!core.recomputeLandmarkExplanation(radius, 0, 1))
+            {
+                verifier.check(name, false, "not computed");
+                continue;
+            }
+
+            const LandmarkExplanation& landmarkExplanation = core.getLandmarkExplanation();
+            const std::vector<int>& landmarks = landmarkExplanation.getLandmarks();
+
+            std::vector<int> sortedLandmarks = landmarks;
+            std::sort(sortedLandmarks.begin(), sortedLandmarks.end());
+
+            const bool distinct = std::adjacent_find(sortedLandmarks.begin(), sortedLandmarks.end()) == sortedLandmarks.end();
+
+            verifier.check(name + " selection", distinct && landmarks.size() <= static_cast<std::size_t>(parameters.numLandmarks) && !landmarks.empty(), std::to_string(landmarks.size()) + " landmarks");
+
+            std::vector<float> ranks, landmarkExpectedRanks;
+            for (int l = 0; l < static_cast<int>(landmarks.size()); l++)
+            {
+                for (int j = 0; j < data.cols(); j++)
+                {
+                    if (std::isnan(expectedRanks(landmarks[l], j)))
+                        continue;
+
+                    ranks.push_back(landmarkExplanation.getLandmarkRanks()(l, j));
+                    landmarkExpectedRanks.push_back(expectedRanks(landmarks[l], j));
+                }
+            }
+
+            verifier.compare(name + " ranks", ranks, landmarkExpectedRanks, ranks.size(), LANDMARK_RANK_TOLERANCE, LANDMARK_RANK_ABSOLUTE_TOLERANCE);
+
+            int numInvalid = 0;
+            for (int i = 0; i < numPoints; i++)
+            {
+                const float quality = landmarkExplanation.getQuality()[i];
+                const float confidence = landmarkExplanation.getConfidences()[i];
+
+                numInvalid += quality >= 0 && quality <= 1 + 1e-5f && confidence >= 0 && confidence <= 1 ? 0 : 1;
+            }
+
+            verifier.check(name + " quality and confidences", numInvalid == 0, std::to_string(numInvalid) + " out of bounds");
+        }
+
+        // With every point a landmark and nearest interpolation the explanation is exact
+        LandmarkParameters parameters;
+        parameters.numLandmarks = numPoints;
+        parameters.selection = LandmarkSelection::RANDOM;
+        parameters.interpolation = LandmarkInterpolation::NEAREST;
+
+        core.setLandmarkParameters(parameters);
+        core.recomputeLandmarkExplanation(radius, 0, 1);
+
+        const LandmarkExplanation& landmarkExplanation = core.getLandmarkExplanation();
+
+        int numAgreeing = 0, numExact = 0;
+        for (int i = 0; i < numPoints; i++)
+        {
+            numAgreeing += landmarkExplanation.getTopDimensions()[i] == expectedTopDimensions[i] ? 1 : 0;
+            numExact += landmarkExplanation.getQuality()[i] == 1.0f ? 1 : 0;
+        }
+
+        verifier.check(metricName + " all-landmark top-ranked dimensions", numAgreeing >= LANDMARK_AGREEMENT * numPoints, std::to_string(numAgreeing) + "/" + std::to_string(numPoints) + " agree");
+        verifier.check(metricName + " all-landmark quality", numExact == numPoints, std::to_string(numExact) + "/" + std::to_string(numPoints) + " exact");
+
+        core.setLandmarkParameters(LandmarkParameters());
+    }
+
+    void verifyLocalPCA(Verifier& verifier, const ExplanationCore& core, const std::vector<unsigned int>& selection)
+    {
+        const DataTable& dataset = core.getDataset();
+        const DataStatistics& dataStats = core.getDataStatistics();
+
+        // Dense covariance of the range-normalized selection, as in the original eigen image
+        std::vector<int> includedDims;
+        for (int j = 0; j < dataset.numDimensions(); j++)
+            if (!dataset.isExcluded(j) && dataStats.ranges[j] > 0) includedDims.push_back(j);
+
+        const int numSelected = static_cast<int>(selection.size());
+        const int numIncluded = static_cast<int>(includedDims.size());
+
+        LocalPCA localPCA;
+        localPCA.compute(dataset, selection, dataStats, false);
+
+        const int numComponents = numSelected < 2 ? 0 : std::min({ 3, numIncluded, numSelected });
+
+        verifier.check("local PCA number of components", localPCA.numComponents() == numComponents);
+
+        if (numComponents == 0 || localPCA.numComponents() != numComponents)
+            return;
+
+        Eigen::MatrixXd rows(numSelected, numIncluded);
+        for (int r = 0; r < numSelected; r++)
+            for (int c = 0; c < numIncluded; c++)
+                rows(r, c) = dataset(selection[r], includedDims[c]) / static_cast<double>(dataStats.ranges[includedDims[c]]);
+
+        rows.rowwise() -= rows.colwise().mean();
+
+        const Eigen::MatrixXd covariance = rows.transpose() * rows / numSelected;
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(covariance);
+
+        std::vector<double> expectedEigenValues(numComponents);
+        for (int k = 0; k < numComponents; k++)
+            expectedEigenValues[k] = std::max(solver.eigenvalues()(numIncluded - 1 - k), 0.0);
+
+        verifier.compare("local PCA eigenvalues", localPCA.getEigenValues(), expectedEigenValues, numComponents, LOCAL_PCA_TOLERANCE, LOCAL_PCA_ABSOLUTE_TOLERANCE * expectedEigenValues[0]);
+
+        const std::vector<float> shares = localPCA.computeLoadingShares();
+
+        double totalShare = 0;
+        for (int j = 0; j < dataset.numDimensions(); j++)
+        {
+            totalShare += shares[j];
+
+            if (dataset.isExcluded(j))
+                verifier.check("local PCA excluded dimension", shares[j] == 0);
+        }
+
+        verifier.check("local PCA loading shares sum to 1", expectedEigenValues[0] == 0 || std::abs(totalShare - 1) < REASSOCIATION_TOLERANCE, std::to_string(totalShare));
+
+        // Starting from the components of the same selection must not take longer and give the same components
+        const std::vector<float> eigenValues = localPCA.getEigenValues();
+        const int numColdIterations = localPCA.getNumIterations();
+
+        localPCA.compute(dataset, selection, dataStats, true);
+
+        verifier.check("local PCA warm start iterations", localPCA.getNumIterations() <= numColdIterations, std::to_string(localPCA.getNumIterations()) + " warm, " + std::to_string(numColdIterations) + " cold");
+        verifier.compare("local PCA warm start eigenvalues", localPCA.getEigenValues(), eigenValues, numComponents, LOCAL_PCA_TOLERANCE, LOCAL_PCA_ABSOLUTE_TOLERANCE * expectedEigenValues[0]);
+    }
+
+    void verifyTopRanks(Verifier& verifier, const DataTable& dataset, const DataStatistics& dataStats, const NeighbourhoodMatrix& neighbourhoodMatrix, const DataMatrix& projection, const DataMatrix& expectedRanks, Explanation::Metric metric, const std::string& name)
+    {
+        const int numPoints = dataset.numPoints();
+        const int numDimensions = dataset.numDimensions();
+        const bool lowRankBest = metric == Explanation::Metric::VARIANCE;
+
+        std::vector<bool> excluded(numDimensions);
+        for (int j = 0; j < numDimensions; j++)
+            excluded[j] = dataset.isExcluded(j);
+
+        const int numIncluded = static_cast<int>(std::count(excluded.begin(), excluded.end(), false));
+
+        TopRanks topRanks;
+        topRanks.compute(dataset, dataStats, neighbourhoodMatrix, metric, TOP_RANK_K, TOP_RANK_BLOCK_SIZE);
+
+        const int k = topRanks.getK();
+
+        verifier.check(name + " K", topRanks.numPoints() == numPoints && k == std::min(TOP_RANK_K, std::max(1, numIncluded)), std::to_string(k));
+
+        if (topRanks.numPoints() != numPoints)
+            return;
+
+        // The kept ranks must be those of the reference, and no dimension that is not kept may rank better than the last kept one
+        std::vector<float> ranks, keptExpectedRanks;
+        int numMissed = 0;
+
+        for (int i = 0; i < numPoints; i++)
+        {
+            std::vector<bool> kept(numDimensions, false);
+
+            for (int r = 0; r < k; r++)
+            {
+                const int j = topRanks.getDimension(i, r);
+
+                kept[j] = true;
+
+                if (numIncluded > 0 && excluded[j])
+                    numMissed++;
+
+                if (std::isnan(expectedRanks(i, j)))
+                    continue;
+
+                ranks.push_back(topRanks.getRank(i, r));
+                keptExpectedRanks.push_back(expectedRanks(i, j));
+            }
+
+            const double lastRank = topRanks.getRank(i, k - 1);
+            const double tolerance = TOP_RANK_ABSOLUTE_TOLERANCE + TOP_RANK_TOLERANCE * std::abs(lastRank);
+
+            for (int j = 0; j < numDimensions; j++)
+            {
+                const double rank = expectedRanks(i, j);
+
+                if (kept[j] || excluded[j] || std::isnan(rank))
+                    continue;
+
+                if (lowRankBest ? rank < lastRank - tolerance : rank > lastRank + tolerance)
+                    numMissed++;
+            }
+        }
+
+        verifier.compare(name + " ranks", ranks, keptExpectedRanks, ranks.size(), TOP_RANK_TOLERANCE, TOP_RANK_ABSOLUTE_TOLERANCE);
+        verifier.check(name + " selection", numMissed == 0, std::to_string(numMissed) + " better ranked dimensions not kept");
+
+        std::vector<int> expectedTopDimensions;
+        reference::computeTopRankedDimensions(metric, expectedRanks, excluded, expectedTopDimensions);
+
+        const std::vector<int> topDimensions = topRanks.getTopDimensions();
+
+        int numAgreeing = 0;
+        for (int i = 0; i < numPoints; i++)
+            numAgreeing += topDimensions[i] == expectedTopDimensions[i] ? 1 : 0;
+
+        verifier.check(name + " top-ranked dimensions", numAgreeing >= TOP_RANK_AGREEMENT * numPoints, std::to_string(numAgreeing) + "/" + std::to_string(numPoints) + " agree");
+
+        // Pruning only skips dimensions outside every top K, the kept dimensions and their scores must be those of the unpruned ranks
+        TopRanks prunedRanks;
+        prunedRanks.computePruned(dataset, dataStats, neighbourhoodMatrix, projection, 0, 1, metric, TOP_RANK_K, TOP_RANK_BLOCK_SIZE);
+
+        if (prunedRanks.numPoints() != numPoints || prunedRanks.getK() != k)
+        {
+            verifier.check(name + " pruned K", false, std::to_string(prunedRanks.getK()));
+            return;
+        }
+
+        std::vector<float> prunedScores, scores;
+        int numDiffering = 0;
+
+        for (int i = 0; i < numPoints; i++)
+        {
+            for (int r = 0; r < k; r++)
+            {
+                numDiffering += prunedRanks.getDimension(i, r) != topRanks.getDimension(i, r) ? 1 : 0;
+
+                prunedScores.push_back(prunedRanks.getRank(i, r) * prunedRanks.getScoreSum(i));
+                scores.push_back(topRanks.getRank(i, r) * topRanks.getScoreSum(i));
+            }
+        }
+
+        const float prunedFraction = prunedRanks.getPrunedFraction();
+
+        verifier.check(name + " pruned dimensions", numDiffering == 0 && prunedFraction >= 0 && prunedFraction <= 1, std::to_string(numDiffering) + " differing, " + std::to_string(100 * prunedFraction) + "% pruned");
+        verifier.compare(name + " pruned scores", prunedScores, scores, scores.size(), PRUNED_SCORE_TOLERANCE, TOP_RANK_ABSOLUTE_TOLERANCE * PRUNED_SCORE_TOLERANCE);
+    }
+
+    /** Compare the confidences of the core from its top ranks against those from the reference rank matrix */
+    void verifyTopRankConfidences(Verifier& verifier, ExplanationCore& core, const DataMatrix& expectedRanks, const std::string& metricName)
+    {
+        // Confidences that are all equal normalize to NaN, which only matches NaN
+        const auto meanError = [](const std::vector<float>& confidences, const std::vector<float>& expectedConfidences) -> double {
+            double error = 0;
+            for (std::size_t i = 0; i < confidences.size(); i++)
+            {
+                if (std::isnan(confidences[i]) || std::isnan(expectedConfidences[i]))
+                    error += std::isnan(confidences[i]) == std::isnan(expectedConfidences[i]) ? 0.0 : 1.0;
+                else
+                    error += std::abs(confidences[i] - expectedConfidences[i]);
+            }
+
+            return confidences.empty() ? 0.0 : error / confidences.size();
+        };
+
+        // The simplified confidences only need the top dimension, the Silva confidences need the ranks of the neighbours
+        // for the top dimension of the point, which are all kept when K is the number of dimensions
+        for (const ConfidenceMethod method : { ConfidenceMethod::SIMPLIFIED, ConfidenceMethod::SILVA })
+        {
+            const int k = method == ConfidenceMethod::SIMPLIFIED ? TOP_RANK_K : core.getDataset().numDimensions();
+            const std::string name = metricName + (method == ConfidenceMethod::SILVA ? " silva" : " simplified") + " top rank confidences";
+
+            core.getConfidenceModel()._method = method;
+            core.setTopK(k);
+            core.recomputeMetrics();
+
+            const MemoryUsage memoryUsage = core.getMemoryUsage();
+
+            verifier.check(name + " storage", core.hasTopRanks() && memoryUsage.rankMatrix == 0 && memoryUsage.topRanks > 0 && memoryUsage.localStatistics < static_cast<std::size_t>(expectedRanks.size()) * sizeof(float));
+
+            if (!core.hasTopRanks())
+                continue;
+
+            const std::vector<float> confidences = core.computeConfidences(core.getTopRanks());
+            const std::vector<float> expectedConfidences = core.computeConfidences(expectedRanks);
+
+            const double error = meanError(confidences, expectedConfidences);
+
+            verifier.check(name, confidences.size() == expectedConfidences.size() && error <= TOP_RANK_CONFIDENCE_ERROR, "mean error " + std::to_string(error));
+        }
+
+        core.getConfidenceModel()._method = ConfidenceMethod::SILVA;
+        core.setTopK(0);
+        core.recomputeMetrics();
+    }
+
+    void verifySparse(Verifier& verifier, const DataMatrix& data, const DataMatrix& projection, float radius, std::mt19937& rng)
+    {
+        // Zero most values, like a count matrix, and keep a dense copy of the same data as the reference
+        const float density = std::uniform_real_distribution<float>(0.02f, 0.3f)(rng);
+        std::uniform_real_distribution<float> uniform(0, 1);
+
+        DataMatrix denseData = data;
+        for (int j = 0; j < denseData.cols(); j++)
+            for (int i = 0; i < denseData.rows(); i++)
+                if (uniform(rng) > density) denseData(i, j) = 0;
+
+        SparseDataMatrix sparseData = denseData.matrix().sparseView();
+
+        DataMatrix coreProjection = projection;
+
+        ExplanationCore denseCore;
+        denseCore.setData(denseData, coreProjection);
+
+        ExplanationCore core;
+        core.setData(sparseData, coreProjection);
+        core.recomputeNeighbourhood(radius, 0, 1);
+
+        verifier.check("sparse backing", core.getDataset().isSparse() && core.getDataset().numNonZeros() == static_cast<std::size_t>(sparseData.nonZeros()));
+
+        const DataStatistics& dataStats = core.getDataStatistics();
+        const DataStatistics& expectedDataStats = denseCore.getDataStatistics();
+        const std::size_t numDimensions = denseData.cols();
+
+        verifier.compare("sparse global means", dataStats.means, expectedDataStats.means, numDimensions, REASSOCIATION_TOLERANCE);
+        verifier.compare("sparse global variances", dataStats.variances, expectedDataStats.variances, numDimensions, REASSOCIATION_TOLERANCE);
+        verifier.compare("sparse global minima", dataStats.minRange, expectedDataStats.minRange, numDimensions, 0);
+        verifier.compare("sparse global maxima", dataStats.maxRange, expectedDataStats.maxRange, numDimensions, 0);
+
+        const NeighbourhoodMatrix& neighbourhoodMatrix = core.getNeighbourhoodMatrix();
+
+        for (const Explanation::Metric metric : { Explanation::Metric::VARIANCE, Explanation::Metric::VALUE })
+        {
+            const std::string metricName = metric == Explanation::Metric::VARIANCE ? "variance" : "value";
+
+            core.setExplanationMetric(metric);
+            core.recomputeMetrics();
+
+            DataMatrix ranks;
+            core.computeDimensionRanks(ranks);
+
+            DataMatrix expectedRanks;
+            if (metric == Explanation::Metric::VARIANCE)    reference::computeVarianceRanks(denseData, neighbourhoodMatrix, expectedRanks);
+            if (metric == Explanation::Metric::VALUE)       reference::computeValueRanks(denseData, neighbourhoodMatrix, expectedRanks);
+
+            const double tolerance = metric == Explanation::Metric::VALUE ? SPARSE_VALUE_RANK_TOLERANCE : REASSOCIATION_TOLERANCE;
+
+            verifier.compare("sparse " + metricName + " ranks", flatten(ranks), flatten(expectedRanks), ranks.size(), tolerance);
+
+            verifyTopRanks(verifier, core.getDataset(), dataStats, neighbourhoodMatrix, core.getProjection(), expectedRanks, metric, "sparse " + metricName + " top ranks");
+        }
+
+        // Statistics of a lens selection, including the histograms
+        const Neighbourhood& lens = neighbourhoodMatrix[rng() % denseData.rows()];
+        const std::vector<unsigned int> selection(lens.begin(), lens.end());
+
+        SelectionStatistics selectionStats;
+        selectionStats.compute(core.getDataset(), selection, dataStats);
+
+        SelectionStatistics expectedSelectionStats;
+        expectedSelectionStats.compute(denseCore.getDataset(), selection, expectedDataStats);
+
+        verifier.compare("sparse selection means", selectionStats.getMeans(), expectedSelectionStats.getMeans(), numDimensions, REASSOCIATION_TOLERANCE);
+        verifier.compare("sparse selection variances", selectionStats.getVariances(), expectedSelectionStats.getVariances(), numDimensions, REASSOCIATION_TOLERANCE);
+
+        // Histograms are binned on request for any subset of the dimensions, here in reverse order
+        std::vector<int> dims(numDimensions);
+        std::iota(dims.rbegin(), dims.rend(), 0);
+
+        std::vector<int> bins, expectedBins;
+        selectionStats.computeHistograms(core.getDataset(), dataStats, dims, bins);
+        expectedSelectionStats.computeHistograms(denseCore.getDataset(), expectedDataStats, dims, expectedBins);
+
+        verifier.compare("sparse selection histograms", bins, expectedBins, bins.size(), 0);
+
+        verifier.check("selection statistics generations", selectionStats.getGeneration() != 0 && expectedSelectionStats.getGeneration() > selectionStats.getGeneration());
+    }
+
+    void verifyPointOrder(Verifier& verifier, const DataMatrix& data, const DataMatrix& projection, float radius, const DataMatrix& expectedRanks)
+    {
+        PointOrder pointOrder;
+        pointOrder.computeMorton(projection, 0, 1);
+
+        // The order must be a permutation with its inverse
+        const int numPoints = static_cast<int>(data.rows());
+        std::vector<int> counts(numPoints, 0);
+        bool inverse = pointOrder.numPoints() == numPoints;
+        for (int i = 0; i < numPoints && inverse; i++)
+        {
+            counts[pointOrder.toOriginal(i)]++;
+            inverse = pointOrder.toInternal(pointOrder.toOriginal(i)) == i;
+        }
+
+        verifier.check("morton order permutation", inverse && std::all_of(counts.begin(), counts.end(), [](int count) { return count == 1; }));
+
+        // The core on the reordered points must give the same ranks, only the order of the neighbours differs
+        DataMatrix coreProjection = pointOrder.permuteRows(projection);
+
+        DataMatrix coreData = pointOrder.permuteRows(data);
+
+        ExplanationCore core;
+        core.setData(coreData, coreProjection);
+        core.recomputeNeighbourhood(radius, 0, 1);
+        core.setExplanationMetric(Explanation::Metric::VARIANCE);
+        core.recomputeMetrics();
+
+        DataMatrix ranks;
+        core.computeDimensionRanks(ranks);
+
+        DataMatrix originalRanks(ranks.rows(), ranks.cols());
+        for (int i = 0; i < numPoints; i++)
+            originalRanks.row(pointOrder.toOriginal(i)) = ranks.row(i);
+
+        verifier.compare("morton order variance ranks", flatten(originalRanks), flatten(expectedRanks), originalRanks.size(), REASSOCIATION_TOLERANCE);
+    }
+
+    void verifySharedData(Verifier& verifier, const ExplanationCore& core, DataMatrix projection, float radius, const std::vector<bool>& excluded, const DataMatrix& expectedRanks)
+    {
+        // A second view of the same data shares the values and statistics, but not the exclusions
+        ExplanationCore sharedCore;
+        sharedCore.setData(core.getDataset(), core.getDataStatistics(), projection);
+        sharedCore.recomputeNeighbourhood(radius, 0, 1);
+
+        const DataTable& dataset = sharedCore.getDataset();
+
+        const bool sharedValues = dataset.isSparse() ? dataset.getSparseData() == core.getDataset().getSparseData() : dataset.getDenseData() == core.getDataset().getDenseData();
+
+        verifier.check("shared data values", sharedValues);
+
+        bool exclusionsSeparate = true;
+        for (int j = 0; j < dataset.numDimensions(); j++)
+            exclusionsSeparate = exclusionsSeparate && !dataset.isExcluded(j) && core.getDataset().isExcluded(j) == excluded[j];
+
+        verifier.check("shared data exclusions", exclusionsSeparate);
+
+        sharedCore.setExplanationMetric(Explanation::Metric::VARIANCE);
+        sharedCore.recomputeMetrics();
+
+        DataMatrix ranks;
+        sharedCore.computeDimensionRanks(ranks);
+
+        verifier.compare("shared data variance ranks", flatten(ranks), flatten(expectedRanks), ranks.size(), REASSOCIATION_TOLERANCE);
+
+        // A third view with the same settings shares the neighbourhoods and local statistics as well
+        ExplanationCore localCore;
+        localCore.setData(core.getDataset(), core.getDataStatistics(), projection);
+
+        localCore.setExplanationMetric(Explanation::Metric::VALUE);
+        verifier.check("shared local explanation of another metric rejected", !localCore.setLocalExplanation(sharedCore.getLocalExplanation()));
+
+        localCore.setExplanationMetric(Explanation::Metric::VARIANCE);
+        verifier.check("shared local explanation taken", localCore.setLocalExplanation(sharedCore.getLocalExplanation()));
+        verifier.check("shared neighbourhoods", &localCore.getNeighbourhoodMatrix() == &sharedCore.getNeighbourhoodMatrix());
+
+        localCore.computeDimensionRanks(ranks);
+
+        verifier.compare("shared local explanation variance ranks", flatten(ranks), flatten(expectedRanks), ranks.size(), REASSOCIATION_TOLERANCE);
+
+        // A streaming update of one view copies what it changes, the other view keeps its neighbourhoods and statistics
+        const NeighbourhoodMatrix sharedNeighbourhoods = sharedCore.getNeighbourhoodMatrix();
+
+        for (int i = 0; i < 5; i++)
+            projection.row(i * 7 % projection.rows()) = projection.row((i * 13 + 1) % projection.rows());
+
+        localCore.updateProjection(projection);
+
+        verifier.check("shared neighbourhoods copied on write", localCore.getLastStreamingUpdate().numAffected == 0 || &localCore.getNeighbourhoodMatrix() != &sharedCore.getNeighbourhoodMatrix());
+        verifier.check("shared neighbourhoods unchanged by the other view", sharedCore.getNeighbourhoodMatrix() == sharedNeighbourhoods);
+
+        sharedCore.computeDimensionRanks(ranks);
+
+        verifier.compare("shared statistics unchanged by the other view", flatten(ranks), flatten(expectedRanks), ranks.size(), REASSOCIATION_TOLERANCE);
+    }
+
+    void verifyDataset(Verifier& verifier, std::mt19937& rng)
+    {
+        SyntheticDataParameters parameters;
+        parameters.numPoints        = std::uniform_int_distribution<int>(200, 1200)(rng);
+        parameters.numDimensions    = std::uniform_int_distribution<int>(2, 24)(rng);
+        parameters.numClusters      = std::uniform_int_distribution<int>(1, 6)(rng);
+        parameters.densitySkew      = std::uniform_real_distribution<float>(0, 1.5f)(rng);
+        parameters.seed             = rng();
+
+        const float radius = std::uniform_real_distribution<float>(0.02f, 0.2f)(rng);
+
+        DataMatrix data;
+        DataMatrix projection;
+        generateGaussianMixture(parameters, data, projection);
+
+        // Degenerate inputs: a constant dimension and duplicated points
+        if (rng() % 2 == 0)
+            data.col(rng() % data.cols()).setConstant(3.0f);
+
+        for (int d = 0; d < 5; d++)
+        {
+            int source = rng() % data.rows();
+            int target = rng() % data.rows();
+            data.row(target) = data.row(source);
+            projection.row(target) = projection.row(source);
+        }
+
+        std::cout << parameters.numPoints << " points, " << parameters.numDimensions << " dimensions, " << parameters.numClusters << " clusters, radius " << radius << std::endl;
+
+        ExplanationCore core;
+        core.setData(data, projection);
+        core.recomputeNeighbourhood(radius, 0, 1);
+
+        const float projectionRadius = computeProjectionDiameter(projection, 0, 1) * radius;
+
+        verifyNeighbourhoods(verifier, projection, projectionRadius, core.getNeighbourhoodMatrix());
+
+        verifyReservoirSampling(verifier, data, projection, projectionRadius, core.getNeighbourhoodMatrix(), std::uniform_int_distribution<int>(8, 64)(rng));
+
+        verifyAdaptiveRadii(verifier, projection, std::uniform_int_distribution<int>(1, 40)(rng), std::uniform_int_distribution<int>(4, 32)(rng));
+
+        verifyStreaming(verifier, data, projection, radius, rng() % 2 == 0 ? 0 : std::uniform_int_distribution<int>(8, 64)(rng), rng);
+
+        verifySparse(verifier, data, projection, radius, rng);
+
+        DataMatrix varianceRanks;
+        reference::computeVarianceRanks(data, core.getNeighbourhoodMatrix(), varianceRanks);
+
+        verifyPointOrder(verifier, data, projection, radius, varianceRanks);
+
+        const NeighbourhoodMatrix& neighbourhoodMatrix = core.getNeighbourhoodMatrix();
+        const NeighbourhoodMatrix& confidenceNeighbourhoods = *core.getConfidenceModel()._confidenceNeighbourhoodMatrix;
+
+        // Exclude a dimension to cover the exclusion paths
+        std::vector<bool> excluded(data.cols(), false);
+        if (data.cols() > 2)
+        {
+            const int excludedDim = rng() % data.cols();
+            core.excludeDimension(excludedDim);
+            excluded[excludedDim] = true;
+        }
+
+        verifySharedData(verifier, core, projection, radius, excluded, varianceRanks);
+
+        std::vector<int> clusterIds;
+        const int numClusters = generateClusters(projection, rng, clusterIds);
+        core.setClusters(clusterIds, numClusters);
+
+        // The selection is the neighbourhood of a random point, like a lens selection
+        const Neighbourhood& lens = neighbourhoodMatrix[rng() % data.rows()];
+        const std::vector<unsigned int> selection(lens.begin(), lens.end());
+
+        for (const Explanation::Metric metric : { Explanation::Metric::VARIANCE, Explanation::Metric::VALUE, Explanation::Metric::EUCLIDEAN })
+        {
+            const std::string metricName = metric == Explanation::Metric::VARIANCE ? "variance" : metric == Explanation::Metric::VALUE ? "value" : "euclidean";
+
+            // The Euclidean method is quadratic in the dimensionality per neighbour, keep it to the smaller datasets
+            if (metric == Explanation::Metric::EUCLIDEAN && data.rows() * data.cols() > 8000)
+                continue;
+
+            core.setExplanationMetric(metric);
+            core.recomputeMetrics();
+
+            DataMatrix ranks;
+            core.computeDimensionRanks(ranks);
+
+            DataMatrix expectedRanks;
+            if (metric == Explanation::Metric::VARIANCE)    reference::computeVarianceRanks(data, neighbourhoodMatrix, expectedRanks);
+            if (metric == Explanation::Metric::VALUE)       reference::computeValueRanks(data, neighbourhoodMatrix, expectedRanks);
+            if (metric == Explanation::Metric::EUCLIDEAN)   reference::computeEuclideanRanks(data, neighbourhoodMatrix, expectedRanks);
+
+            verifier.compare(metricName + " ranks", flatten(ranks), flatten(expectedRanks), ranks.size(), REASSOCIATION_TOLERANCE);
+
+            if (metric == Explanation::Metric::EUCLIDEAN)
+                continue;
+
+            // Compare the downstream kernels on the same ranks, so they are verified independently
+            std::vector<int> topDimensions;
+            core.computeTopRankedDimensions(expectedRanks, topDimensions);
+
+            std::vector<int> expectedTopDimensions;
+            reference::computeTopRankedDimensions(metric, expectedRanks, excluded, expectedTopDimensions);
+
+            verifier.compare(metricName + " top-ranked dimensions", topDimensions, expectedTopDimensions, topDimensions.size(), 0);
+
+            for (const ConfidenceMethod method : { ConfidenceMethod::SILVA, ConfidenceMethod::SIMPLIFIED })
+            {
+                core.getConfidenceModel()._method = method;
+
+                std::vector<float> confidences = core.computeConfidences(expectedRanks);
+
+                std::vector<float> expectedConfidences;
+                reference::computeConfidences(method, metric, expectedRanks, excluded, confidenceNeighbourhoods, expectedConfidences);
+
+                verifier.compare(metricName + (method == ConfidenceMethod::SILVA ? " silva" : " simplified") + " confidences", confidences, expectedConfidences, confidences.size(), REASSOCIATION_TOLERANCE);
+            }
+
+            core.getConfidenceModel()._method = ConfidenceMethod::SILVA;
+
+            std::vector<float> selectionRanking(data.cols());
+            core.computeDimensionRanks(selectionRanking, selection);
+
+            std::vector<float> expectedSelectionRanking;
+            reference::computeSelectionRanks(metric, data, selection, expectedSelectionRanking);
+
+            verifier.compare(metricName + " selection ranks", selectionRanking, expectedSelectionRanking, selectionRanking.size(), REASSOCIATION_TOLERANCE);
+
+            verifyMultiScale(verifier, core, data, projection, radius, excluded, metric, metricName);
+
+            verifyClusters(verifier, core, data, clusterIds, numClusters, excluded, metric, metricName);
+
+            verifyLandmarks(verifier, core, data, radius, neighbourhoodMatrix, excluded, metric, metricName);
+
+            verifyTopRanks(verifier, core.getDataset(), core.getDataStatistics(), neighbourhoodMatrix, core.getProjection(), expectedRanks, metric, metricName + " top ranks");
+
+            verifyTopRankConfidences(verifier, core, expectedRanks, metricName);
+        }
+
+        // Local PCA of the lens and of all points
+        std::vector<unsigned int> allPoints(data.rows());
+        std::iota(allPoints.begin(), allPoints.end(), 0);
+
+        verifyLocalPCA(verifier, core, selection);
+        verifyLocalPCA(verifier, core, allPoints);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseArguments(argc, argv, options))
+        return EXIT_FAILURE;
+
+    std::mt19937 rng(options.seed);
+
+    Verifier verifier(options.verbose);
+
+    for (int d = 0; d < options.numDatasets; d++)
+    {
+        std::cout << "Dataset " << d + 1 << "/" << options.numDatasets << ": ";
+        verifyDataset(verifier, rng);
+    }
+
+    std::cout << verifier.getNumChecks() - verifier.getNumFailures() << "/" << verifier.getNumChecks() << " checks passed" << std::endl;
+
+    return verifier.getNumFailures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,362 @@
+#include "ReferenceKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    float sqrDistance(const DataMatrix& data, int a, int b)
+    {
+        float distance = 0;
+        for (int j = 0; j < data.cols(); j++)
+        {
+            float d = data(a, j) - data(b, j);
+            distance += d * d;
+        }
+        return distance;
+    }
+
+    float sqrDistance(const DataMatrix& data, const std::vector<float>& a, int b)
+    {
+        float distance = 0;
+        for (int j = 0; j < data.cols(); j++)
+        {
+            float d = a[j] - data(b, j);
+            distance += d * d;
+        }
+        return distance;
+    }
+}
+
+namespace reference
+{
+    Neighbourhood findNeighbourhood(const DataMatrix& projection, int centerId, float radius)
+    {
+        Neighbourhood neighbourhood;
+
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            float dx = projection(i, 0) - projection(centerId, 0);
+            float dy = projection(i, 1) - projection(centerId, 1);
+
+            if (dx * dx + dy * dy <= radius * radius)
+                neighbourhood.push_back(i);
+        }
+
+        return neighbourhood;
+    }
+
+    float findKthNearestDistance(const DataMatrix& projection, int centerId, int k)
+    {
+        std::vector<float> distances;
+
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            if (i == centerId)
+                continue;
+
+            float dx = projection(i, 0) - projection(centerId, 0);
+            float dy = projection(i, 1) - projection(centerId, 1);
+
+            distances.push_back(dx * dx + dy * dy);
+        }
+
+        if (distances.empty())
+            return 0;
+
+        std::sort(distances.begin(), distances.end());
+
+        return std::sqrt(distances[std::min<std::size_t>(k, distances.size()) - 1]);
+    }
+
+    std::vector<float> computeGlobalVariances(const DataMatrix& data)
+    {
+        std::vector<float> variances(data.cols());
+
+        for (int j = 0; j < data.cols(); j++)
+        {
+            float mean = 0;
+            for (int i = 0; i < data.rows(); i++)
+                mean += data(i, j);
+            mean /= data.rows();
+
+            float variance = 0;
+            for (int i = 0; i < data.rows(); i++)
+                variance += (data(i, j) - mean) * (data(i, j) - mean);
+            variance /= data.rows();
+
+            variances[j] = variance == 0 ? 1 : variance;
+        }
+
+        return variances;
+    }
+
+    std::vector<float> computeGlobalMeans(const DataMatrix& data)
+    {
+        std::vector<float> means(data.cols());
+
+        for (int j = 0; j < data.cols(); j++)
+        {
+            float mean = 0;
+            for (int i = 0; i < data.rows(); i++)
+                mean += data(i, j);
+            means[j] = mean / data.rows();
+        }
+
+        return means;
+    }
+
+    std::vector<float> computeRanges(const DataMatrix& data)
+    {
+        std::vector<float> ranges(data.cols());
+
+        for (int j = 0; j < data.cols(); j++)
+        {
+            float range = data.col(j).maxCoeff() - data.col(j).minCoeff();
+            ranges[j] = range == 0 ? 1 : range;
+        }
+
+        return ranges;
+    }
+
+    void computeVarianceRanks(const DataMatrix& data, const NeighbourhoodMatrix& neighbourhoodMatrix, DataMatrix& ranks)
+    {
+        const std::vector<float> globalVariances = computeGlobalVariances(data);
+
+        ranks.resize(data.rows(), data.cols());
+
+        std::vector<float> normalized(data.cols());
+        for (int i = 0; i < data.rows(); i++)
+        {
+            const Neighbourhood& neighbourhood = neighbourhoodMatrix[i];
+
+            float sum = 0;
+            for (int j = 0; j < data.cols(); j++)
+            {
+                float mean = 0;
+                for (const int n : neighbourhood)
+                    mean += data(n, j);
+                mean /= neighbourhood.size();
+
+                float variance = 0;
+                for (const int n : neighbourhood)
+                    variance += (data(n, j) - mean) * (data(n, j) - mean);
+                variance /= neighbourhood.size();
+
+                normalized[j] = variance / globalVariances[j];
+                sum += normalized[j];
+            }
+
+            for (int j = 0; j < data.cols(); j++)
+                ranks(i, j) = normalized[j] / sum;
+        }
+    }
+
+    void computeValueRanks(const DataMatrix& data, const NeighbourhoodMatrix& neighbourhoodMatrix, DataMatrix& ranks)
+    {
+        const std::vector<float> globalMeans = computeGlobalMeans(data);
+        const std::vector<float> ranges = computeRanges(data);
+
+        ranks.resize(data.rows(), data.cols());
+
+        std::vector<float> normalized(data.cols());
+        for (int i = 0; i < data.rows(); i++)
+        {
+            const Neighbourhood& neighbourhood = neighbourhoodMatrix[i];
+
+            float sum = 0;
+            for (int j = 0; j < data.cols(); j++)
+            {
+                float mean = 0;
+                for (const int n : neighbourhood)
+                    mean += data(n, j);
+                mean /= neighbourhood.size();
+
+                normalized[j] = (mean - globalMeans[j]) / ranges[j];
+                sum += std::abs(normalized[j]);
+            }
+
+            for (int j = 0; j < data.cols(); j++)
+                ranks(i, j) = normalized[j] / sum;
+        }
+    }
+
+    void computeEuclideanRanks(const DataMatrix& data, const NeighbourhoodMatrix& neighbourhoodMatrix, DataMatrix& ranks)
+    {
+        const std::vector<float> centroid = computeGlobalMeans(data);
+
+        // Average contribution of every dimension to the squared distance to the centroid
+        std::vector<float> globalContribs(data.cols(), 0);
+        for (int j = 0; j < data.cols(); j++)
+        {
+            for (int i = 0; i < data.rows(); i++)
+                globalContribs[j] += (centroid[j] - data(i, j)) * (centroid[j] - data(i, j)) / sqrDistance(data, centroid, i);
+            globalContribs[j] /= data.rows();
+        }
+
+        ranks.resize(data.rows(), data.cols());
+
+        std::vector<float> localContribs(data.cols());
+        for (int i = 0; i < data.rows(); i++)
+        {
+            const Neighbourhood& neighbourhood = neighbourhoodMatrix[i];
+
+            float sum = 0;
+            for (int j = 0; j < data.cols(); j++)
+            {
+                float contrib = 0;
+                for (const int n : neighbourhood)
+                    contrib += (data(i, j) - data(n, j)) * (data(i, j) - data(n, j)) / sqrDistance(data, i, n);
+                localContribs[j] = contrib / neighbourhood.size();
+
+                sum += localContribs[j] / globalContribs[j];
+            }
+
+            for (int j = 0; j < data.cols(); j++)
+                ranks(i, j) = (localContribs[j] / globalContribs[j]) / sum;
+        }
+    }
+
+    void computeSelectionRanks(Explanation::Metric metric, const DataMatrix& data, const std::vector<unsigned int>& selection, std::vector<float>& ranking)
+    {
+        ranking.assign(data.cols(), 0);
+
+        if (selection.empty())
+            return;
+
+        std::vector<float> normalized(data.cols());
+        float sum = 0;
+
+        if (metric == Explanation::Metric::VARIANCE)
+        {
+            const std::vector<float> globalVariances = computeGlobalVariances(data);
+
+            for (int j = 0; j < data.cols(); j++)
+            {
+                double mean = 0;
+                for (const unsigned int i : selection)
+                    mean += data(i, j);
+                mean /= selection.size();
+
+                double variance = 0;
+                for (const unsigned int i : selection)
+                    variance += (data(i, j) - mean) * (data(i, j) - mean);
+                variance /= selection.size();
+
+                normalized[j] = static_cast<float>(variance) / globalVariances[j];
+                sum += normalized[j];
+            }
+        }
+        else
+        {
+            const std::vector<float> globalMeans = computeGlobalMeans(data);
+            const std::vector<float> ranges = computeRanges(data);
+
+            for (int j = 0; j < data.cols(); j++)
+            {
+                double mean = 0;
+                for (const unsigned int i : selection)
+                    mean += data(i, j);
+                mean /= selection.size();
+
+                normalized[j] = (static_cast<float>(mean) - globalMeans[j]) / ranges[j];
+                sum += std::abs(normalized[j]);
+            }
+        }
+
+        for (int j = 0; j < data.cols(); j++)
+            ranking[j] = normalized[j] / sum;
+    }
+
+    void computeTopRankedDimensions(Explanation::Metric metric, const DataMatrix& ranks, const std::vector<bool>& excluded, std::vector<int>& topDimensions)
+    {
+        const bool lowRankBest = metric == Explanation::Metric::VARIANCE;
+
+        topDimensions.assign(ranks.rows(), static_cast<int>(ranks.cols()) - 1);
+
+        for (int i = 0; i < ranks.rows(); i++)
+        {
+            int topDim = -1;
+            for (int j = 0; j < ranks.cols(); j++)
+            {
+                if (excluded[j])
+                    continue;
+
+                if (topDim < 0 || (lowRankBest ? ranks(i, j) < ranks(i, topDim) : ranks(i, j) > ranks(i, topDim)))
+                    topDim = j;
+            }
+
+            if (topDim >= 0)
+                topDimensions[i] = topDim;
+        }
+    }
+
+    void computeConfidences(ConfidenceMethod method, Explanation::Metric metric, const DataMatrix& ranks, const std::vector<bool>& excluded, const NeighbourhoodMatrix& confidenceNeighbourhoods, std::vector<float>& confidences)
+    {
+        const int numPoints = static_cast<int>(ranks.rows());
+
+        // The confidence model picks its own top dimensions, falling back to the first dimension
+        std::vector<int> topDimensions(numPoints, 0);
+        for (int i = 0; i < numPoints; i++)
+        {
+            float best = metric == Explanation::Metric::VARIANCE ? std::numeric_limits<float>::max() : -std::numeric_limits<float>::max();
+
+            for (int j = 0; j < ranks.cols(); j++)
+            {
+                if (excluded[j])
+                    continue;
+
+                if (metric == Explanation::Metric::VARIANCE && ranks(i, j) < best) { best = ranks(i, j); topDimensions[i] = j; }
+                if (metric == Explanation::Metric::VALUE && ranks(i, j) > best) { best = ranks(i, j); topDimensions[i] = j; }
+            }
+        }
+
+        confidences.assign(numPoints, 0);
+
+        for (int i = 0; i < numPoints; i++)
+        {
+            const Neighbourhood& neighbourhood = confidenceNeighbourhoods[i];
+            const int topDim = topDimensions[i];
+
+            if (neighbourhood.empty())
+                continue;
+
+            if (method == ConfidenceMethod::SIMPLIFIED)
+            {
+                int count = 0;
+                for (const int n : neighbourhood)
+                    if (topDimensions[n] == topDim)
+                        count++;
+
+                confidences[i] = static_cast<float>(count) / neighbourhood.size();
+            }
+            else
+            {
+                // Summed top ranks of the neighbours sharing the top dimension over the summed ranks of that dimension
+                float shared = 0;
+                float total = 0;
+                for (const int n : neighbourhood)
+                {
+                    if (topDimensions[n] == topDim)
+                        shared += std::abs(ranks(n, topDim));
+
+                    total += std::abs(ranks(n, topDim));
+                }
+
+                confidences[i] = std::isnan(shared / total) ? 0 : shared / total;
+            }
+        }
+
+        float minConfidence = std::numeric_limits<float>::max();
+        float maxConfidence = -std::numeric_limits<float>::max();
+        for (const float confidence : confidences)
+        {
+            minConfidence = std::min(minConfidence, confidence);
+            maxConfidence = std::max(maxConfidence, confidence);
+        }
+
+        for (float& confidence : confidences)
+            confidence = (confidence - minConfidence) / (maxConfidence - minConfidence);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Explanation/DataTypes.h"
+#include "Explanation/ConfidenceModel.h"
+#include "Explanation/Methods/ExplanationMethod.h"
+
+#include <vector>
+
+/**
+ * Reference implementations of the explanation kernels
+ *
+ * Straightforward, single threaded transcriptions of the original maths of the explanation
+ * methods and the confidence model. They deliberately do not share code with the core, so
+ * faster production paths can be verified against them (see KernelVerification).
+ */
+namespace reference
+{
+    /** Sorted indices of all points within \p radius of point \p centerId (brute force) */
+    Neighbourhood findNeighbourhood(const DataMatrix& projection, int centerId, float radius);
+
+    /** Distance from point \p centerId to its k-th nearest other point (brute force) */
+    float findKthNearestDistance(const DataMatrix& projection, int centerId, int k);
+
+    /** Global variance per dimension, zero variances are replaced by one */
+    std::vector<float> computeGlobalVariances(const DataMatrix& data);
+
+    /** Global mean per dimension */
+    std::vector<float> computeGlobalMeans(const DataMatrix& data);
+
+    /** Value range per dimension, zero ranges are replaced by one */
+    std::vector<float> computeRanges(const DataMatrix& data);
+
+    /** Per-point variance ranks: local variance over global variance, normalized over the dimensions */
+    void computeVarianceRanks(const DataMatrix& data, const NeighbourhoodMatrix& neighbourhoodMatrix, DataMatrix& ranks);
+
+    /** Per-point value ranks: local mean minus global mean over the range, normalized by the absolute sum */
+    void computeValueRanks(const DataMatrix& data, const NeighbourhoodMatrix& neighbourhoodMatrix, DataMatrix& ranks);
+
+    /** Per-point Euclidean ranks: average per-dimension squared distance contribution over the global contribution */
+    void computeEuclideanRanks(const DataMatrix& data, const NeighbourhoodMatrix& neighbourhoodMatrix, DataMatrix& ranks);
+
+    /** Dimension ranking of a selection for the variance or value metric */
+    void computeSelectionRanks(Explanation::Metric metric, const DataMatrix& data, const std::vector<unsigned int>& selection, std::vector<float>& ranking);
+
+    /**
+     * Highest ranked dimension per point that is not excluded, the lowest index wins ties
+     * and the last dimension is used when all dimensions are excluded
+     */
+    void computeTopRankedDimensions(Explanation::Metric metric, const DataMatrix& ranks, const std::vector<bool>& excluded, std::vector<int>& topDimensions);
+
+    /** Normalized confidences of the confidence model, including its own top dimension selection */
+    void computeConfidences(ConfidenceMethod method, Explanation::Metric metric, const DataMatrix& ranks, const std::vector<bool>& excluded, const NeighbourhoodMatrix& confidenceNeighbourhoods, std::vector<float>& confidences);
+}
@@ -0,0 +1,352 @@
+#include "SyntheticData.h"
+#include "BenchmarkUtils.h"
+#include "InteractionTrace.h"
+
+#include "Explanation/ExplanationCore.h"
+#include "Explanation/Neighbourhood.h"
+#include "Explanation/Tracing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+/**
+ * Interactive-latency replay benchmark
+ *
+ * Replays a trace of lens moves, wheel steps and radius slider ticks through the explanation
+ * core, following the same path as the plugin: events are coalesced into at most one batch per
+ * frame (like the InteractionScheduler), a batch first applies the radius (neighbourhoods, metrics,
+ * colors and confidences) and then the lens (lens selection and selection ranking). Time advances
+ * on a virtual clock driven by the trace time stamps and the measured processing times, so the
+ * reported end-to-end latency of an event is the time from its arrival until the batch that
+ * handled it finished.
+ *
+ * Usage: ReplayBenchmark [--trace file] [--write-trace file] [--duration ms] [--frame-budget ms]
+ *                        [--points N] [--dims D] [--clusters K] [--skew S] [--spread W] [--seed S] [--output file]
+ *                        [--trace-output file]
+ */
+namespace
+{
+    struct Options
+    {
+        SyntheticDataParameters data;
+        std::string             tracePath;
+        std::string             writeTracePath;
+        std::string             outputPath;
+        std::string             traceOutputPath;
+        double                  duration        = 4000;
+        double                  frameBudget     = 1000.0 / 60.0;
+    };
+
+    /** Interaction state, mirrors the state the plugin keeps in its widgets */
+    struct InteractionState
+    {
+        float                       lensX           = 0.5f;     /** Lens x-coordinate normalized to the projection bounds */
+        float                       lensY           = 0.5f;     /** Lens y-coordinate normalized to the projection bounds */
+        float                       lensRadius      = 0.05f;    /** Lens radius relative to the projection diameter */
+        int                         sliderValue     = 10;       /** Neighbourhood radius slider value */
+        std::vector<unsigned int>   selection;                  /** Current lens selection */
+    };
+
+    /** Latency samples of one event type */
+    struct EventStatistics
+    {
+        std::vector<double>     latencies;
+        int                     numBatches = 0;
+    };
+
+    constexpr int NUM_VISIBLE_ROWS = 20;
+    constexpr float WHEEL_STEP = 0.005f;
+
+    bool parseArguments(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << argument << std::endl;
+                return false;
+            }
+
+            std::string value = argv[++i];
+
+            if (argument == "--trace")              options.tracePath = value;
+            else if (argument == "--write-trace")   options.writeTracePath = value;
+            else if (argument == "--output")        options.outputPath = value;
+            else if (argument == "--trace-output")  options.traceOutputPath = value;
+            else if (argument == "--duration")      options.duration = std::atof(value.c_str());
+            else if (argument == "--frame-budget")  options.frameBudget = std::atof(value.c_str());
+            else if (argument == "--points")        options.data.numPoints = std::atoi(value.c_str());
+            else if (argument == "--dims")          options.data.numDimensions = std::atoi(value.c_str());
+            else if (argument == "--clusters")      options.data.numClusters = std::atoi(value.c_str());
+            else if (argument == "--skew")          options.data.densitySkew = std::atof(value.c_str());
+            else if (argument == "--spread")        options.data.clusterSpread = std::atof(value.c_str());
+            else if (argument == "--seed")          options.data.seed = std::atoi(value.c_str());
+            else
+            {
+                std::cerr << "Unknown argument " << argument << std::endl;
+                return false;
+            }
+        }
+
+        return options.frameBudget > 0;
+    }
+
+    /** Rank the rows visible in the bar chart, like BarChart::setRanking */
+    void rankVisibleRows(const ExplanationCore& core, const std::vector<float>& ranking, std::vector<int>& sortIndices)
+    {
+        sortIndices.resize(ranking.size());
+        std::iota(sortIndices.begin(), sortIndices.end(), 0);
+
+        auto middle = sortIndices.begin() + std::min<std::size_t>(NUM_VISIBLE_ROWS, sortIndices.size());
+
+        if (core.currentMetric() == Explanation::Metric::VARIANCE)
+            std::partial_sort(sortIndices.begin(), middle, sortIndices.end(), [&](int i, int j) { return ranking[i] < ranking[j]; });
+        else
+            std::partial_sort(sortIndices.begin(), middle, sortIndices.end(), [&](int i, int j) { return ranking[i] > ranking[j]; });
+    }
+
+    /** Explain the current selection, the equivalent of ScatterplotPlugin::processSelectionUpdate */
+    void processSelection(ExplanationCore& core, const InteractionState& state)
+    {
+        if (state.selection.empty())
+            return;
+
+        std::vector<float> ranking(core.getDataset().numDimensions());
+        std::vector<int> sortIndices;
+
+        core.computeDimensionRanks(ranking, state.selection);
+        rankVisibleRows(core, ranking, sortIndices);
+    }
+
+    /** Apply the radius slider, the equivalent of ScatterplotPlugin::processRadiusUpdate */
+    void processRadius(ExplanationCore& core, const InteractionState& state)
+    {
+        core.recomputeNeighbourhood(state.sliderValue / 100.0f, 0, 1);
+        core.recomputeMetrics();
+
+        DataMatrix dimRanks;
+        core.computeDimensionRanks(dimRanks);
+        core.recomputeColorMapping(dimRanks);
+
+        processSelection(core, state);
+
+        std::vector<float> confidences = core.computeConfidences(dimRanks);
+
+        std::vector<int> topRankedDims;
+        core.computeTopRankedDimensions(dimRanks, topRankedDims);
+    }
+
+    /** Recompute the lens selection, the equivalent of ScatterplotPlugin::processLensUpdate */
+    void processLens(ExplanationCore& core, InteractionState& state, const float bounds[4], float diameter)
+    {
+        float x = bounds[0] + state.lensX * (bounds[1] - bounds[0]);
+        float y = bounds[2] + state.lensY * (bounds[3] - bounds[2]);
+
+        findPointsInCircle(core.getProjection(), x, y, state.lensRadius * diameter, state.selection, 0, 1);
+
+        processSelection(core, state);
+    }
+
+    void writeReport(std::ostream& stream, const Options& options, std::size_t numEvents, std::vector<EventStatistics>& eventStatistics, std::vector<double>& batchTimes, int numDroppedFrames)
+    {
+        JsonWriter json(stream);
+
+        json.beginObject();
+        json.value("benchmark", "interaction-replay");
+
+        json.beginObject("parameters");
+        json.value("numPoints", options.data.numPoints);
+        json.value("numDimensions", options.data.numDimensions);
+        json.value("numClusters", options.data.numClusters);
+        json.value("densitySkew", options.data.densitySkew);
+        json.value("trace", options.tracePath.empty() ? std::string("generated") : options.tracePath);
+        json.value("frameBudgetMs", options.frameBudget);
+        json.value("maxThreads", getMaxThreads());
+        json.endObject();
+
+        json.value("numEvents", numEvents);
+        json.value("numBatches", batchTimes.size());
+        json.value("droppedFrames", numDroppedFrames);
+
+        json.beginObject("batchProcessingMs");
+        json.value("p50", percentile(batchTimes, 50));
+        json.value("p95", percentile(batchTimes, 95));
+        json.value("p99", percentile(batchTimes, 99));
+        json.value("max", percentile(batchTimes, 100));
+        json.endObject();
+
+        json.beginObject("latencyMs");
+        for (std::size_t type = 0; type < eventStatistics.size(); type++)
+        {
+            EventStatistics& statistics = eventStatistics[type];
+
+            int numLate = static_cast<int>(std::count_if(statistics.latencies.begin(), statistics.latencies.end(), [&](double latency) { return latency > options.frameBudget; }));
+
+            json.beginObject(getEventTypeName(static_cast<InteractionEvent::Type>(type)));
+            json.value("count", statistics.latencies.size());
+            json.value("batches", statistics.numBatches);
+            json.value("lateEvents", numLate);
+            json.value("p50", percentile(statistics.latencies, 50));
+            json.value("p95", percentile(statistics.latencies, 95));
+            json.value("p99", percentile(statistics.latencies, 99));
+            json.value("max", percentile(statistics.latencies, 100));
+            json.endObject();
+        }
+        json.endObject();
+
+        json.endObject();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseArguments(argc, argv, options))
+        return EXIT_FAILURE;
+
+    // Load or generate the trace
+    InteractionTrace trace;
+    if (!options.tracePath.empty())
+    {
+        std::ifstream file(options.tracePath);
+        std::string error;
+        if (!file || !readTrace(file, trace, error))
+        {
+            std::cerr << "Could not read trace " << options.tracePath << ": " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        trace = generateTrace(options.duration, options.data.seed);
+    }
+
+    if (!options.writeTracePath.empty())
+    {
+        std::ofstream file(options.writeTracePath);
+        writeTrace(file, trace);
+    }
+
+    // Set up the core in the state the plugin is in after loading a dataset
+    DataMatrix data;
+    DataMatrix projection;
+    generateGaussianMixture(options.data, data, projection);
+
+    ExplanationCore core;
+    InteractionState state;
+
+    tracing::setEnabled(!options.traceOutputPath.empty());
+
+    core.setData(data, projection);
+    processRadius(core, state);
+
+    const DataMatrix& corePositions = core.getProjection();
+    const float bounds[4] = { corePositions.col(0).minCoeff(), corePositions.col(0).maxCoeff(), corePositions.col(1).minCoeff(), corePositions.col(1).maxCoeff() };
+    const float diameter = computeProjectionDiameter(corePositions, 0, 1);
+
+    std::vector<EventStatistics> eventStatistics(3);
+    std::vector<double> batchTimes;
+    int numDroppedFrames = 0;
+
+    double now = 0;
+    double lastBatchStart = -options.frameBudget;
+
+    std::size_t next = 0;
+    while (next < trace.size())
+    {
+        // A batch starts once an event is pending, no earlier than one frame after the previous batch and not while processing
+        double batchStart = std::max({ trace[next].time, now, lastBatchStart + options.frameBudget });
+
+        // Coalesce all events that arrived before the batch started
+        std::size_t batchEnd = next;
+        bool hasEventType[3] = { false, false, false };
+
+        while (batchEnd < trace.size() && trace[batchEnd].time <= batchStart)
+        {
+            const InteractionEvent& event = trace[batchEnd];
+
+            switch (event.type)
+            {
+            case InteractionEvent::Type::LENS:
+                state.lensX = event.x;
+                state.lensY = event.y;
+                break;
+            case InteractionEvent::Type::WHEEL:
+                state.lensRadius = std::max(WHEEL_STEP, state.lensRadius + event.x * WHEEL_STEP);
+                break;
+            case InteractionEvent::Type::SLIDER:
+                state.sliderValue = static_cast<int>(event.x);
+                break;
+            }
+
+            hasEventType[static_cast<int>(event.type)] = true;
+            batchEnd++;
+        }
+
+        bool radiusPending = hasEventType[static_cast<int>(InteractionEvent::Type::SLIDER)];
+        bool lensPending = hasEventType[static_cast<int>(InteractionEvent::Type::LENS)] || hasEventType[static_cast<int>(InteractionEvent::Type::WHEEL)];
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        {
+            TRACE_SCOPE("Replay batch");
+
+            if (radiusPending)
+                processRadius(core, state);
+
+            if (lensPending)
+                processLens(core, state, bounds, diameter);
+        }
+
+        double processingTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        double batchFinish = batchStart + processingTime;
+
+        // Every frame that passes while the batch is processed is a frame without an update
+        numDroppedFrames += static_cast<int>(processingTime / options.frameBudget);
+
+        for (std::size_t e = next; e < batchEnd; e++)
+            eventStatistics[static_cast<int>(trace[e].type)].latencies.push_back(batchFinish - trace[e].time);
+
+        for (int type = 0; type < 3; type++)
+            if (hasEventType[type])
+                eventStatistics[type].numBatches++;
+
+        batchTimes.push_back(processingTime);
+
+        now = batchFinish;
+        lastBatchStart = batchStart;
+        next = batchEnd;
+    }
+
+    if (options.outputPath.empty())
+    {
+        writeReport(std::cout, options, trace.size(), eventStatistics, batchTimes, numDroppedFrames);
+    }
+    else
+    {
+        std::ofstream file(options.outputPath);
+        if (!file)
+        {
+            std::cerr << "Could not open " << options.outputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        writeReport(file, options, trace.size(), eventStatistics, batchTimes, numDroppedFrames);
+    }
+
+    if (!options.traceOutputPath.empty() && !tracing::writeChromeTrace(options.traceOutputPath))
+    {
+        std::cerr << "Could not write trace " << options.traceOutputPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+#include "SyntheticData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+void generateGaussianMixture(const SyntheticDataParameters& parameters, DataMatrix& data, DataMatrix& projection, std::vector<int>* labels)
+{
+    std::mt19937 rng(parameters.seed);
+    std::normal_distribution<float> normal(0, 1);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    const int numClusters = std::max(1, parameters.numClusters);
+
+    // Cluster means in the data and the embedding
+    DataMatrix dataMeans(numClusters, parameters.numDimensions);
+    DataMatrix projectionMeans(numClusters, 2);
+    for (int c = 0; c < numClusters; c++)
+    {
+        for (int j = 0; j < parameters.numDimensions; j++)
+            dataMeans(c, j) = 3 * normal(rng);
+
+        projectionMeans(c, 0) = uniform(rng);
+        projectionMeans(c, 1) = uniform(rng);
+    }
+
+    // Cluster sizes follow a Zipf distribution to skew the point density
+    std::vector<double> weights(numClusters);
+    for (int c = 0; c < numClusters; c++)
+        weights[c] = 1.0 / std::pow(c + 1.0, parameters.densitySkew);
+
+    std::discrete_distribution<int> clusterDistribution(weights.begin(), weights.end());
+
+    data.resize(parameters.numPoints, parameters.numDimensions);
+    projection.resize(parameters.numPoints, 2);
+
+    if (labels != nullptr)
+        labels->resize(parameters.numPoints);
+
+    for (int i = 0; i < parameters.numPoints; i++)
+    {
+        int c = clusterDistribution(rng);
+
+        if (labels != nullptr)
+            (*labels)[i] = c;
+
+        for (int j = 0; j < parameters.numDimensions; j++)
+            data(i, j) = dataMeans(c, j) + normal(rng);
+
+        projection(i, 0) = projectionMeans(c, 0) + parameters.clusterSpread * normal(rng);
+        projection(i, 1) = projectionMeans(c, 1) + parameters.clusterSpread * normal(rng);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Explanation/DataTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+/** Parameters of a synthetic Gaussian mixture dataset with a 2D embedding */
+struct SyntheticDataParameters
+{
+    int             numPoints       = 10000;    /** Number of points */
+    int             numDimensions   = 50;       /** Number of high-dimensional attributes */
+    int             numClusters     = 8;        /** Number of mixture components */
+    float           densitySkew     = 0;        /** Zipf exponent of the cluster sizes, 0 gives equally sized clusters */
+    float           clusterSpread   = 0.05f;    /** Standard deviation of a cluster in the embedding, relative to the embedding extent */
+    std::uint32_t   seed            = 1;        /** Seed of the random generator */
+};
+
+/**
+ * Generate a Gaussian mixture in \p data with a matching 2D embedding in \p projection.
+ * Every cluster has a random high-dimensional mean with unit variance noise and a random
+ * position in the unit square of the embedding, so neighbourhoods in the embedding are
+ * dominated by points of the same cluster like in a real projection.
+ * The mixture component of every point is written to \p labels when given.
+ */
+void generateGaussianMixture(const SyntheticDataParameters& parameters, DataMatrix& data, DataMatrix& projection, std::vector<int>* labels = nullptr);
@@ -14,7 +14,9 @@ DatasetsAction::DatasetsAction(QObject* parent, const QString& title) :
     GroupAction(parent, title),
     _scatterplotPlugin(dynamic_cast<ScatterplotPlugin*>(parent->parent())),
     _positionDatasetPickerAction(this, "Position"),
-    _colorDatasetPickerAction(this, "Color")
+    _colorDatasetPickerAction(this, "Color"),
+    _clusterDatasetPickerAction(this, "Explanation clusters"),
+    _explainClustersAction(this, "Explain by clusters", false)
 {
     setIcon(mv::Application::getIconFont("FontAwesome").getIcon("database"));
     setToolTip("Manage loaded datasets for position and color");
@@ -23,6 +25,10 @@ DatasetsAction::DatasetsAction(QObject* parent, const QString& title) :
 
     addAction(&_positionDatasetPickerAction);
     addAction(&_colorDatasetPickerAction);
+    addAction(&_clusterDatasetPickerAction);
+    addAction(&_explainClustersAction);
+
+    _explainClustersAction.setToolTip("Explain every cluster of the explanation clusters as a whole instead of the radius neighbourhood of every point");
 
     _positionDatasetPickerAction.setFilterFunction([](const mv::Dataset<DatasetImpl>& dataset) -> bool {
         return dataset->getDataType() == PointType;
@@ -32,6 +38,10 @@ DatasetsAction::DatasetsAction(QObject* parent, const QString& title) :
         return dataset->getDataType() == PointType || dataset->getDataType() == ColorType || dataset->getDataType() == ClusterType;
     });
 
+    _clusterDatasetPickerAction.setFilterFunction([](const mv::Dataset<DatasetImpl>& dataset) -> bool {
+        return dataset->getDataType() == ClusterType;
+    });
+
     auto scatterplotPlugin = dynamic_cast<ScatterplotPlugin*>(parent->parent());
 
     if (scatterplotPlugin == nullptr)
@@ -52,6 +62,9 @@ DatasetsAction::DatasetsAction(QObject* parent, const QString& title) :
     connect(&scatterplotPlugin->getSettingsAction().getColoringAction(), &ColoringAction::currentColorDatasetChanged, this, [this](Dataset<DatasetImpl> currentColorDataset) -> void {
         _colorDatasetPickerAction.setCurrentDataset(currentColorDataset);
     });
+
+    connect(&_clusterDatasetPickerAction, &DatasetPickerAction::datasetPicked, scatterplotPlugin, &ScatterplotPlugin::updateExplanationClusters);
+    connect(&_explainClustersAction, &ToggleAction::toggled, scatterplotPlugin, &ScatterplotPlugin::updateExplanationClusters);
 }
 
 void DatasetsAction::connectToPublicAction(WidgetAction* publicAction, bool recursive)
@@ -66,6 +79,8 @@ void DatasetsAction::connectToPublicAction(WidgetAction* publicAction, bool recu
     if (recursive) {
         actions().connectPrivateActionToPublicAction(&_positionDatasetPickerAction, &publicDatasetsAction->getPositionDatasetPickerAction(), recursive);
         actions().connectPrivateActionToPublicAction(&_colorDatasetPickerAction, &publicDatasetsAction->getColorDatasetPickerAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_clusterDatasetPickerAction, &publicDatasetsAction->getClusterDatasetPickerAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_explainClustersAction, &publicDatasetsAction->getExplainClustersAction(), recursive);
     }
 
     GroupAction::connectToPublicAction(publicAction, recursive);
@@ -79,6 +94,8 @@ void DatasetsAction::disconnectFromPublicAction(bool recursive)
     if (recursive) {
         actions().disconnectPrivateActionFromPublicAction(&_positionDatasetPickerAction, recursive);
         actions().disconnectPrivateActionFromPublicAction(&_colorDatasetPickerAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_clusterDatasetPickerAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_explainClustersAction, recursive);
     }
 
     GroupAction::disconnectFromPublicAction(recursive);
@@ -90,6 +107,8 @@ void DatasetsAction::fromVariantMap(const QVariantMap& variantMap)
 
     _positionDatasetPickerAction.fromParentVariantMap(variantMap);
     _colorDatasetPickerAction.fromParentVariantMap(variantMap);
+    _clusterDatasetPickerAction.fromParentVariantMap(variantMap);
+    _explainClustersAction.fromParentVariantMap(variantMap);
 }
 
 QVariantMap DatasetsAction::toVariantMap() const
@@ -98,6 +117,8 @@ QVariantMap DatasetsAction::toVariantMap() const
 
     _positionDatasetPickerAction.insertIntoVariantMap(variantMap);
     _colorDatasetPickerAction.insertIntoVariantMap(variantMap);
+    _clusterDatasetPickerAction.insertIntoVariantMap(variantMap);
+    _explainClustersAction.insertIntoVariantMap(variantMap);
 
     return variantMap;
 }
@@ -2,6 +2,7 @@
 
 #include <actions/GroupAction.h>
 #include <actions/DatasetPickerAction.h>
+#include <actions/ToggleAction.h>
 
 using namespace mv::gui;
 
@@ -53,11 +54,15 @@ public: // Action getters
 
     DatasetPickerAction& getPositionDatasetPickerAction() { return _positionDatasetPickerAction; }
     DatasetPickerAction& getColorDatasetPickerAction() { return _colorDatasetPickerAction; }
+    DatasetPickerAction& getClusterDatasetPickerAction() { return _clusterDatasetPickerAction; }
+    ToggleAction& getExplainClustersAction() { return _explainClustersAction; }
 
 private:
     ScatterplotPlugin*      _scatterplotPlugin;                 /** Pointer to scatter plot plugin */
     DatasetPickerAction	    _positionDatasetPickerAction;       /** Dataset picker action for position dataset */
     DatasetPickerAction     _colorDatasetPickerAction;          /** Dataset picker action for color dataset */
+    DatasetPickerAction     _clusterDatasetPickerAction;        /** Dataset picker action for the clusters to explain */
+    ToggleAction            _explainClustersAction;             /** Whether to explain the clusters instead of the radius neighbourhoods */
 
     friend class mv::AbstractActionsManager;
 };
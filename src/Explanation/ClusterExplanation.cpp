@@ -0,0 +1,363 @@
+#include "ClusterExplanation.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace
+{
+    /** Points per block of the statistics pass, each block is traversed one (contiguous) dimension at a time */
+    constexpr int BLOCK_SIZE = 4096;
+}
+
+ClusterExplanation::ClusterExplanation() :
+    _numClusters(0),
+    _hasStatistics(false)
+{
+
+}
+
+void ClusterExplanation::setClusters(std::vector<int> clusterIds, int numClusters)
+{
+    clear();
+
+    _clusterIds = std::move(clusterIds);
+    _numClusters = std::max(0, numClusters);
+}
+
+void ClusterExplanation::clear()
+{
+    _clusterIds = std::vector<int>();
+    _numClusters = 0;
+    _hasStatistics = false;
+
+    _clusterSizes = std::vector<int>();
+    _means.resize(0, 0);
+    _variances.resize(0, 0);
+    _distContribs.resize(0, 0);
+    _globalDistContribs = std::vector<float>();
+
+    _ranks.resize(0, 0);
+    _topDimensions = std::vector<int>();
+    _confidences = std::vector<float>();
+}
+
+bool ClusterExplanation::compute(const DataTable& dataset, const DataStatistics& dataStats, Explanation::Metric metric)
+{
+    if (!hasClusters() || static_cast<int>(_clusterIds.size()) != dataset.numPoints() || dataset.numDimensions() == 0)
+        return false;
+
+    TRACE_SCOPE("ClusterExplanation::compute");
+    TRACE_COUNTER("Clusters", _numClusters);
+
+    if (!_hasStatistics)
+        computeStatistics(dataset);
+
+    if (metric == Explanation::Metric::EUCLIDEAN && _distContribs.size() == 0)
+        computeDistContribs(dataset, dataStats);
+
+    computeRanks(dataset, dataStats, metric);
+    computeTopDimensions(dataset, metric);
+    computeConfidences(dataset);
+
+    return true;
+}
+
+std::vector<int> ClusterExplanation::computeTopCounts(const DataTable& dataset) const
+{
+    std::vector<int> topCounts(dataset.numDimensions(), 0);
+
+    for (int c = 0; c < static_cast<int>(_topDimensions.size()); c++)
+        if (!dataset.isExcluded(_topDimensions[c])) topCounts[_topDimensions[c]] += _clusterSizes[c];
+
+    return topCounts;
+}
+
+void ClusterExplanation::broadcast(std::vector<int>& topRankedDims, std::vector<float>& confidences) const
+{
+    TRACE_SCOPE("ClusterExplanation::broadcast");
+
+    const int numPoints = static_cast<int>(_clusterIds.size());
+
+    topRankedDims.resize(numPoints);
+    confidences.resize(numPoints);
+
+#pragma omp parallel for
+    for (int i = 0; i < numPoints; i++)
+    {
+        const int c = _clusterIds[i];
+
+        topRankedDims[i] = c >= 0 ? _topDimensions[c] : -1;
+        confidences[i] = c >= 0 ? _confidences[c] : 0.0f;
+    }
+}
+
+std::size_t ClusterExplanation::getMemoryUsage() const
+{
+    return (_clusterIds.capacity() + _clusterSizes.capacity() + _topDimensions.capacity()) * sizeof(int)
+        + static_cast<std::size_t>(_means.size() + _variances.size() + _distContribs.size() + _ranks.size()) * sizeof(float)
+        + (_globalDistContribs.capacity() + _confidences.capacity()) * sizeof(float);
+}
+
+void ClusterExplanation::computeStatistics(const DataTable& dataset)
+{
+    TRACE_SCOPE("ClusterExplanation::computeStatistics");
+
+    const int numPoints = dataset.numPoints();
+    const int numDimensions = dataset.numDimensions();
+    const int numBlocks = (numPoints + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    const std::size_t numEntries = static_cast<std::size_t>(_numClusters) * numDimensions;
+
+    std::vector<int> sizes(_numClusters, 0);
+    std::vector<double> sums(numEntries, 0);
+    std::vector<double> squares(numEntries, 0);
+
+#pragma omp parallel
+    {
+        std::vector<int> localSizes(_numClusters, 0);
+        std::vector<double> localSums(numEntries, 0);
+        std::vector<double> localSquares(numEntries, 0);
+
+#pragma omp for schedule(static) nowait
+        for (int b = 0; b < numBlocks; b++)
+        {
+            const int begin = b * BLOCK_SIZE;
+            const int end = std::min(numPoints, begin + BLOCK_SIZE);
+
+            for (int i = begin; i < end; i++)
+                if (_clusterIds[i] >= 0) localSizes[_clusterIds[i]]++;
+
+            for (int j = 0; j < numDimensions; j++)
+            {
+                for (int i = begin; i < end; i++)
+                {
+                    const int c = _clusterIds[i];
+
+                    if (c < 0)
+                        continue;
+
+                    const double value = dataset(i, j);
+
+                    localSums[static_cast<std::size_t>(c) * numDimensions + j] += value;
+                    localSquares[static_cast<std::size_t>(c) * numDimensions + j] += value * value;
+                }
+            }
+        }
+
+#pragma omp critical
+        {
+            for (int c = 0; c < _numClusters; c++)
+                sizes[c] += localSizes[c];
+
+            for (std::size_t k = 0; k < numEntries; k++)
+            {
+                sums[k] += localSums[k];
+                squares[k] += localSquares[k];
+            }
+        }
+    }
+
+    _clusterSizes = sizes;
+    _means.resize(_numClusters, numDimensions);
+    _variances.resize(_numClusters, numDimensions);
+
+    for (int c = 0; c < _numClusters; c++)
+    {
+        for (int j = 0; j < numDimensions; j++)
+        {
+            const std::size_t k = static_cast<std::size_t>(c) * numDimensions + j;
+
+            const double mean = sizes[c] > 0 ? sums[k] / sizes[c] : 0.0;
+
+            _means(c, j) = static_cast<float>(mean);
+            _variances(c, j) = sizes[c] > 0 ? static_cast<float>(std::max(0.0, squares[k] / sizes[c] - mean * mean)) : 0.0f;
+        }
+    }
+
+    // The euclidean contributions depend on the cluster means
+    _distContribs.resize(0, 0);
+    _globalDistContribs = std::vector<float>();
+
+    _hasStatistics = true;
+}
+
+void ClusterExplanation::computeDistContribs(const DataTable& dataset, const DataStatistics& dataStats)
+{
+    TRACE_SCOPE("ClusterExplanation::computeDistContribs");
+
+    const int numPoints = dataset.numPoints();
+    const int numDimensions = dataset.numDimensions();
+
+    const std::size_t numEntries = static_cast<std::size_t>(_numClusters) * numDimensions;
+
+    std::vector<double> contribs(numEntries, 0);
+    std::vector<double> globalContribs(numDimensions, 0);
+
+#pragma omp parallel
+    {
+        std::vector<double> localContribs(numEntries, 0);
+        std::vector<double> localGlobalContribs(numDimensions, 0);
+        std::vector<double> clusterDiffs(numDimensions);
+        std::vector<double> globalDiffs(numDimensions);
+
+#pragma omp for schedule(static) nowait
+        for (int i = 0; i < numPoints; i++)
+        {
+            const int c = _clusterIds[i];
+
+            // Share of every dimension in the squared distance to the cluster and the global centroid
+            double clusterDistance = 0;
+            double globalDistance = 0;
+            for (int j = 0; j < numDimensions; j++)
+            {
+                clusterDiffs[j] = c >= 0 ? dataset(i, j) - _means(c, j) : 0.0;
+                globalDiffs[j] = dataset(i, j) - dataStats.means[j];
+
+                clusterDiffs[j] *= clusterDiffs[j];
+                globalDiffs[j] *= globalDiffs[j];
+
+                clusterDistance += clusterDiffs[j];
+                globalDistance += globalDiffs[j];
+            }
+
+            for (int j = 0; j < numDimensions; j++)
+            {
+                if (clusterDistance > 0)
+                    localContribs[static_cast<std::size_t>(c) * numDimensions + j] += clusterDiffs[j] / clusterDistance;
+
+                if (globalDistance > 0)
+                    localGlobalContribs[j] += globalDiffs[j] / globalDistance;
+            }
+        }
+
+#pragma omp critical
+        {
+            for (std::size_t k = 0; k < numEntries; k++)
+                contribs[k] += localContribs[k];
+
+            for (int j = 0; j < numDimensions; j++)
+                globalContribs[j] += localGlobalContribs[j];
+        }
+    }
+
+    _distContribs.resize(_numClusters, numDimensions);
+    _globalDistContribs.resize(numDimensions);
+
+    for (int c = 0; c < _numClusters; c++)
+        for (int j = 0; j < numDimensions; j++)
+            _distContribs(c, j) = _clusterSizes[c] > 0 ? static_cast<float>(contribs[static_cast<std::size_t>(c) * numDimensions + j] / _clusterSizes[c]) : 0.0f;
+
+    for (int j = 0; j < numDimensions; j++)
+    {
+        _globalDistContribs[j] = static_cast<float>(globalContribs[j] / numPoints);
+
+        if (_globalDistContribs[j] == 0) _globalDistContribs[j] = 1;
+    }
+}
+
+void ClusterExplanation::computeRanks(const DataTable& dataset, const DataStatistics& dataStats, Explanation::Metric metric)
+{
+    const int numDimensions = dataset.numDimensions();
+
+    _ranks.resize(_numClusters, numDimensions);
+
+    std::vector<float> scores(numDimensions);
+
+    const std::vector<double> globalVariances = dataStats.getNormalizingVariances();
+
+    for (int c = 0; c < _numClusters; c++)
+    {
+        // Scores of the explanation methods with the cluster as neighbourhood, normalized to ranks like the methods do
+        float sum = 0;
+        for (int j = 0; j < numDimensions; j++)
+        {
+            switch (metric)
+            {
+            case Explanation::Metric::VARIANCE: scores[j] = _variances(c, j) / static_cast<float>(globalVariances[j]); break;
+            case Explanation::Metric::VALUE: scores[j] = (_means(c, j) - dataStats.means[j]) / dataStats.ranges[j]; break;
+            case Explanation::Metric::EUCLIDEAN: scores[j] = _distContribs(c, j) / _globalDistContribs[j]; break;
+            default: scores[j] = 0; break;
+            }
+
+            sum += std::abs(scores[j]);
+        }
+
+        for (int j = 0; j < numDimensions; j++)
+            _ranks(c, j) = sum > 0 ? scores[j] / sum : 0.0f;
+    }
+}
+
+void ClusterExplanation::computeTopDimensions(const DataTable& dataset, Explanation::Metric metric)
+{
+    const bool lowRankBest = metric == Explanation::Metric::VARIANCE;
+
+    const std::vector<int> includedDims = dataset.getIncludedDimensions();
+
+    _topDimensions.resize(_numClusters);
+
+    for (int c = 0; c < _numClusters; c++)
+    {
+        int topDim = includedDims[0];
+        for (const int j : includedDims)
+            if (lowRankBest ? _ranks(c, j) < _ranks(c, topDim) : _ranks(c, j) > _ranks(c, topDim))
+                topDim = j;
+
+        _topDimensions[c] = topDim;
+    }
+}
+
+void ClusterExplanation::computeConfidences(const DataTable& dataset)
+{
+    const std::vector<int> includedDims = dataset.getIncludedDimensions();
+
+    _confidences.assign(_numClusters, 0.0f);
+
+    // Margin between the top ranked dimension and the runner-up, 0 when they tie
+    for (int c = 0; c < _numClusters; c++)
+    {
+        const int topDim = _topDimensions[c];
+
+        if (_clusterSizes[c] == 0)
+            continue;
+
+        if (includedDims.size() < 2)
+        {
+            _confidences[c] = 1;
+            continue;
+        }
+
+        const float topRank = _ranks(c, topDim);
+
+        float runnerUp = std::numeric_limits<float>::quiet_NaN();
+        for (const int j : includedDims)
+            if (j != topDim && (std::isnan(runnerUp) || std::abs(_ranks(c, j) - topRank) < std::abs(runnerUp - topRank)))
+                runnerUp = _ranks(c, j);
+
+        const float magnitude = std::abs(topRank) + std::abs(runnerUp);
+
+        _confidences[c] = magnitude > 0 ? std::abs(topRank - runnerUp) / magnitude : 0.0f;
+    }
+
+    // Normalize over the (non-empty) clusters, like the point confidences
+    float minVal = std::numeric_limits<float>::max();
+    float maxVal = -std::numeric_limits<float>::max();
+    for (int c = 0; c < _numClusters; c++)
+    {
+        if (_clusterSizes[c] == 0)
+            continue;
+
+        minVal = std::min(minVal, _confidences[c]);
+        maxVal = std::max(maxVal, _confidences[c]);
+    }
+
+    for (int c = 0; c < _numClusters; c++)
+    {
+        if (_clusterSizes[c] == 0)
+            continue;
+
+        _confidences[c] = maxVal > minVal ? (_confidences[c] - minVal) / (maxVal - minVal) : 1.0f;
+    }
+}
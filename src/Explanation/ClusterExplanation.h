@@ -0,0 +1,100 @@
+#pragma once
+
+#include "DataTypes.h"
+#include "Methods/ExplanationMethod.h"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Cluster explanation class
+ *
+ * Explains the projection per cluster instead of per radius neighbourhood: the members of a
+ * cluster form the neighbourhood of every member. The statistics of all clusters are gathered
+ * in a single parallel pass over the data, after which ranks, top dimensions and confidences
+ * are evaluated once per cluster and broadcast to the members, so the cost of an explanation
+ * no longer depends on the size or density of the neighbourhoods.
+ *
+ * The ranks follow the explanation methods with the cluster as neighbourhood; the euclidean
+ * contributions are taken relative to the cluster centroid, as the global contributions are
+ * relative to the global centroid. The confidence of a cluster is the margin between its top
+ * ranked dimension and the runner-up, normalized over the clusters like the point confidences.
+ */
+class ClusterExplanation
+{
+public:
+    ClusterExplanation();
+
+    /**
+     * Set the clusters to explain, drops any previous explanation
+     * @param clusterIds Cluster index of every point, -1 for points in no cluster
+     * @param numClusters Number of clusters
+     */
+    void setClusters(std::vector<int> clusterIds, int numClusters);
+
+    /** Drop the clusters and their explanation */
+    void clear();
+
+    /** Drop the statistics of the clusters (on data change), keeping the clusters */
+    void invalidate() { _hasStatistics = false; }
+
+    bool hasClusters() const { return _numClusters > 0; }
+    int numClusters() const { return _numClusters; }
+
+    /**
+     * Compute the per-cluster statistics when they are missing and explain the clusters
+     * @param dataset High-dimensional data, one row per point
+     * @param dataStats Global statistics of the data
+     * @param metric Explanation metric
+     * @return Whether the clusters were explained, false when there are no clusters
+     */
+    bool compute(const DataTable& dataset, const DataStatistics& dataStats, Explanation::Metric metric);
+
+    /** Get the dimension ranks of every cluster, one row per cluster */
+    const DataMatrix& getRanks() const { return _ranks; }
+
+    /** Get the top ranked dimension of every cluster */
+    const std::vector<int>& getTopDimensions() const { return _topDimensions; }
+
+    /** Get the normalized confidence of every cluster */
+    const std::vector<float>& getConfidences() const { return _confidences; }
+
+    /** Get the number of points for which every dimension is top ranked, to assign the colors */
+    std::vector<int> computeTopCounts(const DataTable& dataset) const;
+
+    /**
+     * Broadcast the cluster explanation to the points
+     * @param topRankedDims Output top ranked dimension of every point, -1 for points in no cluster
+     * @param confidences Output confidence of every point, 0 for points in no cluster
+     */
+    void broadcast(std::vector<int>& topRankedDims, std::vector<float>& confidences) const;
+
+    /** Get the number of bytes held by the clusters and their statistics */
+    std::size_t getMemoryUsage() const;
+
+private:
+    /** Gather the sizes, means and variances of all clusters in one pass */
+    void computeStatistics(const DataTable& dataset);
+
+    /** Gather the euclidean contributions relative to the cluster and global centroids, a second pass only needed for the euclidean metric */
+    void computeDistContribs(const DataTable& dataset, const DataStatistics& dataStats);
+
+    void computeRanks(const DataTable& dataset, const DataStatistics& dataStats, Explanation::Metric metric);
+    void computeTopDimensions(const DataTable& dataset, Explanation::Metric metric);
+    void computeConfidences(const DataTable& dataset);
+
+private:
+    std::vector<int>        _clusterIds;                /** Cluster index of every point, -1 when in no cluster */
+    int                     _numClusters;               /** Number of clusters */
+    bool                    _hasStatistics;             /** Whether the statistics belong to the current clusters and data */
+
+    std::vector<int>        _clusterSizes;              /** Number of members of every cluster */
+    DataMatrix              _means;                     /** Mean of every dimension per cluster */
+    DataMatrix              _variances;                 /** Variance of every dimension per cluster */
+    DataMatrix              _distContribs;              /** Mean euclidean contribution of every dimension per cluster */
+    std::vector<float>      _globalDistContribs;        /** Mean euclidean contribution of every dimension over all points */
+
+    DataMatrix              _ranks;                     /** Dimension ranks per cluster */
+    std::vector<int>        _topDimensions;             /** Top ranked dimension per cluster */
+    std::vector<float>      _confidences;               /** Normalized confidence per cluster */
+};
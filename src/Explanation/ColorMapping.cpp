@@ -1,31 +1,27 @@
 #include "ColorMapping.h"
+#include "Tracing.h"
 
 #include <unordered_set>
 #include <algorithm>
-#include <iostream>
+#include <numeric>
+#include <limits>
 
-ColorMapping::ColorMapping()
+ColorMapping::ColorMapping(int paletteSize) :
+    _paletteSize(paletteSize)
 {
-    // Initialize color palette
-    _palette.resize(20); // "#31a09a", "#59a14f", "#A13237"
-    const char* kelly_colors[] = { "#F3C300", "#875692", "#F38400", "#A1CAF1", "#BE0032", "#C2B280", "#59a14f", "#008856", "#E68FAC", "#0067A5", "#F99379", "#604E97", "#F6A600", "#B3446C", "#DCD300", "#882D17", "#8DB600", "#654522", "#E25822", "#2B3D26" };
-    for (int i = 0; i < _palette.size(); i++)
-    {
-        _palette[i].setNamedColor(kelly_colors[i]);
-    }
+
 }
 
 void ColorMapping::recreate(const DataTable& dataset)
 {
     // Create color mapping
-    _colorMapping.resize(dataset.numDimensions());
-    for (int i = 0; i < _colorMapping.size(); i++)
+    _paletteIndices.resize(dataset.numDimensions());
+    for (int i = 0; i < _paletteIndices.size(); i++)
     {
-        QColor color = (i < _palette.size()) ? _palette[i] : QColor(180, 180, 180);
-        _colorMapping[i] = color;
+        _paletteIndices[i] = (i < _paletteSize) ? i : -1;
     }
 
-    _dimAssignment.resize(_palette.size());
+    _dimAssignment.resize(_paletteSize);
     std::iota(_dimAssignment.begin(), _dimAssignment.end(), 0);
 }
 
@@ -64,6 +60,8 @@ void computeNewColorAssignment(const std::vector<int> oldMapping, const std::vec
 
 void ColorMapping::recompute(const DataTable& dataset, const DataMatrix& dimRanking, Explanation::Metric metric)
 {
+    TRACE_SCOPE("ColorMapping::recompute");
+
     bool lowRankBest = metric == Explanation::Metric::VARIANCE ? true : false;
 
     const int numDimensions = dimRanking.cols();
@@ -95,30 +93,25 @@ void ColorMapping::recompute(const DataTable& dataset, const DataMatrix& dimRank
             else { if (rank >= topRank) topCount[j]++; }
         }
     }
-    for (int i = 0; i < numDimensions; i++)
-    {
-        std::cout << "Top count: " << i << " " << topCount[i] << std::endl;
-    }
+
+    recompute(topCount);
+}
+
+void ColorMapping::recompute(const std::vector<int>& topCount)
+{
+    const int numDimensions = topCount.size();
+
     std::vector<int> indices(numDimensions);
     std::iota(indices.begin(), indices.end(), 0);
     std::sort(indices.begin(), indices.end(), [&](int a, int b) {return topCount[a] > topCount[b]; });
 
-    for (int i = 0; i < numDimensions; i++)
-    {
-        std::cout << "Top indices: " << indices[i] << std::endl;
-    }
-
     computeNewColorAssignment(_dimAssignment, indices, _dimAssignment);
 
-    std::vector<QColor> newMapping(numDimensions);
-    for (int i = 0; i < newMapping.size(); i++)
-    {
-        newMapping[i] = QColor(180, 180, 180);
-    }
-    int numTopDimensions = std::min(_palette.size(), newMapping.size());
+    std::vector<int> newMapping(numDimensions, -1);
+    int numTopDimensions = std::min(_paletteSize, numDimensions);
     for (int i = 0; i < numTopDimensions; i++)
     {
-        newMapping[_dimAssignment[i]] = _palette[i];
+        newMapping[_dimAssignment[i]] = i;
     }
-    _colorMapping = newMapping;
+    _paletteIndices = newMapping;
 }
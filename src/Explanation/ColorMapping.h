@@ -3,24 +3,37 @@
 #include "DataTypes.h"
 #include "Methods/ExplanationMethod.h"
 
-#include <QColor>
-
 #include <vector>
 
+/**
+ * Color mapping class
+ *
+ * Assigns the colors of a palette to the dimensions that are top-ranked for the most points,
+ * keeping colors stable for dimensions that remain in the top. Colors are referred to by their
+ * index in the palette, so the mapping does not depend on a particular color type.
+ */
 class ColorMapping
 {
 public:
-    ColorMapping();
+    ColorMapping(int paletteSize = 20);
+
+    int getPaletteSize() const { return _paletteSize; }
 
-    const std::vector<QColor>& getPalette() { return _palette; }
-    const std::vector<QColor>& getColors() { return _colorMapping; }
+    /** Get the palette index assigned to every dimension, or -1 if the dimension has no color */
+    const std::vector<int>& getPaletteIndices() const { return _paletteIndices; }
 
     void recreate(const DataTable& dataset);
     void recompute(const DataTable& dataset, const DataMatrix& dimRanking, Explanation::Metric metric);
 
+    /**
+     * Recompute the color assignment from the number of points for which each dimension is top ranked
+     * @param topCounts Number of points per dimension
+     */
+    void recompute(const std::vector<int>& topCounts);
+
 private:
-    std::vector<QColor> _palette;
-    std::vector<QColor> _colorMapping;
+    int _paletteSize;
+    std::vector<int> _paletteIndices;
 
     std::vector<int> _dimAssignment;
 };
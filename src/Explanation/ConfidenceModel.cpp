@@ -1,7 +1,8 @@
 #include "ConfidenceModel.h"
+#include "Tracing.h"
 
-#include <chrono>
-#include <iostream>
+#include <cmath>
+#include <limits>
 
 namespace
 {
@@ -39,16 +40,18 @@ namespace
 
 void ConfidenceModel::silvaConfidence(const std::vector<int>& topDimensions, const DataMatrix& dimRanks, std::vector<float>& confidences)
 {
-    auto start = std::chrono::high_resolution_clock::now();
+    TRACE_SCOPE("ConfidenceModel::silvaConfidence");
 
     int numPoints = dimRanks.rows();
     int numDimensions = dimRanks.cols();
 
+    const NeighbourhoodMatrix& confidenceNeighbourhoods = *_confidenceNeighbourhoodMatrix;
+
     // Compute confidences
     confidences.resize(numPoints);
     for (int i = 0; i < numPoints; i++)
     {
-        const std::vector<int>& neighbourhood = _confidenceNeighbourhoodMatrix[i];
+        const std::vector<int>& neighbourhood = confidenceNeighbourhoods[i];
 
         // Add top-1 rankings over all neighbouring points in vector
         std::vector<float> topRankings(numDimensions, 0);
@@ -76,24 +79,63 @@ void ConfidenceModel::silvaConfidence(const std::vector<int>& topDimensions, con
         if (neighbourhood.size() == 0)
             confidences[i] = 0;
     }
+}
+
+void ConfidenceModel::silvaConfidence(const std::vector<int>& topDimensions, const TopRanks& topRanks, std::vector<float>& confidences)
+{
+    TRACE_SCOPE("ConfidenceModel::silvaConfidence");
+
+    int numPoints = topRanks.numPoints();
+    int lastRank = topRanks.getK() - 1;
+
+    const NeighbourhoodMatrix& confidenceNeighbourhoods = *_confidenceNeighbourhoodMatrix;
+
+    // Compute confidences
+    confidences.resize(numPoints);
+
+#pragma omp parallel for
+    for (int i = 0; i < numPoints; i++)
+    {
+        const std::vector<int>& neighbourhood = confidenceNeighbourhoods[i];
+
+        // Top-1 rankings of the neighbours with the same top dimension, and the total ranking of that dimension
+        int topDim = topDimensions[i];
+        float topRanking = 0;
+        float totalRank = 0;
+        for (const int ni : neighbourhood)
+        {
+            float rank = topRanks.getRank(ni, lastRank);
+            topRanks.findRank(ni, topDim, rank);
+
+            if (topDimensions[ni] == topDim)
+                topRanking += std::abs(rank);
+
+            totalRank += std::abs(rank);
+        }
+
+        confidences[i] = topRanking / totalRank;
+
+        if (std::isnan(confidences[i]))
+            confidences[i] = 0;
 
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-    std::cout << "Confidence Elapsed time: " << elapsed.count() << " s\n";
+        if (neighbourhood.size() == 0)
+            confidences[i] = 0;
+    }
 }
 
-void ConfidenceModel::simplifiedConfidence(const std::vector<int>& topDimensions, const DataMatrix& dimRanks, std::vector<float>& confidences)
+void ConfidenceModel::simplifiedConfidence(const std::vector<int>& topDimensions, std::vector<float>& confidences)
 {
-    auto start = std::chrono::high_resolution_clock::now();
+    TRACE_SCOPE("ConfidenceModel::simplifiedConfidence");
 
-    int numPoints = dimRanks.rows();
-    int numDimensions = dimRanks.cols();
+    int numPoints = topDimensions.size();
+
+    const NeighbourhoodMatrix& confidenceNeighbourhoods = *_confidenceNeighbourhoodMatrix;
 
     // Compute confidences
     confidences.resize(numPoints);
     for (int i = 0; i < numPoints; i++)
     {
-        const std::vector<int>& neighbourhood = _confidenceNeighbourhoodMatrix[i];
+        const std::vector<int>& neighbourhood = confidenceNeighbourhoods[i];
 
         int topDim = topDimensions[i];
 
@@ -110,10 +152,6 @@ void ConfidenceModel::simplifiedConfidence(const std::vector<int>& topDimensions
         if (neighbourhood.size() == 0)
             confidences[i] = 0;
     }
-
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-    std::cout << "Confidence Elapsed time: " << elapsed.count() << " s\n";
 }
 
 void ConfidenceModel::normalizeConfidences(std::vector<float>& confidences)
@@ -126,7 +164,6 @@ void ConfidenceModel::normalizeConfidences(std::vector<float>& confidences)
         if (confidences[i] < minVal) minVal = confidences[i];
         if (confidences[i] > maxVal) maxVal = confidences[i];
     }
-    std::cout << "Min val: " << minVal << " Max val: " << maxVal << std::endl;
     for (int i = 0; i < confidences.size(); i++)
     {
         confidences[i] = (confidences[i] - minVal) / (maxVal - minVal);
@@ -135,13 +172,15 @@ void ConfidenceModel::normalizeConfidences(std::vector<float>& confidences)
 
 void ConfidenceModel::computeConfidences(Explanation::Metric metric, DataTable& dataset, const DataMatrix& dimRanks, std::vector<float>& confidences)
 {
+    TRACE_SCOPE("ConfidenceModel::computeConfidences");
+
     // Compute the top-ranked dimension for every point
     std::vector<int> topDimensions;
     computeTopRankedDimensions(metric, dataset, dimRanks, topDimensions);
 
     if (_method == ConfidenceMethod::SIMPLIFIED)
     {
-        simplifiedConfidence(topDimensions, dimRanks, confidences);
+        simplifiedConfidence(topDimensions, confidences);
     }
     else if (_method == ConfidenceMethod::SILVA)
     {
@@ -150,3 +189,22 @@ void ConfidenceModel::computeConfidences(Explanation::Metric metric, DataTable&
 
     normalizeConfidences(confidences);
 }
+
+void ConfidenceModel::computeConfidences(const TopRanks& topRanks, std::vector<float>& confidences)
+{
+    TRACE_SCOPE("ConfidenceModel::computeConfidences");
+
+    // The top K of every point start with its top-ranked dimension
+    std::vector<int> topDimensions = topRanks.getTopDimensions();
+
+    if (_method == ConfidenceMethod::SIMPLIFIED)
+    {
+        simplifiedConfidence(topDimensions, confidences);
+    }
+    else if (_method == ConfidenceMethod::SILVA)
+    {
+        silvaConfidence(topDimensions, topRanks, confidences);
+    }
+
+    normalizeConfidences(confidences);
+}
@@ -2,7 +2,9 @@
 
 #include "DataTypes.h"
 #include "Methods/ExplanationMethod.h"
+#include "TopRanks.h"
 
+#include <memory>
 #include <vector>
 
 enum class ConfidenceMethod
@@ -16,14 +18,24 @@ class ConfidenceModel
 public:
     void silvaConfidence(const std::vector<int>& topDimensions, const DataMatrix& dimRanks, std::vector<float>& confidences);
 
-    void simplifiedConfidence(const std::vector<int>& topDimensions, const DataMatrix& dimRanks, std::vector<float>& confidences);
+    /**
+     * Silva confidence from the top ranks of the points: a neighbour whose top K lacks the top dimension of the point
+     * contributes its K-th rank instead, a lower bound on the missing rank for the variance metric
+     */
+    void silvaConfidence(const std::vector<int>& topDimensions, const TopRanks& topRanks, std::vector<float>& confidences);
+
+    void simplifiedConfidence(const std::vector<int>& topDimensions, std::vector<float>& confidences);
 
     void normalizeConfidences(std::vector<float>& confidences);
 
     void computeConfidences(Explanation::Metric metric, DataTable& dataset, const DataMatrix& dimRanks, std::vector<float>& confidences);
 
+    /** Compute the confidences from the top ranks of the points instead of their full rank matrix */
+    void computeConfidences(const TopRanks& topRanks, std::vector<float>& confidences);
+
 public:
     ConfidenceMethod        _method = ConfidenceMethod::SILVA;
 
-    NeighbourhoodMatrix     _confidenceNeighbourhoodMatrix;
+    /** Neighbourhoods at a quarter of the radius, possibly shared with other cores (see ExplanationCore::setLocalExplanation) */
+    std::shared_ptr<const NeighbourhoodMatrix> _confidenceNeighbourhoodMatrix = std::make_shared<NeighbourhoodMatrix>();
 };
@@ -2,30 +2,183 @@
 
 #include <Eigen/Eigen>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 using DataMatrix = Eigen::ArrayXXf;
 using Neighbourhood = std::vector<int>;
 using NeighbourhoodMatrix = std::vector<Neighbourhood>;
 
+/**
+ * Get a writable reference to \p shared, which is copied first when other holders share it (copy on write).
+ * Only for objects created as non-const T (std::make_shared<T>) and held as const to share them.
+ */
+template<typename T>
+T& makeUnique(std::shared_ptr<const T>& shared)
+{
+    if (shared.use_count() > 1)
+        shared = std::make_shared<T>(*shared);
+
+    return const_cast<T&>(*shared);
+}
+
+class DataStatistics
+{
+public:
+    std::vector<float> means;
+    std::vector<float> variances;
+    std::vector<float> minRange;
+    std::vector<float> maxRange;
+    std::vector<float> ranges;
+
+    /** Get the global variances that local variances are ranked relative to, constant dimensions count as 1 */
+    std::vector<double> getNormalizingVariances() const {
+        std::vector<double> normalizingVariances(variances.size());
+        for (std::size_t j = 0; j < variances.size(); j++)
+            normalizingVariances[j] = variances[j] == 0 ? 1.0 : variances[j];
+
+        return normalizingVariances;
+    }
+};
+
+/** Compressed sparse row matrix, for data that is mostly zeros */
+using SparseDataMatrix = Eigen::SparseMatrix<float, Eigen::RowMajor>;
+
+/**
+ * Data table class
+ *
+ * High-dimensional data, one row per point, backed by a dense column-major matrix or by a
+ * compressed sparse row matrix. Element access works on both backings, a sparse element is
+ * found by binary search in its row. The local and global statistics kernels check isSparse()
+ * and then only visit the stored values with forEachNonZero(), accounting for the implicit
+ * zeros analytically, so their cost scales with the number of non-zeros instead of N·D.
+ *
+ * The values are immutable and held by a shared pointer, so tables of several views of the same
+ * data share one matrix (see ExplanationRegistry); copying a table does not copy the values.
+ * The exclusions are per table.
+ */
 class DataTable
 {
 public:
     void setData(DataMatrix& data) {
-        _data = data;
+        setData(std::make_shared<const DataMatrix>(data));
+    }
+
+    void setData(SparseDataMatrix& data) {
+        auto sparseData = std::make_shared<SparseDataMatrix>(data);
+        sparseData->makeCompressed();
+        setData(std::shared_ptr<const SparseDataMatrix>(std::move(sparseData)));
+    }
+
+    /** Share the dense \p data with the other tables holding it */
+    void setData(std::shared_ptr<const DataMatrix> data) {
+        _data = std::move(data);
+        _sparseData = std::make_shared<const SparseDataMatrix>();
+        _isSparse = false;
+        _exclusionList.clear();
+        _exclusionList.resize(_data->cols(), false);
+    }
+
+    /** Share the compressed sparse \p data with the other tables holding it */
+    void setData(std::shared_ptr<const SparseDataMatrix> data) {
+        _sparseData = std::move(data);
+        _data = std::make_shared<const DataMatrix>();
+        _isSparse = true;
         _exclusionList.clear();
-        _exclusionList.resize(_data.cols(), false);
+        _exclusionList.resize(_sparseData->cols(), false);
     }
 
-    int numDimensions() const { return _data.cols(); }
-    int numPoints() const { return _data.rows(); }
+    /** Get the dense values, empty when sparse */
+    const std::shared_ptr<const DataMatrix>& getDenseData() const { return _data; }
+
+    /** Get the sparse values, empty when dense */
+    const std::shared_ptr<const SparseDataMatrix>& getSparseData() const { return _sparseData; }
+
+    int numDimensions() const { return _isSparse ? _sparseData->cols() : _data->cols(); }
+    int numPoints() const { return _isSparse ? _sparseData->rows() : _data->rows(); }
 
     void excludeDimension(int dim) { _exclusionList[dim] = !_exclusionList[dim]; }
     bool isExcluded(int dim) const { return _exclusionList[dim]; }
 
-    auto row(int row) const { return _data.row(row); }
-    float operator()(int row, int col) const { return _data(row, col); }
+    /** Get the dimensions that are not excluded, the last dimension when all are excluded, none without dimensions */
+    std::vector<int> getIncludedDimensions() const {
+        std::vector<int> includedDims;
+        for (int j = 0; j < numDimensions(); j++)
+            if (!isExcluded(j)) includedDims.push_back(j);
+
+        if (includedDims.empty() && numDimensions() > 0)
+            includedDims.push_back(numDimensions() - 1);
+
+        return includedDims;
+    }
+
+    float operator()(int row, int col) const { return _isSparse ? _sparseData->coeff(row, col) : (*_data)(row, col); }
+
+    bool isSparse() const { return _isSparse; }
+
+    /** Get the number of stored values, all values of a dense table */
+    std::size_t numNonZeros() const { return _isSparse ? static_cast<std::size_t>(_sparseData->nonZeros()) : static_cast<std::size_t>(_data->size()); }
+
+    /**
+     * Visit the stored values of \p row in order of dimension, all values of a dense row
+     * @param visit Called with the dimension and the value
+     */
+    template<typename Visitor>
+    void forEachNonZero(int row, Visitor&& visit) const
+    {
+        if (_isSparse)
+        {
+            for (SparseDataMatrix::InnerIterator it(*_sparseData, row); it; ++it)
+                visit(static_cast<int>(it.index()), it.value());
+        }
+        else
+        {
+            const DataMatrix& data = *_data;
+            for (int j = 0; j < data.cols(); j++)
+                visit(j, data(row, j));
+        }
+    }
+
+    /**
+     * Visit the stored values of \p row within the dimensions [\p begin, \p end), a sparse row is searched for \p begin
+     * @param visit Called with the dimension and the value
+     */
+    template<typename Visitor>
+    void forEachNonZero(int row, int begin, int end, Visitor&& visit) const
+    {
+        if (_isSparse)
+        {
+            const int* indices = _sparseData->innerIndexPtr();
+            const float* values = _sparseData->valuePtr();
+
+            const int* rowEnd = indices + _sparseData->outerIndexPtr()[row + 1];
+
+            for (const int* it = std::lower_bound(indices + _sparseData->outerIndexPtr()[row], rowEnd, begin); it != rowEnd && *it < end; ++it)
+                visit(*it, values[it - indices]);
+        }
+        else
+        {
+            const DataMatrix& data = *_data;
+            for (int j = begin; j < end; j++)
+                visit(j, data(row, j));
+        }
+    }
+
+    /** Get the number of bytes held by the data */
+    std::size_t getMemoryUsage() const {
+        if (_isSparse)
+            return static_cast<std::size_t>(_sparseData->nonZeros()) * (sizeof(float) + sizeof(int)) + static_cast<std::size_t>(_sparseData->rows() + 1) * sizeof(int);
+
+        return static_cast<std::size_t>(_data->size()) * sizeof(float);
+    }
 
 private:
-    DataMatrix _data;
+    std::shared_ptr<const DataMatrix> _data = std::make_shared<const DataMatrix>();
+    std::shared_ptr<const SparseDataMatrix> _sparseData = std::make_shared<const SparseDataMatrix>();
+
+    /** Whether the data is stored in _sparseData instead of _data */
+    bool _isSparse = false;
 
     /** List of dimensions to exclude from analysis */
     std::vector<bool>       _exclusionList;
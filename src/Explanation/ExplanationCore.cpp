@@ -0,0 +1,954 @@
+#include "ExplanationCore.h"
+#include "Neighbourhood.h"
+#include "Parallel.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <limits>
+
+namespace
+{
+    /** Streaming updates recompute everything when more than this fraction of the points moved */
+    constexpr double MAX_STREAMING_MOVED_FRACTION = 0.25;
+
+    /** Number of incremental streaming updates after which the statistics are recomputed, which clears their rounding drift */
+    constexpr int MAX_INCREMENTAL_UPDATES = 64;
+
+    /** Column statistics of sparse data from the stored values, every dimension holds numPoints - count implicit zeros */
+    void computeSparseDatasetStats(const DataTable& dataset, DataStatistics& dataStats)
+    {
+        int numPoints = dataset.numPoints();
+        int numDimensions = dataset.numDimensions();
+
+        std::vector<double> sums(numDimensions, 0);
+        std::vector<double> squaredDeviations(numDimensions, 0);
+        std::vector<int> counts(numDimensions, 0);
+
+        for (int i = 0; i < numPoints; i++)
+        {
+            dataset.forEachNonZero(i, [&](int j, float value) {
+                sums[j] += value;
+                counts[j]++;
+
+                if (value < dataStats.minRange[j]) dataStats.minRange[j] = value;
+                if (value > dataStats.maxRange[j]) dataStats.maxRange[j] = value;
+            });
+        }
+
+        for (int j = 0; j < numDimensions; j++)
+            dataStats.means[j] = static_cast<float>(sums[j] / numPoints);
+
+        // Two-pass variance, the implicit zeros deviate by the mean
+        for (int i = 0; i < numPoints; i++)
+        {
+            dataset.forEachNonZero(i, [&](int j, float value) {
+                const double x = value - static_cast<double>(dataStats.means[j]);
+                squaredDeviations[j] += x * x;
+            });
+        }
+
+        for (int j = 0; j < numDimensions; j++)
+        {
+            const double mean = dataStats.means[j];
+            const int numZeros = numPoints - counts[j];
+
+            dataStats.variances[j] = static_cast<float>((squaredDeviations[j] + numZeros * mean * mean) / numPoints);
+
+            if (numZeros > 0)
+            {
+                dataStats.minRange[j] = std::min(dataStats.minRange[j], 0.0f);
+                dataStats.maxRange[j] = std::max(dataStats.maxRange[j], 0.0f);
+            }
+        }
+    }
+}
+
+void computeDatasetStats(const DataTable& dataset, DataStatistics& dataStats)
+{
+    TRACE_SCOPE("computeDatasetStats");
+
+    int numPoints = dataset.numPoints();
+    int numDimensions = dataset.numDimensions();
+
+    dataStats.means.clear();
+    dataStats.variances.clear();
+    dataStats.minRange.clear();
+    dataStats.maxRange.clear();
+    dataStats.ranges.clear();
+    
+    dataStats.means.resize(numDimensions);
+    dataStats.variances.resize(numDimensions);
+    dataStats.minRange.resize(numDimensions, std::numeric_limits<float>::max());
+    dataStats.maxRange.resize(numDimensions, -std::numeric_limits<float>::max());
+    dataStats.ranges.resize(numDimensions, 0);
+
+    if (dataset.isSparse())
+    {
+        computeSparseDatasetStats(dataset, dataStats);
+    }
+    else
+    {
+        for (int j = 0; j < numDimensions; j++)
+        {
+            // Compute mean
+            float mean = 0;
+            for (int i = 0; i < numPoints; i++)
+            {
+                float value = dataset(i, j);
+
+                if (value < dataStats.minRange[j]) dataStats.minRange[j] = value;
+                if (value > dataStats.maxRange[j]) dataStats.maxRange[j] = value;
+                mean += value;
+            }
+            mean /= numPoints;
+            dataStats.means[j] = mean;
+
+            // Compute variance
+            float variance = 0;
+            for (int i = 0; i < numPoints; i++)
+            {
+                float x = dataset(i, j) - mean;
+                variance += x * x;
+            }
+            variance /= numPoints;
+            dataStats.variances[j] = variance;
+        }
+    }
+
+    for (int j = 0; j < numDimensions; j++)
+    {
+        dataStats.ranges[j] = dataStats.maxRange[j] - dataStats.minRange[j];
+        if (dataStats.ranges[j] == 0) dataStats.ranges[j] = 1;
+    }
+}
+
+ExplanationCore::ExplanationCore() :
+    _hasDataset(false),
+    _projectionDiameter(1),
+    _neighbourhoodMatrix(std::make_shared<NeighbourhoodMatrix>()),
+    _memoryBudget(0),
+    _sampling(),
+    _samplingError(),
+    _estimatedNeighbourhoodMemory(0),
+    _neighbourhoodRadius(-1),
+    _radius(0),
+    _neighbourhoodXDim(0),
+    _neighbourhoodYDim(1),
+    _metricsValid(false),
+    _streamingTolerance(0.1f),
+    _numIncrementalUpdates(0),
+    _streamingUpdate(),
+    _adaptiveNeighbours(0),
+    _adaptiveScale(1),
+    _nearestNeighbourRank(0),
+    _gridXDim(-1),
+    _gridYDim(-1),
+    _explanationMetric(Explanation::Metric::VARIANCE),
+    _topK(0),
+    _dimensionPruning(false),
+    _numThreads(0),
+    _topRanks(std::make_shared<TopRanks>())
+{
+
+}
+
+void ExplanationCore::setData(DataMatrix& data, DataMatrix& projection)
+{
+    TRACE_SCOPE("ExplanationCore::setData");
+    TRACE_COUNTER("Points", data.rows());
+    TRACE_COUNTER("Dimensions", data.cols());
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    _dataset.setData(data);
+    _projection = projection;
+
+    computeDatasetStats(_dataset, _dataStats);
+
+    initialize();
+
+    _hasDataset = true;
+}
+
+void ExplanationCore::setData(SparseDataMatrix& data, DataMatrix& projection)
+{
+    TRACE_SCOPE("ExplanationCore::setData");
+    TRACE_COUNTER("Points", data.rows());
+    TRACE_COUNTER("Dimensions", data.cols());
+    TRACE_COUNTER("Non-zeros", data.nonZeros());
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    _dataset.setData(data);
+    _projection = projection;
+
+    computeDatasetStats(_dataset, _dataStats);
+
+    initialize();
+
+    _hasDataset = true;
+}
+
+void ExplanationCore::setData(const DataTable& dataset, const DataStatistics& dataStats, DataMatrix& projection)
+{
+    TRACE_SCOPE("ExplanationCore::setData (shared)");
+    TRACE_COUNTER("Points", dataset.numPoints());
+    TRACE_COUNTER("Dimensions", dataset.numDimensions());
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    // The values are shared, the exclusions of this core start empty
+    _dataset = DataTable();
+    if (dataset.isSparse())
+        _dataset.setData(dataset.getSparseData());
+    else
+        _dataset.setData(dataset.getDenseData());
+
+    _dataStats = dataStats;
+    _projection = projection;
+
+    initialize();
+
+    _hasDataset = true;
+}
+
+void ExplanationCore::initialize()
+{
+    // Compute projection diameter
+    _projectionDiameter = computeProjectionDiameter(_projection, 0, 1);
+
+    _selectionStats.reset();
+    _localPCA.clear();
+
+    // Clusters refer to the points of the previous data
+    _clusterExplanation.clear();
+
+    // The multi-scale levels, the landmarks and the grid belong to the previous projection
+    clearProjectionCaches();
+
+    _neighbourhoodRadius = -1;
+    _metricsValid = false;
+    _numIncrementalUpdates = 0;
+
+    _topRanks = std::make_shared<TopRanks>();
+
+    // Create color mapping
+    _colorMapping.recreate(_dataset);
+}
+
+void ExplanationCore::recomputeNeighbourhood(float neighbourhoodRadius, int xDim, int yDim)
+{
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    if (!_hasDataset)
+        return;
+
+    TRACE_SCOPE("ExplanationCore::recomputeNeighbourhood");
+
+    _projectionDiameter = computeProjectionDiameter(_projection, xDim, yDim);
+
+    const float radius = _projectionDiameter * neighbourhoodRadius;
+
+    // Kept for streaming updates, the statistics have to follow the new neighbourhoods
+    _neighbourhoodRadius = neighbourhoodRadius;
+    _radius = radius;
+    _neighbourhoodXDim = xDim;
+    _neighbourhoodYDim = yDim;
+    _metricsValid = false;
+    _numIncrementalUpdates = 0;
+
+    // Release the old neighbourhoods first, so they do not coexist with the new ones (unless other cores share them)
+    _neighbourhoodMatrix = std::make_shared<NeighbourhoodMatrix>();
+    _confidenceModel._confidenceNeighbourhoodMatrix = std::make_shared<NeighbourhoodMatrix>();
+
+    NeighbourhoodMatrix& neighbourhoodMatrix = makeUnique(_neighbourhoodMatrix);
+    NeighbourhoodMatrix& confidenceNeighbourhoodMatrix = makeUnique(_confidenceModel._confidenceNeighbourhoodMatrix);
+
+    std::vector<int> numCandidates;
+
+    if (_adaptiveNeighbours > 0)
+    {
+        updateAdaptiveRadii(xDim, yDim);
+
+        // A neighbourhood at the k-th nearest neighbour distance holds the center and k neighbours, scaled by the area
+        const double numPoints = _dataset.numPoints();
+        const double expectedSize = (_adaptiveNeighbours + 1.0) * _adaptiveScale * _adaptiveScale;
+
+        _sampling.stride = chooseNeighbourhoodStride(numPoints * std::max(1.0, expectedSize), numPoints * std::max(1.0, expectedSize / 16));
+
+        computeNeighbourhoodMatrix(_projection, _grid, neighbourhoodMatrix, _nearestNeighbourDistances, _adaptiveScale, xDim, yDim, _sampling, &numCandidates);
+
+        computeNeighbourhoodMatrix(_projection, _grid, confidenceNeighbourhoodMatrix, _nearestNeighbourDistances, _adaptiveScale * 0.25f, xDim, yDim, _sampling);
+    }
+    else
+    {
+        _sampling.stride = chooseNeighbourhoodStride(estimateNeighbourhoodEntries(_projection, radius, xDim, yDim), estimateNeighbourhoodEntries(_projection, radius * 0.25f, xDim, yDim));
+
+        computeNeighbourhoodMatrix(_projection, neighbourhoodMatrix, radius, xDim, yDim, _sampling, &numCandidates);
+
+        computeNeighbourhoodMatrix(_projection, confidenceNeighbourhoodMatrix, radius * 0.25f, xDim, yDim, _sampling);
+    }
+
+    // A strided neighbourhood only saw the candidates of its residue class, scale them up to the full neighbourhood
+    _samplingError = SamplingError();
+
+    double summedError = 0;
+    for (int i = 0; i < static_cast<int>(neighbourhoodMatrix.size()); i++)
+    {
+        const int numSamples = static_cast<int>(neighbourhoodMatrix[i].size());
+        const float error = computeSamplingError(std::max(numSamples, numCandidates[i] * _sampling.stride), numSamples);
+
+        if (error <= 0)
+            continue;
+
+        _samplingError.numSampledPoints++;
+        _samplingError.maxError = std::max(_samplingError.maxError, error);
+        summedError += error;
+    }
+
+    if (_samplingError.numSampledPoints > 0)
+        _samplingError.meanError = static_cast<float>(summedError / _samplingError.numSampledPoints);
+
+    TRACE_COUNTER("Sampled neighbourhoods", _samplingError.numSampledPoints);
+
+    TRACE_COUNTER("Explanation memory (MB)", getMemoryUsage().total() / (1024.0 * 1024.0));
+}
+
+MemoryUsage ExplanationCore::getMemoryUsage() const
+{
+    MemoryUsage memoryUsage;
+
+    memoryUsage.dataset = _dataset.getMemoryUsage() + static_cast<std::size_t>(_projection.size()) * sizeof(float);
+    memoryUsage.neighbourhoods = ::getMemoryUsage(*_neighbourhoodMatrix);
+    memoryUsage.confidenceNeighbourhoods = ::getMemoryUsage(*_confidenceModel._confidenceNeighbourhoodMatrix);
+    memoryUsage.localStatistics = _euclideanMethod.getMemoryUsage() + _varianceMethod.getMemoryUsage() + _valueMethod.getMemoryUsage();
+    memoryUsage.rankMatrix = _topRanks->isEmpty() ? static_cast<std::size_t>(_dataset.numPoints()) * _dataset.numDimensions() * sizeof(float) : 0;
+    memoryUsage.topRanks = _topRanks->getMemoryUsage();
+    memoryUsage.multiScale = _multiScale.getMemoryUsage();
+    memoryUsage.clusters = _clusterExplanation.getMemoryUsage();
+    memoryUsage.landmarks = _landmarkExplanation.getMemoryUsage();
+    memoryUsage.adaptiveRadii = _grid.getMemoryUsage() + _nearestNeighbourDistances.capacity() * sizeof(float);
+
+    return memoryUsage;
+}
+
+bool ExplanationCore::updateProjection(const DataMatrix& projection)
+{
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    if (!_hasDataset || projection.rows() != _projection.rows() || projection.cols() != _projection.cols())
+        return false;
+
+    TRACE_SCOPE("ExplanationCore::updateProjection");
+
+    const int numPoints = static_cast<int>(_projection.rows());
+
+    _streamingUpdate = StreamingUpdate();
+
+    // Without neighbourhoods there is nothing to update
+    if (_neighbourhoodRadius < 0)
+    {
+        _projection = projection;
+        clearProjectionCaches();
+
+        return true;
+    }
+
+    const int xDim = _neighbourhoodXDim;
+    const int yDim = _neighbourhoodYDim;
+
+    // Points that moved beyond the tolerance from their position at the last update
+    const float tolerance = _streamingTolerance * _radius;
+    const float toleranceSquared = tolerance * tolerance;
+
+    std::vector<int> movedPoints;
+    for (int i = 0; i < numPoints; i++)
+    {
+        const float xd = projection(i, xDim) - _projection(i, xDim);
+        const float yd = projection(i, yDim) - _projection(i, yDim);
+
+        if (xd * xd + yd * yd > toleranceSquared)
+            movedPoints.push_back(i);
+    }
+
+    _streamingUpdate.numMoved = static_cast<int>(movedPoints.size());
+
+    TRACE_COUNTER("Moved points", movedPoints.size());
+
+    // The radius is relative to the extent of the projection, which changes as the embedding expands
+    const bool radiusChanged = std::abs(computeProjectionDiameter(projection, xDim, yDim) * _neighbourhoodRadius - _radius) > tolerance;
+
+    if (movedPoints.empty() && !radiusChanged)
+        return true;
+
+    // Adaptive radii depend on the k-th nearest neighbours of all points, they are rebuilt on the grid instead
+    const bool fullRecompute = radiusChanged || _adaptiveNeighbours > 0 || movedPoints.size() > MAX_STREAMING_MOVED_FRACTION * numPoints || _numIncrementalUpdates >= MAX_INCREMENTAL_UPDATES;
+
+    if (!fullRecompute)
+    {
+        updateProjectionIncrementally(projection, movedPoints);
+
+        return true;
+    }
+
+    _projection = projection;
+    clearProjectionCaches();
+
+    recomputeNeighbourhood(_neighbourhoodRadius, xDim, yDim);
+    recomputeMetrics();
+
+    _streamingUpdate.numAffected = numPoints;
+    _streamingUpdate.fullRecompute = true;
+
+    return true;
+}
+
+void ExplanationCore::updateProjectionIncrementally(const DataMatrix& projection, const std::vector<int>& movedPoints)
+{
+    TRACE_SCOPE("ExplanationCore::updateProjectionIncrementally");
+
+    const int numPoints = static_cast<int>(_projection.rows());
+    const int xDim = _neighbourhoodXDim;
+    const int yDim = _neighbourhoodYDim;
+
+    updateGrid(xDim, yDim);
+
+    std::vector<char> moved(numPoints, 0);
+    for (const int i : movedPoints)
+        moved[i] = 1;
+
+    // A neighbourhood changes when a moved point was within its radius before the move or is within it after,
+    // collect those pairs of a point and a moved point (the moved points themselves are searched again)
+    std::vector<std::pair<int, int>> changes;
+
+    const auto collectChanges = [this, &moved, &changes](int movedPoint) -> void {
+        _grid.forEachInRadius(_projection(movedPoint, _neighbourhoodXDim), _projection(movedPoint, _neighbourhoodYDim), _radius, [&](int i, float) {
+            if (!moved[i])
+                changes.emplace_back(i, movedPoint);
+        });
+    };
+
+    for (const int i : movedPoints)
+        collectChanges(i);
+
+    for (const int i : movedPoints)
+        _projection.row(i) = projection.row(i);
+
+    _grid.update(_projection, xDim, yDim, movedPoints);
+
+    for (const int i : movedPoints)
+        collectChanges(i);
+
+    std::sort(changes.begin(), changes.end());
+    changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+
+    std::vector<int> affectedPoints = movedPoints;
+    for (const auto& change : changes)
+        if (affectedPoints.empty() || affectedPoints.back() != change.first)
+            affectedPoints.push_back(change.first);
+
+    std::sort(affectedPoints.begin(), affectedPoints.end());
+    affectedPoints.erase(std::unique(affectedPoints.begin(), affectedPoints.end()), affectedPoints.end());
+
+    _streamingUpdate.numAffected = static_cast<int>(affectedPoints.size());
+
+    TRACE_COUNTER("Affected points", affectedPoints.size());
+
+    // The previous neighbourhoods are kept to downdate the statistics
+    NeighbourhoodMatrix previousNeighbourhoods(affectedPoints.size());
+
+    // Neighbourhoods shared with other cores are copied first, the other cores keep theirs
+    NeighbourhoodMatrix& neighbourhoodMatrix = makeUnique(_neighbourhoodMatrix);
+    NeighbourhoodMatrix& confidenceNeighbourhoods = makeUnique(_confidenceModel._confidenceNeighbourhoodMatrix);
+
+    // A capped neighbourhood is a sample of its candidates, any change of the candidates can change the whole sample
+    const bool capped = _sampling.maxNeighbours > 0;
+    const int stride = std::max(1, _sampling.stride);
+
+    const float confidenceRadius = _radius * 0.25f;
+    const float radSquared = _radius * _radius;
+    const float confidenceRadSquared = confidenceRadius * confidenceRadius;
+
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int p = 0; p < static_cast<int>(affectedPoints.size()); p++)
+    {
+        const int i = affectedPoints[p];
+
+        previousNeighbourhoods[p] = std::move(neighbourhoodMatrix[i]);
+
+        // Same search and sampling as the full recompute
+        if (capped || moved[i])
+        {
+            findNeighbourhood(_projection, _grid, i, _radius, neighbourhoodMatrix[i], xDim, yDim, _sampling);
+            findNeighbourhood(_projection, _grid, i, confidenceRadius, confidenceNeighbourhoods[i], xDim, yDim, _sampling);
+            continue;
+        }
+
+        // Otherwise only the moved points near the point leave or join its neighbourhoods
+        const auto first = std::lower_bound(changes.begin(), changes.end(), std::make_pair(i, -1));
+        const auto last = std::lower_bound(first, changes.end(), std::make_pair(i + 1, -1));
+
+        std::vector<int> nearbyMoved, joined, confidenceJoined;
+        for (auto change = first; change != last; change++)
+        {
+            const int m = change->second;
+
+            nearbyMoved.push_back(m);
+
+            // The distance is computed as by the search from the center
+            const float xd = _projection(m, xDim) - _projection(i, xDim);
+            const float yd = _projection(m, yDim) - _projection(i, yDim);
+
+            const float magSquared = xd * xd + yd * yd;
+
+            if (m % stride != i % stride)
+                continue;
+
+            if (magSquared <= radSquared)
+                joined.push_back(m);
+
+            if (magSquared <= confidenceRadSquared)
+                confidenceJoined.push_back(m);
+        }
+
+        const auto patch = [&nearbyMoved](const Neighbourhood& previous, const std::vector<int>& joined, Neighbourhood& neighbourhood) -> void {
+            Neighbourhood kept;
+            std::set_difference(previous.begin(), previous.end(), nearbyMoved.begin(), nearbyMoved.end(), std::back_inserter(kept));
+
+            neighbourhood.clear();
+            std::set_union(kept.begin(), kept.end(), joined.begin(), joined.end(), std::back_inserter(neighbourhood));
+        };
+
+        patch(previousNeighbourhoods[p], joined, neighbourhoodMatrix[i]);
+
+        const Neighbourhood previousConfidence = std::move(confidenceNeighbourhoods[i]);
+        patch(previousConfidence, confidenceJoined, confidenceNeighbourhoods[i]);
+    }
+
+    // Statistics that were not computed on the previous neighbourhoods cannot be downdated
+    Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+
+    if (!_topRanks->isEmpty())
+    {
+        // Top ranks keep no local statistics to downdate, the affected points are ranked again
+        if (!_metricsValid || !makeUnique(_topRanks).update(_dataset, _dataStats, neighbourhoodMatrix, affectedPoints))
+            recomputeMetrics();
+    }
+    else if (explanationMethod != nullptr && (!_metricsValid || !explanationMethod->update(_dataset, neighbourhoodMatrix, affectedPoints, previousNeighbourhoods)))
+    {
+        recomputeMetrics();
+    }
+
+    _numIncrementalUpdates++;
+
+    // The multi-scale levels, the landmarks and the nearest neighbour distances belong to the previous projection, the grid was updated
+    _multiScale.clear();
+    _landmarkExplanation.clear();
+    _nearestNeighbourDistances = std::vector<float>();
+}
+
+void ExplanationCore::updateGrid(int xDim, int yDim)
+{
+    if (xDim != _gridXDim || yDim != _gridYDim || _grid.isEmpty())
+    {
+        _grid.build(_projection, xDim, yDim);
+
+        _gridXDim = xDim;
+        _gridYDim = yDim;
+
+        _nearestNeighbourDistances.clear();
+    }
+}
+
+void ExplanationCore::updateAdaptiveRadii(int xDim, int yDim)
+{
+    updateGrid(xDim, yDim);
+
+    if (_nearestNeighbourDistances.empty() || _nearestNeighbourRank != _adaptiveNeighbours)
+    {
+        computeNearestNeighbourDistances(_projection, _grid, _adaptiveNeighbours, xDim, yDim, _nearestNeighbourDistances);
+
+        _nearestNeighbourRank = _adaptiveNeighbours;
+    }
+}
+
+void ExplanationCore::clearProjectionCaches()
+{
+    _multiScale.clear();
+
+    // Landmarks are chosen on the previous projection
+    _landmarkExplanation.clear();
+
+    // The grid and the nearest neighbour distances are rebuilt on demand
+    _grid.clear();
+    _nearestNeighbourDistances = std::vector<float>();
+    _gridXDim = _gridYDim = -1;
+}
+
+int ExplanationCore::chooseNeighbourhoodStride(double explanationEntries, double confidenceEntries)
+{
+    const double numPoints = _dataset.numPoints();
+
+    // Neighbourhoods of the methods and of the confidence model (at most the neighbour cap per point), plus a vector header per point
+    const double maxEntries = _sampling.maxNeighbours > 0 ? numPoints * _sampling.maxNeighbours : std::numeric_limits<double>::max();
+    const double entries = std::min(maxEntries, explanationEntries) + std::min(maxEntries, confidenceEntries);
+    const double headerBytes = 2 * numPoints * sizeof(Neighbourhood);
+
+    _estimatedNeighbourhoodMemory = static_cast<std::size_t>(entries * sizeof(int) + headerBytes);
+
+    if (_memoryBudget == 0)
+        return 1;
+
+    // The data, the local statistics of one method (up to two matrices) and the rank matrix do not depend on the radius
+    const double fixedBytes = _dataset.getMemoryUsage() + _projection.size() * sizeof(float) + 3.0 * numPoints * _dataset.numDimensions() * sizeof(float);
+
+    const double available = static_cast<double>(_memoryBudget) - fixedBytes - headerBytes;
+    const double required = entries * sizeof(int);
+
+    if (required <= available)
+        return 1;
+
+    // When nothing is left every neighbourhood shrinks to (about) its center point
+    if (available <= 0)
+        return std::max(1, _dataset.numPoints());
+
+    return static_cast<int>(std::min(numPoints, std::ceil(required / available)));
+}
+
+void ExplanationCore::recomputeMetrics()
+{
+    TRACE_SCOPE("ExplanationCore::recomputeMetrics");
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+
+    // Only the statistics of the current method are kept
+    for (Explanation::Method* method : { static_cast<Explanation::Method*>(&_euclideanMethod), static_cast<Explanation::Method*>(&_varianceMethod), static_cast<Explanation::Method*>(&_valueMethod) })
+        if (method != explanationMethod)
+            method->release();
+
+    // New ranks, the previous ones may still be held by other cores
+    _topRanks = std::make_shared<TopRanks>();
+    TopRanks& topRanks = makeUnique(_topRanks);
+
+    // Very high-dimensional data keeps the top ranked dimensions of every point instead of the local statistics,
+    // the method only keeps its global statistics to rank selections
+    bool topRanksComputed = false;
+    if (_topK > 0 && _dimensionPruning)
+        topRanksComputed = topRanks.computePruned(_dataset, _dataStats, *_neighbourhoodMatrix, _projection, _neighbourhoodXDim, _neighbourhoodYDim, _explanationMetric, _topK);
+    else if (_topK > 0)
+        topRanksComputed = topRanks.compute(_dataset, _dataStats, *_neighbourhoodMatrix, _explanationMetric, _topK);
+
+    if (topRanksComputed)
+    {
+        explanationMethod->recomputeGlobalStatistics(_dataset);
+    }
+    else
+    {
+        topRanks.clear();
+
+        if (explanationMethod != nullptr)
+            explanationMethod->recompute(_dataset, *_neighbourhoodMatrix);
+    }
+
+    _metricsValid = explanationMethod != nullptr;
+}
+
+LocalExplanation ExplanationCore::getLocalExplanation() const
+{
+    const Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+
+    LocalExplanation localExplanation;
+
+    localExplanation.neighbourhoods = _neighbourhoodMatrix;
+    localExplanation.confidenceNeighbourhoods = _confidenceModel._confidenceNeighbourhoodMatrix;
+    localExplanation.statistics = explanationMethod != nullptr ? explanationMethod->getStatistics() : nullptr;
+    localExplanation.topRanks = _topRanks;
+
+    localExplanation.neighbourhoodRadius = _neighbourhoodRadius;
+    localExplanation.radius = _radius;
+    localExplanation.xDim = _neighbourhoodXDim;
+    localExplanation.yDim = _neighbourhoodYDim;
+    localExplanation.projectionDiameter = _projectionDiameter;
+    localExplanation.stride = _sampling.stride;
+    localExplanation.samplingError = _samplingError;
+    localExplanation.estimatedNeighbourhoodMemory = _estimatedNeighbourhoodMemory;
+
+    return localExplanation;
+}
+
+bool ExplanationCore::setLocalExplanation(const LocalExplanation& localExplanation)
+{
+    if (!_hasDataset || !localExplanation.neighbourhoods || !localExplanation.confidenceNeighbourhoods || !localExplanation.topRanks)
+        return false;
+
+    if (static_cast<int>(localExplanation.neighbourhoods->size()) != _dataset.numPoints())
+        return false;
+
+    Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+
+    if (explanationMethod == nullptr || !explanationMethod->setStatistics(localExplanation.statistics))
+        return false;
+
+    TRACE_SCOPE("ExplanationCore::setLocalExplanation");
+
+    // Only the statistics of the current method are kept
+    for (Explanation::Method* method : { static_cast<Explanation::Method*>(&_euclideanMethod), static_cast<Explanation::Method*>(&_varianceMethod), static_cast<Explanation::Method*>(&_valueMethod) })
+        if (method != explanationMethod)
+            method->release();
+
+    _neighbourhoodMatrix = localExplanation.neighbourhoods;
+    _confidenceModel._confidenceNeighbourhoodMatrix = localExplanation.confidenceNeighbourhoods;
+    _topRanks = localExplanation.topRanks;
+
+    _neighbourhoodRadius = localExplanation.neighbourhoodRadius;
+    _radius = localExplanation.radius;
+    _neighbourhoodXDim = localExplanation.xDim;
+    _neighbourhoodYDim = localExplanation.yDim;
+    _projectionDiameter = localExplanation.projectionDiameter;
+    _sampling.stride = localExplanation.stride;
+    _samplingError = localExplanation.samplingError;
+    _estimatedNeighbourhoodMemory = localExplanation.estimatedNeighbourhoodMemory;
+
+    _metricsValid = true;
+    _numIncrementalUpdates = 0;
+
+    return true;
+}
+
+void ExplanationCore::setTopK(int k)
+{
+    k = std::max(0, k);
+
+    // The ranks are kept until the next recompute, so the points stay colored in between
+    if (k != _topK)
+        _metricsValid = false;
+
+    _topK = k;
+}
+
+void ExplanationCore::setDimensionPruning(bool enabled)
+{
+    if (enabled != _dimensionPruning && _topK > 0)
+        _metricsValid = false;
+
+    _dimensionPruning = enabled;
+}
+
+void ExplanationCore::setNumThreads(int numThreads)
+{
+    _numThreads = std::max(0, numThreads);
+}
+
+void ExplanationCore::recomputeColorMapping(const DataMatrix& dimRanks)
+{
+    _colorMapping.recompute(_dataset, dimRanks, currentMetric());
+}
+
+void ExplanationCore::recomputeColorMapping(const TopRanks& topRanks)
+{
+    _colorMapping.recompute(topRanks.computeTopCounts(_dataset.numDimensions()));
+}
+
+bool ExplanationCore::recomputeMultiScale(const std::vector<float>& radii, int xDim, int yDim)
+{
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    if (!_hasDataset)
+        return false;
+
+    return _multiScale.compute(_dataset, _dataStats, _projection, radii, _explanationMetric, xDim, yDim);
+}
+
+bool ExplanationCore::recomputeClusterExplanation()
+{
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    if (!_hasDataset || !_clusterExplanation.compute(_dataset, _dataStats, _explanationMetric))
+        return false;
+
+    _colorMapping.recompute(_clusterExplanation.computeTopCounts(_dataset));
+
+    return true;
+}
+
+bool ExplanationCore::recomputeLandmarkExplanation(float neighbourhoodRadius, int xDim, int yDim)
+{
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    if (!_hasDataset || !hasLandmarks())
+        return false;
+
+    _projectionDiameter = computeProjectionDiameter(_projection, xDim, yDim);
+
+    if (!_landmarkExplanation.compute(_dataset, _dataStats, _projection, _projectionDiameter * neighbourhoodRadius, _explanationMetric, xDim, yDim, _landmarkParameters, _sampling))
+        return false;
+
+    _colorMapping.recompute(_landmarkExplanation.computeTopCounts(_dataset));
+
+    return true;
+}
+
+void ExplanationCore::excludeDimension(int dim)
+{
+    _dataset.excludeDimension(dim);
+
+    // The top dimensions of every level depend on the excluded dimensions
+    _multiScale.clear();
+
+    // Top ranks only keep dimensions that are not excluded, they are recomputed instead of updated
+    if (!_topRanks->isEmpty())
+        _metricsValid = false;
+}
+
+void ExplanationCore::setExplanationMetric(Explanation::Metric metric)
+{
+    if (metric != _explanationMetric)
+    {
+        _multiScale.clear();
+        _metricsValid = false;
+    }
+
+    _explanationMetric = metric;
+}
+
+void ExplanationCore::computeDimensionRanks(std::vector<float>& dimRanking, const std::vector<unsigned int>& selection)
+{
+    TRACE_SCOPE("ExplanationCore::computeSelectionRanks");
+    TRACE_COUNTER("Selection size", selection.size());
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+
+    _selectionStats = computeSelectionStatistics(selection);
+
+    explanationMethod->computeDimensionRank(_dataset, *_selectionStats, dimRanking);
+}
+
+std::shared_ptr<const SelectionStatistics> ExplanationCore::computeSelectionStatistics(const std::vector<unsigned int>& selection) const
+{
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    // A new object every time, so that the holders of the previous statistics keep them unchanged
+    auto selectionStats = std::make_shared<SelectionStatistics>();
+    selectionStats->compute(_dataset, selection, _dataStats);
+
+    return selectionStats;
+}
+
+void ExplanationCore::computeLocalPCARanks(std::vector<float>& dimRanking, const std::vector<unsigned int>& selection, bool warmStart)
+{
+    TRACE_SCOPE("ExplanationCore::computeLocalPCARanks");
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    _localPCA.compute(_dataset, selection, _dataStats, warmStart);
+
+    // The ranks do not need them, but the bar chart shows the statistics of the ranked selection
+    _selectionStats = computeSelectionStatistics(selection);
+
+    dimRanking = _localPCA.computeLoadingShares();
+
+    // The variance metric ranks the most important dimension lowest
+    if (_explanationMetric == Explanation::Metric::VARIANCE)
+    {
+        for (float& rank : dimRanking)
+            rank = 1 - rank;
+    }
+}
+
+void ExplanationCore::computeDimensionRanks(DataMatrix& dimRanking)
+{
+    TRACE_SCOPE("ExplanationCore::computeDimensionRanks");
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    std::vector<unsigned int> selection(_dataset.numPoints());
+    std::iota(selection.begin(), selection.end(), 0);
+
+    Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+
+    dimRanking.resize(selection.size(), _dataset.numDimensions());
+    for (int i = 0; i < selection.size(); i++)
+    {
+        int si = selection[i];
+
+        for (int j = 0; j < _dataset.numDimensions(); j++)
+        {
+            dimRanking(i, j) = explanationMethod->computeDimensionRank(_dataset, si, j);
+        }
+    }
+}
+
+std::vector<float> ExplanationCore::computeConfidences(const DataMatrix& dimRanks)
+{
+    TRACE_SCOPE("ExplanationCore::computeConfidences");
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    int numPoints = dimRanks.rows();
+
+    // Compute confidences
+    std::vector<float> confidences(numPoints);
+
+    _confidenceModel.computeConfidences(currentMetric(), _dataset, dimRanks, confidences);
+
+    return confidences;
+}
+
+std::vector<float> ExplanationCore::computeConfidences(const TopRanks& topRanks)
+{
+    TRACE_SCOPE("ExplanationCore::computeConfidences");
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    std::vector<float> confidences(topRanks.numPoints());
+
+    _confidenceModel.computeConfidences(topRanks, confidences);
+
+    return confidences;
+}
+
+void ExplanationCore::computeTopRankedDimensions(const DataMatrix& dimRanks, std::vector<int>& topRankedDims) const
+{
+    TRACE_SCOPE("ExplanationCore::computeTopRankedDimensions");
+    const parallel::ThreadLimit threadLimit(_numThreads);
+
+    int numPoints = dimRanks.rows();
+
+    bool lowRankBest = _explanationMetric == Explanation::Metric::VARIANCE;
+
+    const std::vector<int> includedDims = _dataset.getIncludedDimensions();
+
+    topRankedDims.resize(numPoints);
+
+#pragma omp parallel for
+    for (int i = 0; i < numPoints; i++)
+    {
+        int topDim = includedDims.empty() ? 0 : includedDims[0];
+        for (const int j : includedDims)
+        {
+            float rank = dimRanks(i, j);
+
+            if (lowRankBest ? rank < dimRanks(i, topDim) : rank > dimRanks(i, topDim))
+                topDim = j;
+        }
+        topRankedDims[i] = topDim;
+    }
+}
+
+Explanation::Method* ExplanationCore::getCurrentExplanationMethod()
+{
+    Explanation::Method* explanationMethod = nullptr;
+
+    switch (_explanationMetric)
+    {
+    case Explanation::Metric::EUCLIDEAN: explanationMethod = &_euclideanMethod; break;
+    case Explanation::Metric::VARIANCE: explanationMethod = &_varianceMethod; break;
+    case Explanation::Metric::VALUE: explanationMethod = &_valueMethod; break;
+    default: break;
+    }
+
+    return explanationMethod;
+}
+
+const Explanation::Method* ExplanationCore::getCurrentExplanationMethod() const
+{
+    return const_cast<ExplanationCore*>(this)->getCurrentExplanationMethod();
+}
@@ -0,0 +1,432 @@
+#pragma once
+
+#include "DataTypes.h"
+#include "SelectionStatistics.h"
+#include "Methods/ExplanationMethod.h"
+#include "ColorMapping.h"
+
+#include "Methods/SilvaEuclidean.h"
+#include "Methods/SilvaVariance.h"
+#include "Methods/ValueRanking.h"
+#include "ConfidenceModel.h"
+#include "ClusterExplanation.h"
+#include "LandmarkExplanation.h"
+#include "LocalPCA.h"
+#include "MultiScaleExplanation.h"
+#include "Neighbourhood.h"
+#include "TopRanks.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/** Bytes held by the data structures of the explanation core */
+struct MemoryUsage
+{
+    std::size_t dataset                     = 0;    /** High-dimensional data and projection */
+    std::size_t neighbourhoods              = 0;    /** Neighbourhoods of the explanation methods */
+    std::size_t confidenceNeighbourhoods    = 0;    /** Neighbourhoods of the confidence model */
+    std::size_t localStatistics             = 0;    /** Precomputed local statistics of the explanation methods */
+    std::size_t rankMatrix                  = 0;    /** Per-point rank matrix built while coloring (transient) */
+    std::size_t topRanks                    = 0;    /** Top ranked dimensions of every point, instead of the rank matrix */
+    std::size_t multiScale                  = 0;    /** Levels of the multi-scale explanation */
+    std::size_t clusters                    = 0;    /** Clusters and their statistics */
+    std::size_t landmarks                   = 0;    /** Landmarks and their interpolated explanation */
+    std::size_t adaptiveRadii               = 0;    /** Spatial grid and nearest neighbour distances of the adaptive radii */
+
+    std::size_t total() const { return dataset + neighbourhoods + confidenceNeighbourhoods + localStatistics + rankMatrix + topRanks + multiScale + clusters + landmarks + adaptiveRadii; }
+};
+
+/**
+ * Error introduced by sampling the neighbourhoods, expressed as the standard error of a local
+ * mean relative to the local standard deviation (see computeSamplingError)
+ */
+struct SamplingError
+{
+    int     numSampledPoints    = 0;    /** Number of points whose neighbourhood was sampled */
+    float   meanError           = 0;    /** Mean relative standard error over the sampled points */
+    float   maxError            = 0;    /** Largest relative standard error */
+};
+
+/** Outcome of a streaming update of the projection, see ExplanationCore::updateProjection */
+struct StreamingUpdate
+{
+    int     numMoved        = 0;        /** Number of points that moved beyond the tolerance */
+    int     numAffected     = 0;        /** Number of points whose neighbourhood was rebuilt */
+    bool    fullRecompute   = false;    /** Whether all neighbourhoods and statistics were recomputed instead */
+};
+
+/**
+ * Neighbourhoods of a core and the statistics of its current metric, see ExplanationCore::getLocalExplanation.
+ * Immutable once shared: the cores that hold them copy them before a streaming update changes them.
+ */
+struct LocalExplanation
+{
+    std::shared_ptr<const NeighbourhoodMatrix>      neighbourhoods;                     /** Neighbourhoods of the explanation methods */
+    std::shared_ptr<const NeighbourhoodMatrix>      confidenceNeighbourhoods;           /** Neighbourhoods of the confidence model */
+    std::shared_ptr<const Explanation::Statistics>  statistics;                         /** Statistics of the current method, only the global ones with top ranks */
+    std::shared_ptr<const TopRanks>                 topRanks;                           /** Top ranked dimensions of every point, empty without a top K */
+
+    float                                           neighbourhoodRadius             = -1;   /** Radius as a fraction of the projection diameter */
+    float                                           radius                          = 0;    /** Radius in projection units */
+    int                                             xDim                            = 0;    /** Projection axes of the neighbourhoods */
+    int                                             yDim                            = 1;
+    float                                           projectionDiameter              = 1;    /** Extent of the projection along the axes */
+    int                                             stride                          = 1;    /** Sampling stride chosen for the memory budget */
+    SamplingError                                   samplingError;                          /** Error introduced by the sampling */
+    std::size_t                                     estimatedNeighbourhoodMemory    = 0;    /** Estimated memory of exact neighbourhoods */
+};
+
+/** Compute the global mean, variance and range of every dimension of \p dataset */
+void computeDatasetStats(const DataTable& dataset, DataStatistics& dataStats);
+
+/**
+ * Explanation core class
+ *
+ * Numeric core of the projection explanation: holds the high-dimensional data and its projection,
+ * the neighbourhoods, the explanation methods, the confidence model and the color assignment.
+ * It only depends on Eigen, OpenMP and the standard library, so it can be built, benchmarked and
+ * tested without Qt or ManiVault. The ExplanationModel is a thin Qt adapter on top of it.
+ *
+ * An optional memory budget bounds the footprint of the explanation: before neighbourhoods are
+ * built their size is estimated from the density of the projection, and when the estimate does
+ * not fit the neighbourhoods are sampled with a stride instead of exhausting memory. Independent
+ * of the budget the neighbourhoods can be capped to a maximum number of neighbours, drawn with
+ * seeded reservoir sampling, which also bounds the time spent on local statistics.
+ *
+ * Instead of a single radius for all points the radius of every point can adapt to the density
+ * of the projection: it is the distance to its k-th nearest neighbour times a global factor, so
+ * every neighbourhood holds about the same number of points, in dense cores and at cluster edges.
+ *
+ * Projections of iterating embeddings can be streamed into the core with updateProjection. The
+ * core keeps the position of every point at its last neighbourhood update and only moves the
+ * points that drifted beyond a tolerance (a fraction of the radius). Only the neighbourhoods
+ * around the old and new positions of the moved points are rebuilt, on a spatial grid, and the
+ * local statistics of those points are downdated and updated with the neighbours that left and
+ * joined. When too many points move, the radius drifts with the extent of the projection, the
+ * radius adapts to the density, or after a number of incremental updates (to bound the rounding
+ * drift of the statistics) everything is recomputed instead.
+ *
+ * For very high-dimensional data neither the N×D local statistics nor the N×D rank matrix fit in
+ * memory. With a top K set, recomputeMetrics only keeps the global statistics of the method and
+ * the K best ranked dimensions of every point (see TopRanks), and the colors, confidences and
+ * top-ranked dimensions are derived from those instead of the rank matrix. With dimension pruning
+ * enabled, the statistics of the dimensions that cannot enter any top K are skipped as well.
+ */
+class ExplanationCore
+{
+public:
+    ExplanationCore();
+
+    bool hasDataset() const { return _hasDataset; }
+    const DataTable& getDataset() const { return _dataset; }
+    const DataMatrix& getProjection() const { return _projection; }
+    const DataStatistics& getDataStatistics() const { return _dataStats; }
+    /** Get the statistics of the most recently ranked selection, null before the first ranking */
+    const std::shared_ptr<const SelectionStatistics>& getSelectionStatistics() const { return _selectionStats; }
+    const NeighbourhoodMatrix& getNeighbourhoodMatrix() const { return *_neighbourhoodMatrix; }
+    const ColorMapping& getColorMapping() const { return _colorMapping; }
+    const MultiScaleExplanation& getMultiScale() const { return _multiScale; }
+    const ClusterExplanation& getClusterExplanation() const { return _clusterExplanation; }
+    const LandmarkExplanation& getLandmarkExplanation() const { return _landmarkExplanation; }
+    ConfidenceModel& getConfidenceModel() { return _confidenceModel; }
+
+    Explanation::Metric currentMetric() const { return _explanationMetric; }
+
+    /**
+     * Set the data to explain, both matrices are copied into the core
+     * @param data High-dimensional data, one row per point
+     * @param projection Projection of the data, one row per point
+     */
+    void setData(DataMatrix& data, DataMatrix& projection);
+
+    /** Set data that is mostly zeros (e.g. single-cell counts), the statistics kernels then scale with its non-zeros */
+    void setData(SparseDataMatrix& data, DataMatrix& projection);
+
+    /**
+     * Share the values of \p dataset instead of copying them, e.g. with the other views of the same data
+     * @param dataset Data table whose values are shared, the exclusions of the core start empty
+     * @param dataStats Global statistics of \p dataset (see computeDatasetStats), computed once for all views
+     * @param projection Projection of the data, one row per point
+     */
+    void setData(const DataTable& dataset, const DataStatistics& dataStats, DataMatrix& projection);
+    void resetDataset() { _hasDataset = false; }
+
+    /**
+     * Set the memory budget of the explanation data structures
+     * @param budget Budget in bytes, 0 for no budget
+     */
+    void setMemoryBudget(std::size_t budget) { _memoryBudget = budget; }
+    std::size_t getMemoryBudget() const { return _memoryBudget; }
+
+    /** Get the bytes held by the explanation data structures */
+    MemoryUsage getMemoryUsage() const;
+
+    /**
+     * Cap the number of neighbours per point, larger neighbourhoods are sampled uniformly
+     * @param maxNeighbours Maximum neighbourhood size, 0 for no cap
+     * @param seed Seed of the sampling, the same seed gives the same neighbourhoods
+     */
+    void setNeighbourCap(int maxNeighbours, std::uint32_t seed = 0) { _sampling.maxNeighbours = maxNeighbours; _sampling.seed = seed; }
+    int getNeighbourCap() const { return _sampling.maxNeighbours; }
+    std::uint32_t getNeighbourSeed() const { return _sampling.seed; }
+
+    /** Get the error introduced by sampling the current neighbourhoods */
+    const SamplingError& getSamplingError() const { return _samplingError; }
+
+    /** Get the sampling stride of the current neighbourhoods, 1 when they are exact */
+    int getNeighbourhoodStride() const { return _sampling.stride; }
+
+    /**
+     * Adapt the radius of every point to the density of the projection
+     * @param numNeighbours Rank of the nearest neighbour whose distance is the radius of a point, 0 for a single global radius
+     * @param scale Factor applied to the nearest neighbour distances
+     */
+    void setAdaptiveRadius(int numNeighbours, float scale = 1.0f) { _adaptiveNeighbours = std::max(0, numNeighbours); _adaptiveScale = scale; }
+    int getAdaptiveNeighbours() const { return _adaptiveNeighbours; }
+    float getAdaptiveScale() const { return _adaptiveScale; }
+
+    /** Get the k-th nearest neighbour distances of the adaptive radii, empty with a global radius */
+    const std::vector<float>& getNearestNeighbourDistances() const { return _nearestNeighbourDistances; }
+
+    /**
+     * Set the tolerance of streaming updates
+     * @param tolerance Distance a point has to move before its neighbourhoods are updated, as a fraction of the radius
+     */
+    void setStreamingTolerance(float tolerance) { _streamingTolerance = std::max(0.0f, tolerance); }
+    float getStreamingTolerance() const { return _streamingTolerance; }
+
+    /**
+     * Stream a new projection of the same points into the core, e.g. the next iteration of an embedding.
+     * Updates the neighbourhoods of the last recomputeNeighbourhood and the statistics of the current metric.
+     * @param projection New projection, one row per point
+     * @return Whether the projection was taken, false when its shape does not match the data
+     */
+    bool updateProjection(const DataMatrix& projection);
+
+    /** Get the outcome of the last streaming update */
+    const StreamingUpdate& getLastStreamingUpdate() const { return _streamingUpdate; }
+
+    /**
+     * Keep only the top ranked dimensions of every point instead of the local statistics and ranks of all
+     * dimensions, for the variance and value metrics; takes effect at the next recomputeMetrics
+     * @param k Number of dimensions to keep per point, 0 for the full rank matrix
+     */
+    void setTopK(int k);
+    int getTopK() const { return _topK; }
+
+    /**
+     * Skip the statistics of the dimensions that cannot enter the top K of any point when a top K is set, see
+     * TopRanks::computePruned; the top dimensions stay exact, the normalization of their ranks is estimated
+     */
+    void setDimensionPruning(bool enabled);
+    bool getDimensionPruning() const { return _dimensionPruning; }
+
+    /**
+     * Cap the number of threads of the explanation, e.g. to leave cores to other work on a shared machine;
+     * the cap applies to the parallel work of the core and of the ExplanationModel around it (the conversion
+     * of the data and the selection statistics of the bar chart), not to the rest of the process
+     * @param numThreads Maximum number of threads, 0 for the OpenMP default (all cores)
+     */
+    void setNumThreads(int numThreads);
+    int getNumThreads() const { return _numThreads; }
+
+    /** Whether the points are ranked by their top dimensions, see setTopK */
+    bool hasTopRanks() const { return !_topRanks->isEmpty(); }
+    const TopRanks& getTopRanks() const { return *_topRanks; }
+
+    /** Get the estimated memory of unstrided neighbourhoods (within the neighbour cap) for the current radius in bytes */
+    std::size_t getEstimatedNeighbourhoodMemory() const { return _estimatedNeighbourhoodMemory; }
+
+    void recomputeNeighbourhood(float neighbourhoodRadius, int xDim, int yDim);
+    void recomputeMetrics();
+
+    /** Whether the statistics of the current metric belong to the current neighbourhoods */
+    bool hasValidMetrics() const { return _metricsValid; }
+
+    /** Get the current neighbourhoods and statistics of the current metric to share them, see setLocalExplanation */
+    LocalExplanation getLocalExplanation() const;
+
+    /**
+     * Share the neighbourhoods and statistics of another core instead of recomputing them. The other core has the
+     * same data, projection, exclusions and settings (see ExplanationRegistry); nothing is copied until a streaming
+     * update of either core changes them.
+     * @return Whether they were taken, false when they do not belong to the current metric or to the data
+     */
+    bool setLocalExplanation(const LocalExplanation& localExplanation);
+    void recomputeColorMapping(const DataMatrix& dimRanks);
+    void recomputeColorMapping(const TopRanks& topRanks);
+
+    /**
+     * Explain the projection for a ladder of radii in a single pass, see MultiScaleExplanation
+     * @param radii Radii of the levels as fractions of the projection diameter
+     * @return Whether the levels were computed (the current metric supports multi-scale explanation)
+     */
+    bool recomputeMultiScale(const std::vector<float>& radii, int xDim, int yDim);
+    void clearMultiScale() { _multiScale.clear(); }
+
+    /**
+     * Explain clusters instead of radius neighbourhoods, see ClusterExplanation
+     * @param clusterIds Cluster index of every point, -1 for points in no cluster
+     * @param numClusters Number of clusters
+     */
+    void setClusters(std::vector<int> clusterIds, int numClusters) { _clusterExplanation.setClusters(std::move(clusterIds), numClusters); }
+    void clearClusters() { _clusterExplanation.clear(); }
+    bool hasClusters() const { return _clusterExplanation.hasClusters(); }
+
+    /** Explain the clusters with the current metric and assign the colors to their top ranked dimensions */
+    bool recomputeClusterExplanation();
+
+    /**
+     * Set the landmarks of the approximate explanation, see LandmarkExplanation
+     * @param parameters Number, selection and interpolation of the landmarks, no landmarks for the exact explanation
+     */
+    void setLandmarkParameters(const LandmarkParameters& parameters) { _landmarkParameters = parameters; }
+    const LandmarkParameters& getLandmarkParameters() const { return _landmarkParameters; }
+    bool hasLandmarks() const { return _landmarkParameters.numLandmarks > 0; }
+
+    /**
+     * Explain the landmarks for \p neighbourhoodRadius, interpolate them to all points and assign the colors
+     * @return Whether the points were explained (landmarks are set and the current metric supports them)
+     */
+    bool recomputeLandmarkExplanation(float neighbourhoodRadius, int xDim, int yDim);
+
+    void excludeDimension(int dim);
+
+    void setExplanationMetric(Explanation::Metric metric);
+    void computeDimensionRanks(std::vector<float>& dimRanking, const std::vector<unsigned int>& selection);
+    void computeDimensionRanks(DataMatrix& dimRanking);
+
+    /** Compute the statistics of \p selection, without ranking it */
+    std::shared_ptr<const SelectionStatistics> computeSelectionStatistics(const std::vector<unsigned int>& selection) const;
+
+    /**
+     * Rank the dimensions of a selection by their loadings on its top principal components, see LocalPCA.
+     * The ranks are oriented like those of the current metric (low is best for variance) so they sort the same way.
+     * @param warmStart Whether to start from the components of the previous selection, for a moving lens
+     */
+    void computeLocalPCARanks(std::vector<float>& dimRanking, const std::vector<unsigned int>& selection, bool warmStart = true);
+    const LocalPCA& getLocalPCA() const { return _localPCA; }
+
+    std::vector<float> computeConfidences(const DataMatrix& dimRanks);
+    std::vector<float> computeConfidences(const TopRanks& topRanks);
+
+    /** Compute for every point the highest ranked dimension that is not excluded */
+    void computeTopRankedDimensions(const DataMatrix& dimRanks, std::vector<int>& topRankedDims) const;
+
+private:
+    /** Initialize core after new data has been set */
+    void initialize();
+
+    Explanation::Method* getCurrentExplanationMethod();
+    const Explanation::Method* getCurrentExplanationMethod() const;
+
+    /**
+     * Choose the neighbourhood sampling stride that keeps the explanation within the memory budget
+     * @param entries Estimated number of indices of the unstrided neighbourhoods of the methods
+     * @param confidenceEntries Estimated number of indices of the unstrided confidence neighbourhoods
+     */
+    int chooseNeighbourhoodStride(double entries, double confidenceEntries);
+
+    /** Build the spatial grid over the projection axes, unless it is still valid */
+    void updateGrid(int xDim, int yDim);
+
+    /** Build the spatial grid and the nearest neighbour distances of the adaptive radii, unless they are still valid */
+    void updateAdaptiveRadii(int xDim, int yDim);
+
+    /** Drop everything derived from the projection, after it was replaced */
+    void clearProjectionCaches();
+
+    /** Move the points that drifted beyond the tolerance and rebuild the neighbourhoods and statistics around them */
+    void updateProjectionIncrementally(const DataMatrix& projection, const std::vector<int>& movedPoints);
+
+private:
+    bool                    _hasDataset;
+
+    DataTable               _dataset;
+    DataMatrix              _projection;
+    DataStatistics          _dataStats;
+    /** Statistics of the most recently ranked selection, shared by the ranking and the bar chart */
+    std::shared_ptr<const SelectionStatistics> _selectionStats;
+    /** Principal components of the most recently ranked selection, the warm start of the next */
+    LocalPCA                _localPCA;
+
+    ColorMapping            _colorMapping;
+
+    /** Largest extent of the projection */
+    float                   _projectionDiameter;
+
+    /** Matrix of neighbourhood indices for every point in the projection, possibly shared with other cores */
+    std::shared_ptr<const NeighbourhoodMatrix> _neighbourhoodMatrix;
+
+    /** Memory budget in bytes, 0 when unlimited */
+    std::size_t             _memoryBudget;
+    /** Sampling of the neighbourhoods, the stride is chosen to fit the memory budget */
+    NeighbourhoodSampling   _sampling;
+    /** Error introduced by the sampling of the neighbourhoods */
+    SamplingError           _samplingError;
+    /** Estimated memory of exact neighbourhoods for the current radius */
+    std::size_t             _estimatedNeighbourhoodMemory;
+
+    // Parameters of the current neighbourhoods, kept for streaming updates
+    /** Radius as a fraction of the projection diameter, negative before the first neighbourhoods */
+    float                   _neighbourhoodRadius;
+    /** Radius in projection units */
+    float                   _radius;
+    int                     _neighbourhoodXDim;
+    int                     _neighbourhoodYDim;
+    /** Whether the statistics of the current method belong to the current neighbourhoods */
+    bool                    _metricsValid;
+
+    // Streaming updates
+    /** Distance a point moves before it is updated, as a fraction of the radius */
+    float                   _streamingTolerance;
+    /** Number of incremental updates since the last full recompute */
+    int                     _numIncrementalUpdates;
+    /** Outcome of the last streaming update */
+    StreamingUpdate         _streamingUpdate;
+
+    // Adaptive radii
+    /** Rank of the nearest neighbour that sets the radius of a point, 0 for a global radius */
+    int                     _adaptiveNeighbours;
+    /** Factor applied to the nearest neighbour distances */
+    float                   _adaptiveScale;
+    /** Grid over the projection axes of the adaptive radii and the streaming updates */
+    SpatialGrid             _grid;
+    /** Distance of every point to its k-th nearest neighbour, k and the axes are kept to detect changes */
+    std::vector<float>      _nearestNeighbourDistances;
+    int                     _nearestNeighbourRank;
+    int                     _gridXDim;
+    int                     _gridYDim;
+
+    // Explanation metrics
+    /** Enum of which method is currently selected */
+    Explanation::Metric     _explanationMetric;
+    /** Da Silva euclidean-based explanation method */
+    EuclideanMethod         _euclideanMethod;
+    /** Da Silva variance-based explanation method */
+    VarianceMethod          _varianceMethod;
+    /** Value-based explanation method */
+    ValueMethod             _valueMethod;
+    /** Number of top ranked dimensions kept per point, 0 for the full rank matrix */
+    int                     _topK;
+    /** Whether the top K skips the dimensions that cannot enter it */
+    bool                    _dimensionPruning;
+    /** Maximum number of threads of the parallel work, 0 for the OpenMP default */
+    int                     _numThreads;
+    /** Top ranked dimensions of every point, empty unless a top K is set; possibly shared with other cores */
+    std::shared_ptr<const TopRanks> _topRanks;
+    /** Confidence model */
+    ConfidenceModel         _confidenceModel;
+    /** Explanation for a ladder of radii, empty unless requested */
+    MultiScaleExplanation   _multiScale;
+    /** Explanation of clusters, empty unless clusters are set */
+    ClusterExplanation      _clusterExplanation;
+    /** Parameters of the landmark explanation, no landmarks by default */
+    LandmarkParameters      _landmarkParameters;
+    /** Approximate explanation from landmarks, empty unless requested */
+    LandmarkExplanation     _landmarkExplanation;
+};
@@ -1,12 +1,90 @@
 #include "ExplanationModel.h"
+#include "Parallel.h"
+#include "Tracing.h"
 
 #include "PointData/DimensionsPickerAction.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
 namespace
 {
-    void convertToEigenMatrix(mv::Dataset<Points> dataset, DataMatrix& dataMatrix)
+    /** Data with at most this fraction of non-zero values is stored sparse */
+    constexpr double MAX_SPARSE_DENSITY = 0.3;
+
+    /**
+     * Convert the enabled dimensions of \p dataset to a sparse matrix, without densifying it first
+     * @param pointOrder Order of the rows of the matrix
+     * @return Whether the data was sparse enough, \p dataMatrix is left empty otherwise
+     */
+    bool convertToSparseMatrix(mv::Dataset<Points> dataset, const PointOrder& pointOrder, SparseDataMatrix& dataMatrix)
+    {
+        int numPoints = dataset->getNumPoints();
+        int numDimensions = dataset->getNumDimensions();
+
+        std::vector<bool> enabledDims = dataset->getDimensionsPickerAction().getEnabledDimensions();
+        int numEnabledDims = std::count(enabledDims.begin(), enabledDims.end(), true);
+
+        // The index of a value exceeds the range of an int for large data, so it is computed in 64 bits
+        const auto valueAt = [&](int i, int j) -> float {
+            std::size_t row = dataset->isFull() ? static_cast<std::size_t>(i) : static_cast<std::size_t>(dataset->indices[i]);
+            return dataset->getValueAt(row * numDimensions + j);
+        };
+
+        // Count the non-zeros of every row first, so the matrix is filled in place
+        const double maxNonZeros = MAX_SPARSE_DENSITY * static_cast<double>(numPoints) * numEnabledDims;
+
+        Eigen::VectorXi rowNonZeros = Eigen::VectorXi::Zero(numPoints);
+        std::int64_t numNonZeros = 0;
+        for (int i = 0; i < numPoints; i++)
+        {
+            for (int j = 0; j < numDimensions; j++)
+                if (enabledDims[j] && valueAt(i, j) != 0) rowNonZeros[i]++;
+
+            // Dense data is recognized after reading the first rows instead of all values
+            numNonZeros += rowNonZeros[i];
+            if (numNonZeros > maxNonZeros)
+                return false;
+        }
+
+        dataMatrix.resize(numPoints, numEnabledDims);
+
+        // Rows are filled in the internal order, so every row is appended
+        Eigen::VectorXi orderedNonZeros(numPoints);
+        for (int r = 0; r < numPoints; r++)
+            orderedNonZeros[r] = rowNonZeros[pointOrder.toOriginal(r)];
+
+        dataMatrix.reserve(orderedNonZeros);
+
+        for (int r = 0; r < numPoints; r++)
+        {
+            const int i = pointOrder.toOriginal(r);
+
+            int d = 0;
+
+            for (int j = 0; j < numDimensions; j++)
+            {
+                if (!enabledDims[j]) continue;
+
+                float value = valueAt(i, j);
+                if (value != 0) dataMatrix.insert(r, d) = value;
+
+                d++;
+            }
+        }
+
+        dataMatrix.makeCompressed();
+
+        return true;
+    }
+
+    /**
+     * Convert the enabled dimensions of \p dataset to a dense matrix
+     * @param pointOrder Order of the rows of the matrix
+     */
+    void convertToEigenMatrix(mv::Dataset<Points> dataset, const PointOrder& pointOrder, DataMatrix& dataMatrix)
     {
         int numPoints = dataset->getNumPoints();
         int numDimensions = dataset->getNumDimensions();
@@ -22,10 +100,12 @@ namespace
         {
             if (!enabledDims[j]) continue;
 
-            for (int i = 0; i < numPoints; i++)
+            for (int r = 0; r < numPoints; r++)
             {
-                int index = dataset->isFull() ? i * numDimensions + j : dataset->indices[i] * numDimensions + j;
-                dataMatrix(i, d) = dataset->getValueAt(index);
+                const int i = pointOrder.toOriginal(r);
+
+                std::size_t row = dataset->isFull() ? static_cast<std::size_t>(i) : static_cast<std::size_t>(dataset->indices[i]);
+                dataMatrix(r, d) = dataset->getValueAt(row * numDimensions + j);
             }
 
             d++;
@@ -40,290 +120,325 @@ namespace
         //}
     }
 
-    float computeProjectionDiameter(const DataMatrix& projection, int xDim, int yDim)
+    /** Convert \p dataset for the explanation of \p projection into the data shared by all views of the two */
+    std::shared_ptr<const SharedExplanationData> createSharedData(mv::Dataset<Points> dataset, mv::Dataset<Points> projection)
     {
-        float minX = std::numeric_limits<float>::max(), maxX = -std::numeric_limits<float>::max();
-        float minY = std::numeric_limits<float>::max(), maxY = -std::numeric_limits<float>::max();
-        for (int i = 0; i < projection.rows(); i++)
-        {
-            float x = projection(i, xDim);
-            float y = projection(i, yDim);
+        TRACE_SCOPE("ExplanationModel::createSharedData");
 
-            if (x < minX) minX = x;
-            if (x > maxX) maxX = x;
-            if (y < minY) minY = y;
-            if (y > maxY) maxY = y;
-        }
-        float rangeX = maxX - minX;
-        float rangeY = maxY - minY;
+        auto sharedData = std::make_shared<SharedExplanationData>();
 
-        float diameter = rangeX > rangeY ? rangeX : rangeY;
-        return diameter;
-    }
+        // Store the points in the Morton order of the projection, so neighbours are close in memory
+        DataMatrix projectionMatrix;
+        convertToEigenMatrix(projection, PointOrder(), projectionMatrix);
 
-    void computeDatasetStats(const DataTable& dataset, DataStatistics& dataStats)
-    {
-        int numPoints = dataset.numPoints();
-        int numDimensions = dataset.numDimensions();
-
-        dataStats.means.clear();
-        dataStats.variances.clear();
-        dataStats.minRange.clear();
-        dataStats.maxRange.clear();
-        dataStats.ranges.clear();
-        
-        dataStats.means.resize(numDimensions);
-        dataStats.variances.resize(numDimensions);
-        dataStats.minRange.resize(numDimensions, std::numeric_limits<float>::max());
-        dataStats.maxRange.resize(numDimensions, -std::numeric_limits<float>::max());
-        dataStats.ranges.resize(numDimensions, 0);
+        if (projectionMatrix.cols() >= 2)
+            sharedData->pointOrder.computeMorton(projectionMatrix, 0, 1);
 
-        for (int j = 0; j < numDimensions; j++)
+        // Convert the dataset to an eigen matrix, mostly zero data (e.g. single-cell counts) is kept sparse
+        SparseDataMatrix sparseDataMatrix;
+
+        if (convertToSparseMatrix(dataset, sharedData->pointOrder, sparseDataMatrix))
         {
-            // Compute mean
-            float mean = 0;
-            for (int i = 0; i < numPoints; i++)
-            {
-                float value = dataset(i, j);
+            sharedData->dataset.setData(sparseDataMatrix);
+        }
+        else
+        {
+            DataMatrix eigenDataMatrix;
+            convertToEigenMatrix(dataset, sharedData->pointOrder, eigenDataMatrix);
 
-                if (value < dataStats.minRange[j]) dataStats.minRange[j] = value;
-                if (value > dataStats.maxRange[j]) dataStats.maxRange[j] = value;
-                mean += value;
-            }
-            mean /= numPoints;
-            dataStats.means[j] = mean;
+            sharedData->dataset.setData(eigenDataMatrix);
+        }
 
-            // Compute variance
-            float variance = 0;
-            for (int i = 0; i < numPoints; i++)
+        computeDatasetStats(sharedData->dataset, sharedData->dataStats);
+
+        // Store dimension names
+        if (dataset->getDimensionNames().size() > 0)
+        {
+            sharedData->dimensionNames = dataset->getDimensionNames();
+        }
+        else
+        {
+            for (int j = 0; j < dataset->getNumDimensions(); j++)
             {
-                float x = dataset(i, j) - mean;
-                variance += x * x;
+                sharedData->dimensionNames.push_back(QString("Dim " + QString::number(j)));
             }
-            variance /= numPoints;
-            dataStats.variances[j] = variance;
         }
-        for (int j = 0; j < numDimensions; j++)
-        {
-            dataStats.ranges[j] = dataStats.maxRange[j] - dataStats.minRange[j];
-            if (dataStats.ranges[j] == 0) dataStats.ranges[j] = 1;
 
-            std::cout << j << ": " << "Means : " << dataStats.means[j] << " Variances : " << dataStats.variances[j] << " Min range : " << dataStats.minRange[j] << " Max range : " << dataStats.maxRange[j] << std::endl;
-        }
+        return sharedData;
     }
+}
 
-    void findNeighbourhood(const DataMatrix& projection, int centerId, float radius, std::vector<int>& neighbourhood, int xDim, int yDim)
+ExplanationModel::ExplanationModel() :
+    _projectionVersion(0),
+    _localSharing(false)
+{
+    // Initialize color palette
+    _palette.resize(_core.getColorMapping().getPaletteSize()); // "#31a09a", "#59a14f", "#A13237"
+    const char* kelly_colors[] = { "#F3C300", "#875692", "#F38400", "#A1CAF1", "#BE0032", "#C2B280", "#59a14f", "#008856", "#E68FAC", "#0067A5", "#F99379", "#604E97", "#F6A600", "#B3446C", "#DCD300", "#882D17", "#8DB600", "#654522", "#E25822", "#2B3D26" };
+    for (int i = 0; i < _palette.size(); i++)
     {
-        float x = projection(centerId, xDim);
-        float y = projection(centerId, yDim);
+        _palette[i] = QColor(kelly_colors[i % 20]);
+    }
+}
 
-        float radSquared = radius * radius;
+const std::vector<QString>& ExplanationModel::getDataNames() const
+{
+    static const std::vector<QString> noNames;
+    return _sharedData ? _sharedData->dimensionNames : noNames;
+}
 
-        neighbourhood.clear();
+const PointOrder& ExplanationModel::getPointOrder() const
+{
+    static const PointOrder identity;
+    return _sharedData ? _sharedData->pointOrder : identity;
+}
 
-        for (int i = 0; i < projection.rows(); i++)
-        {
-            float xd = projection(i, xDim) - x;
-            float yd = projection(i, yDim) - y;
+void ExplanationModel::setDataset(mv::Dataset<Points> dataset, mv::Dataset<Points> projection)
+{
+    TRACE_SCOPE("ExplanationModel::setDataset");
 
-            float magSquared = xd * xd + yd * yd;
+    // Converting the data computes its order and statistics in parallel outside of the core, under the same cap
+    const parallel::ThreadLimit threadLimit(_core.getNumThreads());
 
-            if (magSquared > radSquared)
-                continue;
+    ExplanationRegistry& registry = ExplanationRegistry::instance();
 
-            neighbourhood.push_back(i);
-        }
-    }
+    // The registry drops the entries of the data and the projection when their values change, once for all views
+    const int dataVersion = registry.watch(dataset);
+    _projectionVersion = registry.watch(projection);
+
+    // Views of the same data with the same enabled dimensions share the converted data
+    _dataKey = ExplanationRegistry::Key{ dataset->getId(), dataVersion, projection->getId(), static_cast<int>(projection->getNumPoints()), dataset->getDimensionsPickerAction().getEnabledDimensions() };
+
+    _sharedData = registry.acquire(_dataKey, [&]() {
+        return createSharedData(dataset, projection);
+    });
+
+    // The neighbourhoods and local statistics are shared again until the positions are streamed
+    _localKey = ExplanationRegistry::LocalKey();
+    _sharedLocal.reset();
+    _localSharing = true;
+
+    // The positions are per view, a live projection may have moved since the data was shared
+    DataMatrix projectionMatrix;
+    convertToEigenMatrix(projection, _sharedData->pointOrder, projectionMatrix);
+
+    _core.setData(_sharedData->dataset, _sharedData->dataStats, projectionMatrix);
+
+    updateColors(_core.getColorMapping().getPaletteIndices());
+
+    emit datasetChanged();
 }
 
-ExplanationModel::ExplanationModel() :
-    _hasDataset(false),
-    _projectionDiameter(1),
-    _explanationMetric(Explanation::Metric::VARIANCE)
+void ExplanationModel::recomputeNeighbourhood(float neighbourhoodRadius, int xDim, int yDim)
 {
+    _sharedLocal.reset();
+
+    if (_localSharing)
+    {
+        _localKey = createLocalKey(neighbourhoodRadius, xDim, yDim);
 
+        // Another view with the same settings already computed the neighbourhoods and the statistics of the metric
+        if (importLocalExplanation())
+            return;
+    }
+
+    _core.recomputeNeighbourhood(neighbourhoodRadius, xDim, yDim);
 }
 
-void ExplanationModel::setDataset(mv::Dataset<Points> dataset, mv::Dataset<Points> projection)
+bool ExplanationModel::updateProjection(mv::Dataset<Points> projection)
 {
-    // Convert the dataset and projection to eigen matrices
-    DataMatrix eigenDataMatrix;
-    convertToEigenMatrix(dataset, eigenDataMatrix);
-    _dataset.setData(eigenDataMatrix);
-    convertToEigenMatrix(projection, _projection);
+    TRACE_SCOPE("ExplanationModel::updateProjection");
 
-    initialize();
+    // The points keep the order of the first projection, a different number of points is rejected by the core
+    const PointOrder identity;
+    const PointOrder& pointOrder = projection->getNumPoints() == getPointOrder().numPoints() ? getPointOrder() : identity;
 
-    // Store dimension names
-    if (dataset->getDimensionNames().size() > 0)
-    {
-        _dimensionNames = dataset->getDimensionNames();
-    }
-    else
+    DataMatrix projectionMatrix;
+    convertToEigenMatrix(projection, pointOrder, projectionMatrix);
+
+    // The positions diverge from those of the other views, which keep what they share; the core copies what it updates
+    _localSharing = false;
+    _sharedLocal.reset();
+
+    return _core.updateProjection(projectionMatrix);
+}
+
+void ExplanationModel::recomputeMetrics()
+{
+    // Nothing is shared before the first neighbourhoods of the data
+    if (!_localSharing || _localKey.neighbourhoodRadius < 0)
     {
-        for (int j = 0; j < dataset->getNumDimensions(); j++)
-        {
-            _dimensionNames.push_back(QString("Dim " + QString::number(j)));
-        }
+        _core.recomputeMetrics();
+        return;
     }
 
-    emit datasetChanged();
+    const ExplanationRegistry::LocalKey previousKey = _localKey;
+    updateMetricParameters(_localKey);
+
+    // Still shared, the metric, top K and relevant exclusions did not change
+    if (_sharedLocal && _localKey == previousKey && _core.hasValidMetrics())
+        return;
+
+    _sharedLocal.reset();
 
-    _hasDataset = true;
+    if (importLocalExplanation())
+        return;
+
+    _core.recomputeMetrics();
+
+    if (_core.hasValidMetrics())
+        _sharedLocal = ExplanationRegistry::instance().shareLocal(_localKey, _core.getLocalExplanation());
 }
 
-void ExplanationModel::initialize()
+ExplanationRegistry::LocalKey ExplanationModel::createLocalKey(float neighbourhoodRadius, int xDim, int yDim) const
 {
-    // Compute projection diameter
-    _projectionDiameter = computeProjectionDiameter(_projection, 0, 1);
-    std::cout << "Diameter: " << _projectionDiameter << std::endl;
-
-    //// Standardized dataset
-    //_standardizedDataset = _dataset;
-    //auto means = _standardizedDataset.colwise().mean();
-    //_standardizedDataset.rowwise() -= means;
-
-    //for (int j = 0; j < _standardizedDataset.cols(); j++)
-    //{
-    //    float variance = 0;
-    //    for (int i = 0; i < _standardizedDataset.rows(); i++)
-    //    {
-    //        variance += _standardizedDataset(i, j) * _standardizedDataset(i, j);
-    //    }
-    //    variance /= _standardizedDataset.rows() - 1;
-    //    float stddev = sqrt(variance);
-    //    _standardizedDataset.col(j) /= stddev;
-    //}
-
-    //// Compute global statistics on data
-    //computeDatasetStats(_dataset, _dataStats);
-
-    //// Normalized dataset
-    //_normDataset = _dataset;
-    //std::vector<float> ranges(_dataset.cols());
-    //for (int j = 0; j < ranges.size(); j++) ranges[j] = _dataStats.maxRange[j] - _dataStats.minRange[j];
-    //for (int j = 0; j < _normDataset.cols(); j++)
-    //{
-    //    for (int i = 0; i < _normDataset.rows(); i++)
-    //    {
-    //        _normDataset(i, j) = (_normDataset(i, j)) / ranges[j]; // - _dataStats.means[j]
-    //    }
-    //}
-
-    computeDatasetStats(_dataset, _dataStats);
-
-    // Create color mapping
-    _colorMapping.recreate(_dataset);
+    ExplanationRegistry::LocalKey key;
+
+    key.dataKey = _dataKey;
+    key.projectionVersion = _projectionVersion;
+    key.neighbourhoodRadius = neighbourhoodRadius;
+    key.xDim = xDim;
+    key.yDim = yDim;
+    key.memoryBudget = _core.getMemoryBudget();
+    key.maxNeighbours = _core.getNeighbourCap();
+    key.seed = _core.getNeighbourSeed();
+    key.adaptiveNeighbours = _core.getAdaptiveNeighbours();
+    key.adaptiveScale = _core.getAdaptiveScale();
+
+    updateMetricParameters(key);
+
+    return key;
 }
 
-void ExplanationModel::recomputeNeighbourhood(float neighbourhoodRadius, int xDim, int yDim)
+void ExplanationModel::updateMetricParameters(ExplanationRegistry::LocalKey& key) const
 {
-    if (!_hasDataset)
-        return;
-
-    _projectionDiameter = computeProjectionDiameter(_projection, xDim, yDim);
+    const DataTable& dataset = _core.getDataset();
 
-    computeNeighbourhoodMatrix(_neighbourhoodMatrix, _projectionDiameter * neighbourhoodRadius, xDim, yDim);
+    key.metric = _core.currentMetric();
+    key.topK = _core.getTopK();
+    key.dimensionPruning = _core.getDimensionPruning();
 
-    computeNeighbourhoodMatrix(_confidenceModel._confidenceNeighbourhoodMatrix, _projectionDiameter * neighbourhoodRadius * 0.25f, xDim, yDim);
+    // Only the top ranks depend on the excluded dimensions
+    key.excludedDimensions.clear();
+    if (key.topK > 0)
+    {
+        for (int j = 0; j < dataset.numDimensions(); j++)
+            key.excludedDimensions.push_back(dataset.isExcluded(j));
+    }
 }
 
-void ExplanationModel::recomputeMetrics()
+bool ExplanationModel::importLocalExplanation()
 {
-    Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+    std::shared_ptr<const LocalExplanation> localExplanation = ExplanationRegistry::instance().findLocal(_localKey);
+
+    if (!localExplanation || !_core.setLocalExplanation(*localExplanation))
+        return false;
 
-    if (explanationMethod != nullptr)
-        explanationMethod->recompute(_dataset, _neighbourhoodMatrix);
+    _sharedLocal = std::move(localExplanation);
+
+    return true;
 }
 
 void ExplanationModel::recomputeColorMapping(DataMatrix& dimRanks)
 {
-    _colorMapping.recompute(_dataset, dimRanks, currentMetric());
+    _core.recomputeColorMapping(dimRanks);
+
+    updateColors(_core.getColorMapping().getPaletteIndices());
 }
 
-void ExplanationModel::excludeDimension(int dim)
+void ExplanationModel::recomputeColorMapping(const TopRanks& topRanks)
 {
-    _dataset.excludeDimension(dim);
+    _core.recomputeColorMapping(topRanks);
 
-    emit datasetDimensionsChanged();
+    updateColors(_core.getColorMapping().getPaletteIndices());
 }
 
-void ExplanationModel::setExplanationMetric(Explanation::Metric metric)
+void ExplanationModel::applyScaleLevelColors(const ScaleLevel& level)
 {
-    _explanationMetric = metric;
-
-    emit explanationMetricChanged(metric);
+    updateColors(level.paletteIndices);
 }
 
-void ExplanationModel::computeDimensionRanks(std::vector<float>& dimRanking, std::vector<unsigned int>& selection)
+void ExplanationModel::setClusters(mv::Dataset<Clusters> clusters, mv::Dataset<Points> projection)
 {
-    Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+    TRACE_SCOPE("ExplanationModel::setClusters");
 
-    explanationMethod->computeDimensionRank(_dataset, selection, dimRanking);
-}
+    // Cluster indices refer to the global points, map them to the points of the projection
+    std::vector<std::uint32_t> globalIndices;
+    projection->getGlobalIndices(globalIndices);
 
-void ExplanationModel::computeDimensionRanks(DataMatrix& dimRanking)
-{
-    std::vector<unsigned int> selection(_dataset.numPoints());
-    std::iota(selection.begin(), selection.end(), 0);
+    std::vector<int> localIndices(globalIndices.empty() ? 0 : *std::max_element(globalIndices.begin(), globalIndices.end()) + 1, -1);
+    for (int i = 0; i < globalIndices.size(); i++)
+        localIndices[globalIndices[i]] = i;
 
-    Explanation::Method* explanationMethod = getCurrentExplanationMethod();
+    std::vector<int> clusterIds(globalIndices.size(), -1);
 
-    dimRanking.resize(selection.size(), _dataset.numDimensions());
-    for (int i = 0; i < selection.size(); i++)
+    const auto& clusterList = clusters->getClusters();
+    for (int c = 0; c < clusterList.size(); c++)
     {
-        int si = selection[i];
-
-        for (int j = 0; j < _dataset.numDimensions(); j++)
+        for (const auto& index : clusterList[c].getIndices())
         {
-            dimRanking(i, j) = explanationMethod->computeDimensionRank(_dataset, si, j);
+            if (index < localIndices.size() && localIndices[index] >= 0)
+                clusterIds[localIndices[index]] = c;
         }
     }
+
+    _core.setClusters(getPointOrder().toInternalOrder(clusterIds), static_cast<int>(clusterList.size()));
 }
 
-std::vector<float> ExplanationModel::computeConfidences(const DataMatrix& dimRanks)
+bool ExplanationModel::recomputeClusterExplanation()
 {
-    int numPoints = dimRanks.rows();
+    if (!_core.recomputeClusterExplanation())
+        return false;
 
-    // Compute confidences
-    std::vector<float> confidences(numPoints);
+    updateColors(_core.getColorMapping().getPaletteIndices());
 
-    _confidenceModel.computeConfidences(currentMetric(), _dataset, dimRanks, confidences);
+    return true;
+}
 
-    return confidences;
+bool ExplanationModel::recomputeLandmarkExplanation(float neighbourhoodRadius, int xDim, int yDim)
+{
+    if (!_core.recomputeLandmarkExplanation(neighbourhoodRadius, xDim, yDim))
+        return false;
+
+    updateColors(_core.getColorMapping().getPaletteIndices());
+
+    return true;
 }
 
-void ExplanationModel::computeNeighbourhoodMatrix(NeighbourhoodMatrix& neighbourhoodMatrix, float radius, int xDim, int yDim)
+void ExplanationModel::excludeDimension(int dim)
 {
-    auto start = std::chrono::high_resolution_clock::now();
+    _core.excludeDimension(dim);
 
-    neighbourhoodMatrix.clear();
-    neighbourhoodMatrix.resize(_projection.rows());
+    emit datasetDimensionsChanged();
+}
 
-#pragma omp parallel for
-    for (int i = 0; i < _projection.rows(); i++)
-    {
-        findNeighbourhood(_projection, i, radius, neighbourhoodMatrix[i], xDim, yDim);
+void ExplanationModel::setExplanationMetric(Explanation::Metric metric)
+{
+    _core.setExplanationMetric(metric);
 
-        if (i % 10000 == 0) std::cout << "Computing neighbourhood for points: [" << i << "/" << _projection.rows() << "]" << std::endl;
-    }
+    emit explanationMetricChanged(metric);
+}
 
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-    std::cout << "Neighbourhood Elapsed time : " << elapsed.count() << " s\n";
+void ExplanationModel::computeDimensionRanks(std::vector<float>& dimRanking, std::vector<unsigned int>& selection)
+{
+    _core.computeDimensionRanks(dimRanking, selection);
 }
 
-Explanation::Method* ExplanationModel::getCurrentExplanationMethod()
+void ExplanationModel::computeDimensionRanks(DataMatrix& dimRanking)
+{
+    _core.computeDimensionRanks(dimRanking);
+}
+
+std::vector<float> ExplanationModel::computeConfidences(const DataMatrix& dimRanks)
 {
-    Explanation::Method* explanationMethod = nullptr;
+    return _core.computeConfidences(dimRanks);
+}
 
-    switch (_explanationMetric)
+void ExplanationModel::updateColors(const std::vector<int>& paletteIndices)
+{
+    _colors.resize(paletteIndices.size());
+    for (int i = 0; i < paletteIndices.size(); i++)
     {
-    case Explanation::Metric::EUCLIDEAN: explanationMethod = &_euclideanMethod; break;
-    case Explanation::Metric::VARIANCE: explanationMethod = &_varianceMethod; break;
-    case Explanation::Metric::VALUE: explanationMethod = &_valueMethod; break;
-    default: break;
+        _colors[i] = paletteIndices[i] >= 0 ? _palette[paletteIndices[i]] : QColor(180, 180, 180);
     }
-
-    return explanationMethod;
 }
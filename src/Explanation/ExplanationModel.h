@@ -4,53 +4,97 @@
 #include <QColor>
 
 #include "PointData/PointData.h"
-
-#include "DataTypes.h"
-#include "Methods/ExplanationMethod.h"
-#include "ColorMapping.h"
-
-#include "Methods/SilvaEuclidean.h"
-#include "Methods/SilvaVariance.h"
-#include "Methods/ValueRanking.h"
-#include "ConfidenceModel.h"
-
-class DataStatistics
-{
-public:
-    std::vector<float> means;
-    std::vector<float> variances;
-    std::vector<float> minRange;
-    std::vector<float> maxRange;
-    std::vector<float> ranges;
-};
-
+#include "ClusterData/ClusterData.h"
+
+#include "ExplanationCore.h"
+#include "ExplanationRegistry.h"
+#include "PointOrder.h"
+
+#include <memory>
+
+/**
+ * Explanation model class
+ *
+ * Qt adapter around the numeric ExplanationCore. Converts ManiVault datasets to the matrices
+ * used by the core, keeps the dimension names and color palette, and notifies the views of
+ * changes through signals.
+ *
+ * The core stores the points in the Morton order of the projection (see PointOrder). Selection
+ * indices passed to the model and the core are internal indices (see toInternalIndices), and
+ * per-point results of the core are mapped back with getPointOrder() before they reach ManiVault.
+ *
+ * The converted data, its statistics, the point order and the dimension names are shared with
+ * the other views of the same data through the ExplanationRegistry. The neighbourhoods and local
+ * statistics are shared with the views that have the same settings as well, until the view
+ * streams a live projection (see updateProjection); then it keeps its own until the data is set
+ * again.
+ */
 class ExplanationModel : public QObject
 {
     Q_OBJECT
 public:
     ExplanationModel();
 
-    bool hasDataset() { return _hasDataset; }
-    const DataTable& getDataset() { return _dataset; }
-    const DataStatistics& getDataStatistics() { return _dataStats; }
-    const std::vector<QString>& getDataNames() { return _dimensionNames; }
+    ExplanationCore& getCore() { return _core; }
+
+    bool hasDataset() { return _core.hasDataset(); }
+    const DataTable& getDataset() { return _core.getDataset(); }
+    const DataStatistics& getDataStatistics() { return _core.getDataStatistics(); }
+    const std::shared_ptr<const SelectionStatistics>& getSelectionStatistics() { return _core.getSelectionStatistics(); }
+    const std::vector<QString>& getDataNames() const;
+
+    /** Get the order of the points in the core relative to the ManiVault dataset */
+    const PointOrder& getPointOrder() const;
 
-    Explanation::Metric currentMetric() { return _explanationMetric; }
-    const std::vector<QColor>& getColorMapping() { return _colorMapping.getColors(); }
+    /** Map ManiVault point indices (e.g. a selection) to the internal indices of the core */
+    std::vector<unsigned int> toInternalIndices(const std::vector<unsigned int>& indices) const { return getPointOrder().toInternal(indices); }
 
-    void resetDataset() { _hasDataset = false; }
+    Explanation::Metric currentMetric() { return _core.currentMetric(); }
+    const std::vector<QColor>& getColorMapping() { return _colors; }
+
+    void resetDataset() { _core.resetDataset(); _sharedData.reset(); _sharedLocal.reset(); _localSharing = false; }
     void setDataset(mv::Dataset<Points> dataset, mv::Dataset<Points> projection);
     void recomputeNeighbourhood(float neighbourhoodRadius, int xDim, int yDim);
+
+    /**
+     * Stream the current positions of \p projection into the core, see ExplanationCore::updateProjection
+     * @return Whether the positions were taken, false when the number of points changed
+     */
+    bool updateProjection(mv::Dataset<Points> projection);
+
     void recomputeMetrics();
     void recomputeColorMapping(DataMatrix& dimRanks);
+    void recomputeColorMapping(const TopRanks& topRanks);
+
+    /** Use the dimension colors of a level of the multi-scale explanation */
+    void applyScaleLevelColors(const ScaleLevel& level);
+
+    /**
+     * Explain the clusters of \p clusters instead of the radius neighbourhoods
+     * @param clusters Clusters of the source data of \p projection
+     * @param projection Projection the explanation is computed for
+     */
+    void setClusters(mv::Dataset<Clusters> clusters, mv::Dataset<Points> projection);
+    void clearClusters() { _core.clearClusters(); }
+    bool hasClusters() { return _core.hasClusters(); }
+
+    /** Explain the clusters and assign the dimension colors by the cluster explanation */
+    bool recomputeClusterExplanation();
+
+    /** Explain the landmarks, interpolate them to all points and assign the dimension colors by the result */
+    bool recomputeLandmarkExplanation(float neighbourhoodRadius, int xDim, int yDim);
 
     void excludeDimension(int dim);
 
     void setExplanationMetric(Explanation::Metric metric);
     void computeDimensionRanks(std::vector<float>& dimRanking, std::vector<unsigned int>& selection);
     void computeDimensionRanks(DataMatrix& dimRanking);
+    void computeLocalPCARanks(std::vector<float>& dimRanking, std::vector<unsigned int>& selection) { _core.computeLocalPCARanks(dimRanking, selection); }
+    std::shared_ptr<const SelectionStatistics> computeSelectionStatistics(const std::vector<unsigned int>& selection) { return _core.computeSelectionStatistics(selection); }
 
     std::vector<float> computeConfidences(const DataMatrix& dimRanks);
+    std::vector<float> computeConfidences(const TopRanks& topRanks) { return _core.computeConfidences(topRanks); }
+    void computeTopRankedDimensions(const DataMatrix& dimRanks, std::vector<int>& topRankedDims) { _core.computeTopRankedDimensions(dimRanks, topRankedDims); }
 
 signals:
     void datasetChanged();
@@ -59,44 +103,38 @@ signals:
     void datasetDimensionsChanged();
 
 private:
-    /** Initialize model */
-    void initialize();
+    /** Convert palette indices to the colors of the dimensions */
+    void updateColors(const std::vector<int>& paletteIndices);
 
-    /**
-     * For every point in the projection compute the indices of the points
-     * in its neighbourhood and add them to the matrix.
-     */
-    void computeNeighbourhoodMatrix(NeighbourhoodMatrix& neighbourhoodMatrix, float radius, int xDim, int yDim);
+    /** Get the key of the neighbourhoods of \p neighbourhoodRadius and the statistics for the current settings of the core */
+    ExplanationRegistry::LocalKey createLocalKey(float neighbourhoodRadius, int xDim, int yDim) const;
+
+    /** Set the metric, top K and exclusions of \p key to the current settings of the core */
+    void updateMetricParameters(ExplanationRegistry::LocalKey& key) const;
 
-    Explanation::Method* getCurrentExplanationMethod();
+    /** Take the neighbourhoods and local statistics of another view under the current local key, if any */
+    bool importLocalExplanation();
 
 private:
-    bool                    _hasDataset;
-
-    DataTable               _dataset;
-    DataMatrix              _standardizedDataset;
-    DataMatrix              _normDataset;
-    DataMatrix              _projection;
-    DataStatistics          _dataStats;
-    std::vector<QString>    _dimensionNames;
-
-    ColorMapping            _colorMapping;
-
-    /** Largest extent of the projection */
-    float                   _projectionDiameter;
-
-    /** Matrix of neighbourhood indices for every point in the projection */
-    NeighbourhoodMatrix     _neighbourhoodMatrix;
-
-    // Explanation metrics
-    /** Enum of which method is currently selected */
-    Explanation::Metric     _explanationMetric;
-    /** Da Silva euclidean-based explanation method */
-    EuclideanMethod         _euclideanMethod;
-    /** Da Silva variance-based explanation method */
-    VarianceMethod          _varianceMethod;
-    /** Value-based explanation method */
-    ValueMethod             _valueMethod;
-    /** Confidence model */
-    ConfidenceModel         _confidenceModel;
+    ExplanationCore         _core;
+
+    /** Converted data, statistics, point order and dimension names, shared with the other views of the same data */
+    std::shared_ptr<const SharedExplanationData> _sharedData;
+
+    /** Key of the shared data */
+    ExplanationRegistry::Key _dataKey;
+    /** Version of the projection positions the core was set with */
+    int                     _projectionVersion;
+
+    /** Whether the neighbourhoods and local statistics are shared, false after a streaming update until the data is set again */
+    bool                    _localSharing;
+    /** Key of the current neighbourhoods and statistics of the core */
+    ExplanationRegistry::LocalKey _localKey;
+    /** Neighbourhoods and local statistics shared under the local key, null when the core holds others */
+    std::shared_ptr<const LocalExplanation> _sharedLocal;
+
+    /** Palette of the colors assigned to the top ranked dimensions */
+    std::vector<QColor>     _palette;
+    /** Color of every dimension */
+    std::vector<QColor>     _colors;
 };
@@ -0,0 +1,136 @@
+#include "ExplanationRegistry.h"
+
+#include <tuple>
+
+bool ExplanationRegistry::Key::operator<(const Key& other) const
+{
+    return std::tie(datasetId, dataVersion, projectionId, numPoints, enabledDimensions) < std::tie(other.datasetId, other.dataVersion, other.projectionId, other.numPoints, other.enabledDimensions);
+}
+
+bool ExplanationRegistry::LocalKey::operator<(const LocalKey& other) const
+{
+    if (dataKey < other.dataKey) return true;
+    if (other.dataKey < dataKey) return false;
+
+    return std::tie(projectionVersion, neighbourhoodRadius, xDim, yDim, memoryBudget, maxNeighbours, seed, adaptiveNeighbours, adaptiveScale, metric, topK, dimensionPruning, excludedDimensions)
+        < std::tie(other.projectionVersion, other.neighbourhoodRadius, other.xDim, other.yDim, other.memoryBudget, other.maxNeighbours, other.seed, other.adaptiveNeighbours, other.adaptiveScale, other.metric, other.topK, other.dimensionPruning, other.excludedDimensions);
+}
+
+bool ExplanationRegistry::LocalKey::operator==(const LocalKey& other) const
+{
+    return !(*this < other) && !(other < *this);
+}
+
+ExplanationRegistry& ExplanationRegistry::instance()
+{
+    static ExplanationRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<const SharedExplanationData> ExplanationRegistry::acquire(const Key& key, const std::function<std::shared_ptr<const SharedExplanationData>()>& create)
+{
+    removeExpired();
+
+    auto it = _entries.find(key);
+    if (it != _entries.end())
+    {
+        if (auto data = it->second.lock())
+            return data;
+    }
+
+    std::shared_ptr<const SharedExplanationData> data = create();
+
+    _entries[key] = data;
+
+    return data;
+}
+
+std::shared_ptr<const LocalExplanation> ExplanationRegistry::findLocal(const LocalKey& key)
+{
+    removeExpired();
+
+    auto it = _localEntries.find(key);
+    if (it == _localEntries.end())
+        return nullptr;
+
+    return it->second.lock();
+}
+
+std::shared_ptr<const LocalExplanation> ExplanationRegistry::shareLocal(const LocalKey& key, const LocalExplanation& localExplanation)
+{
+    // The view shares what its core holds, so nothing is copied
+    auto localEntry = std::make_shared<const LocalExplanation>(localExplanation);
+
+    _localEntries[key] = localEntry;
+
+    return localEntry;
+}
+
+int ExplanationRegistry::watch(mv::Dataset<Points> dataset)
+{
+    const QString datasetId = dataset->getId();
+
+    auto it = _watches.find(datasetId);
+    if (it != _watches.end())
+        return it->second.version;
+
+    Watch& watch = _watches[datasetId];
+    watch.dataset = dataset;
+
+    // Connected once per dataset instead of once per view, so every change drops the entries once
+    QObject::connect(&watch.dataset, &mv::Dataset<Points>::dataChanged, [this, datasetId]() {
+        invalidate(datasetId);
+    });
+
+    return watch.version;
+}
+
+void ExplanationRegistry::invalidate(const QString& datasetId)
+{
+    _watches[datasetId].version++;
+
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+        if (it->first.datasetId == datasetId)
+            it = _entries.erase(it);
+        else
+            ++it;
+    }
+
+    // The neighbourhoods also depend on the positions of the projection
+    for (auto it = _localEntries.begin(); it != _localEntries.end();)
+    {
+        if (it->first.dataKey.datasetId == datasetId || it->first.dataKey.projectionId == datasetId)
+            it = _localEntries.erase(it);
+        else
+            ++it;
+    }
+}
+
+int ExplanationRegistry::numEntries() const
+{
+    int numEntries = 0;
+    for (const auto& entry : _entries)
+        if (!entry.second.expired()) numEntries++;
+
+    return numEntries;
+}
+
+void ExplanationRegistry::removeExpired()
+{
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+        if (it->second.expired())
+            it = _entries.erase(it);
+        else
+            ++it;
+    }
+
+    for (auto it = _localEntries.begin(); it != _localEntries.end();)
+    {
+        if (it->second.expired())
+            it = _localEntries.erase(it);
+        else
+            ++it;
+    }
+}
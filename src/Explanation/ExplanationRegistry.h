@@ -0,0 +1,129 @@
+#pragma once
+
+#include "DataTypes.h"
+#include "ExplanationCore.h"
+#include "PointOrder.h"
+
+#include "PointData/PointData.h"
+
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+/** Data of the explanation that does not depend on the settings of a view, never modified once shared */
+struct SharedExplanationData
+{
+    DataTable               dataset;            /** Enabled dimensions of the source data, rows in the point order */
+    DataStatistics          dataStats;          /** Global statistics of the data */
+    PointOrder              pointOrder;         /** Morton order of the projection the data was first converted for */
+    std::vector<QString>    dimensionNames;     /** Names of all dimensions of the source data */
+};
+
+/**
+ * Explanation registry class
+ *
+ * Process-wide registry of the converted data of the explanations, so that several views of the
+ * same data (e.g. the same projection colored by different settings) convert the data, compute
+ * its statistics and hold its values only once. Entries are keyed by the source and projection
+ * dataset GUIDs and the parameters of the conversion. The registry only holds weak references:
+ * the views hold the data, and it is freed together with the last view that uses it.
+ *
+ * A second layer shares the neighbourhoods and local statistics (see LocalExplanation) between the
+ * views with the same data, projection and settings: radius, axes, neighbour cap, memory budget,
+ * adaptive radius, metric and top K. A view that streams a live projection or changes a setting
+ * takes its own from then on; what it shared is only copied when it is modified (see makeUnique).
+ *
+ * The registry watches the source and projection datasets of the views, once per dataset. When
+ * the values of a dataset change its version is incremented and its entries are dropped, the keys
+ * hold the versions so views that still hold the old data never share it with views of the new.
+ * Only used from the GUI thread.
+ */
+class ExplanationRegistry
+{
+public:
+    /** Identity of the shared data, views with equal keys share it */
+    struct Key
+    {
+        QString             datasetId;          /** GUID of the source dataset */
+        int                 dataVersion = 0;    /** Version of the values of the source dataset, see watch */
+        QString             projectionId;       /** GUID of the projection dataset, which determines the point order */
+        int                 numPoints = 0;      /** Number of points of the projection */
+        std::vector<bool>   enabledDimensions;  /** Dimensions of the source data that are converted */
+
+        bool operator<(const Key& other) const;
+    };
+
+    /** Identity of the neighbourhoods and local statistics, views with equal keys share them */
+    struct LocalKey
+    {
+        Key                     dataKey;                    /** Key of the shared data */
+        int                     projectionVersion   = -1;   /** Version of the positions of the projection, see watch */
+        float                   neighbourhoodRadius = -1;   /** Radius as a fraction of the projection diameter */
+        int                     xDim                = 0;    /** Projection axes of the neighbourhoods */
+        int                     yDim                = 1;
+        std::size_t             memoryBudget        = 0;    /** Memory budget, which sets the sampling stride */
+        int                     maxNeighbours       = 0;    /** Neighbour cap and the seed of its sampling */
+        std::uint32_t           seed                = 0;
+        int                     adaptiveNeighbours  = 0;    /** Adaptive radius, 0 for a global radius */
+        float                   adaptiveScale       = 1;
+        Explanation::Metric     metric              = Explanation::Metric::NONE;    /** Metric of the statistics */
+        int                     topK                = 0;    /** Top K of the ranks, 0 for the local statistics of all dimensions */
+        bool                    dimensionPruning    = false;
+        std::vector<bool>       excludedDimensions;         /** Excluded dimensions, only with a top K as the local statistics do not depend on them */
+
+        bool operator<(const LocalKey& other) const;
+        bool operator==(const LocalKey& other) const;
+    };
+
+    static ExplanationRegistry& instance();
+
+    /**
+     * Get the data of \p key, created with \p create when no view holds it
+     * @return Shared data, held by the caller for as long as it is used
+     */
+    std::shared_ptr<const SharedExplanationData> acquire(const Key& key, const std::function<std::shared_ptr<const SharedExplanationData>()>& create);
+
+    /** Get the neighbourhoods and local statistics of \p key, null when no view holds them */
+    std::shared_ptr<const LocalExplanation> findLocal(const LocalKey& key);
+
+    /**
+     * Share the neighbourhoods and local statistics of a view under \p key
+     * @return Shared local explanation, held by the view for as long as its core holds the same
+     */
+    std::shared_ptr<const LocalExplanation> shareLocal(const LocalKey& key, const LocalExplanation& localExplanation);
+
+    /**
+     * Drop the entries of \p dataset whenever its values change, for all views at once
+     * @return Current version of the values of \p dataset, part of the keys of the entries computed from them
+     */
+    int watch(mv::Dataset<Points> dataset);
+
+    /** Get the number of entries held by at least one view */
+    int numEntries() const;
+
+private:
+    ExplanationRegistry() = default;
+
+    /** Increment the version of the dataset \p datasetId after its values changed and drop the entries computed from it, views that hold them keep their data until they reload */
+    void invalidate(const QString& datasetId);
+
+    /** Remove the entries that are no longer held by any view */
+    void removeExpired();
+
+    /** Handle of a watched dataset and the version of its values */
+    struct Watch
+    {
+        mv::Dataset<Points> dataset;
+        int                 version = 0;
+    };
+
+private:
+    std::map<Key, std::weak_ptr<const SharedExplanationData>>       _entries;       /** Shared data by key, weak so that the views own it */
+    std::map<LocalKey, std::weak_ptr<const LocalExplanation>>       _localEntries;  /** Neighbourhoods and local statistics by key */
+    std::map<QString, Watch>                                        _watches;       /** Watched datasets by GUID, kept for the lifetime of the process */
+};
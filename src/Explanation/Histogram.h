@@ -1,7 +1,7 @@
 #pragma once
 
 #include <vector>
-#include <QDebug>
+#include <algorithm>
 
 class Histogram
 {
@@ -0,0 +1,473 @@
+#include "LandmarkExplanation.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    /** SplitMix64 step, the same generator as the neighbourhood sampling */
+    std::uint64_t nextRandom(std::uint64_t& state)
+    {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /** Uniform random integer in [0, bound) */
+    std::uint64_t randomBelow(std::uint64_t& state, std::uint64_t bound)
+    {
+        return ((nextRandom(state) >> 32) * bound) >> 32;
+    }
+
+    float squaredDistance(const DataMatrix& projection, int a, int b, int xDim, int yDim)
+    {
+        const float xd = projection(a, xDim) - projection(b, xDim);
+        const float yd = projection(a, yDim) - projection(b, yDim);
+
+        return xd * xd + yd * yd;
+    }
+
+    /** Area of the intersection of two circles of radius r with centers \p distance apart, relative to the area of a circle */
+    float computeOverlap(float distance, float radius)
+    {
+        if (radius <= 0)
+            return distance > 0 ? 0.0f : 1.0f;
+
+        const double t = distance / (2.0 * radius);
+
+        if (t >= 1)
+            return 0;
+
+        return static_cast<float>(2.0 / PI * (std::acos(t) - t * std::sqrt(1 - t * t)));
+    }
+
+    /** Interpolation weight of a landmark, landmarks at the point itself take all weight */
+    float computeWeight(float distance)
+    {
+        return distance > 0 ? 1.0f / (distance * distance) : std::numeric_limits<float>::max();
+    }
+}
+
+LandmarkExplanation::LandmarkExplanation() :
+    _numInterpolated(0),
+    _xDim(0),
+    _yDim(1),
+    _numPoints(0)
+{
+
+}
+
+bool LandmarkExplanation::compute(const DataTable& dataset, const DataStatistics& dataStats, const DataMatrix& projection, float radius, Explanation::Metric metric, int xDim, int yDim, const LandmarkParameters& parameters, const NeighbourhoodSampling& sampling)
+{
+    TRACE_SCOPE("LandmarkExplanation::compute");
+
+    if (metric != Explanation::Metric::VARIANCE && metric != Explanation::Metric::VALUE)
+        return false;
+
+    if (parameters.numLandmarks <= 0 || dataset.numPoints() == 0)
+        return false;
+
+    updateLandmarks(projection, xDim, yDim, parameters);
+
+    TRACE_COUNTER("Landmarks", _landmarks.size());
+
+    computeLandmarkRanks(dataset, dataStats, projection, radius, metric, xDim, yDim, sampling);
+    interpolate(dataset, metric, radius);
+    computeConfidences(projection, radius, xDim, yDim);
+
+    return true;
+}
+
+void LandmarkExplanation::clear()
+{
+    _landmarks = std::vector<int>();
+    _numInterpolated = 0;
+    _nearestLandmarks = std::vector<int>();
+    _nearestDistances = std::vector<float>();
+    _numPoints = 0;
+
+    _landmarkRanks.resize(0, 0);
+    _landmarkNeighbourhoods = NeighbourhoodMatrix();
+    _landmarkTopDimensions = std::vector<int>();
+
+    _topDimensions = std::vector<int>();
+    _confidences = std::vector<float>();
+    _quality = std::vector<float>();
+}
+
+std::vector<int> LandmarkExplanation::computeTopCounts(const DataTable& dataset) const
+{
+    std::vector<int> topCounts(dataset.numDimensions(), 0);
+
+    for (const int topDim : _topDimensions)
+        if (!dataset.isExcluded(topDim)) topCounts[topDim]++;
+
+    return topCounts;
+}
+
+std::size_t LandmarkExplanation::getMemoryUsage() const
+{
+    return (_landmarks.capacity() + _nearestLandmarks.capacity() + _landmarkTopDimensions.capacity() + _topDimensions.capacity()) * sizeof(int)
+        + (_nearestDistances.capacity() + _landmarkRanks.size() + _confidences.capacity() + _quality.capacity()) * sizeof(float)
+        + ::getMemoryUsage(_landmarkNeighbourhoods);
+}
+
+void LandmarkExplanation::updateLandmarks(const DataMatrix& projection, int xDim, int yDim, const LandmarkParameters& parameters)
+{
+    const int numPoints = static_cast<int>(projection.rows());
+    const int numLandmarks = std::min(parameters.numLandmarks, numPoints);
+    const int numInterpolated = parameters.interpolation == LandmarkInterpolation::NEAREST ? 1 : std::max(1, std::min(parameters.numInterpolated, numLandmarks));
+
+    const bool sameLandmarks = !_landmarks.empty() && numPoints == _numPoints && xDim == _xDim && yDim == _yDim
+        && parameters.numLandmarks == _parameters.numLandmarks && parameters.selection == _parameters.selection && parameters.seed == _parameters.seed;
+
+    if (sameLandmarks && numInterpolated == _numInterpolated)
+        return;
+
+    if (!sameLandmarks)
+    {
+        TRACE_SCOPE("LandmarkExplanation::selectLandmarks");
+
+        if (parameters.selection == LandmarkSelection::RANDOM)
+            selectRandom(numPoints, numLandmarks, parameters.seed);
+        else
+            selectFarthestPoints(projection, numLandmarks, parameters.seed, xDim, yDim);
+    }
+
+    _parameters = parameters;
+    _xDim = xDim;
+    _yDim = yDim;
+    _numPoints = numPoints;
+    _numInterpolated = numInterpolated;
+
+    findNearestLandmarks(projection, xDim, yDim);
+}
+
+void LandmarkExplanation::selectRandom(int numPoints, int numLandmarks, std::uint32_t seed)
+{
+    // Partial Fisher-Yates shuffle, the first numLandmarks indices are a uniform sample
+    std::vector<int> indices(numPoints);
+    std::iota(indices.begin(), indices.end(), 0);
+
+    std::uint64_t state = seed;
+
+    for (int i = 0; i < numLandmarks; i++)
+        std::swap(indices[i], indices[i + randomBelow(state, numPoints - i)]);
+
+    _landmarks.assign(indices.begin(), indices.begin() + numLandmarks);
+
+    std::sort(_landmarks.begin(), _landmarks.end());
+}
+
+void LandmarkExplanation::selectFarthestPoints(const DataMatrix& projection, int numLandmarks, std::uint32_t seed, int xDim, int yDim)
+{
+    const int numPoints = static_cast<int>(projection.rows());
+
+    std::uint64_t state = seed;
+
+    _landmarks.clear();
+    _landmarks.push_back(static_cast<int>(randomBelow(state, numPoints)));
+
+    // Squared distance of every point to its closest landmark so far
+    std::vector<float> minDistances(numPoints, std::numeric_limits<float>::max());
+
+    while (static_cast<int>(_landmarks.size()) < numLandmarks)
+    {
+        const int landmark = _landmarks.back();
+
+        float farthestDistance = -1;
+        int farthest = -1;
+
+#pragma omp parallel
+        {
+            float threadDistance = -1;
+            int threadFarthest = -1;
+
+#pragma omp for
+            for (int i = 0; i < numPoints; i++)
+            {
+                minDistances[i] = std::min(minDistances[i], squaredDistance(projection, i, landmark, xDim, yDim));
+
+                if (minDistances[i] > threadDistance)
+                {
+                    threadDistance = minDistances[i];
+                    threadFarthest = i;
+                }
+            }
+
+            // Ties go to the lowest index, so the selection does not depend on the number of threads
+#pragma omp critical
+            if (threadDistance > farthestDistance || (threadDistance == farthestDistance && threadFarthest < farthest))
+            {
+                farthestDistance = threadDistance;
+                farthest = threadFarthest;
+            }
+        }
+
+        // Only duplicates of the landmarks are left
+        if (farthestDistance <= 0)
+            break;
+
+        _landmarks.push_back(farthest);
+    }
+}
+
+void LandmarkExplanation::findNearestLandmarks(const DataMatrix& projection, int xDim, int yDim)
+{
+    TRACE_SCOPE("LandmarkExplanation::findNearestLandmarks");
+
+    const int numPoints = static_cast<int>(projection.rows());
+    const int numLandmarks = static_cast<int>(_landmarks.size());
+    const int k = std::min(_numInterpolated, numLandmarks);
+
+    _numInterpolated = k;
+    _nearestLandmarks.assign(static_cast<std::size_t>(numPoints) * k, 0);
+    _nearestDistances.assign(static_cast<std::size_t>(numPoints) * k, std::numeric_limits<float>::max());
+
+#pragma omp parallel for
+    for (int i = 0; i < numPoints; i++)
+    {
+        int* nearest = &_nearestLandmarks[static_cast<std::size_t>(i) * k];
+        float* distances = &_nearestDistances[static_cast<std::size_t>(i) * k];
+
+        // Insertion into the k closest landmarks so far, k is small
+        for (int l = 0; l < numLandmarks; l++)
+        {
+            const float distance = squaredDistance(projection, i, _landmarks[l], xDim, yDim);
+
+            if (distance >= distances[k - 1])
+                continue;
+
+            int n = k - 1;
+            for (; n > 0 && distances[n - 1] > distance; n--)
+            {
+                distances[n] = distances[n - 1];
+                nearest[n] = nearest[n - 1];
+            }
+
+            distances[n] = distance;
+            nearest[n] = l;
+        }
+
+        for (int n = 0; n < k; n++)
+            distances[n] = std::sqrt(distances[n]);
+    }
+}
+
+void LandmarkExplanation::computeLandmarkRanks(const DataTable& dataset, const DataStatistics& dataStats, const DataMatrix& projection, float radius, Explanation::Metric metric, int xDim, int yDim, const NeighbourhoodSampling& sampling)
+{
+    TRACE_SCOPE("LandmarkExplanation::computeLandmarkRanks");
+
+    const int numLandmarks = static_cast<int>(_landmarks.size());
+    const int numDimensions = dataset.numDimensions();
+
+    const bool lowRankBest = metric == Explanation::Metric::VARIANCE;
+
+    // Local variances are ranked relative to the global variances, local means relative to the global means and ranges
+    const std::vector<double> globalVariances = dataStats.getNormalizingVariances();
+
+    // The landmark neighbourhoods are kept for the confidences, they are never strided
+    NeighbourhoodSampling landmarkSampling = sampling;
+    landmarkSampling.stride = 1;
+
+    _landmarkNeighbourhoods.resize(numLandmarks);
+    _landmarkRanks.resize(numLandmarks, numDimensions);
+
+#pragma omp parallel
+    {
+        std::vector<double> sums(numDimensions);
+        std::vector<double> squares(numDimensions);
+
+#pragma omp for schedule(dynamic, 4)
+        for (int l = 0; l < numLandmarks; l++)
+        {
+            Neighbourhood& neighbourhood = _landmarkNeighbourhoods[l];
+
+            findNeighbourhood(projection, _landmarks[l], radius, neighbourhood, xDim, yDim, landmarkSampling);
+
+            std::fill(sums.begin(), sums.end(), 0.0);
+            std::fill(squares.begin(), squares.end(), 0.0);
+
+            // Zeros add nothing to the sums, so sparse rows only visit their stored values
+            for (const int n : neighbourhood)
+            {
+                dataset.forEachNonZero(n, [&](int j, float value) {
+                    sums[j] += value;
+                    squares[j] += static_cast<double>(value) * value;
+                });
+            }
+
+            const double numNeighbours = static_cast<double>(neighbourhood.size());
+
+            double sum = 0;
+            for (int j = 0; j < numDimensions; j++)
+            {
+                const double mean = sums[j] / numNeighbours;
+
+                if (lowRankBest)
+                    sums[j] = std::max(0.0, squares[j] / numNeighbours - mean * mean) / globalVariances[j];
+                else
+                    sums[j] = (mean - dataStats.means[j]) / dataStats.ranges[j];
+
+                sum += std::abs(sums[j]);
+            }
+
+            for (int j = 0; j < numDimensions; j++)
+                _landmarkRanks(l, j) = sum > 0 ? static_cast<float>(sums[j] / sum) : 0.0f;
+        }
+    }
+}
+
+void LandmarkExplanation::interpolate(const DataTable& dataset, Explanation::Metric metric, float radius)
+{
+    TRACE_SCOPE("LandmarkExplanation::interpolate");
+
+    const int numPoints = _numPoints;
+    const int numLandmarks = static_cast<int>(_landmarks.size());
+    const int numDimensions = dataset.numDimensions();
+    const int k = _numInterpolated;
+
+    const bool lowRankBest = metric == Explanation::Metric::VARIANCE;
+
+    const std::vector<int> includedDims = dataset.getIncludedDimensions();
+
+    const auto findTopDimension = [&](const float* ranks, int stride) -> int {
+        int topDim = includedDims[0];
+        for (const int j : includedDims)
+            if (lowRankBest ? ranks[j * stride] < ranks[topDim * stride] : ranks[j * stride] > ranks[topDim * stride])
+                topDim = j;
+        return topDim;
+    };
+
+    // The rank matrix is column-major, the ranks of a landmark are numLandmarks apart
+    _landmarkTopDimensions.resize(numLandmarks);
+    for (int l = 0; l < numLandmarks; l++)
+        _landmarkTopDimensions[l] = findTopDimension(&_landmarkRanks(l, 0), numLandmarks);
+
+    _topDimensions.resize(numPoints);
+    _quality.resize(numPoints);
+
+#pragma omp parallel
+    {
+        std::vector<float> blendedRanks(numDimensions);
+
+#pragma omp for
+        for (int i = 0; i < numPoints; i++)
+        {
+            const int* nearest = &_nearestLandmarks[static_cast<std::size_t>(i) * k];
+            const float* distances = &_nearestDistances[static_cast<std::size_t>(i) * k];
+
+            // Points at a landmark and nearest landmark interpolation take the landmark explanation as is
+            if (k == 1 || distances[0] == 0)
+            {
+                _topDimensions[i] = _landmarkTopDimensions[nearest[0]];
+                _quality[i] = computeOverlap(distances[0], radius);
+                continue;
+            }
+
+            std::fill(blendedRanks.begin(), blendedRanks.end(), 0.0f);
+
+            float weightSum = 0;
+            for (int n = 0; n < k; n++)
+            {
+                const float weight = computeWeight(distances[n]);
+
+                for (int j = 0; j < numDimensions; j++)
+                    blendedRanks[j] += weight * _landmarkRanks(nearest[n], j);
+
+                weightSum += weight;
+            }
+
+            const int topDim = findTopDimension(blendedRanks.data(), 1);
+
+            // Share of the neighbourhood covered by interpolating landmarks that agree with the point
+            float quality = 0;
+            for (int n = 0; n < k; n++)
+                if (_landmarkTopDimensions[nearest[n]] == topDim)
+                    quality += computeWeight(distances[n]) * computeOverlap(distances[n], radius);
+
+            _topDimensions[i] = topDim;
+            _quality[i] = quality / weightSum;
+        }
+    }
+}
+
+void LandmarkExplanation::computeConfidences(const DataMatrix& projection, float radius, int xDim, int yDim)
+{
+    TRACE_SCOPE("LandmarkExplanation::computeConfidences");
+
+    const int numPoints = _numPoints;
+    const int numLandmarks = static_cast<int>(_landmarks.size());
+    const int k = _numInterpolated;
+
+    // The confidence neighbourhoods are a quarter of the explanation neighbourhoods, as in the confidence model
+    const float confidenceRadius = radius * 0.25f;
+    const float confidenceRadSquared = confidenceRadius * confidenceRadius;
+
+    std::vector<float> landmarkConfidences(numLandmarks);
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int l = 0; l < numLandmarks; l++)
+    {
+        int count = 0;
+        int total = 0;
+
+        for (const int n : _landmarkNeighbourhoods[l])
+        {
+            if (squaredDistance(projection, _landmarks[l], n, xDim, yDim) > confidenceRadSquared)
+                continue;
+
+            total++;
+
+            if (_topDimensions[n] == _landmarkTopDimensions[l])
+                count++;
+        }
+
+        landmarkConfidences[l] = total > 0 ? static_cast<float>(count) / total : 0.0f;
+    }
+
+    // Only the confidences and ranks are needed from here on
+    _landmarkNeighbourhoods = NeighbourhoodMatrix();
+
+    _confidences.resize(numPoints);
+
+#pragma omp parallel for
+    for (int i = 0; i < numPoints; i++)
+    {
+        const int* nearest = &_nearestLandmarks[static_cast<std::size_t>(i) * k];
+        const float* distances = &_nearestDistances[static_cast<std::size_t>(i) * k];
+
+        if (k == 1 || distances[0] == 0)
+        {
+            _confidences[i] = landmarkConfidences[nearest[0]];
+            continue;
+        }
+
+        float confidence = 0;
+        float weightSum = 0;
+        for (int n = 0; n < k; n++)
+        {
+            const float weight = computeWeight(distances[n]);
+
+            confidence += weight * landmarkConfidences[nearest[n]];
+            weightSum += weight;
+        }
+
+        _confidences[i] = confidence / weightSum;
+    }
+
+    // Normalize the confidences to [0, 1] like the point confidences
+    const auto range = std::minmax_element(_confidences.begin(), _confidences.end());
+
+    const float minVal = *range.first;
+    const float maxVal = *range.second;
+
+    for (float& confidence : _confidences)
+        confidence = maxVal > minVal ? (confidence - minVal) / (maxVal - minVal) : 1.0f;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "DataTypes.h"
+#include "Methods/ExplanationMethod.h"
+#include "Neighbourhood.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** How the landmarks are chosen from the points of the projection */
+enum class LandmarkSelection
+{
+    RANDOM,             /** Uniform random sample of the points */
+    FARTHEST_POINT      /** Greedy farthest-point sampling, covers sparse regions as well as dense ones */
+};
+
+/** How the explanation of the landmarks is carried over to the other points */
+enum class LandmarkInterpolation
+{
+    NEAREST,            /** Ranks of the nearest landmark */
+    INVERSE_DISTANCE    /** Inverse squared distance weighted blend of the ranks of the nearest landmarks */
+};
+
+/** Parameters of the landmark explanation */
+struct LandmarkParameters
+{
+    int                     numLandmarks    = 0;                                            /** Number of landmarks, 0 disables the landmark explanation */
+    LandmarkSelection       selection       = LandmarkSelection::FARTHEST_POINT;            /** Selection of the landmarks */
+    LandmarkInterpolation   interpolation   = LandmarkInterpolation::INVERSE_DISTANCE;      /** Interpolation of the landmark ranks */
+    int                     numInterpolated = 4;                                            /** Number of nearest landmarks blended by the inverse distance interpolation */
+    std::uint32_t           seed            = 0;                                            /** Seed of the random selection and of the first farthest point */
+};
+
+/**
+ * Landmark explanation class
+ *
+ * Approximates the explanation of large projections: the local statistics and ranks are only
+ * computed exactly for M landmark points, every other point takes the ranks of its nearest
+ * landmark or an inverse distance weighted blend of the ranks of its nearest landmarks. The cost
+ * of the statistics drops from N·k·D to M·k·D, finding the landmark neighbourhoods and the nearest
+ * landmarks of the points are O(N·M) scans over the projection.
+ *
+ * The landmarks and the nearest landmarks of every point only depend on the projection, so they
+ * are kept while the radius, the metric or the excluded dimensions change; they have to be
+ * cleared when the data changes.
+ *
+ * Confidences follow the simplified confidence model at the landmarks (the share of the confidence
+ * neighbourhood with the same top dimension) and are interpolated like the ranks. The quality of
+ * the approximation of a point is the share of its neighbourhood that overlaps the neighbourhoods
+ * of interpolating landmarks with the same top dimension: 1 at the landmarks, falling off with the
+ * distance to the landmarks and where the landmarks disagree.
+ *
+ * Only the variance and value metrics are supported, like the multi-scale explanation.
+ */
+class LandmarkExplanation
+{
+public:
+    LandmarkExplanation();
+
+    /**
+     * Explain the landmarks and interpolate the explanation to all points
+     * @param dataset High-dimensional data, one row per point
+     * @param dataStats Global statistics of the data
+     * @param projection Projection matrix, one row per point
+     * @param radius Radius of the neighbourhoods in projection units
+     * @param metric Explanation metric, variance or value
+     * @param parameters Number, selection and interpolation of the landmarks
+     * @param sampling Sampling of the landmark neighbourhoods (the neighbour cap)
+     * @return Whether the explanation was computed, false for unsupported metrics or without landmarks
+     */
+    bool compute(const DataTable& dataset, const DataStatistics& dataStats, const DataMatrix& projection, float radius, Explanation::Metric metric, int xDim, int yDim, const LandmarkParameters& parameters, const NeighbourhoodSampling& sampling = NeighbourhoodSampling());
+
+    /** Drop the landmarks and their explanation (on data change) */
+    void clear();
+
+    bool isEmpty() const { return _topDimensions.empty(); }
+    int numLandmarks() const { return static_cast<int>(_landmarks.size()); }
+
+    /** Get the point indices of the landmarks */
+    const std::vector<int>& getLandmarks() const { return _landmarks; }
+
+    /** Get the exact dimension ranks of the landmarks, one row per landmark */
+    const DataMatrix& getLandmarkRanks() const { return _landmarkRanks; }
+
+    /** Get the (interpolated) top ranked dimension of every point */
+    const std::vector<int>& getTopDimensions() const { return _topDimensions; }
+
+    /** Get the (interpolated) normalized confidence of every point */
+    const std::vector<float>& getConfidences() const { return _confidences; }
+
+    /** Get the approximation quality of every point in [0, 1] */
+    const std::vector<float>& getQuality() const { return _quality; }
+
+    /** Get the number of points for which every dimension is top ranked, to assign the colors */
+    std::vector<int> computeTopCounts(const DataTable& dataset) const;
+
+    /** Get the number of bytes held by the landmarks and their explanation */
+    std::size_t getMemoryUsage() const;
+
+private:
+    /** Choose the landmarks and find the nearest landmarks of every point, unless they are still valid */
+    void updateLandmarks(const DataMatrix& projection, int xDim, int yDim, const LandmarkParameters& parameters);
+
+    void selectRandom(int numPoints, int numLandmarks, std::uint32_t seed);
+    void selectFarthestPoints(const DataMatrix& projection, int numLandmarks, std::uint32_t seed, int xDim, int yDim);
+    void findNearestLandmarks(const DataMatrix& projection, int xDim, int yDim);
+
+    /** Compute the exact ranks of every landmark from its neighbourhood */
+    void computeLandmarkRanks(const DataTable& dataset, const DataStatistics& dataStats, const DataMatrix& projection, float radius, Explanation::Metric metric, int xDim, int yDim, const NeighbourhoodSampling& sampling);
+
+    /** Interpolate the ranks to the points and derive their top dimensions and approximation quality */
+    void interpolate(const DataTable& dataset, Explanation::Metric metric, float radius);
+
+    /** Compute the confidences at the landmarks and interpolate them to the points */
+    void computeConfidences(const DataMatrix& projection, float radius, int xDim, int yDim);
+
+private:
+    // Landmarks, kept while the projection and the selection parameters do not change
+    std::vector<int>        _landmarks;                 /** Point indices of the landmarks */
+    int                     _numInterpolated;           /** Number of nearest landmarks per point */
+    std::vector<int>        _nearestLandmarks;          /** Nearest landmarks of every point, _numInterpolated per point in order of distance */
+    std::vector<float>      _nearestDistances;          /** Projection distances to the nearest landmarks */
+    LandmarkParameters      _parameters;                /** Parameters the landmarks were chosen with */
+    int                     _xDim;                      /** Projection axes the landmarks were chosen on */
+    int                     _yDim;
+    int                     _numPoints;                 /** Number of points the landmarks were chosen from */
+
+    DataMatrix              _landmarkRanks;             /** Exact ranks of the landmarks */
+    NeighbourhoodMatrix     _landmarkNeighbourhoods;    /** Neighbourhoods of the landmarks, released after the confidences */
+    std::vector<int>        _landmarkTopDimensions;     /** Top ranked dimension of every landmark */
+
+    std::vector<int>        _topDimensions;             /** Top ranked dimension of every point */
+    std::vector<float>      _confidences;               /** Normalized confidence of every point */
+    std::vector<float>      _quality;                   /** Approximation quality of every point */
+};
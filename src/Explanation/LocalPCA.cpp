@@ -0,0 +1,178 @@
+#include "LocalPCA.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+namespace
+{
+    /** Upper bound on the number of subspace iterations */
+    constexpr int MAX_ITERATIONS = 20;
+
+    /**
+     * Residual norm of the components, relative to the largest variance, below which the iteration has converged;
+     * the error of the variances is of the order of the squared residual, unlike their change between iterations
+     * which stalls long before convergence when the variances are close
+     */
+    constexpr float CONVERGENCE_TOLERANCE = 1e-3f;
+
+    /** Seed of the random start basis, fixed so the same selection gives the same components */
+    constexpr std::uint32_t START_SEED = 0;
+
+    /** Replace the columns of \p basis by an orthonormal basis of their span */
+    void orthonormalize(Eigen::MatrixXf& basis)
+    {
+        Eigen::HouseholderQR<Eigen::MatrixXf> qr(basis);
+
+        basis = qr.householderQ() * Eigen::MatrixXf::Identity(basis.rows(), basis.cols());
+    }
+}
+
+LocalPCA::LocalPCA(int numComponents, int oversampling) :
+    _numComponents(numComponents),
+    _oversampling(oversampling),
+    _numIterations(0)
+{
+
+}
+
+void LocalPCA::compute(const DataTable& dataset, const std::vector<unsigned int>& selection, const DataStatistics& dataStats, bool warmStart)
+{
+    TRACE_SCOPE("LocalPCA::compute");
+    TRACE_COUNTER("Selection size", selection.size());
+
+    const int numDimensions = dataset.numDimensions();
+    const int numSelected = static_cast<int>(selection.size());
+
+    // Constant dimensions do not contribute any variance
+    std::vector<int> includedDims;
+    for (int j = 0; j < numDimensions; j++)
+        if (!dataset.isExcluded(j) && dataStats.ranges[j] > 0) includedDims.push_back(j);
+
+    const int numIncluded = static_cast<int>(includedDims.size());
+    const int numBasis = std::min({ _numComponents + _oversampling, numIncluded, numSelected });
+    const int numComponents = std::min(_numComponents, numBasis);
+
+    _numIterations = 0;
+
+    if (numSelected < 2 || numComponents <= 0)
+    {
+        _components.resize(numDimensions, 0);
+        _eigenValues.clear();
+        return;
+    }
+
+    // Range-normalized selected rows centred on their mean, gathered once per dimension from the column-major dataset
+    Eigen::MatrixXf rows(numSelected, numIncluded);
+
+#pragma omp parallel for schedule(static)
+    for (int c = 0; c < numIncluded; c++)
+    {
+        const int j = includedDims[c];
+        const float scale = 1.0f / dataStats.ranges[j];
+
+        double sum = 0;
+        for (int r = 0; r < numSelected; r++)
+        {
+            rows(r, c) = dataset(selection[r], j) * scale;
+            sum += rows(r, c);
+        }
+
+        rows.col(c).array() -= static_cast<float>(sum / numSelected);
+    }
+
+    // Start from the previous components when they span the same number of dimensions, else from a random basis
+    Eigen::MatrixXf basis(numIncluded, numBasis);
+
+    if (warmStart && _basis.rows() == numDimensions && _basis.cols() == numBasis)
+    {
+        for (int c = 0; c < numIncluded; c++)
+            basis.row(c) = _basis.row(includedDims[c]);
+    }
+    else
+    {
+        std::mt19937 rng(START_SEED);
+        std::normal_distribution<float> normal;
+
+        for (int b = 0; b < numBasis; b++)
+            for (int c = 0; c < numIncluded; c++)
+                basis(c, b) = normal(rng);
+    }
+
+    orthonormalize(basis);
+
+    // Subspace iteration, the variances within the subspace (Rayleigh-Ritz) converge to the top eigenvalues
+    Eigen::MatrixXf projected;
+    Eigen::MatrixXf product;
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> solver;
+
+    for (int iteration = 0; ; iteration++)
+    {
+        projected.noalias() = rows * basis;
+        product.noalias() = rows.transpose() * projected / static_cast<float>(numSelected);
+
+        solver.compute(projected.transpose() * projected / static_cast<float>(numSelected));
+
+        _numIterations = iteration;
+
+        // Residuals of the top components from the covariance times the basis, which is the next basis anyway;
+        // the eigenvalues are in increasing order
+        const Eigen::MatrixXf topVectors = solver.eigenvectors().rightCols(numComponents);
+        const Eigen::VectorXf topValues = solver.eigenvalues().tail(numComponents);
+
+        const Eigen::MatrixXf residuals = product * topVectors - basis * topVectors * topValues.asDiagonal();
+        const float largestValue = std::max(topValues(numComponents - 1), 0.0f);
+
+        if (residuals.colwise().norm().maxCoeff() <= CONVERGENCE_TOLERANCE * largestValue || iteration == MAX_ITERATIONS)
+            break;
+
+        basis = product;
+
+        orthonormalize(basis);
+    }
+
+    // Rotate the basis onto the eigenvectors, in order of decreasing variance
+    const Eigen::MatrixXf ritzVectors = (basis * solver.eigenvectors()).rowwise().reverse();
+
+    _basis.setZero(numDimensions, numBasis);
+    for (int c = 0; c < numIncluded; c++)
+        _basis.row(includedDims[c]) = ritzVectors.row(c);
+
+    _components = _basis.leftCols(numComponents);
+
+    _eigenValues.resize(numComponents);
+    for (int k = 0; k < numComponents; k++)
+        _eigenValues[k] = std::max(solver.eigenvalues()(numBasis - 1 - k), 0.0f);
+}
+
+void LocalPCA::clear()
+{
+    _numIterations = 0;
+    _basis = Eigen::MatrixXf();
+    _components = Eigen::MatrixXf();
+    _eigenValues = std::vector<float>();
+}
+
+std::vector<float> LocalPCA::computeLoadingShares() const
+{
+    std::vector<float> shares(_components.rows(), 0);
+
+    double totalVariance = 0;
+    for (const float eigenValue : _eigenValues)
+        totalVariance += eigenValue;
+
+    if (totalVariance <= 0)
+        return shares;
+
+    for (int j = 0; j < _components.rows(); j++)
+    {
+        double share = 0;
+        for (int k = 0; k < numComponents(); k++)
+            share += _eigenValues[k] * _components(j, k) * _components(j, k);
+
+        shares[j] = static_cast<float>(share / totalVariance);
+    }
+
+    return shares;
+}
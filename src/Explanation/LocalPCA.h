@@ -0,0 +1,67 @@
+#pragma once
+
+#include "DataTypes.h"
+
+#include <vector>
+
+/**
+ * Local PCA class
+ *
+ * Principal components of a selection of points, to explain a lens or brushed selection by the
+ * dimensions that vary together within it. The selected rows are range-normalized and centred,
+ * excluded dimensions are left out.
+ *
+ * Only the top components are computed, with a randomized subspace iteration that works on the
+ * centred rows directly: every iteration multiplies a D×l basis by the rows and back (2·n·D·l),
+ * the D×D covariance is never formed and the only eigen decomposition is of an l×l matrix. The
+ * basis of the previous selection is used as the start of the next one, so a lens that moves a
+ * little converges in one or two iterations instead of starting from a random basis.
+ */
+class LocalPCA
+{
+public:
+    /**
+     * @param numComponents Number of principal components
+     * @param oversampling Number of extra basis vectors of the subspace iteration, improves the accuracy of the last components
+     */
+    LocalPCA(int numComponents = 3, int oversampling = 4);
+
+    /**
+     * Compute the top principal components of the selection
+     * @param dataset Dataset to compute the components on
+     * @param selection Row indices of the selected points
+     * @param dataStats Global statistics of the dataset, the dimensions are normalized by their range
+     * @param warmStart Whether to start from the basis of the previous selection
+     */
+    void compute(const DataTable& dataset, const std::vector<unsigned int>& selection, const DataStatistics& dataStats, bool warmStart = true);
+
+    /** Drop the components and the warm start basis (on data change) */
+    void clear();
+
+    void setNumComponents(int numComponents) { _numComponents = numComponents; }
+    int numComponents() const { return static_cast<int>(_eigenValues.size()); }
+
+    /** Get the principal components, one column of D loadings per component in order of decreasing variance */
+    const Eigen::MatrixXf& getComponents() const { return _components; }
+
+    /** Get the variance along every principal component */
+    const std::vector<float>& getEigenValues() const { return _eigenValues; }
+
+    /** Get the number of iterations of the last computation */
+    int getNumIterations() const { return _numIterations; }
+
+    /**
+     * Get the share of the variance captured by the components that every dimension contributes,
+     * the variance weighted squared loadings of the dimension, summing to 1 over the dimensions
+     */
+    std::vector<float> computeLoadingShares() const;
+
+private:
+    int                 _numComponents;     /** Number of principal components to compute */
+    int                 _oversampling;      /** Extra basis vectors of the subspace iteration */
+    int                 _numIterations;     /** Number of iterations of the last computation */
+
+    Eigen::MatrixXf     _basis;             /** Orthonormal D×l basis of the last computation, the warm start of the next */
+    Eigen::MatrixXf     _components;        /** Top principal components, D×k */
+    std::vector<float>  _eigenValues;       /** Variance along every principal component */
+};
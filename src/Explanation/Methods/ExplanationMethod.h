@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Explanation/DataTypes.h"
+#include "Explanation/SelectionStatistics.h"
 
+#include <memory>
 #include <vector>
 
 namespace Explanation
@@ -14,11 +16,50 @@ namespace Explanation
         VALUE
     };
 
+    /** Precomputed statistics of a method, shared between the cores of the views with the same neighbourhoods */
+    struct Statistics
+    {
+        virtual ~Statistics() = default;
+    };
+
     class Method
     {
     public:
-        virtual void  recompute(const DataTable& dataset, NeighbourhoodMatrix& neighbourhoodMatrix) = 0;
+        virtual ~Method() = default;
+
+        virtual void  recompute(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix) = 0;
+
+        /**
+         * Compute only the global statistics, which rank selections, and release the local ones; for when the
+         * points are ranked without the local statistics of all dimensions (see TopRanks)
+         */
+        virtual void recomputeGlobalStatistics(const DataTable& dataset) = 0;
+
+        /**
+         * Update the precomputed local statistics of \p points after their neighbourhoods changed
+         * @param points Indices of the points whose neighbourhood changed
+         * @param previousNeighbourhoods Neighbourhoods of \p points before the change, in the same order
+         * @return Whether the statistics were updated, false when they have not been computed by recompute
+         */
+        virtual bool update(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points, const NeighbourhoodMatrix& previousNeighbourhoods) = 0;
+
         virtual float computeDimensionRank(const DataTable& dataset, int i, int j) = 0;
-        virtual void computeDimensionRank(const DataTable& dataset, const std::vector<unsigned int>& selection, std::vector<float>& dimRanking) = 0;
+        virtual void computeDimensionRank(const DataTable& dataset, const SelectionStatistics& selectionStats, std::vector<float>& dimRanking) = 0;
+
+        /** Get the number of bytes held by the precomputed statistics */
+        virtual std::size_t getMemoryUsage() const = 0;
+
+        /** Release the precomputed statistics, they are rebuilt by the next call to recompute */
+        virtual void release() = 0;
+
+        /** Get the precomputed statistics to share them, null when released */
+        virtual std::shared_ptr<const Statistics> getStatistics() const = 0;
+
+        /**
+         * Share precomputed statistics, e.g. of another core with the same data and neighbourhoods; they are
+         * never modified in place while shared, update copies them first
+         * @return Whether the statistics were taken, false when they belong to another method
+         */
+        virtual bool setStatistics(std::shared_ptr<const Statistics> statistics) = 0;
     };
 }
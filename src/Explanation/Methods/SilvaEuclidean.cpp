@@ -1,7 +1,6 @@
 #include "SilvaEuclidean.h"
 
-#include <iostream>
-#include <chrono>
+#include "../Tracing.h"
 
 namespace
 {
@@ -33,8 +32,7 @@ namespace
 
     float distance(const DataTable& dataset, int a, int b)
     {
-        return (dataset.row(a) - dataset.row(b)).matrix().norm();
-        //return sqrt(sqrMag(dataset, a, b));
+        return std::sqrt(sqrMag(dataset, a, b));
     }
 
     float distContrib(const DataTable& dataset, int p, int r, int dim)
@@ -108,83 +106,147 @@ namespace
     }
 }
 
-void EuclideanMethod::recompute(const DataTable& dataset, std::vector<std::vector<int>>& neighbourhoodMatrix)
+void EuclideanMethod::recompute(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix)
 {
-    computeCentroid(dataset);
-    computeGlobalContribs(dataset);
-    computeLocalContribs(dataset, neighbourhoodMatrix);
+    TRACE_SCOPE("EuclideanMethod::recompute");
+
+    // New statistics, the previous ones may still be held by other cores
+    _statistics = std::make_shared<EuclideanStatistics>();
+    EuclideanStatistics& statistics = makeUnique(_statistics);
+
+    computeCentroid(statistics, dataset);
+    computeGlobalContribs(statistics, dataset);
+    computeLocalContribs(statistics, dataset, neighbourhoodMatrix);
+}
+
+void EuclideanMethod::recomputeGlobalStatistics(const DataTable& dataset)
+{
+    TRACE_SCOPE("EuclideanMethod::recomputeGlobalStatistics");
+
+    _statistics = std::make_shared<EuclideanStatistics>();
+    EuclideanStatistics& statistics = makeUnique(_statistics);
+
+    computeCentroid(statistics, dataset);
+    computeGlobalContribs(statistics, dataset);
+}
+
+// The distance contributions of a point do not downdate, its rows are recomputed instead of using the previous neighbourhoods
+bool EuclideanMethod::update(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points, const NeighbourhoodMatrix& /*previousNeighbourhoods*/)
+{
+    TRACE_SCOPE("EuclideanMethod::update");
+
+    int numDimensions = dataset.numDimensions();
+
+    if (!_statistics || _statistics->localDistContribs.rows() != dataset.numPoints())
+        return false;
+
+    // Copied first when the statistics are shared with other cores
+    EuclideanStatistics& statistics = makeUnique(_statistics);
+
+    // The rows of the changed points are recomputed from their neighbourhoods
+    for (const int i : points)
+    {
+        for (int j = 0; j < numDimensions; j++)
+        {
+            statistics.localDistContribs(i, j) = localDistContrib(dataset, i, j, neighbourhoodMatrix[i]);
+        }
+    }
+
+    return true;
 }
 
 float EuclideanMethod::computeDimensionRank(const DataTable& dataset, int i, int j)
 {
+    const EuclideanStatistics& statistics = *_statistics;
+
     float sum = 0;
     for (int k = 0; k < dataset.numDimensions(); k++)
     {
-        sum += _localDistContribs(i, k) / _globalDistContribs[k];
+        sum += statistics.localDistContribs(i, k) / statistics.globalDistContribs[k];
     }
-    return (_localDistContribs(i, j) / _globalDistContribs[j]) / sum;
+    return (statistics.localDistContribs(i, j) / statistics.globalDistContribs[j]) / sum;
+}
+
+void EuclideanMethod::computeDimensionRank(const DataTable& dataset, const SelectionStatistics& selectionStats, std::vector<float>& dimRanking)
+{
+
+}
+
+std::size_t EuclideanMethod::getMemoryUsage() const
+{
+    if (!_statistics)
+        return 0;
+
+    return (_statistics->centroid.capacity() + _statistics->globalDistContribs.capacity() + _statistics->localDistContribs.size()) * sizeof(float);
+}
+
+void EuclideanMethod::release()
+{
+    _statistics.reset();
 }
 
-void EuclideanMethod::computeDimensionRank(const DataTable& dataset, const std::vector<unsigned int>& selection, std::vector<float>& dimRanking)
+bool EuclideanMethod::setStatistics(std::shared_ptr<const Explanation::Statistics> statistics)
 {
+    auto euclideanStatistics = std::dynamic_pointer_cast<const EuclideanStatistics>(statistics);
+    if (!euclideanStatistics)
+        return false;
 
+    _statistics = std::move(euclideanStatistics);
+
+    return true;
 }
 
-void EuclideanMethod::computeCentroid(const DataTable& dataset)
+void EuclideanMethod::computeCentroid(EuclideanStatistics& statistics, const DataTable& dataset)
 {
     int numPoints = dataset.numPoints();
     int numDimensions = dataset.numDimensions();
 
-    _centroid.clear();
-    _centroid.resize(numDimensions, 0);
+    std::vector<float>& centroid = statistics.centroid;
+
+    centroid.clear();
+    centroid.resize(numDimensions, 0);
 
     for (int i = 0; i < numPoints; i++)
     {
         for (int j = 0; j < numDimensions; j++)
         {
-            _centroid[j] += dataset(i, j);
+            centroid[j] += dataset(i, j);
         }
     }
     for (int j = 0; j < numDimensions; j++)
     {
-        _centroid[j] /= numPoints;
+        centroid[j] /= numPoints;
     }
 }
 
-void EuclideanMethod::computeGlobalContribs(const DataTable& dataset)
+void EuclideanMethod::computeGlobalContribs(EuclideanStatistics& statistics, const DataTable& dataset)
 {
-    std::cout << "Precomputing global distance contributions.." << std::endl;
+    TRACE_SCOPE("EuclideanMethod::computeGlobalContribs");
+
     int numDimensions = dataset.numDimensions();
 
-    _globalDistContribs.clear();
-    _globalDistContribs.resize(numDimensions);
+    statistics.globalDistContribs.clear();
+    statistics.globalDistContribs.resize(numDimensions);
     for (int dim = 0; dim < numDimensions; dim++)
     {
-        std::cout << "Dim: " << dim << std::endl;
-        _globalDistContribs[dim] = globalDistContrib(dataset, _centroid, dim);
+        statistics.globalDistContribs[dim] = globalDistContrib(dataset, statistics.centroid, dim);
     }
 }
 
-void EuclideanMethod::computeLocalContribs(const DataTable& dataset, std::vector<std::vector<int>>& neighbourhoodMatrix)
+void EuclideanMethod::computeLocalContribs(EuclideanStatistics& statistics, const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix)
 {
-    std::cout << "Precomputing local distance contributions.." << std::endl;
+    TRACE_SCOPE("EuclideanMethod::computeLocalContribs");
 
     int numPoints = dataset.numPoints();
     int numDimensions = dataset.numDimensions();
 
-    _localDistContribs.resize(numPoints, numDimensions);
+    statistics.localDistContribs.resize(numPoints, numDimensions);
 
     for (int i = 0; i < numPoints; i++)
     {
-        auto start = std::chrono::system_clock::now();
         for (int j = 0; j < numDimensions; j++)
         {
-            _localDistContribs(i, j) = localDistContrib(dataset, i, j, neighbourhoodMatrix[i]);
+            statistics.localDistContribs(i, j) = localDistContrib(dataset, i, j, neighbourhoodMatrix[i]);
         }
-        if (i % 10 == 0) std::cout << "Local dist contribs: " << i << std::endl;
-        auto end = std::chrono::system_clock::now();
-
-        std::chrono::duration<double> elapsed = end - start;
-        std::cout << "Elapsed time: " << elapsed.count() << "s";
     }
 }
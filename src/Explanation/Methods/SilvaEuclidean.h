@@ -23,19 +23,34 @@ namespace
     float dimensionRank(const DataTable& dataset, int p, int dim, const Neighbourhood& neighbourhood, const std::vector<float>& globalDistContribs);
 }
 
+/** Precomputed statistics of the euclidean method */
+struct EuclideanStatistics : public Explanation::Statistics
+{
+    std::vector<float> centroid;
+    std::vector<float> globalDistContribs;
+    DataMatrix localDistContribs;
+};
+
 class EuclideanMethod : public Explanation::Method
 {
 public:
-    void recompute(const DataTable& dataset, NeighbourhoodMatrix& neighbourhoodMatrix) override;
+    void recompute(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix) override;
+    void recomputeGlobalStatistics(const DataTable& dataset) override;
+    bool update(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points, const NeighbourhoodMatrix& previousNeighbourhoods) override;
     float computeDimensionRank(const DataTable& dataset, int i, int j) override;
-    void computeDimensionRank(const DataTable& dataset, const std::vector<unsigned int>& selection, std::vector<float>& dimRanking) override;
+    void computeDimensionRank(const DataTable& dataset, const SelectionStatistics& selectionStats, std::vector<float>& dimRanking) override;
+
+    std::size_t getMemoryUsage() const override;
+    void release() override;
+
+    std::shared_ptr<const Explanation::Statistics> getStatistics() const override { return _statistics; }
+    bool setStatistics(std::shared_ptr<const Explanation::Statistics> statistics) override;
 
 private:
-    void computeCentroid(const DataTable& dataset);
-    void computeGlobalContribs(const DataTable& dataset);
-    void computeLocalContribs(const DataTable& dataset, NeighbourhoodMatrix& neighbourhoodMatrix);
+    void computeCentroid(EuclideanStatistics& statistics, const DataTable& dataset);
+    void computeGlobalContribs(EuclideanStatistics& statistics, const DataTable& dataset);
+    void computeLocalContribs(EuclideanStatistics& statistics, const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix);
 
-    std::vector<float> _centroid;
-    std::vector<float> _globalDistContribs;
-    DataMatrix _localDistContribs;
+    /** Statistics of the last recompute, possibly shared with other cores */
+    std::shared_ptr<const EuclideanStatistics> _statistics;
 };
@@ -1,78 +1,237 @@
 #include "SilvaVariance.h"
 
-#include <iostream>
-#include <chrono>
+#include "../Neighbourhood.h"
+#include "../Parallel.h"
+#include "../Tracing.h"
 
-void VarianceMethod::recompute(const DataTable& dataset, std::vector<std::vector<int>>& neighbourhoodMatrix)
-{
-    precomputeGlobalVariances(dataset);
-    precomputeLocalVariances(_localVariances, dataset, neighbourhoodMatrix);
-}
+#include <algorithm>
+#include <numeric>
+#include <vector>
 
-float VarianceMethod::computeDimensionRank(const DataTable& dataset, int i, int j)
+namespace
 {
-    float sum = 0;
-    for (int k = 0; k < dataset.numDimensions(); k++)
+    /** Downdated variances that dropped below this fraction of their previous value are recomputed */
+    constexpr double CANCELLATION_THRESHOLD = 1e-3;
+
+    /**
+     * Means and variances of sparse data over \p rows, from their stored values only: a dimension with
+     * count stored values holds rows.size() - count implicit zeros, which each deviate by the mean
+     */
+    void computeSparseVariances(const DataTable& dataset, const std::vector<int>& rows, std::vector<double>& means, std::vector<double>& variances)
     {
-        sum += _localVariances(i, k) / _globalVariances[k];
+        const int numDimensions = dataset.numDimensions();
+        const double numRows = static_cast<double>(rows.size());
+
+        std::vector<int> counts(numDimensions, 0);
+        means.assign(numDimensions, 0);
+        variances.assign(numDimensions, 0);
+
+        for (const int i : rows)
+        {
+            dataset.forEachNonZero(i, [&](int j, float value) {
+                means[j] += value;
+                counts[j]++;
+            });
+        }
+
+        for (int j = 0; j < numDimensions; j++)
+            means[j] /= numRows;
+
+        for (const int i : rows)
+        {
+            dataset.forEachNonZero(i, [&](int j, float value) {
+                const double x = value - means[j];
+                variances[j] += x * x;
+            });
+        }
+
+        for (int j = 0; j < numDimensions; j++)
+            variances[j] = (variances[j] + (numRows - counts[j]) * means[j] * means[j]) / numRows;
     }
-    return (_localVariances(i, j) / _globalVariances[j]) / sum;
 }
 
-void VarianceMethod::computeDimensionRank(const DataTable& dataset, const std::vector<unsigned int>& selection, std::vector<float>& dimRanking)
+void VarianceMethod::recompute(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix)
+{
+    TRACE_SCOPE("VarianceMethod::recompute");
+
+    // New statistics, the previous ones may still be held by other cores
+    _statistics = std::make_shared<VarianceStatistics>();
+    VarianceStatistics& statistics = makeUnique(_statistics);
+
+    precomputeGlobalVariances(statistics, dataset);
+    precomputeLocalVariances(statistics, dataset, neighbourhoodMatrix);
+}
+
+void VarianceMethod::recomputeGlobalStatistics(const DataTable& dataset)
 {
+    TRACE_SCOPE("VarianceMethod::recomputeGlobalStatistics");
+
+    _statistics = std::make_shared<VarianceStatistics>();
+    VarianceStatistics& statistics = makeUnique(_statistics);
+
+    precomputeGlobalVariances(statistics, dataset);
+}
+
+bool VarianceMethod::update(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points, const NeighbourhoodMatrix& previousNeighbourhoods)
+{
+    TRACE_SCOPE("VarianceMethod::update");
+
+    int numPoints = dataset.numPoints();
     int numDimensions = dataset.numDimensions();
 
-    // Compute mean over selection
-    std::vector<float> localMeans(numDimensions, 0);
-    for (int j = 0; j < numDimensions; j++)
+    if (!_statistics || _statistics->localVariances.rows() != numPoints || _statistics->localMeans.rows() != numPoints)
+        return false;
+
+    // Copied first when the statistics are shared with other cores
+    VarianceStatistics& statistics = makeUnique(_statistics);
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int p = 0; p < static_cast<int>(points.size()); p++)
     {
-        for (int i = 0; i < selection.size(); i++)
+        const int i = points[p];
+
+        std::vector<int> removed, added;
+        diffNeighbourhoods(previousNeighbourhoods[p], neighbourhoodMatrix[i], removed, added);
+
+        if (removed.empty() && added.empty())
+            continue;
+
+        // Recomputing is exact, and not more work when most of the neighbourhood changed
+        if (removed.size() + added.size() >= neighbourhoodMatrix[i].size())
+        {
+            computeLocalVariance(statistics, dataset, i, neighbourhoodMatrix[i]);
+            continue;
+        }
+
+        bool cancelled = false;
+
+        for (int j = 0; j < numDimensions; j++)
         {
-            int si = selection[i];
+            // Welford downdate of the neighbours that left and update of the neighbours that joined,
+            // both neighbourhoods hold the center so the count never drops to zero
+            double n = static_cast<double>(previousNeighbourhoods[p].size());
+            double mean = statistics.localMeans(i, j);
+            double m2 = statistics.localVariances(i, j) * n;
+
+            const double previousM2 = m2;
+
+            for (const int ni : removed)
+            {
+                const double x = dataset(ni, j);
+                const double delta = x - mean;
 
-            localMeans[j] += dataset(si, j);
+                n--;
+                mean -= delta / n;
+                m2 -= delta * (x - mean);
+            }
+
+            for (const int ni : added)
+            {
+                const double x = dataset(ni, j);
+                const double delta = x - mean;
+
+                n++;
+                mean += delta / n;
+                m2 += delta * (x - mean);
+            }
+
+            statistics.localMeans(i, j) = static_cast<float>(mean);
+            statistics.localVariances(i, j) = static_cast<float>(std::max(0.0, m2 / n));
+
+            // When the neighbours that left carried nearly all of the spread, what remains is rounding
+            if (m2 < CANCELLATION_THRESHOLD * previousM2)
+                cancelled = true;
         }
 
-        localMeans[j] /= selection.size();
+        if (cancelled)
+            computeLocalVariance(statistics, dataset, i, neighbourhoodMatrix[i]);
     }
 
-    // Compute variances
-    std::vector<float> localVariances(numDimensions, 0);
-    localVariances.resize(numDimensions, 0);
-    for (int j = 0; j < numDimensions; j++)
+    return true;
+}
+
+float VarianceMethod::computeDimensionRank(const DataTable& dataset, int i, int j)
+{
+    const VarianceStatistics& statistics = *_statistics;
+
+    float sum = 0;
+    for (int k = 0; k < dataset.numDimensions(); k++)
     {
-        for (int i = 0; i < selection.size(); i++)
-        {
-            int si = selection[i];
-            float x = dataset(si, j) - localMeans[j];
-            localVariances[j] += x * x;
-        }
-        localVariances[j] /= selection.size();
-        //variances[j] = sqrt(variances[j]);
+        sum += statistics.localVariances(i, k) / statistics.globalVariances[k];
     }
+    return (statistics.localVariances(i, j) / statistics.globalVariances[j]) / sum;
+}
+
+void VarianceMethod::computeDimensionRank(const DataTable& dataset, const SelectionStatistics& selectionStats, std::vector<float>& dimRanking)
+{
+    int numDimensions = dataset.numDimensions();
+
+    // Variances over the selection
+    const std::vector<float>& localVariances = selectionStats.getVariances();
+    const std::vector<float>& globalVariances = _statistics->globalVariances;
 
     // Compute ranking
     float sum = 0;
     for (int k = 0; k < numDimensions; k++)
     {
-        sum += localVariances[k] / _globalVariances[k];
+        sum += localVariances[k] / globalVariances[k];
     }
     for (int j = 0; j < numDimensions; j++)
     {
-        dimRanking[j] = (localVariances[j] / _globalVariances[j]) / sum;
+        dimRanking[j] = (localVariances[j] / globalVariances[j]) / sum;
     }
 }
 
-void VarianceMethod::precomputeGlobalVariances(const DataTable& dataset)
+std::size_t VarianceMethod::getMemoryUsage() const
+{
+    if (!_statistics)
+        return 0;
+
+    return (_statistics->globalVariances.capacity() + _statistics->localVariances.size() + _statistics->localMeans.size()) * sizeof(float);
+}
+
+void VarianceMethod::release()
+{
+    _statistics.reset();
+}
+
+bool VarianceMethod::setStatistics(std::shared_ptr<const Explanation::Statistics> statistics)
 {
-    auto start = std::chrono::high_resolution_clock::now();
+    auto varianceStatistics = std::dynamic_pointer_cast<const VarianceStatistics>(statistics);
+    if (!varianceStatistics)
+        return false;
+
+    _statistics = std::move(varianceStatistics);
+
+    return true;
+}
+
+void VarianceMethod::precomputeGlobalVariances(VarianceStatistics& statistics, const DataTable& dataset)
+{
+    TRACE_SCOPE("VarianceMethod::precomputeGlobalVariances");
 
     int numPoints = dataset.numPoints();
     int numDimensions = dataset.numDimensions();
 
-    _globalVariances.clear();
-    _globalVariances.resize(numDimensions);
+    std::vector<float>& globalVariances = statistics.globalVariances;
+
+    globalVariances.clear();
+    globalVariances.resize(numDimensions);
+
+    if (dataset.isSparse())
+    {
+        std::vector<int> points(numPoints);
+        std::iota(points.begin(), points.end(), 0);
+
+        std::vector<double> means, variances;
+        computeSparseVariances(dataset, points, means, variances);
+
+        for (int j = 0; j < numDimensions; j++)
+            globalVariances[j] = variances[j] == 0 ? 1 : static_cast<float>(variances[j]);
+
+        return;
+    }
+
     for (int j = 0; j < numDimensions; j++)
     {
         // Compute mean
@@ -92,59 +251,71 @@ void VarianceMethod::precomputeGlobalVariances(const DataTable& dataset)
         }
         variance /= numPoints;
 
-        _globalVariances[j] = variance;
+        globalVariances[j] = variance;
 
-        if (variance == 0) _globalVariances[j] = 1;
+        if (variance == 0) globalVariances[j] = 1;
     }
-
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-    std::cout << "Global Elapsed time : " << elapsed.count() << " s\n";
 }
 
-void VarianceMethod::precomputeLocalVariances(DataMatrix& localVariance, const DataTable& dataset, std::vector<std::vector<int>>& neighbourhoodMatrix)
+void VarianceMethod::precomputeLocalVariances(VarianceStatistics& statistics, const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix)
 {
+    TRACE_SCOPE("VarianceMethod::precomputeLocalVariances");
+
     int numPoints = dataset.numPoints();
     int numDimensions = dataset.numDimensions();
-    auto start = std::chrono::high_resolution_clock::now();
 
-    localVariance.resize(numPoints, numDimensions);
+    statistics.localVariances.resize(numPoints, numDimensions);
+    statistics.localMeans.resize(numPoints, numDimensions);
+
+    parallel::forEachPoint(neighbourhoodMatrix, [&](int i) {
+        computeLocalVariance(statistics, dataset, i, neighbourhoodMatrix[i]);
+    });
+}
+
+void VarianceMethod::computeLocalVariance(VarianceStatistics& statistics, const DataTable& dataset, int i, const Neighbourhood& neighbourhood)
+{
+    int numDimensions = dataset.numDimensions();
 
-#pragma omp parallel for
-    for (int i = 0; i < numPoints; i++)
+    if (dataset.isSparse())
     {
-        const std::vector<int>& neighbourhood = neighbourhoodMatrix[i];
+        // Only the stored values of the neighbours are visited, the buffers are reused by the thread
+        thread_local std::vector<double> means, variances;
+        computeSparseVariances(dataset, neighbourhood, means, variances);
 
-        //auto subdata = dataset(neighbourhood, Eigen::all);
-        //auto variances = ((subdata.rowwise() - subdata.colwise().mean()).pow(2).colwise().sum()) / neighbourhood.size();
-        //localVariance.row(i) = variances;
-        
         for (int j = 0; j < numDimensions; j++)
         {
-            // Compute mean
-            float mean = 0;
-            for (const int ni : neighbourhood)
-            {
-                mean += dataset(ni, j);
-            }
-            mean /= neighbourhood.size();
+            statistics.localVariances(i, j) = static_cast<float>(variances[j]);
+            statistics.localMeans(i, j) = static_cast<float>(means[j]);
+        }
+        return;
+    }
 
-            // Compute variance
-            float variance = 0;
-            for (const int ni : neighbourhood)
-            {
-                float x = dataset(ni, j) - mean;
-                variance += x * x;
-            }
-            variance /= neighbourhood.size();
+    //auto subdata = dataset(neighbourhood, Eigen::all);
+    //auto variances = ((subdata.rowwise() - subdata.colwise().mean()).pow(2).colwise().sum()) / neighbourhood.size();
+    //_localVariances.row(i) = variances;
 
-            localVariance(i, j) = variance;
+    const DataMatrix& data = *dataset.getDenseData();
+
+    for (int j = 0; j < numDimensions; j++)
+    {
+        // Compute mean
+        float mean = 0;
+        for (const int ni : neighbourhood)
+        {
+            mean += data(ni, j);
         }
-        if (i % 10000 == 0)
-            std::cout << "Local var: " << i << std::endl;
-    }
+        mean /= neighbourhood.size();
 
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-    std::cout << "Local Variance Elapsed time: " << elapsed.count() << " s\n";
+        // Compute variance
+        float variance = 0;
+        for (const int ni : neighbourhood)
+        {
+            float x = data(ni, j) - mean;
+            variance += x * x;
+        }
+        variance /= neighbourhood.size();
+
+        statistics.localVariances(i, j) = variance;
+        statistics.localMeans(i, j) = mean;
+    }
 }
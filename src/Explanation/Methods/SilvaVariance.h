@@ -2,18 +2,37 @@
 
 #include "ExplanationMethod.h"
 
+/** Precomputed statistics of the variance method */
+struct VarianceStatistics : public Explanation::Statistics
+{
+    std::vector<float> globalVariances;
+
+    Eigen::ArrayXXf localVariances;
+
+    /** Local means, kept to downdate and update the local variances */
+    Eigen::ArrayXXf localMeans;
+};
+
 class VarianceMethod : public Explanation::Method
 {
 public:
-    void recompute(const DataTable& dataset, NeighbourhoodMatrix& neighbourhoodMatrix) override;
+    void recompute(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix) override;
+    void recomputeGlobalStatistics(const DataTable& dataset) override;
+    bool update(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points, const NeighbourhoodMatrix& previousNeighbourhoods) override;
     float computeDimensionRank(const DataTable& dataset, int i, int j) override;
-    void computeDimensionRank(const DataTable& dataset, const std::vector<unsigned int>& selection, std::vector<float>& dimRanking) override;
+    void computeDimensionRank(const DataTable& dataset, const SelectionStatistics& selectionStats, std::vector<float>& dimRanking) override;
 
-private:
-    void precomputeGlobalVariances(const DataTable& dataset);
-    void precomputeLocalVariances(DataMatrix& localVariances, const DataTable& dataset, NeighbourhoodMatrix& neighbourhoodMatrix);
+    std::size_t getMemoryUsage() const override;
+    void release() override;
 
-    std::vector<float> _globalVariances;
+    std::shared_ptr<const Explanation::Statistics> getStatistics() const override { return _statistics; }
+    bool setStatistics(std::shared_ptr<const Explanation::Statistics> statistics) override;
+
+private:
+    void precomputeGlobalVariances(VarianceStatistics& statistics, const DataTable& dataset);
+    void precomputeLocalVariances(VarianceStatistics& statistics, const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix);
+    void computeLocalVariance(VarianceStatistics& statistics, const DataTable& dataset, int i, const Neighbourhood& neighbourhood);
 
-    Eigen::ArrayXXf _localVariances;
+    /** Statistics of the last recompute, possibly shared with other cores */
+    std::shared_ptr<const VarianceStatistics> _statistics;
 };
@@ -1,87 +1,232 @@
 #include "ValueRanking.h"
 
-#include <iostream>
-#include <chrono>
+#include "../Neighbourhood.h"
+#include "../Parallel.h"
+#include "../Tracing.h"
 
-void ValueMethod::recompute(const DataTable& dataset, std::vector<std::vector<int>>& neighbourhoodMatrix)
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+void ValueMethod::recompute(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix)
+{
+    TRACE_SCOPE("ValueMethod::recompute");
+
+    // New statistics, the previous ones may still be held by other cores
+    _statistics = std::make_shared<ValueStatistics>();
+    ValueStatistics& statistics = makeUnique(_statistics);
+
+    precomputeDataRanges(statistics, dataset);
+    precomputeGlobalValues(statistics, dataset);
+    precomputeLocalValues(statistics, dataset, neighbourhoodMatrix);
+}
+
+void ValueMethod::recomputeGlobalStatistics(const DataTable& dataset)
 {
+    TRACE_SCOPE("ValueMethod::recomputeGlobalStatistics");
+
+    _statistics = std::make_shared<ValueStatistics>();
+    ValueStatistics& statistics = makeUnique(_statistics);
+
+    precomputeDataRanges(statistics, dataset);
+    precomputeGlobalValues(statistics, dataset);
+}
+
+bool ValueMethod::update(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points, const NeighbourhoodMatrix& previousNeighbourhoods)
+{
+    TRACE_SCOPE("ValueMethod::update");
+
     int numPoints = dataset.numPoints();
     int numDimensions = dataset.numDimensions();
 
-    _dataRanges.clear();
-    _dataRanges.resize(numDimensions);
-    std::vector<float> minRanges(numDimensions, std::numeric_limits<float>::max());
-    std::vector<float> maxRanges(numDimensions, -std::numeric_limits<float>::max());
+    if (!_statistics || _statistics->localValues.rows() != numPoints)
+        return false;
 
-    for (int j = 0; j < numDimensions; j++)
+    // Copied first when the statistics are shared with other cores
+    ValueStatistics& statistics = makeUnique(_statistics);
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int p = 0; p < static_cast<int>(points.size()); p++)
     {
-        // Compute mean
-        float mean = 0;
-        for (int i = 0; i < numPoints; i++)
-        {
-            float value = dataset(i, j);
+        const int i = points[p];
+
+        std::vector<int> removed, added;
+        diffNeighbourhoods(previousNeighbourhoods[p], neighbourhoodMatrix[i], removed, added);
 
-            if (value < minRanges[j]) minRanges[j] = value;
-            if (value > maxRanges[j]) maxRanges[j] = value;
-            mean += value;
+        if (removed.empty() && added.empty())
+            continue;
+
+        // Recomputing is exact, and not more work when most of the neighbourhood changed
+        if (removed.size() + added.size() >= neighbourhoodMatrix[i].size())
+        {
+            computeLocalValue(statistics, dataset, i, neighbourhoodMatrix[i]);
+            continue;
         }
-        mean /= numPoints;
-        _dataRanges[j] = maxRanges[j] - minRanges[j];
 
-        if (_dataRanges[j] == 0) _dataRanges[j] = 1;
+        const double previousSize = static_cast<double>(previousNeighbourhoods[p].size());
+        const double currentSize = static_cast<double>(neighbourhoodMatrix[i].size());
+
+        for (int j = 0; j < numDimensions; j++)
+        {
+            // Subtract the neighbours that left from the sum and add the neighbours that joined
+            double sum = statistics.localValues(i, j) * previousSize;
+
+            for (const int ni : removed)
+                sum -= dataset(ni, j);
+
+            for (const int ni : added)
+                sum += dataset(ni, j);
+
+            statistics.localValues(i, j) = static_cast<float>(sum / currentSize);
+        }
     }
 
-    precomputeGlobalValues(dataset);
-    precomputeLocalValues(dataset, neighbourhoodMatrix);
+    return true;
 }
 
 float ValueMethod::computeDimensionRank(const DataTable& dataset, int i, int j)
 {
+    const ValueStatistics& statistics = *_statistics;
+
     float sum = 0;
     for (int k = 0; k < dataset.numDimensions(); k++)
     {
-        sum += abs((_localValues(i, k) - _globalValues[k]) / _dataRanges[k]); //_localValues(i, k) / _globalValues[k];
+        sum += abs((statistics.localValues(i, k) - statistics.globalValues[k]) / statistics.dataRanges[k]); //_localValues(i, k) / _globalValues[k];
     }
-    return ((_localValues(i, j) - _globalValues[j]) / _dataRanges[j]) / sum;
+    return ((statistics.localValues(i, j) - statistics.globalValues[j]) / statistics.dataRanges[j]) / sum;
 }
 
-void ValueMethod::computeDimensionRank(const DataTable& dataset, const std::vector<unsigned int>& selection, std::vector<float>& dimRanking)
+void ValueMethod::computeDimensionRank(const DataTable& dataset, const SelectionStatistics& selectionStats, std::vector<float>& dimRanking)
 {
     int numDimensions = dataset.numDimensions();
 
-    // Compute mean over selection
-    std::vector<float> localMeans(numDimensions, 0);
-    for (int j = 0; j < numDimensions; j++)
-    {
-        for (int i = 0; i < selection.size(); i++)
-        {
-            int si = selection[i];
-
-            localMeans[j] += dataset(si, j);
-        }
-
-        localMeans[j] /= selection.size();
-    }
+    // Means over the selection
+    const std::vector<float>& localMeans = selectionStats.getMeans();
+    const std::vector<float>& globalValues = _statistics->globalValues;
+    const std::vector<float>& dataRanges = _statistics->dataRanges;
 
     // Compute ranking
     float sum = 0;
     for (int k = 0; k < numDimensions; k++)
     {
-        sum += abs((localMeans[k] - _globalValues[k]) / _dataRanges[k]);
+        sum += abs((localMeans[k] - globalValues[k]) / dataRanges[k]);
     }
     for (int j = 0; j < numDimensions; j++)
     {
-        dimRanking[j] = ((localMeans[j] - _globalValues[j]) / _dataRanges[j]) / sum;
+        dimRanking[j] = ((localMeans[j] - globalValues[j]) / dataRanges[j]) / sum;
+    }
+}
+
+std::size_t ValueMethod::getMemoryUsage() const
+{
+    if (!_statistics)
+        return 0;
+
+    return (_statistics->globalValues.capacity() + _statistics->localValues.size() + _statistics->dataRanges.capacity()) * sizeof(float);
+}
+
+void ValueMethod::release()
+{
+    _statistics.reset();
+}
+
+bool ValueMethod::setStatistics(std::shared_ptr<const Explanation::Statistics> statistics)
+{
+    auto valueStatistics = std::dynamic_pointer_cast<const ValueStatistics>(statistics);
+    if (!valueStatistics)
+        return false;
+
+    _statistics = std::move(valueStatistics);
+
+    return true;
+}
+
+void ValueMethod::precomputeDataRanges(ValueStatistics& statistics, const DataTable& dataset)
+{
+    int numPoints = dataset.numPoints();
+    int numDimensions = dataset.numDimensions();
+
+    std::vector<float>& dataRanges = statistics.dataRanges;
+
+    dataRanges.clear();
+    dataRanges.resize(numDimensions);
+    std::vector<float> minRanges(numDimensions, std::numeric_limits<float>::max());
+    std::vector<float> maxRanges(numDimensions, -std::numeric_limits<float>::max());
+
+    // Ranges of sparse data from the stored values, dimensions with implicit zeros include zero
+    if (dataset.isSparse())
+    {
+        std::vector<int> counts(numDimensions, 0);
+
+        for (int i = 0; i < numPoints; i++)
+        {
+            dataset.forEachNonZero(i, [&](int j, float value) {
+                if (value < minRanges[j]) minRanges[j] = value;
+                if (value > maxRanges[j]) maxRanges[j] = value;
+                counts[j]++;
+            });
+        }
+
+        for (int j = 0; j < numDimensions; j++)
+        {
+            if (counts[j] < numPoints)
+            {
+                minRanges[j] = std::min(minRanges[j], 0.0f);
+                maxRanges[j] = std::max(maxRanges[j], 0.0f);
+            }
+
+            dataRanges[j] = maxRanges[j] - minRanges[j];
+
+            if (dataRanges[j] == 0) dataRanges[j] = 1;
+        }
+    }
+    else
+    {
+        for (int j = 0; j < numDimensions; j++)
+        {
+            // Compute mean
+            float mean = 0;
+            for (int i = 0; i < numPoints; i++)
+            {
+                float value = dataset(i, j);
+
+                if (value < minRanges[j]) minRanges[j] = value;
+                if (value > maxRanges[j]) maxRanges[j] = value;
+                mean += value;
+            }
+            mean /= numPoints;
+            dataRanges[j] = maxRanges[j] - minRanges[j];
+
+            if (dataRanges[j] == 0) dataRanges[j] = 1;
+        }
     }
 }
 
-void ValueMethod::precomputeGlobalValues(const DataTable& dataset)
+void ValueMethod::precomputeGlobalValues(ValueStatistics& statistics, const DataTable& dataset)
 {
     int numPoints = dataset.numPoints();
     int numDimensions = dataset.numDimensions();
 
-    _globalValues.clear();
-    _globalValues.resize(numDimensions);
+    std::vector<float>& globalValues = statistics.globalValues;
+
+    globalValues.clear();
+    globalValues.resize(numDimensions);
+
+    // The implicit zeros of sparse data add nothing to the sums
+    if (dataset.isSparse())
+    {
+        std::vector<double> sums(numDimensions, 0);
+
+        for (int i = 0; i < numPoints; i++)
+            dataset.forEachNonZero(i, [&sums](int j, float value) { sums[j] += value; });
+
+        for (int j = 0; j < numDimensions; j++)
+            globalValues[j] = static_cast<float>(sums[j] / numPoints);
+
+        return;
+    }
+
     for (int j = 0; j < numDimensions; j++)
     {
         // Compute mean
@@ -92,40 +237,55 @@ void ValueMethod::precomputeGlobalValues(const DataTable& dataset)
         }
         mean /= numPoints;
 
-        _globalValues[j] = mean;
+        globalValues[j] = mean;
     }
 }
 
-void ValueMethod::precomputeLocalValues(const DataTable& dataset, std::vector<std::vector<int>>& neighbourhoodMatrix)
+void ValueMethod::precomputeLocalValues(ValueStatistics& statistics, const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix)
 {
-    auto start = std::chrono::high_resolution_clock::now();
+    TRACE_SCOPE("ValueMethod::precomputeLocalValues");
 
     int numPoints = dataset.numPoints();
     int numDimensions = dataset.numDimensions();
 
-    _localValues.resize(numPoints, numDimensions);
-#pragma omp parallel for
-    for (int i = 0; i < numPoints; i++)
+    statistics.localValues.resize(numPoints, numDimensions);
+
+    parallel::forEachPoint(neighbourhoodMatrix, [&](int i) {
+        computeLocalValue(statistics, dataset, i, neighbourhoodMatrix[i]);
+    });
+}
+
+void ValueMethod::computeLocalValue(ValueStatistics& statistics, const DataTable& dataset, int i, const Neighbourhood& neighbourhood)
+{
+    int numDimensions = dataset.numDimensions();
+
+    if (dataset.isSparse())
     {
-        const std::vector<int>& neighbourhood = neighbourhoodMatrix[i];
+        // Only the stored values of the neighbours are visited, the buffer is reused by the thread
+        thread_local std::vector<double> sums;
+        sums.assign(numDimensions, 0);
+
+        for (const int ni : neighbourhood)
+            dataset.forEachNonZero(ni, [](int j, float value) { sums[j] += value; });
 
         for (int j = 0; j < numDimensions; j++)
-        {
-            // Compute mean
-            float mean = 0;
-            for (int n = 0; n < neighbourhood.size(); n++)
-            {
-                mean += dataset(neighbourhood[n], j);
-            }
-            mean /= neighbourhood.size();
+            statistics.localValues(i, j) = static_cast<float>(sums[j] / neighbourhood.size());
 
-            _localValues(i, j) = mean;
-        }
-        if (i % 1000 == 0)
-            std::cout << "Local var: " << i << std::endl;
+        return;
     }
 
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-    std::cout << "Local Value Elapsed time: " << elapsed.count() << " s\n";
+    const DataMatrix& data = *dataset.getDenseData();
+
+    for (int j = 0; j < numDimensions; j++)
+    {
+        // Compute mean
+        float mean = 0;
+        for (int n = 0; n < neighbourhood.size(); n++)
+        {
+            mean += data(neighbourhood[n], j);
+        }
+        mean /= neighbourhood.size();
+
+        statistics.localValues(i, j) = mean;
+    }
 }
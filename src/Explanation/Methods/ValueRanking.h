@@ -2,20 +2,37 @@
 
 #include "ExplanationMethod.h"
 
+/** Precomputed statistics of the value method */
+struct ValueStatistics : public Explanation::Statistics
+{
+    std::vector<float> globalValues;
+
+    DataMatrix localValues;
+
+    std::vector<float> dataRanges;
+};
+
 class ValueMethod : public Explanation::Method
 {
 public:
-    void recompute(const DataTable& dataset, NeighbourhoodMatrix& neighbourhoodMatrix) override;
+    void recompute(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix) override;
+    void recomputeGlobalStatistics(const DataTable& dataset) override;
+    bool update(const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points, const NeighbourhoodMatrix& previousNeighbourhoods) override;
     float computeDimensionRank(const DataTable& dataset, int i, int j) override;
-    void computeDimensionRank(const DataTable& dataset, const std::vector<unsigned int>& selection, std::vector<float>& dimRanking) override;
+    void computeDimensionRank(const DataTable& dataset, const SelectionStatistics& selectionStats, std::vector<float>& dimRanking) override;
 
-private:
-    void precomputeGlobalValues(const DataTable& dataset);
-    void precomputeLocalValues(const DataTable& dataset, NeighbourhoodMatrix& neighbourhoodMatrix);
+    std::size_t getMemoryUsage() const override;
+    void release() override;
 
-    std::vector<float> _globalValues;
+    std::shared_ptr<const Explanation::Statistics> getStatistics() const override { return _statistics; }
+    bool setStatistics(std::shared_ptr<const Explanation::Statistics> statistics) override;
 
-    DataMatrix _localValues;
+private:
+    void precomputeDataRanges(ValueStatistics& statistics, const DataTable& dataset);
+    void precomputeGlobalValues(ValueStatistics& statistics, const DataTable& dataset);
+    void precomputeLocalValues(ValueStatistics& statistics, const DataTable& dataset, const NeighbourhoodMatrix& neighbourhoodMatrix);
+    void computeLocalValue(ValueStatistics& statistics, const DataTable& dataset, int i, const Neighbourhood& neighbourhood);
 
-    std::vector<float> _dataRanges;
+    /** Statistics of the last recompute, possibly shared with other cores */
+    std::shared_ptr<const ValueStatistics> _statistics;
 };
@@ -0,0 +1,284 @@
+#include "MultiScaleExplanation.h"
+#include "Neighbourhood.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace
+{
+    using Candidate = std::pair<float, int>;
+
+    /** Collect the points within sqrt(\p radSquared) of \p centerId as (squared distance, index) pairs in order of distance */
+    void findSortedCandidates(const DataMatrix& projection, int centerId, float radSquared, int xDim, int yDim, std::vector<Candidate>& candidates)
+    {
+        const float x = projection(centerId, xDim);
+        const float y = projection(centerId, yDim);
+
+        candidates.clear();
+
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            float xd = projection(i, xDim) - x;
+            float yd = projection(i, yDim) - y;
+
+            float magSquared = xd * xd + yd * yd;
+
+            if (magSquared <= radSquared)
+                candidates.emplace_back(magSquared, i);
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+    /** Squared absolute radii of the levels, computed like the neighbourhoods of the core so both agree on the boundary */
+    std::vector<float> computeSquaredRadii(const std::vector<float>& radii, float diameter, float scale)
+    {
+        std::vector<float> squaredRadii(radii.size());
+
+        for (std::size_t l = 0; l < radii.size(); l++)
+        {
+            const float radius = diameter * radii[l] * scale;
+            squaredRadii[l] = radius * radius;
+        }
+
+        return squaredRadii;
+    }
+}
+
+MultiScaleExplanation::MultiScaleExplanation() :
+    _metric(Explanation::Metric::NONE),
+    _levels()
+{
+
+}
+
+bool MultiScaleExplanation::compute(const DataTable& dataset, const DataStatistics& dataStats, const DataMatrix& projection, std::vector<float> radii, Explanation::Metric metric, int xDim, int yDim)
+{
+    TRACE_SCOPE("MultiScaleExplanation::compute");
+
+    clear();
+
+    if (metric != Explanation::Metric::VARIANCE && metric != Explanation::Metric::VALUE)
+        return false;
+
+    if (dataset.numPoints() == 0 || dataset.numDimensions() > std::numeric_limits<std::uint16_t>::max() + 1)
+        return false;
+
+    std::sort(radii.begin(), radii.end());
+    radii.erase(std::unique(radii.begin(), radii.end()), radii.end());
+
+    if (radii.empty())
+        return false;
+
+    TRACE_COUNTER("Scale levels", radii.size());
+
+    _metric = metric;
+    _levels.resize(radii.size());
+
+    for (std::size_t l = 0; l < radii.size(); l++)
+    {
+        _levels[l].radius = radii[l];
+        _levels[l].topDimensions.resize(dataset.numPoints());
+        _levels[l].confidences.resize(dataset.numPoints());
+    }
+
+    computeTopDimensions(dataset, dataStats, projection, radii, xDim, yDim);
+    computeConfidences(projection, radii, xDim, yDim);
+    computeColorMappings(dataset);
+
+    return true;
+}
+
+void MultiScaleExplanation::clear()
+{
+    _metric = Explanation::Metric::NONE;
+    _levels = std::vector<ScaleLevel>();
+}
+
+int MultiScaleExplanation::findLevel(float radius) const
+{
+    int closest = -1;
+    float closestDistance = std::numeric_limits<float>::max();
+
+    for (int l = 0; l < numLevels(); l++)
+    {
+        const float distance = std::abs(_levels[l].radius - radius);
+
+        if (distance < closestDistance)
+        {
+            closest = l;
+            closestDistance = distance;
+        }
+    }
+
+    return closest;
+}
+
+std::size_t MultiScaleExplanation::getMemoryUsage() const
+{
+    std::size_t bytes = _levels.capacity() * sizeof(ScaleLevel);
+
+    for (const ScaleLevel& level : _levels)
+        bytes += level.topDimensions.capacity() * sizeof(std::uint16_t) + level.confidences.capacity() * sizeof(std::uint8_t) + level.paletteIndices.capacity() * sizeof(int);
+
+    return bytes;
+}
+
+void MultiScaleExplanation::computeTopDimensions(const DataTable& dataset, const DataStatistics& dataStats, const DataMatrix& projection, const std::vector<float>& radii, int xDim, int yDim)
+{
+    TRACE_SCOPE("MultiScaleExplanation::computeTopDimensions");
+
+    const int numPoints = dataset.numPoints();
+    const int numDimensions = dataset.numDimensions();
+    const int numLevels = static_cast<int>(radii.size());
+
+    const std::vector<float> squaredRadii = computeSquaredRadii(radii, computeProjectionDiameter(projection, xDim, yDim), 1.0f);
+
+    const bool lowRankBest = _metric == Explanation::Metric::VARIANCE;
+
+    const std::vector<int> includedDims = dataset.getIncludedDimensions();
+
+    // Local variances are ranked relative to the global variances, local means relative to the global means and ranges
+    const std::vector<double> globalVariances = dataStats.getNormalizingVariances();
+
+#pragma omp parallel
+    {
+        std::vector<Candidate> candidates;
+        std::vector<double> sums(numDimensions);
+        std::vector<double> squares(numDimensions);
+        std::vector<double> scores(numDimensions);
+
+#pragma omp for schedule(dynamic, 16)
+        for (int i = 0; i < numPoints; i++)
+        {
+            findSortedCandidates(projection, i, squaredRadii.back(), xDim, yDim, candidates);
+
+            std::fill(sums.begin(), sums.end(), 0.0);
+            std::fill(squares.begin(), squares.end(), 0.0);
+
+            std::size_t numNeighbours = 0;
+
+            for (int l = 0; l < numLevels; l++)
+            {
+                // Extend the prefix sums with the neighbours between the previous and the current radius
+                for (; numNeighbours < candidates.size() && candidates[numNeighbours].first <= squaredRadii[l]; numNeighbours++)
+                {
+                    const int n = candidates[numNeighbours].second;
+
+                    // Zeros add nothing to the sums, so sparse rows only visit their stored values
+                    dataset.forEachNonZero(n, [&](int j, float value) {
+                        sums[j] += value;
+                        squares[j] += static_cast<double>(value) * value;
+                    });
+                }
+
+                // The ranks are the scores divided by their sum over all dimensions, which does not change their order
+                double sum = 0;
+                for (int j = 0; j < numDimensions; j++)
+                {
+                    const double mean = sums[j] / numNeighbours;
+
+                    if (lowRankBest)
+                        scores[j] = std::max(0.0, squares[j] / numNeighbours - mean * mean) / globalVariances[j];
+                    else
+                        scores[j] = (mean - dataStats.means[j]) / dataStats.ranges[j];
+
+                    sum += std::abs(scores[j]);
+                }
+
+                int topDim = includedDims[0];
+
+                if (sum > 0)
+                {
+                    for (const int j : includedDims)
+                        if (lowRankBest ? scores[j] < scores[topDim] : scores[j] > scores[topDim])
+                            topDim = j;
+                }
+
+                _levels[l].topDimensions[i] = static_cast<std::uint16_t>(topDim);
+            }
+        }
+    }
+}
+
+void MultiScaleExplanation::computeConfidences(const DataMatrix& projection, const std::vector<float>& radii, int xDim, int yDim)
+{
+    TRACE_SCOPE("MultiScaleExplanation::computeConfidences");
+
+    const int numPoints = static_cast<int>(projection.rows());
+    const int numLevels = static_cast<int>(radii.size());
+
+    // The confidence neighbourhoods are a quarter of the explanation neighbourhoods, as in the confidence model
+    const std::vector<float> squaredRadii = computeSquaredRadii(radii, computeProjectionDiameter(projection, xDim, yDim), 0.25f);
+
+    std::vector<float> confidences(static_cast<std::size_t>(numPoints) * numLevels);
+
+#pragma omp parallel
+    {
+        std::vector<Candidate> candidates;
+
+#pragma omp for schedule(dynamic, 16)
+        for (int i = 0; i < numPoints; i++)
+        {
+            findSortedCandidates(projection, i, squaredRadii.back(), xDim, yDim, candidates);
+
+            std::size_t numNeighbours = 0;
+
+            for (int l = 0; l < numLevels; l++)
+            {
+                while (numNeighbours < candidates.size() && candidates[numNeighbours].first <= squaredRadii[l])
+                    numNeighbours++;
+
+                const std::vector<std::uint16_t>& topDimensions = _levels[l].topDimensions;
+
+                int count = 0;
+                for (std::size_t k = 0; k < numNeighbours; k++)
+                    if (topDimensions[candidates[k].second] == topDimensions[i]) count++;
+
+                confidences[static_cast<std::size_t>(l) * numPoints + i] = numNeighbours > 0 ? static_cast<float>(count) / numNeighbours : 0.0f;
+            }
+        }
+    }
+
+    // Normalize the confidences of every level to [0, 1] and quantize them
+    for (int l = 0; l < numLevels; l++)
+    {
+        const auto begin = confidences.begin() + static_cast<std::size_t>(l) * numPoints;
+        const auto range = std::minmax_element(begin, begin + numPoints);
+
+        const float minVal = *range.first;
+        const float maxVal = *range.second;
+
+        for (int i = 0; i < numPoints; i++)
+        {
+            const float confidence = maxVal > minVal ? (begin[i] - minVal) / (maxVal - minVal) : 1.0f;
+
+            _levels[l].confidences[i] = static_cast<std::uint8_t>(std::lround(confidence * 255.0f));
+        }
+    }
+}
+
+void MultiScaleExplanation::computeColorMappings(const DataTable& dataset)
+{
+    const int numDimensions = dataset.numDimensions();
+
+    ColorMapping colorMapping;
+    colorMapping.recreate(dataset);
+
+    std::vector<int> topCounts(numDimensions);
+
+    for (ScaleLevel& level : _levels)
+    {
+        std::fill(topCounts.begin(), topCounts.end(), 0);
+
+        for (const std::uint16_t topDim : level.topDimensions)
+            if (!dataset.isExcluded(topDim)) topCounts[topDim]++;
+
+        colorMapping.recompute(topCounts);
+
+        level.paletteIndices = colorMapping.getPaletteIndices();
+    }
+}
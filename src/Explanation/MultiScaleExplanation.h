@@ -0,0 +1,84 @@
+#pragma once
+
+#include "DataTypes.h"
+#include "ColorMapping.h"
+#include "Methods/ExplanationMethod.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Explanation of all points at a single radius of the multi-scale ladder, stored compactly
+ * so that moving between radii only rebuilds the point colors from the stored level
+ */
+struct ScaleLevel
+{
+    float                       radius = 0;         /** Radius of the level as a fraction of the projection diameter */
+    std::vector<std::uint16_t>  topDimensions;      /** Top ranked dimension of every point */
+    std::vector<std::uint8_t>   confidences;        /** Normalized confidence of every point, quantized to [0, 255] */
+    std::vector<int>            paletteIndices;     /** Palette index of every dimension at this level, -1 if it has no color */
+
+    float getConfidence(int i) const { return confidences[i] / 255.0f; }
+};
+
+/**
+ * Multi-scale explanation class
+ *
+ * Explains the projection for a ladder of radii at once. The neighbours of every point within the
+ * largest radius are visited once, in order of distance, while per-dimension sums and sums of squares
+ * are accumulated. Each time the distance passes the radius of a level the local means and variances
+ * of that level follow from the prefix sums, so the cost is that of a single explanation at the largest
+ * radius instead of one per level.
+ *
+ * Only the variance and value metrics are supported, the euclidean metric depends on every neighbour
+ * individually and has no prefix form. Confidences use the simplified confidence model (the share of
+ * the confidence neighbourhood with the same top dimension), the confidence of the Silva model needs
+ * the full rank matrix of every level.
+ */
+class MultiScaleExplanation
+{
+public:
+    MultiScaleExplanation();
+
+    /**
+     * Compute the explanation for every radius of the ladder
+     * @param dataset High-dimensional data
+     * @param dataStats Global statistics of the data
+     * @param projection Projection matrix, one row per point
+     * @param radii Radii of the levels as fractions of the projection diameter
+     * @param metric Explanation metric, variance or value
+     * @return Whether the levels were computed, false for unsupported metrics or too many dimensions
+     */
+    bool compute(const DataTable& dataset, const DataStatistics& dataStats, const DataMatrix& projection, std::vector<float> radii, Explanation::Metric metric, int xDim, int yDim);
+
+    /** Drop all levels (on data, metric or exclusion change) */
+    void clear();
+
+    bool isEmpty() const { return _levels.empty(); }
+    int numLevels() const { return static_cast<int>(_levels.size()); }
+    const ScaleLevel& getLevel(int level) const { return _levels[level]; }
+
+    /** Get the metric the levels were computed for */
+    Explanation::Metric getMetric() const { return _metric; }
+
+    /** Get the index of the level with the radius closest to \p radius, or -1 when there are no levels */
+    int findLevel(float radius) const;
+
+    /** Get the number of bytes held by the levels */
+    std::size_t getMemoryUsage() const;
+
+private:
+    /** Compute the top ranked dimension of every point at every level */
+    void computeTopDimensions(const DataTable& dataset, const DataStatistics& dataStats, const DataMatrix& projection, const std::vector<float>& radii, int xDim, int yDim);
+
+    /** Compute the confidences of every level from the top dimensions in the confidence neighbourhoods */
+    void computeConfidences(const DataMatrix& projection, const std::vector<float>& radii, int xDim, int yDim);
+
+    /** Assign palette colors level by level, so colors stay stable between neighbouring levels */
+    void computeColorMappings(const DataTable& dataset);
+
+private:
+    Explanation::Metric         _metric;    /** Metric of the levels */
+    std::vector<ScaleLevel>     _levels;    /** Levels in order of increasing radius */
+};
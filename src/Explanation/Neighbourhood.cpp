@@ -0,0 +1,340 @@
+#include "Neighbourhood.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+    /** SplitMix64 step, a small and fast generator for per-point reproducible random streams */
+    std::uint64_t nextRandom(std::uint64_t& state)
+    {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /** Uniform random integer in [0, bound) */
+    std::uint64_t randomBelow(std::uint64_t& state, std::uint64_t bound)
+    {
+        return ((nextRandom(state) >> 32) * bound) >> 32;
+    }
+
+    /**
+     * Collects a neighbourhood from its candidates: the center is always kept, the other candidates
+     * compete for the remaining slots of a reservoir when the neighbourhood is capped. The candidates
+     * must be added in index order (without the center), so every search gives the same sample.
+     */
+    class NeighbourhoodReservoir
+    {
+    public:
+        NeighbourhoodReservoir(Neighbourhood& neighbourhood, int centerId, const NeighbourhoodSampling& sampling) :
+            _neighbourhood(neighbourhood),
+            _centerId(centerId),
+            _capacity(sampling.maxNeighbours > 0 ? std::max(1, sampling.maxNeighbours) : std::numeric_limits<int>::max()),
+            _numCandidates(1),
+            _state((static_cast<std::uint64_t>(sampling.seed) << 32) ^ static_cast<std::uint32_t>(centerId))
+        {
+            _neighbourhood.clear();
+            _neighbourhood.push_back(centerId);
+        }
+
+        void add(int i)
+        {
+            _numCandidates++;
+
+            if (static_cast<int>(_neighbourhood.size()) < _capacity)
+            {
+                _neighbourhood.push_back(i);
+            }
+            else
+            {
+                // Reservoir sampling (algorithm R) over the candidates other than the center
+                std::uint64_t slot = randomBelow(_state, static_cast<std::uint64_t>(_numCandidates - 1));
+
+                if (slot < static_cast<std::uint64_t>(_capacity - 1))
+                    _neighbourhood[slot + 1] = i;
+            }
+        }
+
+        /** Sort the neighbourhood and get the number of candidates before the cap was applied */
+        int finish()
+        {
+            if (_numCandidates > _capacity)
+                std::sort(_neighbourhood.begin(), _neighbourhood.end());
+            else // The candidates were added in index order, only the center needs to move to its place
+                std::rotate(_neighbourhood.begin(), _neighbourhood.begin() + 1, std::upper_bound(_neighbourhood.begin() + 1, _neighbourhood.end(), _centerId));
+
+            return _numCandidates;
+        }
+
+    private:
+        Neighbourhood&  _neighbourhood;
+        int             _centerId;
+        int             _capacity;
+        int             _numCandidates;
+        std::uint64_t   _state;
+    };
+}
+
+float computeSamplingError(int numCandidates, int numSamples)
+{
+    if (numSamples <= 0 || numSamples >= numCandidates)
+        return 0;
+
+    return static_cast<float>(std::sqrt(static_cast<double>(numCandidates - numSamples) / (numCandidates - 1)) / std::sqrt(static_cast<double>(numSamples)));
+}
+
+float computeProjectionDiameter(const DataMatrix& projection, int xDim, int yDim)
+{
+    float minX = std::numeric_limits<float>::max(), maxX = -std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max(), maxY = -std::numeric_limits<float>::max();
+    for (int i = 0; i < projection.rows(); i++)
+    {
+        float x = projection(i, xDim);
+        float y = projection(i, yDim);
+
+        if (x < minX) minX = x;
+        if (x > maxX) maxX = x;
+        if (y < minY) minY = y;
+        if (y > maxY) maxY = y;
+    }
+    float rangeX = maxX - minX;
+    float rangeY = maxY - minY;
+
+    float diameter = rangeX > rangeY ? rangeX : rangeY;
+    return diameter;
+}
+
+int findNeighbourhood(const DataMatrix& projection, int centerId, float radius, Neighbourhood& neighbourhood, int xDim, int yDim, const NeighbourhoodSampling& sampling)
+{
+    float x = projection(centerId, xDim);
+    float y = projection(centerId, yDim);
+
+    float radSquared = radius * radius;
+
+    NeighbourhoodReservoir reservoir(neighbourhood, centerId, sampling);
+
+    // Sampled neighbourhoods only visit the candidates in the residue class of the center
+    const int stride = std::max(1, sampling.stride);
+
+    for (int i = centerId % stride; i < projection.rows(); i += stride)
+    {
+        if (i == centerId)
+            continue;
+
+        float xd = projection(i, xDim) - x;
+        float yd = projection(i, yDim) - y;
+
+        float magSquared = xd * xd + yd * yd;
+
+        if (magSquared > radSquared)
+            continue;
+
+        reservoir.add(i);
+    }
+
+    return reservoir.finish();
+}
+
+int findNeighbourhood(const DataMatrix& projection, const SpatialGrid& grid, int centerId, float radius, Neighbourhood& neighbourhood, int xDim, int yDim, const NeighbourhoodSampling& sampling)
+{
+    const int stride = std::max(1, sampling.stride);
+    const int residue = centerId % stride;
+
+    // The grid visits the candidates by cell, the reservoir needs them in index order to match the exhaustive search
+    thread_local std::vector<int> candidates;
+    candidates.clear();
+
+    grid.forEachInRadius(projection(centerId, xDim), projection(centerId, yDim), radius, [&](int i, float) {
+        if (i != centerId && i % stride == residue)
+            candidates.push_back(i);
+    });
+
+    std::sort(candidates.begin(), candidates.end());
+
+    NeighbourhoodReservoir reservoir(neighbourhood, centerId, sampling);
+
+    for (const int i : candidates)
+        reservoir.add(i);
+
+    return reservoir.finish();
+}
+
+void findPointsInCircle(const DataMatrix& projection, float x, float y, float radius, std::vector<unsigned int>& indices, int xDim, int yDim)
+{
+    float radSquared = radius * radius;
+
+    indices.clear();
+
+    for (int i = 0; i < projection.rows(); i++)
+    {
+        float xd = projection(i, xDim) - x;
+        float yd = projection(i, yDim) - y;
+
+        if (xd * xd + yd * yd > radSquared)
+            continue;
+
+        indices.push_back(i);
+    }
+}
+
+void computeNeighbourhoodMatrix(const DataMatrix& projection, NeighbourhoodMatrix& neighbourhoodMatrix, float radius, int xDim, int yDim, const NeighbourhoodSampling& sampling, std::vector<int>* numCandidates)
+{
+    TRACE_SCOPE("computeNeighbourhoodMatrix");
+
+    neighbourhoodMatrix.clear();
+    neighbourhoodMatrix.resize(projection.rows());
+
+    if (numCandidates != nullptr)
+        numCandidates->assign(projection.rows(), 0);
+
+    std::int64_t numNeighbours = 0;
+
+#pragma omp parallel reduction(+:numNeighbours)
+    {
+        TRACE_SCOPE("computeNeighbourhoodMatrix worker");
+
+        // The size of a neighbourhood is only known once it is found, small dynamic chunks balance the dense regions
+#pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < projection.rows(); i++)
+        {
+            int count = findNeighbourhood(projection, i, radius, neighbourhoodMatrix[i], xDim, yDim, sampling);
+
+            if (numCandidates != nullptr)
+                (*numCandidates)[i] = count;
+
+            // Growing the neighbourhood leaves up to half of its capacity unused
+            neighbourhoodMatrix[i].shrink_to_fit();
+
+            numNeighbours += neighbourhoodMatrix[i].size();
+        }
+    }
+
+    TRACE_COUNTER("Neighbourhood size", projection.rows() > 0 ? numNeighbours / projection.rows() : 0);
+}
+
+void computeNearestNeighbourDistances(const DataMatrix& projection, const SpatialGrid& grid, int k, int xDim, int yDim, std::vector<float>& distances)
+{
+    TRACE_SCOPE("computeNearestNeighbourDistances");
+
+    distances.resize(projection.rows());
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int i = 0; i < projection.rows(); i++)
+        distances[i] = grid.findKthNearestDistance(projection, i, k, xDim, yDim);
+}
+
+void computeNeighbourhoodMatrix(const DataMatrix& projection, const SpatialGrid& grid, NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<float>& radii, float radiusScale, int xDim, int yDim, const NeighbourhoodSampling& sampling, std::vector<int>* numCandidates)
+{
+    TRACE_SCOPE("computeNeighbourhoodMatrix (adaptive)");
+
+    neighbourhoodMatrix.clear();
+    neighbourhoodMatrix.resize(projection.rows());
+
+    if (numCandidates != nullptr)
+        numCandidates->assign(projection.rows(), 0);
+
+    std::int64_t numNeighbours = 0;
+
+    // The grid queries are cheap and of similar cost, small dynamic chunks still balance the remaining variation
+#pragma omp parallel for schedule(dynamic, 64) reduction(+:numNeighbours)
+    for (int i = 0; i < projection.rows(); i++)
+    {
+        int count = findNeighbourhood(projection, grid, i, radii[i] * radiusScale, neighbourhoodMatrix[i], xDim, yDim, sampling);
+
+        if (numCandidates != nullptr)
+            (*numCandidates)[i] = count;
+
+        neighbourhoodMatrix[i].shrink_to_fit();
+
+        numNeighbours += neighbourhoodMatrix[i].size();
+    }
+
+    TRACE_COUNTER("Neighbourhood size", projection.rows() > 0 ? numNeighbours / projection.rows() : 0);
+}
+
+double estimateNeighbourhoodEntries(const DataMatrix& projection, float radius, int xDim, int yDim)
+{
+    TRACE_SCOPE("estimateNeighbourhoodEntries");
+
+    constexpr int GRID_SIZE = 64;
+
+    const int numPoints = static_cast<int>(projection.rows());
+
+    if (numPoints == 0)
+        return 0;
+
+    float minX = projection.col(xDim).minCoeff();
+    float minY = projection.col(yDim).minCoeff();
+    float extent = std::max(projection.col(xDim).maxCoeff() - minX, projection.col(yDim).maxCoeff() - minY);
+
+    if (extent <= 0)
+        return static_cast<double>(numPoints) * numPoints;
+
+    const float cellSize = extent / GRID_SIZE;
+
+    // Point counts per grid cell and their summed-area table
+    std::vector<int> counts(GRID_SIZE * GRID_SIZE, 0);
+    for (int i = 0; i < numPoints; i++)
+    {
+        int cx = std::min(GRID_SIZE - 1, static_cast<int>((projection(i, xDim) - minX) / cellSize));
+        int cy = std::min(GRID_SIZE - 1, static_cast<int>((projection(i, yDim) - minY) / cellSize));
+        counts[cy * GRID_SIZE + cx]++;
+    }
+
+    std::vector<double> summedArea((GRID_SIZE + 1) * (GRID_SIZE + 1), 0);
+    for (int cy = 0; cy < GRID_SIZE; cy++)
+        for (int cx = 0; cx < GRID_SIZE; cx++)
+            summedArea[(cy + 1) * (GRID_SIZE + 1) + cx + 1] = counts[cy * GRID_SIZE + cx] + summedArea[cy * (GRID_SIZE + 1) + cx + 1] + summedArea[(cy + 1) * (GRID_SIZE + 1) + cx] - summedArea[cy * (GRID_SIZE + 1) + cx];
+
+    // The points of a cell see the points in a square window around it, scaled down to the area of the circle
+    const int halfWindow = static_cast<int>(std::ceil(radius / cellSize));
+    const double windowSide = (2.0 * halfWindow + 1) * cellSize;
+    const double circleFraction = std::min(1.0, 3.14159265358979 * radius * radius / (windowSide * windowSide));
+
+    double entries = 0;
+    for (int cy = 0; cy < GRID_SIZE; cy++)
+    {
+        for (int cx = 0; cx < GRID_SIZE; cx++)
+        {
+            const int count = counts[cy * GRID_SIZE + cx];
+
+            if (count == 0)
+                continue;
+
+            int x0 = std::max(0, cx - halfWindow), x1 = std::min(GRID_SIZE, cx + halfWindow + 1);
+            int y0 = std::max(0, cy - halfWindow), y1 = std::min(GRID_SIZE, cy + halfWindow + 1);
+
+            double windowCount = summedArea[y1 * (GRID_SIZE + 1) + x1] - summedArea[y0 * (GRID_SIZE + 1) + x1] - summedArea[y1 * (GRID_SIZE + 1) + x0] + summedArea[y0 * (GRID_SIZE + 1) + x0];
+
+            // Every point is at least its own neighbour
+            entries += count * std::max(1.0, windowCount * circleFraction);
+        }
+    }
+
+    return std::min(entries, static_cast<double>(numPoints) * numPoints);
+}
+
+void diffNeighbourhoods(const Neighbourhood& previous, const Neighbourhood& current, std::vector<int>& removed, std::vector<int>& added)
+{
+    removed.clear();
+    added.clear();
+
+    std::set_difference(previous.begin(), previous.end(), current.begin(), current.end(), std::back_inserter(removed));
+    std::set_difference(current.begin(), current.end(), previous.begin(), previous.end(), std::back_inserter(added));
+}
+
+std::size_t getMemoryUsage(const NeighbourhoodMatrix& neighbourhoodMatrix)
+{
+    std::size_t bytes = neighbourhoodMatrix.capacity() * sizeof(Neighbourhood);
+
+    for (const Neighbourhood& neighbourhood : neighbourhoodMatrix)
+        bytes += neighbourhood.capacity() * sizeof(int);
+
+    return bytes;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "DataTypes.h"
+#include "SpatialGrid.h"
+
+#include <cstdint>
+
+/**
+ * Sampling of the neighbourhoods, bounds their memory and the time spent on local statistics
+ * at large radii. Both kinds of sampling are deterministic and always keep the center point.
+ */
+struct NeighbourhoodSampling
+{
+    int             stride          = 1;    /** Only keep the candidates whose index is congruent to the center modulo the stride */
+    int             maxNeighbours   = 0;    /** Keep a uniform reservoir sample of at most this many neighbours, 0 for no cap */
+    std::uint32_t   seed            = 0;    /** Seed of the reservoir sampling, combined with the center index */
+};
+
+/**
+ * Get the standard error of a mean over \p numSamples points drawn without replacement
+ * from \p numCandidates points, relative to the standard deviation of the candidates
+ * (including the finite population correction), 0 when all candidates are used
+ */
+float computeSamplingError(int numCandidates, int numSamples);
+
+/**
+ * Compute the largest extent of the projection along the given axes
+ * @param projection Projection matrix, one row per point
+ * @param xDim Column of the x-coordinates
+ * @param yDim Column of the y-coordinates
+ */
+float computeProjectionDiameter(const DataMatrix& projection, int xDim, int yDim);
+
+/**
+ * Find the indices of all points in the projection within \p radius of the point \p centerId
+ * @param projection Projection matrix, one row per point
+ * @param centerId Index of the center point
+ * @param radius Radius of the neighbourhood in projection units
+ * @param neighbourhood Output sorted indices of the neighbouring points (including the center point)
+ * @param sampling Sampling of the neighbourhood, by default all neighbours are kept
+ * @return Number of candidates within the radius before the neighbour cap was applied
+ */
+int findNeighbourhood(const DataMatrix& projection, int centerId, float radius, Neighbourhood& neighbourhood, int xDim, int yDim, const NeighbourhoodSampling& sampling = NeighbourhoodSampling());
+
+/**
+ * Find the neighbourhood of the point \p centerId like findNeighbourhood, visiting only the cells of \p grid
+ * that overlap the neighbourhood; gives the same (sampled) neighbourhood as the exhaustive search
+ * @param grid Grid over the same axes of the projection
+ */
+int findNeighbourhood(const DataMatrix& projection, const SpatialGrid& grid, int centerId, float radius, Neighbourhood& neighbourhood, int xDim, int yDim, const NeighbourhoodSampling& sampling = NeighbourhoodSampling());
+
+/**
+ * Find the indices of all points in the projection within \p radius of the position (\p x, \p y),
+ * e.g. the points under a selection lens
+ * @param projection Projection matrix, one row per point
+ * @param x Center x-coordinate in projection units
+ * @param y Center y-coordinate in projection units
+ * @param radius Radius of the circle in projection units
+ * @param indices Output sorted indices of the points inside the circle
+ */
+void findPointsInCircle(const DataMatrix& projection, float x, float y, float radius, std::vector<unsigned int>& indices, int xDim, int yDim);
+
+/**
+ * For every point in the projection compute the indices of the points
+ * in its neighbourhood and add them to the matrix.
+ * @param sampling Sampling of the neighbourhoods, by default they are exact
+ * @param numCandidates Optional output number of candidates per point before the neighbour cap was applied
+ */
+void computeNeighbourhoodMatrix(const DataMatrix& projection, NeighbourhoodMatrix& neighbourhoodMatrix, float radius, int xDim, int yDim, const NeighbourhoodSampling& sampling = NeighbourhoodSampling(), std::vector<int>* numCandidates = nullptr);
+
+/**
+ * For every point in the projection compute the distance to its k-th nearest other point
+ * @param grid Grid over the same axes of the projection
+ * @param k Rank of the neighbour, 1 for the nearest neighbour
+ * @param distances Output distance of every point in projection units
+ */
+void computeNearestNeighbourDistances(const DataMatrix& projection, const SpatialGrid& grid, int k, int xDim, int yDim, std::vector<float>& distances);
+
+/**
+ * For every point in the projection compute its neighbourhood with a radius of its own,
+ * e.g. derived from the k-th nearest neighbour distances for neighbourhoods adapted to the density
+ * @param grid Grid over the same axes of the projection
+ * @param radii Radius of every point in projection units
+ * @param radiusScale Factor applied to all radii
+ * @param sampling Sampling of the neighbourhoods, by default they are exact
+ * @param numCandidates Optional output number of candidates per point before the neighbour cap was applied
+ */
+void computeNeighbourhoodMatrix(const DataMatrix& projection, const SpatialGrid& grid, NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<float>& radii, float radiusScale, int xDim, int yDim, const NeighbourhoodSampling& sampling = NeighbourhoodSampling(), std::vector<int>* numCandidates = nullptr);
+
+/**
+ * Estimate the total number of indices computeNeighbourhoodMatrix would store for \p radius
+ * without building the neighbourhoods, from the density of the projection on a coarse grid
+ * @param projection Projection matrix, one row per point
+ * @param radius Radius of the neighbourhoods in projection units
+ * @return Estimated sum of all neighbourhood sizes (exact neighbourhoods, stride 1)
+ */
+double estimateNeighbourhoodEntries(const DataMatrix& projection, float radius, int xDim, int yDim);
+
+/**
+ * Split the change from the \p previous to the \p current neighbourhood (both sorted) into the
+ * indices that left and the indices that joined it, e.g. to downdate and update local statistics
+ */
+void diffNeighbourhoods(const Neighbourhood& previous, const Neighbourhood& current, std::vector<int>& removed, std::vector<int>& added);
+
+/** Get the number of bytes held by \p neighbourhoodMatrix */
+std::size_t getMemoryUsage(const NeighbourhoodMatrix& neighbourhoodMatrix);
@@ -0,0 +1,86 @@
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace parallel
+{
+    int getNumProcessors()
+    {
+#ifdef _OPENMP
+        return omp_get_num_procs();
+#else
+        return 1;
+#endif
+    }
+
+    int getMaxThreads()
+    {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    std::vector<int> partitionByCost(const NeighbourhoodMatrix& neighbourhoodMatrix, int numChunks)
+    {
+        const int numPoints = static_cast<int>(neighbourhoodMatrix.size());
+
+        if (numChunks <= 0)
+            numChunks = getMaxThreads() * CHUNKS_PER_THREAD;
+
+        numChunks = std::max(1, std::min(numChunks, numPoints));
+
+        // The point itself is part of the cost, so empty neighbourhoods are not free
+        std::int64_t totalCost = 0;
+        for (const Neighbourhood& neighbourhood : neighbourhoodMatrix)
+            totalCost += static_cast<std::int64_t>(neighbourhood.size()) + 1;
+
+        std::vector<int> chunks;
+        chunks.reserve(numChunks + 1);
+        chunks.push_back(0);
+
+        // Close a chunk once the cost up to it reaches its share of the total
+        std::int64_t cost = 0;
+        for (int i = 0; i < numPoints; i++)
+        {
+            cost += static_cast<std::int64_t>(neighbourhoodMatrix[i].size()) + 1;
+
+            const int numClosed = static_cast<int>(chunks.size());
+            if (numClosed < numChunks && cost * numChunks >= totalCost * numClosed)
+                chunks.push_back(i + 1);
+        }
+
+        if (chunks.back() != numPoints)
+            chunks.push_back(numPoints);
+
+        return chunks;
+    }
+
+    ThreadLimit::ThreadLimit(int numThreads) :
+        _previousThreads(0)
+    {
+#ifdef _OPENMP
+        if (numThreads <= 0)
+            return;
+
+        _previousThreads = omp_get_max_threads();
+        omp_set_num_threads(numThreads);
+#else
+        (void) numThreads;
+#endif
+    }
+
+    ThreadLimit::~ThreadLimit()
+    {
+#ifdef _OPENMP
+        if (_previousThreads > 0)
+            omp_set_num_threads(_previousThreads);
+#endif
+    }
+}
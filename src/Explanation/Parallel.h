@@ -0,0 +1,70 @@
+#pragma once
+
+#include "DataTypes.h"
+
+#include <vector>
+
+/**
+ * Parallel scheduling of the explanation pipeline
+ *
+ * The cost of a point is proportional to the size of its neighbourhood, which varies by orders of
+ * magnitude between dense and sparse regions of the projection. The static schedule gives every
+ * thread an equal range of points, so the threads that get the dense regions do most of the work.
+ * The per-point loops over the neighbourhoods instead split the points into contiguous chunks of
+ * similar cost, several per thread, and hand them out dynamically. The chunks stay contiguous so
+ * that the points of a chunk stay close in memory (see PointOrder).
+ *
+ * The number of threads can be capped, e.g. to share a machine, with a ThreadLimit around the
+ * parallel work; the cap only applies to the thread that sets it and is restored afterwards.
+ */
+namespace parallel
+{
+    /** Number of chunks per thread of the cost-balanced loops, the dynamic schedule balances the remaining differences */
+    constexpr int CHUNKS_PER_THREAD = 16;
+
+    /** Get the number of processors available to the process */
+    int getNumProcessors();
+
+    /** Get the number of threads of the next parallel region */
+    int getMaxThreads();
+
+    /**
+     * Split the points into contiguous chunks of similar cost, the size of their neighbourhood plus one
+     * @param neighbourhoodMatrix Neighbourhood of every point
+     * @param numChunks Number of chunks, 0 for CHUNKS_PER_THREAD per thread
+     * @return First point of every chunk followed by the number of points
+     */
+    std::vector<int> partitionByCost(const NeighbourhoodMatrix& neighbourhoodMatrix, int numChunks = 0);
+
+    /** Call \p visit for every point in parallel, in chunks of similar neighbourhood size */
+    template<typename Visit>
+    void forEachPoint(const NeighbourhoodMatrix& neighbourhoodMatrix, Visit visit)
+    {
+        const std::vector<int> chunks = partitionByCost(neighbourhoodMatrix);
+        const int numChunks = static_cast<int>(chunks.size()) - 1;
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int c = 0; c < numChunks; c++)
+            for (int i = chunks[c]; i < chunks[c + 1]; i++)
+                visit(i);
+    }
+
+    /**
+     * Thread limit class
+     *
+     * Caps the number of threads of the parallel regions started by this thread while in scope
+     */
+    class ThreadLimit
+    {
+    public:
+        /** Cap the threads to \p numThreads, 0 keeps the current number */
+        explicit ThreadLimit(int numThreads);
+        ~ThreadLimit();
+
+        ThreadLimit(const ThreadLimit&) = delete;
+        ThreadLimit& operator=(const ThreadLimit&) = delete;
+
+    private:
+        int     _previousThreads;   /** Number of threads before the cap, 0 when not capped */
+    };
+}
@@ -0,0 +1,113 @@
+#include "PointOrder.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+    /** Spread the lower 16 bits of \p x to the even bits */
+    std::uint32_t spreadBits(std::uint32_t x)
+    {
+        x &= 0x0000FFFF;
+        x = (x | (x << 8)) & 0x00FF00FF;
+        x = (x | (x << 4)) & 0x0F0F0F0F;
+        x = (x | (x << 2)) & 0x33333333;
+        x = (x | (x << 1)) & 0x55555555;
+
+        return x;
+    }
+
+    /** Quantize \p value within [minValue, minValue + extent] to MORTON_BITS bits */
+    std::uint32_t quantize(float value, float minValue, float extent)
+    {
+        constexpr float maxCell = static_cast<float>((1 << PointOrder::MORTON_BITS) - 1);
+
+        if (!(extent > 0))
+            return 0;
+
+        return static_cast<std::uint32_t>(std::clamp((value - minValue) / extent, 0.0f, 1.0f) * maxCell);
+    }
+}
+
+PointOrder::PointOrder()
+{
+
+}
+
+void PointOrder::computeMorton(const DataMatrix& projection, int xDim, int yDim)
+{
+    TRACE_SCOPE("PointOrder::computeMorton");
+
+    const int numPoints = static_cast<int>(projection.rows());
+
+    clear();
+
+    if (numPoints == 0)
+        return;
+
+    const float minX = projection.col(xDim).minCoeff();
+    const float minY = projection.col(yDim).minCoeff();
+    const float extentX = projection.col(xDim).maxCoeff() - minX;
+    const float extentY = projection.col(yDim).maxCoeff() - minY;
+
+    // Morton code in the upper half and the original index in the lower half, so ties keep their order
+    std::vector<std::uint64_t> keys(numPoints);
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < numPoints; i++)
+    {
+        const std::uint32_t code = spreadBits(quantize(projection(i, xDim), minX, extentX)) | (spreadBits(quantize(projection(i, yDim), minY, extentY)) << 1);
+
+        keys[i] = (static_cast<std::uint64_t>(code) << 32) | static_cast<std::uint32_t>(i);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    _order.resize(numPoints);
+    _slots.resize(numPoints);
+
+    for (int i = 0; i < numPoints; i++)
+    {
+        _order[i] = static_cast<int>(keys[i] & 0xFFFFFFFF);
+        _slots[_order[i]] = i;
+    }
+}
+
+void PointOrder::clear()
+{
+    _order = std::vector<int>();
+    _slots = std::vector<int>();
+}
+
+std::vector<unsigned int> PointOrder::toInternal(const std::vector<unsigned int>& indices) const
+{
+    std::vector<unsigned int> internalIndices(indices.size());
+    for (std::size_t s = 0; s < indices.size(); s++)
+        internalIndices[s] = static_cast<unsigned int>(toInternal(static_cast<int>(indices[s])));
+
+    std::sort(internalIndices.begin(), internalIndices.end());
+
+    return internalIndices;
+}
+
+DataMatrix PointOrder::permuteRows(const DataMatrix& matrix) const
+{
+    if (isIdentity())
+        return matrix;
+
+    DataMatrix permuted(matrix.rows(), matrix.cols());
+
+    // Column by column, the matrices are column-major
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < static_cast<int>(matrix.cols()); j++)
+        for (int i = 0; i < static_cast<int>(matrix.rows()); i++)
+            permuted(i, j) = matrix(_order[i], j);
+
+    return permuted;
+}
+
+std::size_t PointOrder::getMemoryUsage() const
+{
+    return (_order.capacity() + _slots.capacity()) * sizeof(int);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "DataTypes.h"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Point order class
+ *
+ * Permutation of the points by the Morton (Z-order) code of their position in the projection.
+ * Neighbourhoods are gathered from the rows of the data in the order of the neighbour indices,
+ * which follow the arbitrary order of the dataset. Stored in Morton order, points that are close
+ * in the projection are close in memory, so the gathers of the local statistics and confidences
+ * touch few cache lines instead of jumping through the whole N×D table.
+ *
+ * The core only sees the internal order: the data, the projection, the neighbourhoods and all
+ * per-point results are in that order. The adapter maps between the two orders where points
+ * cross into ManiVault: selection indices are mapped to the internal order, per-point results
+ * (e.g. colors) back to the original order. An empty order is the identity.
+ */
+class PointOrder
+{
+public:
+    /** Bits per axis of the Morton codes, the projection is quantized to a 2^16 × 2^16 grid */
+    static constexpr int MORTON_BITS = 16;
+
+    PointOrder();
+
+    /**
+     * Order the points by the Morton code of their position, ties keep their original order
+     * @param projection Projection matrix, one row per point in the original order
+     * @param xDim Projection dimension of the x-axis
+     * @param yDim Projection dimension of the y-axis
+     */
+    void computeMorton(const DataMatrix& projection, int xDim, int yDim);
+
+    /** Reset to the identity */
+    void clear();
+
+    bool isIdentity() const { return _order.empty(); }
+    int numPoints() const { return static_cast<int>(_order.size()); }
+
+    /** Get the original index of internal point \p i */
+    int toOriginal(int i) const { return isIdentity() ? i : _order[i]; }
+
+    /** Get the internal index of original point \p i */
+    int toInternal(int i) const { return isIdentity() ? i : _slots[i]; }
+
+    /** Map original indices (e.g. a selection) to internal indices, in ascending order */
+    std::vector<unsigned int> toInternal(const std::vector<unsigned int>& indices) const;
+
+    /** Get the rows of \p matrix in the internal order */
+    DataMatrix permuteRows(const DataMatrix& matrix) const;
+
+    /** Move per-point values in the original order to the internal order */
+    template<typename T>
+    std::vector<T> toInternalOrder(const std::vector<T>& values) const
+    {
+        if (isIdentity())
+            return values;
+
+        std::vector<T> permuted(values.size());
+        for (std::size_t i = 0; i < values.size(); i++)
+            permuted[i] = values[_order[i]];
+
+        return permuted;
+    }
+
+    /** Move per-point values in the internal order back to the original order */
+    template<typename T>
+    std::vector<T> toOriginalOrder(const std::vector<T>& values) const
+    {
+        if (isIdentity())
+            return values;
+
+        std::vector<T> permuted(values.size());
+        for (std::size_t i = 0; i < values.size(); i++)
+            permuted[_order[i]] = values[i];
+
+        return permuted;
+    }
+
+    /** Get the original index of every internal point, empty for the identity */
+    const std::vector<int>& getOrder() const { return _order; }
+
+    /** Get the number of bytes held by the index maps */
+    std::size_t getMemoryUsage() const;
+
+private:
+    std::vector<int>    _order;     /** Original index of every internal point */
+    std::vector<int>    _slots;     /** Internal index of every original point, the inverse of _order */
+};
@@ -0,0 +1,187 @@
+#include "SelectionStatistics.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace
+{
+    /** Generation of the last computation of any statistics */
+    std::atomic<std::uint64_t> lastGeneration(0);
+}
+
+SelectionStatistics::SelectionStatistics(int numBins) :
+    _numBins(numBins),
+    _generation(0)
+{
+
+}
+
+void SelectionStatistics::compute(const DataTable& dataset, const std::vector<unsigned int>& selection, const DataStatistics& dataStats)
+{
+    TRACE_SCOPE("SelectionStatistics::compute");
+
+    int numDimensions = dataset.numDimensions();
+    int numSelected = static_cast<int>(selection.size());
+
+    _generation = ++lastGeneration;
+    _selection = selection;
+
+    _means.assign(numDimensions, 0);
+    _variances.assign(numDimensions, 0);
+    _minValues.assign(numDimensions, 0);
+    _maxValues.assign(numDimensions, 0);
+
+    if (numSelected == 0)
+        return;
+
+    if (dataset.isSparse())
+    {
+        computeSparse(dataset, dataStats);
+        return;
+    }
+
+    // The dataset is stored column-major, so every thread takes whole dimensions and streams through its column,
+    // which needs no reduction of per-thread accumulators and reads every selected value exactly once
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < numDimensions; j++)
+    {
+        // Accumulate relative to the global mean in double precision to avoid cancellation in the variance
+        const double shift = dataStats.means[j];
+
+        double sum = 0;
+        double sumSquares = 0;
+        float minValue = std::numeric_limits<float>::max();
+        float maxValue = -std::numeric_limits<float>::max();
+
+        for (int i = 0; i < numSelected; i++)
+        {
+            float value = dataset(selection[i], j);
+
+            double x = value - shift;
+            sum += x;
+            sumSquares += x * x;
+
+            if (value < minValue) minValue = value;
+            if (value > maxValue) maxValue = value;
+        }
+
+        double mean = sum / numSelected;
+
+        _means[j] = static_cast<float>(shift + mean);
+        _variances[j] = static_cast<float>(std::max(0.0, sumSquares / numSelected - mean * mean));
+        _minValues[j] = minValue;
+        _maxValues[j] = maxValue;
+    }
+}
+
+void SelectionStatistics::computeSparse(const DataTable& dataset, const DataStatistics& dataStats)
+{
+    int numDimensions = dataset.numDimensions();
+    int numSelected = static_cast<int>(_selection.size());
+
+    // Same shifted accumulation as the dense pass, but row by row over the stored values only
+    std::vector<double> sums(numDimensions, 0);
+    std::vector<double> sumSquares(numDimensions, 0);
+    std::vector<int> counts(numDimensions, 0);
+
+    _minValues.assign(numDimensions, std::numeric_limits<float>::max());
+    _maxValues.assign(numDimensions, -std::numeric_limits<float>::max());
+
+    for (const unsigned int i : _selection)
+    {
+        dataset.forEachNonZero(i, [&](int j, float value) {
+            double x = value - static_cast<double>(dataStats.means[j]);
+            sums[j] += x;
+            sumSquares[j] += x * x;
+            counts[j]++;
+
+            if (value < _minValues[j]) _minValues[j] = value;
+            if (value > _maxValues[j]) _maxValues[j] = value;
+        });
+    }
+
+    for (int j = 0; j < numDimensions; j++)
+    {
+        const double shift = dataStats.means[j];
+
+        // Every implicit zero deviates by minus the shift
+        const int numZeros = numSelected - counts[j];
+
+        if (numZeros > 0)
+        {
+            sums[j] -= numZeros * shift;
+            sumSquares[j] += numZeros * shift * shift;
+
+            _minValues[j] = std::min(_minValues[j], 0.0f);
+            _maxValues[j] = std::max(_maxValues[j], 0.0f);
+        }
+
+        double mean = sums[j] / numSelected;
+
+        _means[j] = static_cast<float>(shift + mean);
+        _variances[j] = static_cast<float>(std::max(0.0, sumSquares[j] / numSelected - mean * mean));
+    }
+}
+
+void SelectionStatistics::computeHistograms(const DataTable& dataset, const DataStatistics& dataStats, const std::vector<int>& dims, std::vector<int>& bins) const
+{
+    TRACE_SCOPE("SelectionStatistics::computeHistograms");
+
+    const int numDims = static_cast<int>(dims.size());
+
+    bins.assign(static_cast<std::size_t>(numDims) * _numBins, 0);
+
+    if (dataset.isSparse())
+    {
+        // Row-wise over the stored values, so map every dimension to its histogram and count the implicit zeros afterwards
+        std::vector<int> histogramOf(dataset.numDimensions(), -1);
+        for (int d = 0; d < numDims; d++)
+            histogramOf[dims[d]] = d;
+
+        std::vector<int> counts(numDims, 0);
+
+        for (const unsigned int i : _selection)
+        {
+            dataset.forEachNonZero(i, [&](int j, float value) {
+                const int d = histogramOf[j];
+                if (d < 0)
+                    return;
+
+                bins[static_cast<std::size_t>(d) * _numBins + binOf(dataStats, j, value)]++;
+                counts[d]++;
+            });
+        }
+
+        for (int d = 0; d < numDims; d++)
+            bins[static_cast<std::size_t>(d) * _numBins + binOf(dataStats, dims[d], 0)] += numPoints() - counts[d];
+
+        return;
+    }
+
+    for (int d = 0; d < numDims; d++)
+    {
+        const int j = dims[d];
+        int* dimBins = bins.data() + static_cast<std::size_t>(d) * _numBins;
+
+        for (const unsigned int i : _selection)
+            dimBins[binOf(dataStats, j, dataset(i, j))]++;
+    }
+}
+
+int SelectionStatistics::binOf(const DataStatistics& dataStats, int dim, float value) const
+{
+    const float binScale = dataStats.maxRange[dim] > dataStats.minRange[dim] ? _numBins / (dataStats.maxRange[dim] - dataStats.minRange[dim]) : 0;
+
+    return std::clamp(static_cast<int>((value - dataStats.minRange[dim]) * binScale), 0, _numBins - 1);
+}
+
+void SelectionStatistics::clear()
+{
+    _selection.clear();
+    _means.clear();
+    _variances.clear();
+    _minValues.clear();
+    _maxValues.clear();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "DataTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Selection statistics class
+ *
+ * Per-dimension statistics of a selection of points: mean, variance, minimum and maximum. The
+ * moments of all dimensions are accumulated in a single fused pass over the selected values, so
+ * that the ranking methods, the bar chart and the differential view share one computation
+ * instead of each traversing the selection. Histograms over the global range of a dimension are
+ * only binned on request, for the dimensions that are shown.
+ *
+ * Every computation gets a new generation, so that holders of the statistics can tell whether
+ * they changed without comparing selections.
+ */
+class SelectionStatistics
+{
+public:
+    SelectionStatistics(int numBins = 20);
+
+    /**
+     * Compute the moments of all dimensions over the selection
+     * @param dataset Dataset to compute the statistics on
+     * @param selection Row indices of the selected points
+     * @param dataStats Global statistics of the dataset
+     */
+    void compute(const DataTable& dataset, const std::vector<unsigned int>& selection, const DataStatistics& dataStats);
+
+    /**
+     * Bin the selected values of \p dims into histograms over the global range of the dimensions
+     * @param dataset Dataset the statistics were computed on
+     * @param dataStats Global statistics of the dataset
+     * @param dims Dimensions to bin
+     * @param bins Receives numBins() consecutive bins per dimension of \p dims
+     */
+    void computeHistograms(const DataTable& dataset, const DataStatistics& dataStats, const std::vector<int>& dims, std::vector<int>& bins) const;
+
+    /** Clear all statistics */
+    void clear();
+
+    int numDimensions() const { return static_cast<int>(_means.size()); }
+    int numPoints() const { return static_cast<int>(_selection.size()); }
+    int numBins() const { return _numBins; }
+
+    /** Get the generation of the computation, unique over all statistics, 0 when never computed */
+    std::uint64_t getGeneration() const { return _generation; }
+
+    /** Get the selection the statistics were computed on */
+    const std::vector<unsigned int>& getSelection() const { return _selection; }
+
+    float getMean(int dim) const { return _means[dim]; }
+    float getVariance(int dim) const { return _variances[dim]; }
+    float getMin(int dim) const { return _minValues[dim]; }
+    float getMax(int dim) const { return _maxValues[dim]; }
+
+    const std::vector<float>& getMeans() const { return _means; }
+    const std::vector<float>& getVariances() const { return _variances; }
+
+private:
+    /** Accumulate the statistics of sparse data over the stored values of the selected rows */
+    void computeSparse(const DataTable& dataset, const DataStatistics& dataStats);
+
+    /** Get the histogram bin of \p value of dimension \p dim */
+    int binOf(const DataStatistics& dataStats, int dim, float value) const;
+
+private:
+    int                         _numBins;               /** Number of histogram bins per dimension */
+    std::uint64_t               _generation;            /** Generation of the last computation */
+    std::vector<unsigned int>   _selection;             /** Selection the statistics were computed on */
+    std::vector<float>          _means;                 /** Mean of every dimension over the selection */
+    std::vector<float>          _variances;             /** Population variance of every dimension over the selection */
+    std::vector<float>          _minValues;             /** Minimum of every dimension over the selection */
+    std::vector<float>          _maxValues;             /** Maximum of every dimension over the selection */
+};
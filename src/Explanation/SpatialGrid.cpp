@@ -0,0 +1,210 @@
+#include "SpatialGrid.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace
+{
+    /** Upper bound on the number of cells along an axis, limits the grid for very elongated projections */
+    constexpr int MAX_CELLS_PER_AXIS = 4096;
+}
+
+SpatialGrid::SpatialGrid() :
+    _minX(0),
+    _minY(0),
+    _cellSize(1),
+    _numCellsX(1),
+    _numCellsY(1)
+{
+
+}
+
+void SpatialGrid::build(const DataMatrix& projection, int xDim, int yDim, int pointsPerCell)
+{
+    TRACE_SCOPE("SpatialGrid::build");
+
+    const int numPoints = static_cast<int>(projection.rows());
+
+    clear();
+
+    if (numPoints == 0)
+        return;
+
+    _minX = projection.col(xDim).minCoeff();
+    _minY = projection.col(yDim).minCoeff();
+
+    const float extentX = projection.col(xDim).maxCoeff() - _minX;
+    const float extentY = projection.col(yDim).maxCoeff() - _minY;
+
+    // Square cells that hold pointsPerCell points on average over the bounding box
+    const double numCells = std::max(1.0, static_cast<double>(numPoints) / std::max(1, pointsPerCell));
+    const double area = static_cast<double>(extentX) * extentY;
+
+    if (area > 0)
+        _cellSize = static_cast<float>(std::sqrt(area / numCells));
+    else if (std::max(extentX, extentY) > 0)
+        _cellSize = static_cast<float>(std::max(extentX, extentY) / numCells);
+    else
+        _cellSize = 1;
+
+    // Coarsen the cells when an axis would get too many
+    _cellSize = std::max({ _cellSize, extentX / MAX_CELLS_PER_AXIS, extentY / MAX_CELLS_PER_AXIS });
+
+    _numCellsX = std::min(MAX_CELLS_PER_AXIS, static_cast<int>(extentX / _cellSize) + 1);
+    _numCellsY = std::min(MAX_CELLS_PER_AXIS, static_cast<int>(extentY / _cellSize) + 1);
+
+    sortByCell(projection, xDim, yDim);
+}
+
+void SpatialGrid::update(const DataMatrix& projection, int xDim, int yDim, const std::vector<int>& points)
+{
+    TRACE_SCOPE("SpatialGrid::update");
+
+    bool changedCells = false;
+
+    // Points that stay in their cell only get new coordinates
+    for (const int i : points)
+    {
+        const int slot = _slots[i];
+        const int cell = cellY(projection(i, yDim)) * _numCellsX + cellX(projection(i, xDim));
+
+        _xs[slot] = projection(i, xDim);
+        _ys[slot] = projection(i, yDim);
+
+        if (slot < _cellStarts[cell] || slot >= _cellStarts[cell + 1])
+            changedCells = true;
+    }
+
+    if (changedCells)
+        sortByCell(projection, xDim, yDim);
+}
+
+void SpatialGrid::sortByCell(const DataMatrix& projection, int xDim, int yDim)
+{
+    const int numPoints = static_cast<int>(projection.rows());
+
+    // Counting sort of the points by cell
+    std::vector<int> cells(numPoints);
+    _cellStarts.assign(static_cast<std::size_t>(_numCellsX) * _numCellsY + 1, 0);
+
+    for (int i = 0; i < numPoints; i++)
+    {
+        cells[i] = cellY(projection(i, yDim)) * _numCellsX + cellX(projection(i, xDim));
+        _cellStarts[cells[i] + 1]++;
+    }
+
+    for (std::size_t c = 1; c < _cellStarts.size(); c++)
+        _cellStarts[c] += _cellStarts[c - 1];
+
+    _points.resize(numPoints);
+    _xs.resize(numPoints);
+    _ys.resize(numPoints);
+    _slots.resize(numPoints);
+
+    std::vector<int> offsets(_cellStarts.begin(), _cellStarts.end() - 1);
+
+    for (int i = 0; i < numPoints; i++)
+    {
+        const int p = offsets[cells[i]]++;
+
+        _points[p] = i;
+        _slots[i] = p;
+        _xs[p] = projection(i, xDim);
+        _ys[p] = projection(i, yDim);
+    }
+}
+
+void SpatialGrid::clear()
+{
+    _cellStarts = std::vector<int>();
+    _points = std::vector<int>();
+    _xs = std::vector<float>();
+    _ys = std::vector<float>();
+    _slots = std::vector<int>();
+}
+
+float SpatialGrid::findKthNearestDistance(const DataMatrix& projection, int centerId, int k, int xDim, int yDim) const
+{
+    const float x = projection(centerId, xDim);
+    const float y = projection(centerId, yDim);
+
+    const int cx = cellX(x);
+    const int cy = cellY(y);
+
+    // Max-heap of the k smallest squared distances so far
+    std::priority_queue<float> nearest;
+
+    const auto visitCell = [&](int rx, int ry) -> void {
+        if (rx < 0 || rx >= _numCellsX || ry < 0 || ry >= _numCellsY)
+            return;
+
+        const int cell = ry * _numCellsX + rx;
+
+        for (int p = _cellStarts[cell]; p < _cellStarts[cell + 1]; p++)
+        {
+            if (_points[p] == centerId)
+                continue;
+
+            const float xd = _xs[p] - x;
+            const float yd = _ys[p] - y;
+
+            const float magSquared = xd * xd + yd * yd;
+
+            if (static_cast<int>(nearest.size()) < k)
+                nearest.push(magSquared);
+            else if (magSquared < nearest.top())
+            {
+                nearest.pop();
+                nearest.push(magSquared);
+            }
+        }
+    };
+
+    const int maxRing = std::max(_numCellsX, _numCellsY);
+
+    for (int ring = 0; ring <= maxRing; ring++)
+    {
+        // Visit the cells on the border of the square ring
+        for (int rx = cx - ring; rx <= cx + ring; rx++)
+        {
+            visitCell(rx, cy - ring);
+
+            if (ring > 0)
+                visitCell(rx, cy + ring);
+        }
+
+        for (int ry = cy - ring + 1; ry <= cy + ring - 1; ry++)
+        {
+            visitCell(cx - ring, ry);
+            visitCell(cx + ring, ry);
+        }
+
+        // Points beyond the next ring are at least ring cells away from the center
+        if (static_cast<int>(nearest.size()) == k)
+        {
+            const float bound = ring * _cellSize;
+
+            if (nearest.top() <= bound * bound)
+                break;
+        }
+    }
+
+    return nearest.empty() ? 0.0f : std::sqrt(nearest.top());
+}
+
+std::size_t SpatialGrid::getMemoryUsage() const
+{
+    return (_cellStarts.capacity() + _points.capacity() + _slots.capacity()) * sizeof(int) + (_xs.capacity() + _ys.capacity()) * sizeof(float);
+}
+
+int SpatialGrid::cellX(float x) const
+{
+    return std::clamp(static_cast<int>(std::floor((x - _minX) / _cellSize)), 0, _numCellsX - 1);
+}
+
+int SpatialGrid::cellY(float y) const
+{
+    return std::clamp(static_cast<int>(std::floor((y - _minY) / _cellSize)), 0, _numCellsY - 1);
+}
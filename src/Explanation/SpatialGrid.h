@@ -0,0 +1,117 @@
+#pragma once
+
+#include "DataTypes.h"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Spatial grid class
+ *
+ * Uniform bucket grid over two axes of the projection. The points are sorted by cell once
+ * (counting sort), with their coordinates stored in cell order, so a query only visits the
+ * cells that overlap its circle instead of all points. The cell size is chosen to hold a few
+ * points per cell on average.
+ *
+ * Moved points can be updated without rebuilding the grid: its bounds and cell size are kept,
+ * points outside the bounds are kept in the border cells, which keeps the queries exact.
+ */
+class SpatialGrid
+{
+public:
+    SpatialGrid();
+
+    /**
+     * Bucket the points of the projection
+     * @param projection Projection matrix, one row per point
+     * @param pointsPerCell Average number of points per cell
+     */
+    void build(const DataMatrix& projection, int xDim, int yDim, int pointsPerCell = 4);
+
+    /**
+     * Update the coordinates of moved points, keeping the bounds and the cell size of the grid
+     * @param points Indices of the points whose coordinates in \p projection changed
+     */
+    void update(const DataMatrix& projection, int xDim, int yDim, const std::vector<int>& points);
+
+    void clear();
+
+    bool isEmpty() const { return _points.empty(); }
+    float getCellSize() const { return _cellSize; }
+
+    /** Get the number of cells, numbered row by row */
+    int numCells() const { return _cellStarts.empty() ? 0 : static_cast<int>(_cellStarts.size()) - 1; }
+
+    /**
+     * Visit all points of cell \p cell
+     * @param visit Called with the point index
+     */
+    template<typename Visitor>
+    void forEachInCell(int cell, Visitor&& visit) const
+    {
+        for (int p = _cellStarts[cell]; p < _cellStarts[cell + 1]; p++)
+            visit(_points[p]);
+    }
+
+    /**
+     * Visit all points within \p radius of the position (\p x, \p y)
+     * @param visit Called with the point index and its squared distance, in no particular order
+     */
+    template<typename Visitor>
+    void forEachInRadius(float x, float y, float radius, Visitor&& visit) const
+    {
+        const float radSquared = radius * radius;
+
+        const int cx0 = cellX(x - radius), cx1 = cellX(x + radius);
+        const int cy0 = cellY(y - radius), cy1 = cellY(y + radius);
+
+        for (int cy = cy0; cy <= cy1; cy++)
+        {
+            for (int cx = cx0; cx <= cx1; cx++)
+            {
+                const int cell = cy * _numCellsX + cx;
+
+                for (int p = _cellStarts[cell]; p < _cellStarts[cell + 1]; p++)
+                {
+                    const float xd = _xs[p] - x;
+                    const float yd = _ys[p] - y;
+
+                    const float magSquared = xd * xd + yd * yd;
+
+                    if (magSquared <= radSquared)
+                        visit(_points[p], magSquared);
+                }
+            }
+        }
+    }
+
+    /**
+     * Find the distance from the point \p centerId to its k-th nearest other point
+     * @param k Rank of the neighbour, 1 for the nearest neighbour
+     * @return Distance in projection units, the largest distance when there are fewer than k other points
+     */
+    float findKthNearestDistance(const DataMatrix& projection, int centerId, int k, int xDim, int yDim) const;
+
+    /** Get the number of bytes held by the grid */
+    std::size_t getMemoryUsage() const;
+
+private:
+    int cellX(float x) const;
+    int cellY(float y) const;
+
+    /** Counting sort of the points into the cells of the current geometry */
+    void sortByCell(const DataMatrix& projection, int xDim, int yDim);
+
+private:
+    float               _minX;          /** Lower bound of the grid along the x-axis */
+    float               _minY;          /** Lower bound of the grid along the y-axis */
+    float               _cellSize;      /** Side of a square cell in projection units */
+    int                 _numCellsX;     /** Number of cells along the x-axis */
+    int                 _numCellsY;     /** Number of cells along the y-axis */
+
+    std::vector<int>    _cellStarts;    /** Offset of the first point of every cell, one extra entry for the end */
+    std::vector<int>    _points;        /** Point indices in cell order */
+    std::vector<float>  _xs;            /** X-coordinates in cell order */
+    std::vector<float>  _ys;            /** Y-coordinates in cell order */
+    std::vector<int>    _slots;         /** Position of every point in cell order, the inverse of _points */
+};
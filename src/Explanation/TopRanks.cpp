@@ -0,0 +1,608 @@
+#include "TopRanks.h"
+#include "SpatialGrid.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+namespace
+{
+    /** A scored dimension, the candidates of the top K of a point */
+    using Candidate = std::pair<double, int>;
+
+    /** Mask of the included dimensions (see DataTable::getIncludedDimensions), for the loops over all dimensions */
+    std::vector<char> findIncludedDimensions(const DataTable& dataset, int& numIncluded)
+    {
+        const std::vector<int> includedDims = dataset.getIncludedDimensions();
+
+        std::vector<char> included(dataset.numDimensions(), 0);
+        for (const int j : includedDims)
+            included[j] = 1;
+
+        numIncluded = static_cast<int>(includedDims.size());
+
+        return included;
+    }
+
+    /**
+     * Means of the \p blockSize ascending dimensions \p dims over the neighbourhood, and their variances unless
+     * \p variances is null. Sparse rows only visit their stored values within the block, a dimension with count
+     * stored values holds neighbourhood.size() - count implicit zeros, which each deviate by the mean.
+     */
+    void computeBlockStatistics(const DataTable& dataset, const Neighbourhood& neighbourhood, const int* dims, int blockSize, std::vector<double>& means, std::vector<double>* variances)
+    {
+        const double numNeighbours = static_cast<double>(neighbourhood.size());
+
+        if (dataset.isSparse())
+        {
+            // Position of every dimension in the block, -1 for dimensions outside the block
+            thread_local std::vector<int> slots;
+            thread_local std::vector<int> counts;
+
+            if (static_cast<int>(slots.size()) < dataset.numDimensions())
+                slots.assign(dataset.numDimensions(), -1);
+
+            for (int b = 0; b < blockSize; b++)
+                slots[dims[b]] = b;
+
+            counts.assign(blockSize, 0);
+            std::fill(means.begin(), means.begin() + blockSize, 0.0);
+
+            const int begin = dims[0];
+            const int end = dims[blockSize - 1] + 1;
+
+            for (const int ni : neighbourhood)
+            {
+                dataset.forEachNonZero(ni, begin, end, [&](int j, float value) {
+                    const int b = slots[j];
+                    if (b < 0) return;
+
+                    means[b] += value;
+                    counts[b]++;
+                });
+            }
+
+            for (int b = 0; b < blockSize; b++)
+                means[b] /= numNeighbours;
+
+            if (variances != nullptr)
+            {
+                std::fill(variances->begin(), variances->begin() + blockSize, 0.0);
+
+                for (const int ni : neighbourhood)
+                {
+                    dataset.forEachNonZero(ni, begin, end, [&](int j, float value) {
+                        const int b = slots[j];
+                        if (b < 0) return;
+
+                        const double x = value - means[b];
+                        (*variances)[b] += x * x;
+                    });
+                }
+
+                for (int b = 0; b < blockSize; b++)
+                    (*variances)[b] = ((*variances)[b] + (numNeighbours - counts[b]) * means[b] * means[b]) / numNeighbours;
+            }
+
+            for (int b = 0; b < blockSize; b++)
+                slots[dims[b]] = -1;
+
+            return;
+        }
+
+        // Dense columns are accumulated in single precision, like the local statistics of the methods
+        for (int b = 0; b < blockSize; b++)
+        {
+            const int j = dims[b];
+
+            // Compute mean
+            float mean = 0;
+            for (const int ni : neighbourhood)
+                mean += dataset(ni, j);
+            mean /= numNeighbours;
+
+            means[b] = mean;
+
+            if (variances == nullptr)
+                continue;
+
+            // Compute variance
+            float variance = 0;
+            for (const int ni : neighbourhood)
+            {
+                const float x = dataset(ni, j) - mean;
+                variance += x * x;
+            }
+
+            (*variances)[b] = variance / numNeighbours;
+        }
+    }
+
+    /** Bounds on the scores of every dimension that hold at all points of a cell */
+    struct CellBounds
+    {
+        std::vector<double> lower;      /** Lower bound on the score of every dimension */
+        std::vector<double> upper;      /** Upper bound on the score of every dimension */
+        std::vector<double> estimate;   /** Score over the union of the neighbourhoods, clamped to the bounds */
+    };
+
+    /**
+     * Bound the scores of the points of a cell from the union and the intersection of their neighbourhoods,
+     * each neighbourhood holds the intersection and lies within the union
+     * @return Whether any point of the cell has neighbours, the bounds are left unchanged otherwise
+     */
+    bool computeCellBounds(const DataTable& dataset, const DataStatistics& dataStats, const std::vector<double>& globalVariances, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& cellPoints, bool lowRankBest, CellBounds& bounds)
+    {
+        const int numDimensions = dataset.numDimensions();
+
+        thread_local std::vector<int> members, common, others;
+        members.clear();
+        common.clear();
+        others.clear();
+
+        int numNeighbourhoods = 0;
+        std::size_t minSize = std::numeric_limits<std::size_t>::max(), maxSize = 0;
+
+        for (const int i : cellPoints)
+        {
+            const Neighbourhood& neighbourhood = neighbourhoodMatrix[i];
+            if (neighbourhood.empty()) continue;
+
+            members.insert(members.end(), neighbourhood.begin(), neighbourhood.end());
+            minSize = std::min(minSize, neighbourhood.size());
+            maxSize = std::max(maxSize, neighbourhood.size());
+            numNeighbourhoods++;
+        }
+
+        if (numNeighbourhoods == 0)
+            return false;
+
+        // Members that occur in every neighbourhood form the intersection
+        std::sort(members.begin(), members.end());
+
+        for (std::size_t m = 0; m < members.size(); )
+        {
+            std::size_t next = m + 1;
+            while (next < members.size() && members[next] == members[m]) next++;
+
+            if (static_cast<int>(next - m) == numNeighbourhoods)
+                common.push_back(members[m]);
+            else
+                others.push_back(members[m]);
+
+            m = next;
+        }
+
+        const int numCommon = static_cast<int>(common.size());
+        const int numUnion = numCommon + static_cast<int>(others.size());
+        const int numOthers = numUnion - numCommon;
+        const double minNeighbours = static_cast<double>(minSize);
+        const double maxNeighbours = static_cast<double>(maxSize);
+
+        // Sums over the intersection and the union, and the range of the union
+        thread_local std::vector<double> commonSums, commonSquares, unionSums, unionSquares;
+        thread_local std::vector<float> minima, maxima;
+
+        commonSums.assign(numDimensions, 0.0);
+        commonSquares.assign(numDimensions, 0.0);
+        unionSums.assign(numDimensions, 0.0);
+        unionSquares.assign(numDimensions, 0.0);
+        minima.assign(numDimensions, std::numeric_limits<float>::max());
+        maxima.assign(numDimensions, std::numeric_limits<float>::lowest());
+
+        if (dataset.isSparse())
+        {
+            thread_local std::vector<int> counts;
+            counts.assign(numDimensions, 0);
+
+            const auto accumulate = [&](int u, bool isCommon) -> void {
+                dataset.forEachNonZero(u, [&](int j, float value) {
+                    const double x = value;
+
+                    minima[j] = std::min(minima[j], value);
+                    maxima[j] = std::max(maxima[j], value);
+                    unionSums[j] += x;
+                    unionSquares[j] += x * x;
+                    counts[j]++;
+
+                    if (isCommon)
+                    {
+                        commonSums[j] += x;
+                        commonSquares[j] += x * x;
+                    }
+                });
+            };
+
+            for (const int u : common)
+                accumulate(u, true);
+            for (const int u : others)
+                accumulate(u, false);
+
+            // Members without a stored value hold a zero
+            for (int j = 0; j < numDimensions; j++)
+            {
+                if (counts[j] == numUnion) continue;
+
+                minima[j] = std::min(minima[j], 0.0f);
+                maxima[j] = std::max(maxima[j], 0.0f);
+            }
+        }
+        else
+        {
+            for (int j = 0; j < numDimensions; j++)
+            {
+                float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+                double sum = 0, squares = 0;
+
+                for (const int u : common)
+                {
+                    const float value = dataset(u, j);
+                    lo = std::min(lo, value);
+                    hi = std::max(hi, value);
+                    sum += value;
+                    squares += static_cast<double>(value) * value;
+                }
+
+                commonSums[j] = sum;
+                commonSquares[j] = squares;
+
+                for (const int u : others)
+                {
+                    const float value = dataset(u, j);
+                    lo = std::min(lo, value);
+                    hi = std::max(hi, value);
+                    sum += value;
+                    squares += static_cast<double>(value) * value;
+                }
+
+                unionSums[j] = sum;
+                unionSquares[j] = squares;
+                minima[j] = lo;
+                maxima[j] = hi;
+            }
+        }
+
+        bounds.lower.resize(numDimensions);
+        bounds.upper.resize(numDimensions);
+        bounds.estimate.resize(numDimensions);
+
+        // The exact scores are accumulated in single precision, the bounds are widened by its rounding error
+        const double roundingError = 2.0 * maxNeighbours * FLT_EPSILON;
+
+        for (int j = 0; j < numDimensions; j++)
+        {
+            const double lo = minima[j];
+            const double hi = maxima[j];
+            const double maxMagnitude = std::max(std::abs(lo), std::abs(hi));
+            const double unionMean = unionSums[j] / numUnion;
+
+            if (lowRankBest)
+            {
+                // A neighbourhood scatters at least as much as the intersection around its own mean, and at most as much
+                // as the union around its mean, or by a quarter of the squared range of the union (Popoviciu's inequality)
+                const double commonScatter = numCommon > 0 ? std::max(0.0, commonSquares[j] - commonSums[j] * commonSums[j] / numCommon) : 0.0;
+                const double unionScatter = std::max(0.0, unionSquares[j] - unionSums[j] * unionSums[j] / numUnion);
+                const double unionVariance = unionScatter / numUnion;
+
+                const double lowerVariance = commonScatter / maxNeighbours;
+                const double upperVariance = std::min(unionScatter / minNeighbours, 0.25 * (hi - lo) * (hi - lo));
+                const double error = 2.0 * roundingError * maxMagnitude * maxMagnitude;
+
+                bounds.lower[j] = (lowerVariance - error) / globalVariances[j];
+                bounds.upper[j] = (upperVariance + error) / globalVariances[j];
+                bounds.estimate[j] = std::max(lowerVariance, std::min(unionVariance, upperVariance)) / globalVariances[j];
+            }
+            else
+            {
+                // A neighbourhood holds the intersection and n - c other members of the union, whose deviation from the
+                // mean m of the others is at most their range, and at most sqrt((n - c) * scatter of the others) (Cauchy-Schwarz)
+                const double otherSum = unionSums[j] - commonSums[j];
+                const double otherMean = numOthers > 0 ? otherSum / numOthers : 0.0;
+                const double otherScatter = numOthers > 0 ? std::max(0.0, unionSquares[j] - commonSquares[j] - otherSum * otherSum / numOthers) : 0.0;
+
+                const double commonDeviation = commonSums[j] - numCommon * otherMean;
+                const double otherDeviation = std::sqrt((maxNeighbours - numCommon) * otherScatter);
+
+                // A deviation of the sum moves the mean most in the smallest neighbourhood, towards the bound it extends
+                const auto extremeMean = [&](double deviation, bool upper) -> double {
+                    return otherMean + deviation / ((deviation >= 0) == upper ? minNeighbours : maxNeighbours);
+                };
+
+                const double lowerMean = std::max(lo + (commonSums[j] - numCommon * lo) / maxNeighbours, extremeMean(commonDeviation - otherDeviation, false));
+                const double upperMean = std::min(hi - (numCommon * hi - commonSums[j]) / maxNeighbours, extremeMean(commonDeviation + otherDeviation, true));
+                const double error = roundingError * maxMagnitude;
+
+                bounds.lower[j] = (lowerMean - error - dataStats.means[j]) / dataStats.ranges[j];
+                bounds.upper[j] = (upperMean + error - dataStats.means[j]) / dataStats.ranges[j];
+                bounds.estimate[j] = (std::max(lowerMean, std::min(unionMean, upperMean)) - dataStats.means[j]) / dataStats.ranges[j];
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Keep the dimensions that can enter the top K of a point of the cell: a dimension whose best possible score
+     * is worse than the K-th best of the worst possible scores is beaten by K dimensions at every point
+     * @param candidateDims Dimensions that are kept, in ascending order
+     * @return Sum of the estimated absolute scores of the other dimensions, excluded ones included
+     */
+    double pruneDimensions(const CellBounds& bounds, const std::vector<char>& included, bool lowRankBest, int k, std::vector<int>& candidateDims)
+    {
+        const int numDimensions = static_cast<int>(included.size());
+
+        // Scores are compared with the lower ones best
+        thread_local std::vector<double> worstScores;
+        worstScores.clear();
+
+        for (int j = 0; j < numDimensions; j++)
+            if (included[j]) worstScores.push_back(lowRankBest ? bounds.upper[j] : -bounds.lower[j]);
+
+        std::nth_element(worstScores.begin(), worstScores.begin() + (k - 1), worstScores.end());
+
+        const double threshold = worstScores[k - 1];
+
+        candidateDims.clear();
+
+        double prunedSum = 0;
+        for (int j = 0; j < numDimensions; j++)
+        {
+            const double bestScore = lowRankBest ? bounds.lower[j] : -bounds.upper[j];
+
+            if (included[j] && bestScore <= threshold)
+                candidateDims.push_back(j);
+            else
+                prunedSum += std::abs(bounds.estimate[j]);
+        }
+
+        return prunedSum;
+    }
+}
+
+TopRanks::TopRanks() :
+    _metric(Explanation::Metric::NONE),
+    _k(0),
+    _blockSize(DEFAULT_BLOCK_SIZE),
+    _prunedFraction(0)
+{
+
+}
+
+bool TopRanks::compute(const DataTable& dataset, const DataStatistics& dataStats, const NeighbourhoodMatrix& neighbourhoodMatrix, Explanation::Metric metric, int k, int blockSize)
+{
+    clear();
+
+    if (metric != Explanation::Metric::VARIANCE && metric != Explanation::Metric::VALUE)
+        return false;
+
+    TRACE_SCOPE("TopRanks::compute");
+
+    int numIncluded = 0;
+    const std::vector<char> included = findIncludedDimensions(dataset, numIncluded);
+
+    allocate(dataset.numPoints(), metric, k, numIncluded, blockSize);
+
+    const std::vector<double> globalVariances = dataStats.getNormalizingVariances();
+
+    std::vector<int> allDims(dataset.numDimensions());
+    std::iota(allDims.begin(), allDims.end(), 0);
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < dataset.numPoints(); i++)
+        computePoint(dataset, globalVariances, dataStats, allDims, included, i, neighbourhoodMatrix[i], 0.0);
+
+    return true;
+}
+
+bool TopRanks::computePruned(const DataTable& dataset, const DataStatistics& dataStats, const NeighbourhoodMatrix& neighbourhoodMatrix, const DataMatrix& projection, int xDim, int yDim, Explanation::Metric metric, int k, int blockSize)
+{
+    clear();
+
+    if (metric != Explanation::Metric::VARIANCE && metric != Explanation::Metric::VALUE)
+        return false;
+
+    TRACE_SCOPE("TopRanks::computePruned");
+
+    int numIncluded = 0;
+    const std::vector<char> included = findIncludedDimensions(dataset, numIncluded);
+
+    allocate(dataset.numPoints(), metric, k, numIncluded, blockSize);
+
+    const std::vector<double> globalVariances = dataStats.getNormalizingVariances();
+    const bool lowRankBest = _metric == Explanation::Metric::VARIANCE;
+
+    SpatialGrid cells;
+    cells.build(projection, xDim, yDim, PRUNING_POINTS_PER_CELL);
+
+    // Number of point and dimension pairs whose statistics are skipped
+    long long numPruned = 0;
+
+#pragma omp parallel for schedule(dynamic, 4) reduction(+:numPruned)
+    for (int cell = 0; cell < cells.numCells(); cell++)
+    {
+        thread_local std::vector<int> cellPoints, candidateDims;
+        thread_local CellBounds bounds;
+
+        cellPoints.clear();
+        cells.forEachInCell(cell, [&](int i) { cellPoints.push_back(i); });
+
+        if (cellPoints.empty())
+            continue;
+
+        // Points without neighbours rank all dimensions zero, without any statistics
+        double prunedSum = 0;
+        candidateDims.clear();
+
+        if (computeCellBounds(dataset, dataStats, globalVariances, neighbourhoodMatrix, cellPoints, lowRankBest, bounds))
+        {
+            prunedSum = pruneDimensions(bounds, included, lowRankBest, _k, candidateDims);
+            numPruned += static_cast<long long>(numIncluded - static_cast<int>(candidateDims.size())) * static_cast<long long>(cellPoints.size());
+        }
+
+        for (const int i : cellPoints)
+            computePoint(dataset, globalVariances, dataStats, candidateDims, included, i, neighbourhoodMatrix[i], prunedSum);
+    }
+
+    const double numPairs = static_cast<double>(dataset.numPoints()) * numIncluded;
+    _prunedFraction = numPairs > 0 ? static_cast<float>(numPruned / numPairs) : 0.0f;
+
+    TRACE_COUNTER("Pruned dimensions (%)", 100 * _prunedFraction);
+
+    return true;
+}
+
+bool TopRanks::update(const DataTable& dataset, const DataStatistics& dataStats, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points)
+{
+    int numIncluded = 0;
+    const std::vector<char> included = findIncludedDimensions(dataset, numIncluded);
+
+    // Excluding dimensions can leave fewer than K to keep
+    if (isEmpty() || numPoints() != dataset.numPoints() || numIncluded < _k)
+        return false;
+
+    TRACE_SCOPE("TopRanks::update");
+
+    const std::vector<double> globalVariances = dataStats.getNormalizingVariances();
+
+    // The cell bounds do not hold for the moved neighbourhoods, the points are updated over all dimensions
+    std::vector<int> allDims(dataset.numDimensions());
+    std::iota(allDims.begin(), allDims.end(), 0);
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int p = 0; p < static_cast<int>(points.size()); p++)
+        computePoint(dataset, globalVariances, dataStats, allDims, included, points[p], neighbourhoodMatrix[points[p]], 0.0);
+
+    return true;
+}
+
+void TopRanks::clear()
+{
+    _metric = Explanation::Metric::NONE;
+    _k = 0;
+    _prunedFraction = 0;
+    _dimensions = std::vector<int>();
+    _ranks = std::vector<float>();
+    _sums = std::vector<float>();
+}
+
+void TopRanks::allocate(int numPoints, Explanation::Metric metric, int k, int numIncluded, int blockSize)
+{
+    _metric = metric;
+    _k = std::clamp(k, 1, std::max(1, numIncluded));
+    _blockSize = std::max(1, blockSize);
+
+    TRACE_COUNTER("Top dimensions", _k);
+
+    _dimensions.resize(static_cast<std::size_t>(numPoints) * _k);
+    _ranks.resize(static_cast<std::size_t>(numPoints) * _k);
+    _sums.resize(numPoints);
+}
+
+void TopRanks::computePoint(const DataTable& dataset, const std::vector<double>& globalVariances, const DataStatistics& dataStats, const std::vector<int>& dims, const std::vector<char>& included, int i, const Neighbourhood& neighbourhood, double baseSum)
+{
+    const int numDimensions = dataset.numDimensions();
+    const int numDims = static_cast<int>(dims.size());
+    const bool lowRankBest = _metric == Explanation::Metric::VARIANCE;
+
+    // Better scores first, ties go to the lower dimension as in the full rank matrix
+    const auto better = [lowRankBest](const Candidate& a, const Candidate& b) -> bool {
+        if (a.first != b.first)
+            return lowRankBest ? a.first < b.first : a.first > b.first;
+
+        return a.second < b.second;
+    };
+
+    // The statistics of a block and the candidates are reused by the thread
+    thread_local std::vector<double> means, variances;
+    thread_local std::vector<Candidate> candidates;
+
+    means.resize(_blockSize);
+    variances.resize(_blockSize);
+    candidates.clear();
+
+    double sum = neighbourhood.empty() ? 0.0 : baseSum;
+
+    for (int begin = 0; begin < numDims && !neighbourhood.empty(); begin += _blockSize)
+    {
+        const int end = std::min(numDims, begin + _blockSize);
+
+        computeBlockStatistics(dataset, neighbourhood, dims.data() + begin, end - begin, means, lowRankBest ? &variances : nullptr);
+
+        for (int b = begin; b < end; b++)
+        {
+            const int j = dims[b];
+            const double score = lowRankBest ? variances[b - begin] / globalVariances[j] : (means[b - begin] - dataStats.means[j]) / dataStats.ranges[j];
+
+            sum += std::abs(score);
+
+            if (included[j])
+                candidates.emplace_back(score, j);
+        }
+
+        // Keep the best K of the block and the previous candidates, the rest of the block is discarded
+        if (static_cast<int>(candidates.size()) > _k)
+        {
+            std::nth_element(candidates.begin(), candidates.begin() + _k, candidates.end(), better);
+            candidates.resize(_k);
+        }
+    }
+
+    // Without neighbours all scores are zero
+    for (int j = 0; j < numDimensions && static_cast<int>(candidates.size()) < _k; j++)
+        if (included[j]) candidates.emplace_back(0.0, j);
+
+    std::sort(candidates.begin(), candidates.end(), better);
+
+    const std::size_t offset = static_cast<std::size_t>(i) * _k;
+
+    for (int r = 0; r < _k; r++)
+    {
+        _dimensions[offset + r] = candidates[r].second;
+        _ranks[offset + r] = sum > 0 ? static_cast<float>(candidates[r].first / sum) : 0.0f;
+    }
+
+    _sums[i] = static_cast<float>(sum);
+}
+
+bool TopRanks::findRank(int i, int j, float& rank) const
+{
+    const std::size_t offset = static_cast<std::size_t>(i) * _k;
+
+    for (int r = 0; r < _k; r++)
+    {
+        if (_dimensions[offset + r] == j)
+        {
+            rank = _ranks[offset + r];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<int> TopRanks::getTopDimensions() const
+{
+    std::vector<int> topDimensions(numPoints());
+    for (int i = 0; i < numPoints(); i++)
+        topDimensions[i] = getDimension(i, 0);
+
+    return topDimensions;
+}
+
+std::vector<int> TopRanks::computeTopCounts(int numDimensions) const
+{
+    std::vector<int> topCounts(numDimensions, 0);
+    for (int i = 0; i < numPoints(); i++)
+        topCounts[getDimension(i, 0)]++;
+
+    return topCounts;
+}
+
+std::size_t TopRanks::getMemoryUsage() const
+{
+    return _dimensions.capacity() * sizeof(int) + (_ranks.capacity() + _sums.capacity()) * sizeof(float);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "DataTypes.h"
+#include "Methods/ExplanationMethod.h"
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Top ranks class
+ *
+ * Sparse alternative to the N×D rank matrix for very high-dimensional data (e.g. 20,000 genes),
+ * where neither the local statistics nor the ranks of all dimensions fit in memory. Only the K
+ * best ranked dimensions of every point are kept, with their ranks and the sum of the absolute
+ * scores of all dimensions that normalizes them, so the memory is N·K instead of N·D.
+ *
+ * The local statistics of a point are computed over its neighbourhood in blocks of dimensions:
+ * the scores of a block are added to the normalization sum and merged into the top K of the
+ * point, then the block is discarded. Each thread only holds the statistics of one block.
+ *
+ * The ranks are those of the variance and value methods: the local variance over the global
+ * variance, or the local mean minus the global mean over the range, divided by the sum of the
+ * absolute scores of all dimensions (excluded ones included, as for the full rank matrix). Only
+ * dimensions that are not excluded are kept, so the ranks have to be recomputed when the
+ * exclusions change. The euclidean metric is not supported.
+ *
+ * Most dimensions of wide data cannot enter the top K of any point, computePruned skips their
+ * statistics. The points are grouped into cells of the projection and every neighbourhood of a
+ * cell holds the intersection of the neighbourhoods and lies within their union, which bounds
+ * the local variance and mean of every dimension at all points of the cell. A dimension whose
+ * best possible score is worse than the K-th best of the worst possible scores is pruned, the
+ * exact statistics are only computed for the remaining candidates. The top K dimensions and their
+ * scores are exact, the pruned dimensions only add an estimate (their score over the union of
+ * the cell) to the normalization sum, so the ranks are normalized approximately.
+ */
+class TopRanks
+{
+public:
+    /** Default number of dimensions whose statistics are computed at once */
+    static constexpr int DEFAULT_BLOCK_SIZE = 256;
+
+    /** Average number of points per cell whose dimensions are pruned together */
+    static constexpr int PRUNING_POINTS_PER_CELL = 2;
+
+    TopRanks();
+
+    /**
+     * Compute the top ranked dimensions of every point
+     * @param dataset High-dimensional data, one row per point
+     * @param dataStats Global statistics of the data
+     * @param neighbourhoodMatrix Neighbourhood of every point
+     * @param metric Explanation metric, variance or value
+     * @param k Number of dimensions to keep per point
+     * @param blockSize Number of dimensions whose statistics are computed at once
+     * @return Whether the ranks were computed, false for unsupported metrics
+     */
+    bool compute(const DataTable& dataset, const DataStatistics& dataStats, const NeighbourhoodMatrix& neighbourhoodMatrix, Explanation::Metric metric, int k, int blockSize = DEFAULT_BLOCK_SIZE);
+
+    /**
+     * Compute the top ranked dimensions of every point, skipping the statistics of the dimensions that
+     * cannot enter the top K of any point of their cell
+     * @param projection Projection matrix whose cells group the points, one row per point
+     * @param xDim Projection dimension of the x-axis
+     * @param yDim Projection dimension of the y-axis
+     * @return Whether the ranks were computed, false for unsupported metrics
+     */
+    bool computePruned(const DataTable& dataset, const DataStatistics& dataStats, const NeighbourhoodMatrix& neighbourhoodMatrix, const DataMatrix& projection, int xDim, int yDim, Explanation::Metric metric, int k, int blockSize = DEFAULT_BLOCK_SIZE);
+
+    /**
+     * Recompute the top ranked dimensions of \p points after their neighbourhoods changed
+     * @return Whether the ranks were updated, false when they have not been computed for the same data
+     */
+    bool update(const DataTable& dataset, const DataStatistics& dataStats, const NeighbourhoodMatrix& neighbourhoodMatrix, const std::vector<int>& points);
+
+    /** Drop the ranks (on data, metric or exclusion change) */
+    void clear();
+
+    bool isEmpty() const { return _sums.empty(); }
+    int numPoints() const { return static_cast<int>(_sums.size()); }
+
+    /** Get the number of dimensions kept per point, at most the number of dimensions that are not excluded */
+    int getK() const { return _k; }
+
+    /** Get the metric the ranks were computed for */
+    Explanation::Metric getMetric() const { return _metric; }
+
+    /** Get the fraction of the point and dimension pairs whose statistics were skipped, 0 unless pruned */
+    float getPrunedFraction() const { return _prunedFraction; }
+
+    /** Get the dimension of point \p i at position \p r of its top K, in order of decreasing importance */
+    int getDimension(int i, int r) const { return _dimensions[static_cast<std::size_t>(i) * _k + r]; }
+
+    /** Get the rank of the dimension of point \p i at position \p r of its top K */
+    float getRank(int i, int r) const { return _ranks[static_cast<std::size_t>(i) * _k + r]; }
+
+    /** Get the sum of the absolute scores of all dimensions of point \p i, which normalizes its ranks */
+    float getScoreSum(int i) const { return _sums[i]; }
+
+    /**
+     * Find the rank of dimension \p j of point \p i
+     * @return Whether the dimension is in the top K of the point, \p rank is left unchanged otherwise
+     */
+    bool findRank(int i, int j, float& rank) const;
+
+    /** Get the top ranked dimension of every point */
+    std::vector<int> getTopDimensions() const;
+
+    /** Get the number of points for which every dimension is top ranked, to assign the colors */
+    std::vector<int> computeTopCounts(int numDimensions) const;
+
+    /** Get the number of bytes held by the ranks */
+    std::size_t getMemoryUsage() const;
+
+private:
+    /** Set the metric and K, and size the ranks for \p numPoints points */
+    void allocate(int numPoints, Explanation::Metric metric, int k, int numIncluded, int blockSize);
+
+    /**
+     * Compute the top K of point \p i from its neighbourhood, block by block
+     * @param dims Ascending dimensions whose statistics are computed
+     * @param baseSum Absolute scores of the other dimensions, added to the normalization sum
+     */
+    void computePoint(const DataTable& dataset, const std::vector<double>& globalVariances, const DataStatistics& dataStats, const std::vector<int>& dims, const std::vector<char>& included, int i, const Neighbourhood& neighbourhood, double baseSum);
+
+private:
+    Explanation::Metric     _metric;          /** Metric of the ranks */
+    int                     _k;               /** Number of dimensions kept per point */
+    int                     _blockSize;       /** Number of dimensions whose statistics are computed at once */
+    float                   _prunedFraction;  /** Fraction of the point and dimension pairs whose statistics were skipped */
+
+    std::vector<int>        _dimensions;      /** Top K dimensions of every point, K per point in order of decreasing importance */
+    std::vector<float>      _ranks;           /** Ranks of the top K dimensions */
+    std::vector<float>      _sums;            /** Sum of the absolute scores of all dimensions of every point */
+};
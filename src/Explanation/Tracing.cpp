@@ -0,0 +1,189 @@
+#include "Tracing.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace
+{
+    /** Upper limit on the events kept per thread, so a forgotten recording cannot exhaust memory */
+    constexpr std::size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+    struct TraceEvent
+    {
+        const char*     name;       /** Name of the span or counter */
+        std::int64_t    start;      /** Start time (ns) */
+        std::int64_t    duration;   /** Duration of a span (ns), -1 for counters */
+        double          value;      /** Value of a counter */
+    };
+
+    /** Events of a single thread, the mutex is only contended while clearing or exporting */
+    struct ThreadBuffer
+    {
+        std::mutex              mutex;
+        std::vector<TraceEvent> events;
+        int                     threadId;
+    };
+
+    struct Registry
+    {
+        std::mutex                                  mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>>  buffers;
+        const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    };
+
+    Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    ThreadBuffer& getThreadBuffer()
+    {
+        // The registry co-owns the buffer so events survive the thread that recorded them
+        thread_local std::shared_ptr<ThreadBuffer> buffer = []() {
+            auto newBuffer = std::make_shared<ThreadBuffer>();
+
+            Registry& registry = getRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            newBuffer->threadId = static_cast<int>(registry.buffers.size());
+            registry.buffers.push_back(newBuffer);
+
+            return newBuffer;
+        }();
+
+        return *buffer;
+    }
+
+    void addEvent(const TraceEvent& event)
+    {
+        ThreadBuffer& buffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+
+        if (buffer.events.size() < MAX_EVENTS_PER_THREAD)
+            buffer.events.push_back(event);
+    }
+
+    void writeEscaped(std::ostream& stream, const char* text)
+    {
+        stream << '"';
+        for (const char* c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                stream << '\\';
+            stream << *c;
+        }
+        stream << '"';
+    }
+}
+
+namespace tracing
+{
+    void setEnabled(bool enabled)
+    {
+        getRegistry();
+
+        enabledFlag().store(enabled, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        for (auto& buffer : registry.buffers)
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            buffer->events.clear();
+        }
+    }
+
+    std::size_t numEvents()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        std::size_t count = 0;
+        for (auto& buffer : registry.buffers)
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            count += buffer->events.size();
+        }
+        return count;
+    }
+
+    void counter(const char* name, double value)
+    {
+        if (!isEnabled())
+            return;
+
+        addEvent({ name, now(), -1, value });
+    }
+
+    bool writeChromeTrace(std::ostream& stream)
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        const std::ios_base::fmtflags flags = stream.flags();
+        const std::streamsize precision = stream.precision();
+
+        stream << std::fixed << std::setprecision(3);
+
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool first = true;
+        for (auto& buffer : registry.buffers)
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+
+            for (const TraceEvent& event : buffer->events)
+            {
+                stream << (first ? "\n" : ",\n") << "{\"name\":";
+                writeEscaped(stream, event.name);
+
+                // Chrome trace time stamps are in microseconds
+                stream << ",\"pid\":1,\"tid\":" << buffer->threadId << ",\"ts\":" << event.start / 1000.0;
+
+                if (event.duration >= 0)
+                    stream << ",\"ph\":\"X\",\"dur\":" << event.duration / 1000.0 << "}";
+                else
+                    stream << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+
+                first = false;
+            }
+        }
+
+        stream << "\n]}\n";
+
+        stream.flags(flags);
+        stream.precision(precision);
+
+        return static_cast<bool>(stream);
+    }
+
+    bool writeChromeTrace(const std::string& filePath)
+    {
+        std::ofstream file(filePath);
+
+        if (!file)
+            return false;
+
+        return writeChromeTrace(file);
+    }
+
+    std::int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - getRegistry().origin).count();
+    }
+
+    void Scope::record(const char* name, std::int64_t start, std::int64_t end)
+    {
+        addEvent({ name, start, end - start, 0.0 });
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+/**
+ * Tracing of the explanation pipeline
+ *
+ * Scoped spans and counters recorded into per-thread buffers and exported in the Chrome trace
+ * event format (load the file in chrome://tracing or https://ui.perfetto.dev). Recording is off
+ * by default; when off a span costs a single relaxed atomic load. Building with
+ * PROJECTION_EXPLORER_TRACING=0 compiles the TRACE_ macros out entirely.
+ *
+ * Span and counter names must be string literals (or otherwise outlive the recording).
+ */
+#ifndef PROJECTION_EXPLORER_TRACING
+#define PROJECTION_EXPLORER_TRACING 1
+#endif
+
+namespace tracing
+{
+    /** Whether events are currently being recorded */
+    inline std::atomic<bool>& enabledFlag()
+    {
+        static std::atomic<bool> enabled(false);
+        return enabled;
+    }
+
+    inline bool isEnabled() { return enabledFlag().load(std::memory_order_relaxed); }
+
+    /** Start or stop recording, recorded events are kept until clear() is called */
+    void setEnabled(bool enabled);
+
+    /** Discard all recorded events */
+    void clear();
+
+    /** Get the number of recorded events over all threads */
+    std::size_t numEvents();
+
+    /** Get the time on the trace clock in nanoseconds */
+    std::int64_t now();
+
+    /** Record a counter sample, shown as a graph track in the trace viewer */
+    void counter(const char* name, double value);
+
+    /**
+     * Write all recorded events in Chrome trace JSON format
+     * @return Whether the events could be written
+     */
+    bool writeChromeTrace(std::ostream& stream);
+    bool writeChromeTrace(const std::string& filePath);
+
+    /** Records the lifetime of the scope as a span on the calling thread */
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name) :
+            _name(isEnabled() ? name : nullptr),
+            _start(_name ? now() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (_name)
+                record(_name, _start, now());
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        static void record(const char* name, std::int64_t start, std::int64_t end);
+
+    private:
+        const char*     _name;      /** Name of the span, null when not recording */
+        std::int64_t    _start;     /** Start time of the span (ns) */
+    };
+}
+
+#define TRACE_CONCATENATE_IMPL(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_IMPL(a, b)
+
+#if PROJECTION_EXPLORER_TRACING
+#define TRACE_SCOPE(name) tracing::Scope TRACE_CONCATENATE(traceScope, __LINE__)(name)
+#define TRACE_COUNTER(name, value) do { if (tracing::isEnabled()) tracing::counter(name, static_cast<double>(value)); } while (0)
+#else
+#define TRACE_SCOPE(name) do { } while (0)
+#define TRACE_COUNTER(name, value) do { } while (0)
+#endif
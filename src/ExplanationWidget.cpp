@@ -1,10 +1,13 @@
 #include "ExplanationWidget.h"
+#include "Explanation/Tracing.h"
 
 #include <QVBoxLayout>
 #include <QPushButton>
 #include <QGroupBox>
 #include <QEvent>
 #include <QMouseEvent>
+#include <QPaintEvent>
+#include <QFontMetrics>
 
 #include <string>
 #include <iostream>
@@ -17,6 +20,11 @@
 #define BOX_HEIGHT 40
 #define DIFF_HEIGHT 12
 #define LEGEND_BUTTON 400
+#define LEGEND_BOX_X 10
+#define LEGEND_BOX_SIZE 14
+#define LABEL_X 30
+#define LABEL_WIDTH 150
+#define MIN_RANKED_ROWS 16
 #define HIGHLIGHT_COLOR Qt::white
 
 bool isMouseOverBox(QPoint mousePos, int x, int y, int size)
@@ -24,52 +32,40 @@ bool isMouseOverBox(QPoint mousePos, int x, int y, int size)
     return mousePos.x() > x && mousePos.x() < x + size && mousePos.y() > y && mousePos.y() < y + size;
 }
 
-void DataMetrics::compute(const DataTable& dataset, const std::vector<unsigned int>& selection, const DataStatistics& dataStats)
+namespace
 {
-    int numDimensions = dataset.numDimensions();
-
-    // Compute average values
-    averageValues.clear();
-    averageValues.resize(numDimensions, 0);
-    for (int j = 0; j < numDimensions; j++)
+    QFont labelFont()
     {
-        for (int i = 0; i < selection.size(); i++)
-        {
-            int si = selection[i];
-
-            averageValues[j] += dataset(si, j);
-        }
+        QFont font = QFont("MS Shell Dlg 2", 10, QFont::ExtraBold);
+        font.setPixelSize(16);
+        return font;
+    }
 
-        averageValues[j] /= selection.size();
+    /** Create a transparent pixmap of the given logical size, matching the device pixel ratio of the widget */
+    QPixmap createLayerPixmap(int width, int height, qreal devicePixelRatio)
+    {
+        QPixmap pixmap(qRound(width * devicePixelRatio), qRound(height * devicePixelRatio));
+        pixmap.setDevicePixelRatio(devicePixelRatio);
+        pixmap.fill(Qt::transparent);
+        return pixmap;
     }
+}
 
-    // Compute variances
+void DataMetrics::reset(int numDimensions)
+{
+    averageValues.clear();
+    averageValues.resize(numDimensions, 0);
     variances.clear();
     variances.resize(numDimensions, 0);
-    for (int j = 0; j < numDimensions; j++)
-    {
-        for (int i = 0; i < selection.size(); i++)
-        {
-            int si = selection[i];
-            float x = dataset(si, j) - averageValues[j];
-            variances[j] += x * x;
-        }
-        variances[j] /= selection.size();
-        variances[j] = sqrt(variances[j]);
-    }
+}
 
+void DataMetrics::computeDimension(const SelectionStatistics& selectionStats, const DataStatistics& dataStats, int dim)
+{
     // Normalization
-    for (int j = 0; j < numDimensions; j++)
-    {
-        float range = dataStats.ranges[j];
-
-        float normalizedValue = (averageValues[j] - dataStats.minRange[j]) / range;
-        averageValues[j] = normalizedValue;
-        float normalizedStddev = variances[j] / range;
-        variances[j] = normalizedStddev;
+    float range = dataStats.ranges[dim];
 
-        //std::cout << "Dim: " << j << " Min ranges: " << minRanges[j] << " Max ranges: " << maxRanges[j] << std::endl;
-    }
+    averageValues[dim] = (selectionStats.getMean(dim) - dataStats.minRange[dim]) / range;
+    variances[dim] = sqrt(selectionStats.getVariance(dim)) / range;
 }
 
 void drawVarianceWhiskers(QPainter& painter, float x1, float x2, int y)
@@ -113,16 +109,17 @@ BarChart::BarChart(ExplanationModel& explanationModel) :
     //const char* tab_colors[] = { "#4e79a7", "#59a14f", "#9c755f", "#f28e2b", "#edc948", "#bab0ac", "#e15759", "#b07aa1", "#76b7b2", "#ff9da7" };
 }
 
-void BarChart::setRanking(DataMatrix& ranking, const std::vector<unsigned int>& selection)
+void BarChart::setRanking(DataMatrix& ranking, const std::vector<unsigned int>& selection, std::shared_ptr<const SelectionStatistics> selectionStats)
 {
     int numPoints = ranking.rows();
     int numDimensions = ranking.cols();
 
-    _selection = selection;
-
     if (numPoints == 0)
     {
         _dimAggregation.clear();
+        _sortIndices.clear();
+        _selectionStats.reset();
+        _numRankedRows = 0;
         return;
     }
 
@@ -138,49 +135,25 @@ void BarChart::setRanking(DataMatrix& ranking, const std::vector<unsigned int>&
     {
         dimAggregation[i] /= (float) numPoints;
     }
-    _dimAggregation = dimAggregation;
-
-    // Compute metrics on current selection
-    _newMetrics.compute(_explanationModel.getDataset(), _selection, _explanationModel.getDataStatistics());
-
-    // Compute sorting
-    _sortIndices.resize(numDimensions);
-    std::iota(_sortIndices.begin(), _sortIndices.end(), 0);
 
-    switch (_explanationModel.currentMetric())
-    {
-    case Explanation::Metric::VARIANCE:
-        std::sort(_sortIndices.begin(), _sortIndices.end(), [&](int i, int j) {return dimAggregation[i] < dimAggregation[j]; }); break;
-    case Explanation::Metric::VALUE:
-        std::sort(_sortIndices.begin(), _sortIndices.end(), [&](int i, int j) {return dimAggregation[i] > dimAggregation[j]; }); break;
-    default: break;
-    }
-    //if (_explanationModel.currentMetric() == Explanation::Metric::VARIANCE)
-    //    std::sort(_sortIndices.begin(), _sortIndices.end(), [&](int i, int j) {return dimAggregation[i] < dimAggregation[j]; });
-    //else if (_sortingType == SortingType::VALUE)
-    //    std::sort(_sortIndices.begin(), _sortIndices.end(), [&](int i, int j) {return _newMetrics.averageValues[i] > _newMetrics.averageValues[j]; });
-    //else if (_sortingType == SortingType::NONE) {}
+    setRanking(dimAggregation, selection, std::move(selectionStats));
 }
 
-void BarChart::setRanking(const std::vector<float>& dimRanking, const std::vector<unsigned int>& selection)
+void BarChart::setRanking(const std::vector<float>& dimRanking, const std::vector<unsigned int>& selection, std::shared_ptr<const SelectionStatistics> selectionStats)
 {
-    _selection = selection;
+    TRACE_SCOPE("BarChart::setRanking");
 
     if (selection.size() == 0)
     {
         _dimAggregation.clear();
         _sortIndices.clear();
+        _selectionStats.reset();
+        _numRankedRows = 0;
         return;
     }
 
     int numDimensions = dimRanking.size();
 
-    _globalHistograms.clear();
-    _globalHistograms.resize(numDimensions, Histogram(20));
-
-    _histograms.clear();
-    _histograms.resize(numDimensions, Histogram(20));
-
     // Print rankings
     //for (int j = 0; j < numDimensions; j++)
     //{
@@ -190,32 +163,23 @@ void BarChart::setRanking(const std::vector<float>& dimRanking, const std::vecto
 
     _dimAggregation = dimRanking;
 
-    // Compute metrics on current selection
-    _newMetrics.compute(_explanationModel.getDataset(), _selection, _explanationModel.getDataStatistics());
+    // Share the statistics the ranking was computed from, only compute them when the caller has none
+    _selectionStats = selectionStats ? std::move(selectionStats) : _explanationModel.computeSelectionStatistics(selection);
 
-    const DataTable& dataset = _explanationModel.getDataset();
-
-    // Compute global histograms
-    for (int j = 0; j < numDimensions; j++)
+    // The histograms stay valid until the statistics change, the ranking may show them in a different order
+    if (_selectionStats->getGeneration() != _histogramGeneration)
     {
-        _globalHistograms[j].setRange(_explanationModel.getDataStatistics().minRange[j], _explanationModel.getDataStatistics().maxRange[j]);
-        for (int i = 0; i < dataset.numPoints(); i++)
-        {
-            _globalHistograms[j].addDataValue(dataset(i, j));
-        }
+        _histogramGeneration = _selectionStats->getGeneration();
+        _histogramOf.assign(numDimensions, -1);
+        _histogramBins.clear();
+        _highestBinValues.clear();
     }
 
-    // Compute local histograms
-    for (int j = 0; j < numDimensions; j++)
-    {
-        _histograms[j].setRange(_explanationModel.getDataStatistics().minRange[j], _explanationModel.getDataStatistics().maxRange[j]);
-        for (int i = 0; i < selection.size(); i++)
-        {
-            int si = selection[i];
+    // Metrics are only computed for the dimensions that get ranked
+    _newMetrics.reset(numDimensions);
+    _oldMetrics.reset(numDimensions);
 
-            _histograms[j].addDataValue(dataset(si, j));
-        }
-    }
+    // Global histograms only depend on the dataset, they are rendered once per dimension in getGlobalHistogramPixmap()
 
     // Compute sorting
     _sortIndices.clear();
@@ -234,35 +198,233 @@ void BarChart::setRanking(const std::vector<float>& dimRanking, const std::vecto
         }
     }
 
+    // Only rank the rows that are visible, the remaining rows are ranked when scrolled into view
+    _numRankedRows = 0;
+
+    rankRows(numVisibleRows());
+
+    update();
+}
+
+void BarChart::rankRows(int numRows)
+{
+    numRows = std::min(numRows, (int) _sortIndices.size());
+
+    if (numRows <= _numRankedRows)
+        return;
+
+    // Rank at least a page of rows at once, so scrolling does not rank row by row
+    numRows = std::min(std::max(numRows, _numRankedRows + MIN_RANKED_ROWS), (int) _sortIndices.size());
+
+    // The first _numRankedRows are in their final place, so partially sorting the remainder yields the next rows
+    auto first = _sortIndices.begin() + _numRankedRows;
+    auto middle = _sortIndices.begin() + numRows;
+
     switch (_explanationModel.currentMetric())
     {
     case Explanation::Metric::VARIANCE:
-        std::sort(_sortIndices.begin(), _sortIndices.end(), [&](int i, int j) {return _dimAggregation[i] < _dimAggregation[j]; }); break;
+        std::partial_sort(first, middle, _sortIndices.end(), [&](int i, int j) {return _dimAggregation[i] < _dimAggregation[j]; }); break;
     case Explanation::Metric::VALUE:
-        std::sort(_sortIndices.begin(), _sortIndices.end(), [&](int i, int j) {return _dimAggregation[i] > _dimAggregation[j]; }); break;
+        std::partial_sort(first, middle, _sortIndices.end(), [&](int i, int j) {return _dimAggregation[i] > _dimAggregation[j]; }); break;
     default: break;
     }
 
-    update();
+    // Compute local histograms and metrics of the newly ranked rows
+    binHistograms(_numRankedRows, numRows);
+
+    const DataStatistics& dataStats = _explanationModel.getDataStatistics();
+
+    for (int row = _numRankedRows; row < numRows; row++)
+    {
+        int j = _sortIndices[row];
+
+        _newMetrics.computeDimension(*_selectionStats, dataStats, j);
+
+        if (_oldSelectionStats)
+            _oldMetrics.computeDimension(*_oldSelectionStats, dataStats, j);
+    }
+
+    _numRankedRows = numRows;
+}
+
+void BarChart::binHistograms(int firstRow, int lastRow)
+{
+    std::vector<int> dims;
+    for (int row = firstRow; row < lastRow; row++)
+    {
+        if (_histogramOf[_sortIndices[row]] < 0)
+            dims.push_back(_sortIndices[row]);
+    }
+
+    if (dims.empty())
+        return;
+
+    std::vector<int> bins;
+    _selectionStats->computeHistograms(_explanationModel.getDataset(), _explanationModel.getDataStatistics(), dims, bins);
+
+    const int numBins = _selectionStats->numBins();
+
+    for (int d = 0; d < dims.size(); d++)
+    {
+        const int* dimBins = bins.data() + static_cast<std::size_t>(d) * numBins;
+
+        _histogramOf[dims[d]] = static_cast<int>(_highestBinValues.size());
+        _highestBinValues.push_back(*std::max_element(dimBins, dimBins + numBins));
+    }
+
+    _histogramBins.insert(_histogramBins.end(), bins.begin(), bins.end());
+}
+
+int BarChart::numVisibleRows() const
+{
+    const int visibleHeight = parentWidget() ? parentWidget()->height() : height();
+
+    return visibleHeight / BOX_HEIGHT + 2;
 }
 
-void BarChart::computeOldMetrics(const std::vector<unsigned int>& oldSelection)
+void BarChart::computeOldMetrics()
 {
-    _oldMetrics.compute(_explanationModel.getDataset(), oldSelection, _explanationModel.getDataStatistics());
+    TRACE_SCOPE("BarChart::computeOldMetrics");
+
+    // The statistics are never modified once shared, so the reference is simply held on to
+    _oldSelectionStats = _selectionStats;
+
+    _oldMetrics.reset(numRows());
+
+    if (!_oldSelectionStats)
+        return;
+
+    for (int row = 0; row < _numRankedRows; row++)
+        _oldMetrics.computeDimension(*_oldSelectionStats, _explanationModel.getDataStatistics(), _sortIndices[row]);
 }
 
 void BarChart::datasetChanged()
 {
     _dimAggregation.clear();
     _sortIndices.clear();
-    _selection.clear();
+    _selectionStats.reset();
+    _oldSelectionStats.reset();
+    _numRankedRows = 0;
+    _histogramGeneration = 0;
+    _histogramOf.clear();
+    _histogramBins.clear();
+    _highestBinValues.clear();
+    _hoveredBox = -1;
+
+    invalidateCaches();
+
+    // Draw legend or not depending on whether the dimensions fit in the visible part of the chart
+    const int visibleHeight = parentWidget() ? parentWidget()->height() : height();
+    _drawLegend = TOP_MARGIN + 8 + BOX_HEIGHT * (numRows() + 2) + 270 <= visibleHeight;
+
+    updateContentHeight();
+    update();
+}
 
-    // Draw legend or not depending on the number of dimensions
-    std::cout << "Height: " << height() << " Dim height: " << (_explanationModel.getDataset().numDimensions() * 20 + 270) << std::endl;
-    if (_explanationModel.getDataset().numDimensions() * 20 + 270 > height())
-        _drawLegend = false;
-    else
-        _drawLegend = true;
+int BarChart::numRows() const
+{
+    return _explanationModel.hasDataset() ? _explanationModel.getDataset().numDimensions() : 0;
+}
+
+int BarChart::rowTop(int row) const
+{
+    return TOP_MARGIN + BOX_HEIGHT * row;
+}
+
+int BarChart::legendBoxAt(QPoint pos) const
+{
+    if (pos.y() <= TOP_MARGIN)
+        return -1;
+
+    const int row = (pos.y() - TOP_MARGIN) / BOX_HEIGHT;
+
+    if (row >= numRows() || !isMouseOverBox(pos, LEGEND_BOX_X, rowTop(row), LEGEND_BOX_SIZE))
+        return -1;
+
+    return row;
+}
+
+QRect BarChart::legendBoxRect(int row) const
+{
+    return QRect(LEGEND_BOX_X, rowTop(row), LEGEND_BOX_SIZE, LEGEND_BOX_SIZE);
+}
+
+int BarChart::legendTop() const
+{
+    return _drawLegend ? std::min(TOP_MARGIN + 8 + BOX_HEIGHT * (numRows() + 2), height() - 270) : height() - 30;
+}
+
+void BarChart::updateContentHeight()
+{
+    const int legendHeight = _drawLegend ? 270 : 30;
+
+    setMinimumHeight(std::max(270, TOP_MARGIN + 8 + BOX_HEIGHT * (numRows() + 2) + legendHeight));
+}
+
+void BarChart::invalidateCaches()
+{
+    const int numDimensions = numRows();
+
+    _globalHistogramPixmaps.assign(numDimensions, QPixmap());
+    _labelPixmaps.assign(numDimensions, QPixmap());
+    _labelPixmapColors.assign(numDimensions, 0);
+}
+
+const QPixmap& BarChart::getGlobalHistogramPixmap(int dim)
+{
+    QPixmap& pixmap = _globalHistogramPixmaps[dim];
+
+    if (!pixmap.isNull())
+        return pixmap;
+
+    const DataTable& dataset = _explanationModel.getDataset();
+    const DataStatistics& dataStats = _explanationModel.getDataStatistics();
+
+    Histogram globalHist(20);
+    globalHist.setRange(dataStats.minRange[dim], dataStats.maxRange[dim]);
+    for (int i = 0; i < dataset.numPoints(); i++)
+    {
+        globalHist.addDataValue(dataset(i, dim));
+    }
+
+    int globalHighestBinValue = globalHist.getHighestBinValue();
+
+    pixmap = createLayerPixmap(RANGE_WIDTH, BOX_HEIGHT / 2, devicePixelRatioF());
+
+    QPainter painter(&pixmap);
+
+    float globalBoxWidth = (float) RANGE_WIDTH / globalHist.getBins().size();
+    for (int b = 0; b < globalHist.getBins().size(); b++)
+    {
+        painter.fillRect(QRectF(b * globalBoxWidth, 0, globalBoxWidth, ((float) globalHist.getBins()[b] / globalHighestBinValue) * BOX_HEIGHT / 2), QColor(180, 180, 180));
+    }
+
+    return pixmap;
+}
+
+const QPixmap& BarChart::getLabelPixmap(int dim, const QColor& color)
+{
+    QPixmap& pixmap = _labelPixmaps[dim];
+
+    if (!pixmap.isNull() && _labelPixmapColors[dim] == color.rgba())
+        return pixmap;
+
+    QFont font = labelFont();
+    QFontMetrics fm(font);
+
+    QString dimName = _explanationModel.getDataNames().size() > dim ? _explanationModel.getDataNames()[dim] : QString::number(dim);
+    dimName = fm.elidedText(dimName, Qt::TextElideMode::ElideRight, LABEL_WIDTH);
+
+    pixmap = createLayerPixmap(LABEL_WIDTH + 10, fm.height(), devicePixelRatioF());
+
+    QPainter painter(&pixmap);
+    painter.setFont(font);
+    painter.setPen(color);
+    painter.drawText(0, fm.ascent(), dimName);
+
+    _labelPixmapColors[dim] = color.rgba();
+
+    return pixmap;
 }
 
 void BarChart::sortByDefault()
@@ -287,25 +449,36 @@ void BarChart::paintEvent(QPaintEvent* event)
         return;
     }
 
+    TRACE_SCOPE("BarChart::paintEvent");
+
     const DataTable& dataset = _explanationModel.getDataset();
     const DataStatistics& dataStats = _explanationModel.getDataStatistics();
 
     int numDimensions = dataset.numDimensions();
 
+    // Layers can be out of date if the dimensions changed without a dataset change
+    if (_globalHistogramPixmaps.size() != static_cast<std::size_t>(numDimensions))
+        invalidateCaches();
+
     const std::vector<QColor>& colorMapping = _explanationModel.getColorMapping();
 
+    // Only paint the rows that intersect the exposed area, a row extends half a box above and below its range line
+    const QRect exposedRect = event->rect();
+    const int firstRow = std::max(0, (exposedRect.top() - TOP_MARGIN - BOX_HEIGHT / 2) / BOX_HEIGHT);
+    const int lastRow = std::min(numDimensions - 1, (exposedRect.bottom() - TOP_MARGIN + BOX_HEIGHT / 2) / BOX_HEIGHT + 1);
+
     QPainter painter(this);
-    painter.setRenderHint(QPainter::RenderHint::Antialiasing);
-    painter.fillRect(0, 0, 600, (numDimensions + 2) * BOX_HEIGHT, QColor(38, 38, 38));
+    painter.fillRect(exposedRect.intersected(QRect(0, 0, 600, height())), QColor(38, 38, 38));
 
     painter.setPen(Qt::white);
-    QFont font = QFont("MS Shell Dlg 2", 10, QFont::ExtraBold);
-    QFontMetricsF fm(font);
-    font.setPixelSize(16);
+    QFont font = labelFont();
     painter.setFont(font);
     
     if (_dimAggregation.size() > 0)
     {
+        // Rank the rows that were scrolled into view
+        rankRows(lastRow + 1);
+
         // Draw sorting label
         switch (_explanationModel.currentMetric())
         {
@@ -342,7 +515,7 @@ void BarChart::paintEvent(QPaintEvent* event)
             //}
         }
 
-        for (int i = 0; i < _dimAggregation.size(); i++)
+        for (int i = firstRow; i <= lastRow && i < _dimAggregation.size(); i++)
         {
             int sortIndex = _sortIndices[i];
 
@@ -359,20 +532,11 @@ void BarChart::paintEvent(QPaintEvent* event)
 
             // Draw colored legend boxes
             // Check if mouse is over box, if so, draw a cross over it
-            if (isMouseOverBox(_mousePos, 10, TOP_MARGIN + BOX_HEIGHT * i, 14))
-            {
-                painter.fillRect(10, TOP_MARGIN + BOX_HEIGHT * i, 14, 14, HIGHLIGHT_COLOR);
-            }
-            else
-            {
-                painter.fillRect(10, TOP_MARGIN + BOX_HEIGHT * i, 14, 14, color);
-            }
+            painter.fillRect(legendBoxRect(i), i == _hoveredBox ? QColor(HIGHLIGHT_COLOR) : color);
 
             // Draw dimension names
             painter.setPen(color);
-            QString dimName = _explanationModel.getDataNames()[sortIndex];
-            dimName = fm.elidedText(dimName, Qt::TextElideMode::ElideRight, 150);
-            painter.drawText(30, TOP_MARGIN + 10 + i * BOX_HEIGHT, dimName);
+            painter.drawPixmap(LABEL_X, TOP_MARGIN + 10 + i * BOX_HEIGHT - QFontMetrics(font).ascent(), getLabelPixmap(sortIndex, color));
 
             if (excluded)
                 continue;
@@ -401,25 +565,19 @@ void BarChart::paintEvent(QPaintEvent* event)
             // Draw histogram
             if (!_differentialRanking)
             {
-                Histogram& globalHist = _globalHistograms[sortIndex];
-                Histogram& hist = _histograms[sortIndex];
-                int globalNumPoints = globalHist.getNumDataPoints();
-                int localNumPoints = hist.getNumDataPoints();
-                int globalHighestBinValue = globalHist.getHighestBinValue();
-                int localHighestBinValue = hist.getHighestBinValue();
+                int histogram = _histogramOf[sortIndex];
+                int numBins = _selectionStats->numBins();
+                const int* localBins = _histogramBins.data() + static_cast<std::size_t>(histogram) * numBins;
+                int localHighestBinValue = _highestBinValues[histogram];
 
                 // Draw global histograms
-                float globalBoxWidth = (float)RANGE_WIDTH / globalHist.getBins().size();
-                for (int b = 0; b < globalHist.getBins().size(); b++)
-                {
-                    painter.fillRect(RANGE_OFFSET + b * globalBoxWidth, TOP_MARGIN + BOX_HEIGHT * i + 0, globalBoxWidth, ((float) globalHist.getBins()[b] / globalHighestBinValue) * BOX_HEIGHT / 2, QColor(180, 180, 180));
-                }
+                painter.drawPixmap(RANGE_OFFSET, TOP_MARGIN + BOX_HEIGHT * i + 0, getGlobalHistogramPixmap(sortIndex));
 
                 // Draw local histograms
-                float boxWidth = (float) RANGE_WIDTH / hist.getBins().size();
-                for (int b = 0; b < hist.getBins().size(); b++)
+                float boxWidth = (float) RANGE_WIDTH / numBins;
+                for (int b = 0; b < numBins; b++)
                 {
-                    painter.fillRect(RANGE_OFFSET + b * boxWidth, TOP_MARGIN + BOX_HEIGHT * i + 0, boxWidth, ((float) -hist.getBins()[b] / localHighestBinValue) * BOX_HEIGHT / 2, QColor(0, 180, 225));
+                    painter.fillRect(RANGE_OFFSET + b * boxWidth, TOP_MARGIN + BOX_HEIGHT * i + 0, boxWidth, ((float) -localBins[b] / localHighestBinValue) * BOX_HEIGHT / 2, QColor(0, 180, 225));
                 }
 
                 //// Draw mean
@@ -502,25 +660,26 @@ void BarChart::paintEvent(QPaintEvent* event)
                 int newMeanX = RANGE_OFFSET + newMean * RANGE_WIDTH;
 
                 QColor diffColor = newMeanX - oldMeanX >= 0 ? QColor(0, 255, 0, 128) : QColor(255, 0, 0, 128);
-                painter.fillRect(oldMeanX, TOP_MARGIN + 16 * i + 2, newMeanX - oldMeanX, DIFF_HEIGHT, diffColor);
+                // The differential glyph is 16 pixels high and centered on the range line of the row
+                int glyphTop = TOP_MARGIN + BOX_HEIGHT * i - 8;
+
+                painter.fillRect(oldMeanX, glyphTop + 2, newMeanX - oldMeanX, DIFF_HEIGHT, diffColor);
 
                 QPen meanPen;
                 meanPen.setWidth(2);
 
                 meanPen.setColor(QColor(128, 0, 0, 255));
                 painter.setPen(meanPen);
-                painter.drawLine(oldMeanX, TOP_MARGIN + 16 * i + 2, oldMeanX, TOP_MARGIN + 16 * i + 14);
+                painter.drawLine(oldMeanX, glyphTop + 2, oldMeanX, glyphTop + 14);
                 
                 meanPen.setColor(QColor(255, 0, 0, 255));
                 painter.setPen(meanPen);
-                painter.drawLine(newMeanX, TOP_MARGIN + 16 * i, newMeanX, TOP_MARGIN + 16 * i + 16);
-
-                qDebug() << newMeanX << oldMeanX << newMean << oldMean;
+                painter.drawLine(newMeanX, glyphTop, newMeanX, glyphTop + 16);
 
                 // Draw variance
                 painter.setPen(QColor(255, 255, 255, 255));
                 //painter.drawRect(RANGE_OFFSET + (newMean - _newMetrics.variances[sortIndex]) * RANGE_WIDTH, 10 + 16 * i, 2 * _newMetrics.variances[sortIndex] * RANGE_WIDTH, 16);
-                drawVarianceWhiskers(painter, newMean - _newMetrics.variances[sortIndex], newMean + _newMetrics.variances[sortIndex], 16 * i + 8);
+                drawVarianceWhiskers(painter, newMean - _newMetrics.variances[sortIndex], newMean + _newMetrics.variances[sortIndex], BOX_HEIGHT * i);
 
                 //painter.drawLine(RANGE_OFFSET + (newMean - _newMetrics.variances[sortIndex]) * RANGE_WIDTH, TOP_MARGIN + 8 + 16 * i, RANGE_OFFSET + (newMean + _newMetrics.variances[sortIndex]) * RANGE_WIDTH, TOP_MARGIN + 8 + 16 * i);
                 //painter.drawLine(RANGE_OFFSET + (newMean - _newMetrics.variances[sortIndex]) * RANGE_WIDTH, TOP_MARGIN + 4 + 16 * i, RANGE_OFFSET + (newMean - _newMetrics.variances[sortIndex]) * RANGE_WIDTH, TOP_MARGIN + 12 + 16 * i);
@@ -532,7 +691,7 @@ void BarChart::paintEvent(QPaintEvent* event)
     {
         painter.drawText(10, 20, "No Sorting");
 
-        for (int i = 0; i < _explanationModel.getDataset().numDimensions(); i++)
+        for (int i = firstRow; i <= lastRow; i++)
         {
             // Draw colored legend boxes
             // Set color according to exclusion
@@ -545,31 +704,19 @@ void BarChart::paintEvent(QPaintEvent* event)
                 color = QColor(255, 255, 255);
 
             // Check if mouse is over box, if so, draw a cross over it
-            if (isMouseOverBox(_mousePos, 10, TOP_MARGIN + BOX_HEIGHT * i, 14))
-            {
-                painter.fillRect(10, TOP_MARGIN + BOX_HEIGHT * i, 14, 14, HIGHLIGHT_COLOR);
-            }
-            else
-            {
-                painter.fillRect(10, TOP_MARGIN + BOX_HEIGHT * i, 14, 14, color);
-            }
+            painter.fillRect(legendBoxRect(i), i == _hoveredBox ? QColor(HIGHLIGHT_COLOR) : color);
 
-            painter.setPen(QColor(255, 255, 255));
-            if (_explanationModel.getDataNames().size() > 0)
-            {
-                painter.drawText(30, TOP_MARGIN + 10 + BOX_HEIGHT * i, _explanationModel.getDataNames()[i]);
-            }
-            else
-            {
-                painter.drawText(30, TOP_MARGIN + 10 + BOX_HEIGHT * i, QString::number(i));
-            }
+            painter.drawPixmap(LABEL_X, TOP_MARGIN + 10 + BOX_HEIGHT * i - QFontMetrics(font).ascent(), getLabelPixmap(i, QColor(255, 255, 255)));
         }
     }
 
     // Draw legend
-    int legendY = _drawLegend ? std::min(TOP_MARGIN + 8 + BOX_HEIGHT * (numDimensions + 2), height()-270) : height() - 30;
+    int legendY = legendTop();
     int legendHeight = _drawLegend ? 270 : 30;
 
+    if (!exposedRect.intersects(QRect(0, legendY, width(), legendHeight)))
+        return;
+
     painter.fillRect(0, legendY, 600, legendHeight, QColor(60, 60, 60));
 
     painter.setPen(QColor(255, 255, 255));
@@ -670,25 +817,23 @@ bool BarChart::eventFilter(QObject* target, QEvent* event)
 
         QPoint mousePos = mouseEvent->pos();
 
-        for (int j = 0; j < _explanationModel.getDataset().numDimensions(); j++)
+        int row = legendBoxAt(mousePos);
+        if (row >= 0)
         {
-            if (isMouseOverBox(mousePos, 10, TOP_MARGIN + 16 * j, 14))
-            {
-                if (_sortIndices.size() > 0)
-                    emit dimensionExcluded(_sortIndices[j]);
-                else
-                    emit dimensionExcluded(j);
-            }
+            if (_sortIndices.size() > row)
+                emit dimensionExcluded(_sortIndices[row]);
+            else
+                emit dimensionExcluded(row);
         }
 
         if (_explanationModel.hasDataset())
         {
-            int numDimensions = _explanationModel.getDataset().numDimensions();
-            int legendY = _drawLegend ? std::min(TOP_MARGIN + 8 + 16 * (numDimensions + 2), height() - 270) : height() - 30;
+            int legendY = legendTop();
 
             if (isMouseOverBox(mousePos, LEGEND_BUTTON - 4, legendY + 10 - 4, 18)) // Padded by 4 pixels all sides
             {
                 _drawLegend = !_drawLegend;
+                updateContentHeight();
                 update();
             }
         }
@@ -702,8 +847,27 @@ bool BarChart::eventFilter(QObject* target, QEvent* event)
 
 
         _mousePos = QPoint(mouseEvent->position().x(), mouseEvent->position().y());
-        update();
 
+        // Only repaint the legend boxes of which the hover state changed
+        int hoveredBox = legendBoxAt(_mousePos);
+        if (hoveredBox != _hoveredBox)
+        {
+            if (_hoveredBox >= 0)
+                update(legendBoxRect(_hoveredBox));
+            if (hoveredBox >= 0)
+                update(legendBoxRect(hoveredBox));
+
+            _hoveredBox = hoveredBox;
+        }
+
+        break;
+    }
+    case QEvent::Leave:
+    {
+        if (_hoveredBox >= 0)
+            update(legendBoxRect(_hoveredBox));
+
+        _hoveredBox = -1;
         break;
     }
 
@@ -738,9 +902,21 @@ ExplanationWidget::ExplanationWidget(ExplanationModel& explanationModel)
     _barChart = new BarChart(explanationModel);
     _imageViewWidget = new ImageViewWidget();
 
+    // The bar chart is as high as all its rows, the scroll area makes sure only the visible rows are painted
+    _barChartScrollArea = new QScrollArea();
+    _barChartScrollArea->setWidget(_barChart);
+    _barChartScrollArea->setWidgetResizable(true);
+    _barChartScrollArea->setFrameShape(QFrame::NoFrame);
+    _barChartScrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    _barChartScrollArea->setMinimumHeight(270);
+
     QVBoxLayout* layout = new QVBoxLayout();
     layout->setContentsMargins(0, 0, 0, 0);
-    layout->addWidget(_barChart);
+    layout->addWidget(_barChartScrollArea);
+
+    _localPCACheckBox = new QCheckBox("Rank selection by local PCA");
+    _localPCACheckBox->setToolTip("Rank the dimensions of the selection by their loadings on its top principal components instead of the explanation metric");
+    layout->addWidget(_localPCACheckBox);
     //layout->addWidget(_imageViewWidget);
     //layout->addWidget(_rankLabel);
     QPushButton* noSortButton = new QPushButton("No Ranking");
@@ -774,12 +950,19 @@ ExplanationWidget::ExplanationWidget(ExplanationModel& explanationModel)
         _radiusSlider->setRange(0, 50);
         connect(_radiusSlider, &QSlider::valueChanged, this, &ExplanationWidget::neighbourhoodRadiusValueChanged);
         _radiusSlider->setValue(10);
+        _samplingLabel = new QLabel("");
+        _samplingLabel->setToolTip("Standard error of the local means relative to the local spread, caused by the neighbour cap or memory budget");
+        _samplingLabel->hide();
+        _multiScaleCheckBox = new QCheckBox("Precompute all neighbourhood sizes");
+        _multiScaleCheckBox->setToolTip("Explain all slider positions in a single pass, so the slider only swaps colors (variance and value rankings, simplified confidence)");
 
         hBoxLayout->addWidget(radiusSliderLabel);
         hBoxLayout->addWidget(_radiusSliderValueLabel);
         hBoxLayout->setContentsMargins(0, 6, 0, 6);
         vBoxLayout->addLayout(hBoxLayout);
         vBoxLayout->addWidget(_radiusSlider);
+        vBoxLayout->addWidget(_samplingLabel);
+        vBoxLayout->addWidget(_multiScaleCheckBox);
         groupBox->setLayout(vBoxLayout);
         layout->addWidget(groupBox);
     }
@@ -819,8 +1002,9 @@ ExplanationWidget::~ExplanationWidget()
 
 void ExplanationWidget::update()
 {
-    _barChart->repaint();
-    _imageViewWidget->repaint();
+    // Schedule repaints instead of painting synchronously, so multiple updates within a frame are merged
+    _barChart->update();
+    _imageViewWidget->update();
 }
 
 void ExplanationWidget::neighbourhoodRadiusValueChanged(int value)
@@ -828,3 +1012,18 @@ void ExplanationWidget::neighbourhoodRadiusValueChanged(int value)
     // Display value of slider (times two, because explaining neighbourhood size is easier than radius)
     _radiusSliderValueLabel->setText(QString::number(value*2) + QString("% of projection size"));
 }
+
+void ExplanationWidget::updateSamplingError(const SamplingError& samplingError)
+{
+    if (samplingError.numSampledPoints == 0)
+    {
+        _samplingLabel->hide();
+        return;
+    }
+
+    _samplingLabel->setText(QString("Sampled neighbourhoods: %1 points, error %2% mean, %3% max")
+        .arg(samplingError.numSampledPoints)
+        .arg(samplingError.meanError * 100, 0, 'f', 1)
+        .arg(samplingError.maxError * 100, 0, 'f', 1));
+    _samplingLabel->show();
+}
@@ -12,16 +12,25 @@
 #include <QImage>
 #include <QSlider>
 #include <QComboBox>
+#include <QCheckBox>
+#include <QScrollArea>
+#include <QPixmap>
 #include <QPoint>
 
 #include <Eigen/Eigen>
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 class DataMetrics
 {
 public:
-    void compute(const DataTable& dataset, const std::vector<unsigned int>& selection, const DataStatistics& dataStats);
+    /** Clear the metrics of all \p numDimensions dimensions, they are then computed per dimension */
+    void reset(int numDimensions);
+
+    /** Compute the range-normalized mean and standard deviation of \p dim from the statistics of a selection */
+    void computeDimension(const SelectionStatistics& selectionStats, const DataStatistics& dataStats, int dim);
 
     std::vector<float> averageValues;
     std::vector<float> variances;
@@ -46,9 +55,16 @@ public:
 
     BarChart(ExplanationModel& explanationModel);
 
-    void setRanking(DataMatrix& ranking, const std::vector<unsigned int>& selection);
-    void setRanking(const std::vector<float>& dimRanking, const std::vector<unsigned int>& selection);
-    void computeOldMetrics(const std::vector<unsigned int>& oldSelection);
+    void setRanking(DataMatrix& ranking, const std::vector<unsigned int>& selection, std::shared_ptr<const SelectionStatistics> selectionStats = nullptr);
+
+    /**
+     * Show the ranking of \p selection
+     * @param selectionStats Statistics the ranking was computed from, null to compute them for \p selection
+     */
+    void setRanking(const std::vector<float>& dimRanking, const std::vector<unsigned int>& selection, std::shared_ptr<const SelectionStatistics> selectionStats = nullptr);
+
+    /** Keep the shown selection as the reference of the differential values */
+    void computeOldMetrics();
 
     void showDifferentialValues(bool on) { _differentialRanking = on; }
 
@@ -65,11 +81,64 @@ protected:
     void paintEvent(QPaintEvent* event) override;
     bool eventFilter(QObject* target, QEvent* event);
 
+private:
+    /**
+     * Make sure the first \p numRows rows are in ranked order, rows are ranked with
+     * a partial sort so the cost depends on the number of ranked rows rather than all dimensions.
+     * The local histograms and metrics are only computed for the ranked rows.
+     */
+    void rankRows(int numRows);
+
+    /** Bin the local histograms of the dimensions of \p rows that were not binned yet */
+    void binHistograms(int firstRow, int lastRow);
+
+    /** Number of rows that fit in the visible part of the chart */
+    int numVisibleRows() const;
+
+    /** Number of dimension rows in the chart */
+    int numRows() const;
+
+    /** Top y-coordinate of \p row */
+    int rowTop(int row) const;
+
+    /** Row of which the legend box contains \p pos, or -1 if there is none */
+    int legendBoxAt(QPoint pos) const;
+
+    /** Rectangle of the legend box of \p row */
+    QRect legendBoxRect(int row) const;
+
+    /** Top y-coordinate of the legend */
+    int legendTop() const;
+
+    /** Resize the chart to fit all rows and the legend, so that the enclosing scroll area can scroll through them */
+    void updateContentHeight();
+
+    /** Drop all cached row layers (on data change) */
+    void invalidateCaches();
+
+    /** Get cached pixmap of the global histogram of dimension \p dim, rendering it when not yet cached */
+    const QPixmap& getGlobalHistogramPixmap(int dim);
+
+    /** Get cached pixmap of the (elided) name of dimension \p dim in \p color, rendering it when not yet cached */
+    const QPixmap& getLabelPixmap(int dim, const QColor& color);
+
 private:
     ExplanationModel& _explanationModel;
 
-    std::vector<Histogram> _histograms;
-    std::vector<Histogram> _globalHistograms;
+    std::shared_ptr<const SelectionStatistics> _selectionStats;     /** Statistics of the ranked selection, shared with the model */
+    std::shared_ptr<const SelectionStatistics> _oldSelectionStats;  /** Statistics of the reference selection of the differential values */
+    int _numRankedRows = 0;                 /** Number of leading rows in final ranked order */
+
+    // Local histograms of the ranked dimensions, kept while the statistics are of the same generation
+    std::uint64_t _histogramGeneration = 0;
+    std::vector<int> _histogramOf;          /** Histogram of every dimension, -1 when not binned */
+    std::vector<int> _histogramBins;        /** Bins of the histograms, consecutive per histogram */
+    std::vector<int> _highestBinValues;     /** Highest bin count of every histogram */
+
+    // Cached static row layers, indexed by dimension
+    std::vector<QPixmap> _globalHistogramPixmaps;
+    std::vector<QPixmap> _labelPixmaps;
+    std::vector<QRgb> _labelPixmapColors;
 
     std::vector<float> _dimAggregation;
     std::vector<int> _sortIndices;
@@ -77,8 +146,6 @@ private:
     DataMetrics _newMetrics;
     DataMetrics _oldMetrics;
 
-    std::vector<unsigned int> _selection;
-
     bool _differentialRanking;
 
     SortingType _sortingType;
@@ -86,6 +153,7 @@ private:
 
     // Mouse events
     QPoint _mousePos;
+    int _hoveredBox = -1;
 
     QImage _legend;
     QImage _diffLegend;
@@ -120,6 +188,11 @@ public:
     ImageViewWidget& getImageWidget() { return *_imageViewWidget; }
     QSlider* getRadiusSlider() { return _radiusSlider; }
     QComboBox* getRankingComboBox() { return _rankingCombobox; }
+    QCheckBox* getMultiScaleCheckBox() { return _multiScaleCheckBox; }
+    QCheckBox* getLocalPCACheckBox() { return _localPCACheckBox; }
+
+    /** Show the estimated error of the local statistics due to sampled neighbourhoods, hidden when no neighbourhood is sampled */
+    void updateSamplingError(const SamplingError& samplingError);
 
 public slots:
     void neighbourhoodRadiusValueChanged(int value);
@@ -127,10 +200,14 @@ public slots:
 private:
     QLabel* _rankLabel;
     BarChart* _barChart;
+    QScrollArea* _barChartScrollArea;
     ImageViewWidget* _imageViewWidget;
 
     // UI Elements
     QLabel* _radiusSliderValueLabel;
     QSlider* _radiusSlider;
+    QLabel* _samplingLabel;
+    QCheckBox* _multiScaleCheckBox;
+    QCheckBox* _localPCACheckBox;
     QComboBox* _rankingCombobox;
 };
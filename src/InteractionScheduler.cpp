@@ -0,0 +1,173 @@
+#include "InteractionScheduler.h"
+
+#include "Explanation/Tracing.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+
+#include <algorithm>
+#include <cmath>
+
+InteractionScheduler::InteractionScheduler(QObject* parent) :
+    QObject(parent),
+    _timer(),
+    _clock(),
+    _frameInterval(16),
+    _projectionInterval(250),
+    _lastProjectionUpdate(-1),
+    _lastBatchStart(-1),
+    _firstRequestTime(-1),
+    _processing(false),
+    _numProjectionRequests(0),
+    _numRadiusRequests(0),
+    _numLensRequests(0),
+    _numSelectionRequests(0)
+{
+    _timer.setSingleShot(true);
+    _timer.setTimerType(Qt::PreciseTimer);
+
+    // Pace the batches at the refresh rate of the primary screen
+    if (auto screen = QGuiApplication::primaryScreen())
+        if (screen->refreshRate() > 0)
+            _frameInterval = std::max(1, static_cast<int>(std::lround(1000.0 / screen->refreshRate())));
+
+    _clock.start();
+
+    connect(&_timer, &QTimer::timeout, this, &InteractionScheduler::processBatch);
+}
+
+void InteractionScheduler::requestProjectionUpdate()
+{
+    _numProjectionRequests++;
+    schedule();
+}
+
+void InteractionScheduler::requestRadiusUpdate()
+{
+    _numRadiusRequests++;
+    schedule();
+}
+
+void InteractionScheduler::requestLensUpdate()
+{
+    _numLensRequests++;
+    schedule();
+}
+
+void InteractionScheduler::requestSelectionUpdate()
+{
+    _numSelectionRequests++;
+    schedule();
+}
+
+void InteractionScheduler::setFrameInterval(int frameInterval)
+{
+    _frameInterval = std::max(0, frameInterval);
+}
+
+void InteractionScheduler::setProjectionInterval(int projectionInterval)
+{
+    _projectionInterval = std::max(0, projectionInterval);
+}
+
+void InteractionScheduler::schedule()
+{
+    if (_firstRequestTime < 0)
+        _firstRequestTime = _clock.nsecsElapsed();
+
+    // Requests made while processing are picked up by the batch itself or scheduled afterwards
+    if (_processing)
+        return;
+
+    const auto sinceLastBatch = _lastBatchStart < 0 ? _frameInterval : _clock.elapsed() - _lastBatchStart;
+
+    qint64 delay = std::max<qint64>(0, _frameInterval - sinceLastBatch);
+
+    // A pending projection alone waits until it is due
+    if (_numRadiusRequests == 0 && _numLensRequests == 0 && _numSelectionRequests == 0)
+        delay = std::max(delay, getProjectionDelay());
+
+    // Interactions do not wait for a batch that was scheduled for a projection
+    if (_timer.isActive() && _timer.remainingTime() <= delay)
+        return;
+
+    _timer.start(static_cast<int>(delay));
+}
+
+qint64 InteractionScheduler::getProjectionDelay() const
+{
+    if (_lastProjectionUpdate < 0)
+        return 0;
+
+    return std::max<qint64>(0, _projectionInterval - (_clock.elapsed() - _lastProjectionUpdate));
+}
+
+void InteractionScheduler::processBatch()
+{
+    TRACE_SCOPE("InteractionScheduler::processBatch");
+
+    _processing = true;
+
+    const auto batchStart = _clock.nsecsElapsed();
+
+    _lastBatchStart = _clock.elapsed();
+
+    BatchTiming batchTiming{ 0, _numRadiusRequests, _numLensRequests, 0, 0.0, 0.0 };
+
+    batchTiming.queueDelay = (batchStart - _firstRequestTime) / 1.0e6;
+
+    _firstRequestTime = -1;
+
+    // Process the stages in dependency order, a stage may request a later stage in the same batch
+    if (_numProjectionRequests > 0 && getProjectionDelay() == 0)
+    {
+        batchTiming.numProjectionRequests = _numProjectionRequests;
+
+        _numProjectionRequests = 0;
+        emit projectionUpdate();
+
+        // The interval starts when the update is done, so slow updates leave time for the interaction
+        _lastProjectionUpdate = _clock.elapsed();
+    }
+
+    if (_numRadiusRequests > 0)
+    {
+        _numRadiusRequests = 0;
+        emit radiusUpdate();
+    }
+
+    if (_numLensRequests > 0)
+    {
+        _numLensRequests = 0;
+        emit lensUpdate();
+    }
+
+    batchTiming.numSelectionRequests = _numSelectionRequests;
+
+    if (_numSelectionRequests > 0)
+    {
+        _numSelectionRequests = 0;
+        emit selectionUpdate();
+    }
+
+    batchTiming.processingTime = (_clock.nsecsElapsed() - batchStart) / 1.0e6;
+
+    traceBatch(batchTiming);
+
+    _processing = false;
+
+    // Requests that arrived for already processed stages are deferred to the next frame
+    if (_numProjectionRequests > 0 || _numRadiusRequests > 0 || _numLensRequests > 0 || _numSelectionRequests > 0)
+        schedule();
+}
+
+void InteractionScheduler::traceBatch(const BatchTiming& batchTiming) const
+{
+    // More than one request of a stage in a batch is a recomputation that was saved
+    TRACE_COUNTER("Coalesced projection requests", batchTiming.numProjectionRequests);
+    TRACE_COUNTER("Coalesced radius requests", batchTiming.numRadiusRequests);
+    TRACE_COUNTER("Coalesced lens requests", batchTiming.numLensRequests);
+    TRACE_COUNTER("Coalesced selection requests", batchTiming.numSelectionRequests);
+    TRACE_COUNTER("Batch queue delay (ms)", batchTiming.queueDelay);
+    TRACE_COUNTER("Batch processing time (ms)", batchTiming.processingTime);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <cstdint>
+
+/**
+ * Interaction scheduler class
+ *
+ * Collapses bursts of interaction requests (lens moves, radius slider ticks and selection
+ * changes coming from linked views) into at most one update per display frame. Requests
+ * only set a pending flag; once per frame the pending stages are processed in dependency
+ * order (radius, lens, selection) by emitting the corresponding signals. Every batch is traced
+ * (see Tracing.h) as a span with counters of the coalesced requests, the queueing delay and the
+ * processing time, so redundant recomputations show up in a recorded trace.
+ *
+ * Streamed projections of iterating embeddings are a stage of their own that runs before the
+ * others, rate-limited to one update per projection interval: requests in between only keep
+ * the stage pending, so the explanation follows the embedding without an update per iteration.
+ */
+class InteractionScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Timing record of a single coalesced batch */
+    struct BatchTiming
+    {
+        std::uint32_t   numProjectionRequests;  /** Number of projection requests collapsed into the batch (0 while the stage waits) */
+        std::uint32_t   numRadiusRequests;      /** Number of radius requests collapsed into the batch */
+        std::uint32_t   numLensRequests;        /** Number of lens requests collapsed into the batch */
+        std::uint32_t   numSelectionRequests;   /** Number of selection requests collapsed into the batch */
+        double          queueDelay;             /** Time between the first request and the start of processing (ms) */
+        double          processingTime;         /** Time spent processing the batch (ms) */
+    };
+
+public:
+    InteractionScheduler(QObject* parent = nullptr);
+
+    /** Request an update of the explanation to a changed projection, at most once per projection interval */
+    void requestProjectionUpdate();
+
+    /** Request an update of the neighbourhood radius */
+    void requestRadiusUpdate();
+
+    /** Request an update of the lens selection */
+    void requestLensUpdate();
+
+    /** Request an update of the explanation of the current selection */
+    void requestSelectionUpdate();
+
+    /** Get the frame interval in milliseconds */
+    int getFrameInterval() const { return _frameInterval; }
+
+    /**
+     * Set the frame interval
+     * @param frameInterval Minimum time between two batches in milliseconds
+     */
+    void setFrameInterval(int frameInterval);
+
+    /** Get the projection interval in milliseconds */
+    int getProjectionInterval() const { return _projectionInterval; }
+
+    /**
+     * Set the projection interval
+     * @param projectionInterval Minimum time between the end of a projection update and the start of the next in milliseconds
+     */
+    void setProjectionInterval(int projectionInterval);
+
+signals:
+
+    /** Signals that the changed projection needs to be processed */
+    void projectionUpdate();
+
+    /** Signals that the neighbourhood radius needs to be processed */
+    void radiusUpdate();
+
+    /** Signals that the lens selection needs to be processed */
+    void lensUpdate();
+
+    /** Signals that the explanation of the selection needs to be processed */
+    void selectionUpdate();
+
+private:
+    void schedule();
+    void processBatch();
+
+    /** Record the counters of \p batchTiming in the trace */
+    void traceBatch(const BatchTiming& batchTiming) const;
+
+    /** Get the time until the projection stage is due in milliseconds, 0 when it is */
+    qint64 getProjectionDelay() const;
+
+private:
+    QTimer                  _timer;                 /** Single shot timer that paces the batches */
+    QElapsedTimer           _clock;                 /** Monotonic clock for pacing and timing */
+    int                     _frameInterval;         /** Minimum time between two batches (ms) */
+    int                     _projectionInterval;    /** Minimum time between two projection updates (ms) */
+    qint64                  _lastProjectionUpdate;  /** Clock time at which the last projection update ended (ms) */
+    qint64                  _lastBatchStart;        /** Clock time at which the last batch started (ms) */
+    qint64                  _firstRequestTime;      /** Clock time of the first pending request (ns) */
+    bool                    _processing;            /** Whether a batch is being processed */
+    std::uint32_t           _numProjectionRequests; /** Pending projection requests */
+    std::uint32_t           _numRadiusRequests;     /** Pending radius requests */
+    std::uint32_t           _numLensRequests;       /** Pending lens requests */
+    std::uint32_t           _numSelectionRequests;  /** Pending selection requests */
+};
@@ -2,20 +2,59 @@
 #include "ScatterplotPlugin.h"
 #include "ScatterplotWidget.h"
 
+#include "Explanation/Parallel.h"
+#include "Explanation/Tracing.h"
+
+#include <QDebug>
+#include <QFileDialog>
+
 using namespace mv::gui;
 
 const QColor MiscellaneousAction::DEFAULT_BACKGROUND_COLOR = qRgb(255, 255, 255);
+const std::int32_t MiscellaneousAction::DEFAULT_MEMORY_BUDGET = 4096;
 
 MiscellaneousAction::MiscellaneousAction(QObject* parent, const QString& title) :
     VerticalGroupAction(parent, title),
     _scatterplotPlugin(dynamic_cast<ScatterplotPlugin*>(parent->parent())),
-    _backgroundColorAction(this, "Background color")
+    _backgroundColorAction(this, "Background color"),
+    _memoryBudgetAction(this, "Memory budget", 0, 1024 * 1024, DEFAULT_MEMORY_BUDGET),
+    _memoryUsageAction(this, "Memory usage"),
+    _neighbourCapAction(this, "Neighbour cap", 0, 1000000, 0),
+    _topDimensionsAction(this, "Top dimensions per point", 0, 1000, 0),
+    _dimensionPruningAction(this, "Prune dimensions"),
+    _threadsAction(this, "Threads", 0, parallel::getNumProcessors(), 0),
+    _landmarksAction(this, "Landmarks", 0, 1000000, 0),
+    _landmarkSelectionAction(this, "Landmark selection", { "Random", "Farthest point" }, "Farthest point"),
+    _landmarkInterpolationAction(this, "Landmark interpolation", { "Nearest landmark", "Inverse distance" }, "Inverse distance"),
+    _adaptiveNeighboursAction(this, "Adaptive neighbours", 0, 1000, 0),
+    _adaptiveRadiusScaleAction(this, "Adaptive radius scale", 0.1f, 10.0f, 1.0f, 2),
+    _liveExplanationAction(this, "Live explanation"),
+    _liveUpdateIntervalAction(this, "Live update interval", 0, 10000, 250),
+    _liveUpdateToleranceAction(this, "Live update tolerance", 0.0f, 1.0f, 0.1f, 2),
+    _recordTraceAction(this, "Record trace"),
+    _exportTraceAction(this, "Export trace")
 {
     setIcon(Application::getIconFont("FontAwesome").getIcon("cog"));
     setLabelSizingType(LabelSizingType::Auto);
     setConfigurationFlag(WidgetAction::ConfigurationFlag::ForceCollapsedInGroup);
 
     addAction(&_backgroundColorAction);
+    addAction(&_memoryBudgetAction);
+    addAction(&_memoryUsageAction);
+    addAction(&_neighbourCapAction);
+    addAction(&_topDimensionsAction);
+    addAction(&_dimensionPruningAction);
+    addAction(&_threadsAction);
+    addAction(&_landmarksAction);
+    addAction(&_landmarkSelectionAction);
+    addAction(&_landmarkInterpolationAction);
+    addAction(&_adaptiveNeighboursAction);
+    addAction(&_adaptiveRadiusScaleAction);
+    addAction(&_liveExplanationAction);
+    addAction(&_liveUpdateIntervalAction);
+    addAction(&_liveUpdateToleranceAction);
+    addAction(&_recordTraceAction);
+    addAction(&_exportTraceAction);
 
     _backgroundColorAction.setColor(DEFAULT_BACKGROUND_COLOR);
 
@@ -28,6 +67,52 @@ MiscellaneousAction::MiscellaneousAction(QObject* parent, const QString& title)
     });
 
     updateBackgroundColor();
+
+    _memoryBudgetAction.setSuffix(" MB");
+    _memoryBudgetAction.setToolTip("Memory budget of the explanation, neighbourhoods are sampled when exact ones do not fit (0 disables the budget)");
+
+    _memoryUsageAction.setToolTip("Memory held by the explanation data structures");
+    _memoryUsageAction.setEnabled(false);
+
+    _neighbourCapAction.setToolTip("Maximum number of neighbours per neighbourhood, larger neighbourhoods are randomly sampled (0 disables the cap)");
+
+    _topDimensionsAction.setToolTip("Only keep the ranks of this many top ranked dimensions per point, for datasets with very many dimensions (0 keeps the ranks of all dimensions)");
+    _dimensionPruningAction.setToolTip("Skip the statistics of dimensions that provably cannot enter the top dimensions of any point, the top dimensions stay exact but their ranks are normalized approximately");
+
+    _threadsAction.setToolTip("Maximum number of threads of the explanation, e.g. to leave cores to other work on a shared machine (0 uses all cores)");
+
+    _landmarksAction.setToolTip("Only explain this many landmark points exactly and interpolate the other points from them (0 explains all points exactly)");
+    _landmarkSelectionAction.setToolTip("How the landmarks are chosen from the projection");
+    _landmarkInterpolationAction.setToolTip("How the points take the explanation of the landmarks");
+
+    _adaptiveNeighboursAction.setToolTip("Give every point a radius at the distance of its k-th nearest neighbour, so dense and sparse regions get neighbourhoods of similar size (0 uses the global radius)");
+    _adaptiveRadiusScaleAction.setToolTip("Scale of the adaptive radii relative to the k-th nearest neighbour distance");
+
+    _liveExplanationAction.setToolTip("Update the explanation while the positions change, e.g. while an embedding is running");
+    _liveUpdateIntervalAction.setSuffix(" ms");
+    _liveUpdateIntervalAction.setToolTip("Minimum time between two live updates of the explanation");
+    _liveUpdateToleranceAction.setToolTip("Distance a point has to move before its neighbourhoods are updated, as a fraction of the neighbourhood radius");
+
+    _recordTraceAction.setToolTip("Record timing spans of the explanation pipeline");
+    _exportTraceAction.setToolTip("Save the recorded spans as a Chrome trace (open in chrome://tracing or Perfetto)");
+
+    connect(&_recordTraceAction, &ToggleAction::toggled, this, [](bool toggled) {
+        // A new recording replaces the previous one
+        if (toggled)
+            tracing::clear();
+
+        tracing::setEnabled(toggled);
+    });
+
+    connect(&_exportTraceAction, &TriggerAction::triggered, this, []() {
+        const auto filePath = QFileDialog::getSaveFileName(nullptr, "Export trace", "projection-explorer-trace.json", "Chrome trace (*.json)");
+
+        if (filePath.isEmpty())
+            return;
+
+        if (!tracing::writeChromeTrace(filePath.toStdString()))
+            qWarning() << "Could not write trace to" << filePath;
+    });
 }
 
 QMenu* MiscellaneousAction::getContextMenu()
@@ -50,6 +135,19 @@ void MiscellaneousAction::connectToPublicAction(WidgetAction* publicAction, bool
 
     if (recursive) {
         actions().connectPrivateActionToPublicAction(&_backgroundColorAction, &publicMiscellaneousAction->getBackgroundColorAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_memoryBudgetAction, &publicMiscellaneousAction->getMemoryBudgetAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_neighbourCapAction, &publicMiscellaneousAction->getNeighbourCapAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_topDimensionsAction, &publicMiscellaneousAction->getTopDimensionsAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_dimensionPruningAction, &publicMiscellaneousAction->getDimensionPruningAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_threadsAction, &publicMiscellaneousAction->getThreadsAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_landmarksAction, &publicMiscellaneousAction->getLandmarksAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_landmarkSelectionAction, &publicMiscellaneousAction->getLandmarkSelectionAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_landmarkInterpolationAction, &publicMiscellaneousAction->getLandmarkInterpolationAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_adaptiveNeighboursAction, &publicMiscellaneousAction->getAdaptiveNeighboursAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_adaptiveRadiusScaleAction, &publicMiscellaneousAction->getAdaptiveRadiusScaleAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_liveExplanationAction, &publicMiscellaneousAction->getLiveExplanationAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_liveUpdateIntervalAction, &publicMiscellaneousAction->getLiveUpdateIntervalAction(), recursive);
+        actions().connectPrivateActionToPublicAction(&_liveUpdateToleranceAction, &publicMiscellaneousAction->getLiveUpdateToleranceAction(), recursive);
     }
 
     GroupAction::connectToPublicAction(publicAction, recursive);
@@ -62,6 +160,19 @@ void MiscellaneousAction::disconnectFromPublicAction(bool recursive)
 
     if (recursive) {
         actions().disconnectPrivateActionFromPublicAction(&_backgroundColorAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_memoryBudgetAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_neighbourCapAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_topDimensionsAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_dimensionPruningAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_threadsAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_landmarksAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_landmarkSelectionAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_landmarkInterpolationAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_adaptiveNeighboursAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_adaptiveRadiusScaleAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_liveExplanationAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_liveUpdateIntervalAction, recursive);
+        actions().disconnectPrivateActionFromPublicAction(&_liveUpdateToleranceAction, recursive);
     }
 
     GroupAction::disconnectFromPublicAction(recursive);
@@ -72,6 +183,19 @@ void MiscellaneousAction::fromVariantMap(const QVariantMap& variantMap)
     GroupAction::fromVariantMap(variantMap);
 
     _backgroundColorAction.fromParentVariantMap(variantMap);
+    _memoryBudgetAction.fromParentVariantMap(variantMap);
+    _neighbourCapAction.fromParentVariantMap(variantMap);
+    _topDimensionsAction.fromParentVariantMap(variantMap);
+    _dimensionPruningAction.fromParentVariantMap(variantMap);
+    _threadsAction.fromParentVariantMap(variantMap);
+    _landmarksAction.fromParentVariantMap(variantMap);
+    _landmarkSelectionAction.fromParentVariantMap(variantMap);
+    _landmarkInterpolationAction.fromParentVariantMap(variantMap);
+    _adaptiveNeighboursAction.fromParentVariantMap(variantMap);
+    _adaptiveRadiusScaleAction.fromParentVariantMap(variantMap);
+    _liveExplanationAction.fromParentVariantMap(variantMap);
+    _liveUpdateIntervalAction.fromParentVariantMap(variantMap);
+    _liveUpdateToleranceAction.fromParentVariantMap(variantMap);
 }
 
 QVariantMap MiscellaneousAction::toVariantMap() const
@@ -79,6 +203,19 @@ QVariantMap MiscellaneousAction::toVariantMap() const
     auto variantMap = GroupAction::toVariantMap();
 
     _backgroundColorAction.insertIntoVariantMap(variantMap);
+    _memoryBudgetAction.insertIntoVariantMap(variantMap);
+    _neighbourCapAction.insertIntoVariantMap(variantMap);
+    _topDimensionsAction.insertIntoVariantMap(variantMap);
+    _dimensionPruningAction.insertIntoVariantMap(variantMap);
+    _threadsAction.insertIntoVariantMap(variantMap);
+    _landmarksAction.insertIntoVariantMap(variantMap);
+    _landmarkSelectionAction.insertIntoVariantMap(variantMap);
+    _landmarkInterpolationAction.insertIntoVariantMap(variantMap);
+    _adaptiveNeighboursAction.insertIntoVariantMap(variantMap);
+    _adaptiveRadiusScaleAction.insertIntoVariantMap(variantMap);
+    _liveExplanationAction.insertIntoVariantMap(variantMap);
+    _liveUpdateIntervalAction.insertIntoVariantMap(variantMap);
+    _liveUpdateToleranceAction.insertIntoVariantMap(variantMap);
 
     return variantMap;
 }
\ No newline at end of file
@@ -2,6 +2,12 @@
 
 #include <actions/VerticalGroupAction.h>
 #include <actions/ColorAction.h>
+#include <actions/DecimalAction.h>
+#include <actions/IntegralAction.h>
+#include <actions/OptionAction.h>
+#include <actions/StringAction.h>
+#include <actions/ToggleAction.h>
+#include <actions/TriggerAction.h>
 
 using namespace mv::gui;
 
@@ -13,6 +19,7 @@ class ScatterplotPlugin;
  * Miscellaneous action class
  *
  * Action class for configuring miscellaneous settings (such as the background color)
+ * and for the resources of the explanation (memory budget, threads and tracing)
  *
  * @author Thomas Kroes
  */
@@ -65,12 +72,45 @@ public: // Serialization
 public: // Action getters
 
     ColorAction& getBackgroundColorAction() { return _backgroundColorAction; }
+    IntegralAction& getMemoryBudgetAction() { return _memoryBudgetAction; }
+    StringAction& getMemoryUsageAction() { return _memoryUsageAction; }
+    IntegralAction& getNeighbourCapAction() { return _neighbourCapAction; }
+    IntegralAction& getTopDimensionsAction() { return _topDimensionsAction; }
+    ToggleAction& getDimensionPruningAction() { return _dimensionPruningAction; }
+    IntegralAction& getThreadsAction() { return _threadsAction; }
+    IntegralAction& getLandmarksAction() { return _landmarksAction; }
+    OptionAction& getLandmarkSelectionAction() { return _landmarkSelectionAction; }
+    OptionAction& getLandmarkInterpolationAction() { return _landmarkInterpolationAction; }
+    IntegralAction& getAdaptiveNeighboursAction() { return _adaptiveNeighboursAction; }
+    DecimalAction& getAdaptiveRadiusScaleAction() { return _adaptiveRadiusScaleAction; }
+    ToggleAction& getLiveExplanationAction() { return _liveExplanationAction; }
+    IntegralAction& getLiveUpdateIntervalAction() { return _liveUpdateIntervalAction; }
+    DecimalAction& getLiveUpdateToleranceAction() { return _liveUpdateToleranceAction; }
+    ToggleAction& getRecordTraceAction() { return _recordTraceAction; }
+    TriggerAction& getExportTraceAction() { return _exportTraceAction; }
 
 private:
     ScatterplotPlugin*  _scatterplotPlugin;         /** Pointer to scatter plot plugin */
     ColorAction         _backgroundColorAction;     /** Color action for settings the background color action */
+    IntegralAction      _memoryBudgetAction;        /** Memory budget of the explanation in megabytes (0 is unlimited) */
+    StringAction        _memoryUsageAction;         /** Read-only memory usage of the explanation */
+    IntegralAction      _neighbourCapAction;        /** Maximum number of neighbours per neighbourhood (0 is no cap) */
+    IntegralAction      _topDimensionsAction;       /** Number of top ranked dimensions kept per point (0 keeps the ranks of all dimensions) */
+    ToggleAction        _dimensionPruningAction;    /** Whether the top dimensions skip the dimensions that cannot enter them */
+    IntegralAction      _threadsAction;             /** Maximum number of threads of the explanation (0 uses all cores) */
+    IntegralAction      _landmarksAction;           /** Number of landmarks of the approximate explanation (0 is exact) */
+    OptionAction        _landmarkSelectionAction;   /** Selection of the landmarks (random or farthest point) */
+    OptionAction        _landmarkInterpolationAction; /** Interpolation of the landmark ranks (nearest or inverse distance) */
+    IntegralAction      _adaptiveNeighboursAction;  /** Neighbour rank k of the density-adaptive radii (0 is the global radius) */
+    DecimalAction       _adaptiveRadiusScaleAction; /** Scale of the adaptive radii relative to the k-th neighbour distance */
+    ToggleAction        _liveExplanationAction;     /** Whether the explanation follows changing positions (e.g. a running embedding) */
+    IntegralAction      _liveUpdateIntervalAction;  /** Minimum time between two live updates in milliseconds */
+    DecimalAction       _liveUpdateToleranceAction; /** Distance a point moves before its neighbourhoods are updated, as a fraction of the radius */
+    ToggleAction        _recordTraceAction;         /** Toggle action for recording a trace of the explanation pipeline */
+    TriggerAction       _exportTraceAction;         /** Trigger action for exporting the recorded trace */
 
     static const QColor DEFAULT_BACKGROUND_COLOR;
+    static const std::int32_t DEFAULT_MEMORY_BUDGET;
 
     friend class mv::AbstractActionsManager;
 };
@@ -15,7 +15,9 @@ PointPlotAction::PointPlotAction(QObject* parent, const QString& title) :
     _pointSizeScalars(),
     _pointOpacityScalars(),
     _focusSelection(this, "Focus selection"),
-    _lastOpacitySourceIndex(-1)
+    _lastOpacitySourceIndex(-1),
+    _pointSizeGeneration(0),
+    _pointOpacityGeneration(0)
 {
     setToolTip("Point plot settings");
     setConfigurationFlag(WidgetAction::ConfigurationFlag::NoLabelInGroup);
@@ -150,8 +152,8 @@ void PointPlotAction::initialize(ScatterplotPlugin* scatterplotPlugin)
 
     connect(&_scatterplotPlugin->getPositionDataset(), &Dataset<Points>::childAdded, this, &PointPlotAction::updateDefaultDatasets);
     connect(&_scatterplotPlugin->getPositionDataset(), &Dataset<Points>::childRemoved, this, &PointPlotAction::updateDefaultDatasets);
-    connect(&_scatterplotPlugin->getPositionDataset(), &Dataset<Points>::dataSelectionChanged, this, &PointPlotAction::updateScatterPlotWidgetPointSizeScalars);
-    connect(&_scatterplotPlugin->getPositionDataset(), &Dataset<Points>::dataSelectionChanged, this, &PointPlotAction::updateScatterPlotWidgetPointOpacityScalars);
+    connect(&_scatterplotPlugin->getSelectionState(), &SelectionState::changed, this, &PointPlotAction::updateScatterPlotWidgetPointSizeScalarsForSelection);
+    connect(&_scatterplotPlugin->getSelectionState(), &SelectionState::changed, this, &PointPlotAction::updateScatterPlotWidgetPointOpacityScalarsForSelection);
 
     connect(&_sizeAction, &ScalarAction::magnitudeChanged, this, &PointPlotAction::updateScatterPlotWidgetPointSizeScalars);
     connect(&_sizeAction, &ScalarAction::offsetChanged, this, &PointPlotAction::updateScatterPlotWidgetPointSizeScalars);
@@ -253,23 +255,16 @@ void PointPlotAction::updateScatterPlotWidgetPointSizeScalars()
 
     std::fill(_pointSizeScalars.begin(), _pointSizeScalars.end(), _sizeAction.getMagnitudeAction().getValue());
 
-    if (_sizeAction.isSourceSelection()) {
-        auto positionDataset = _scatterplotPlugin->getPositionDataset();
+    const auto& selectionState = _scatterplotPlugin->getSelectionState();
 
-        std::fill(_pointSizeScalars.begin(), _pointSizeScalars.end(), _sizeAction.getMagnitudeAction().getValue());
+    _pointSizeGeneration = selectionState.getGeneration();
 
+    if (_sizeAction.isSourceSelection()) {
         const auto pointSizeSelectedPoints = _sizeAction.getMagnitudeAction().getValue() + _sizeAction.getSourceAction().getOffsetAction().getValue();
 
-        std::vector<bool> selected;
-
-        positionDataset->selectedLocalIndices(positionDataset->getSelection<Points>()->indices, selected);
-
-        for (int i = 0; i < selected.size(); i++) {
-            if (!selected[i])
-                continue;
-
-            _pointSizeScalars[i] = pointSizeSelectedPoints;
-        }
+        if (selectionState.getNumPoints() == numberOfPoints)
+            for (const auto& selectionIndex : selectionState.getSelectedIndices())
+                _pointSizeScalars[selectionIndex] = pointSizeSelectedPoints;
     }
 
     if (_sizeAction.isSourceDataset()) {
@@ -321,20 +316,17 @@ void PointPlotAction::updateScatterPlotWidgetPointOpacityScalars()
 
     std::fill(_pointOpacityScalars.begin(), _pointOpacityScalars.end(), opacityMagnitude);
 
-    if (_opacityAction.isSourceSelection()) {
-        auto positionDataset    = _scatterplotPlugin->getPositionDataset();
-        auto selectionSet       = positionDataset->getSelection<Points>();
+    const auto& selectionState = _scatterplotPlugin->getSelectionState();
 
-        std::fill(_pointOpacityScalars.begin(), _pointOpacityScalars.end(), 0.01f * _opacityAction.getMagnitudeAction().getValue());
+    _pointOpacityGeneration = selectionState.getGeneration();
 
+    if (_opacityAction.isSourceSelection()) {
         const auto opacityOffset                = 0.01f * _opacityAction.getSourceAction().getOffsetAction().getValue();
         const auto pointOpacitySelectedPoints   = std::min(1.0f, opacityMagnitude + opacityOffset);
 
-        std::vector<uint32_t> localSelectionIndices;
-        positionDataset->getLocalSelectionIndices(localSelectionIndices);
-
-        for (const auto& selectionIndex : localSelectionIndices)
-            _pointOpacityScalars[selectionIndex] = pointOpacitySelectedPoints;
+        if (selectionState.getNumPoints() == numberOfPoints)
+            for (const auto& selectionIndex : selectionState.getSelectedIndices())
+                _pointOpacityScalars[selectionIndex] = pointOpacitySelectedPoints;
     }
 
     if (_opacityAction.isSourceDataset()) {
@@ -375,6 +367,69 @@ void PointPlotAction::updateScatterPlotWidgetPointOpacityScalars()
     _scatterplotPlugin->getScatterplotWidget().setPointOpacityScalars(_pointOpacityScalars);
 }
 
+void PointPlotAction::updateScatterPlotWidgetPointSizeScalarsForSelection()
+{
+    if (_scatterplotPlugin == nullptr)
+        return;
+
+    const auto& selectionState = _scatterplotPlugin->getSelectionState();
+
+    // The point size only depends on the selection when the selection is the source
+    if (!_sizeAction.isSourceSelection()) {
+        _pointSizeGeneration = selectionState.getGeneration();
+        return;
+    }
+
+    if (!selectionState.hasDeltaSince(_pointSizeGeneration) || _pointSizeScalars.size() != selectionState.getNumPoints()) {
+        updateScatterPlotWidgetPointSizeScalars();
+        return;
+    }
+
+    const auto pointSizeMagnitude       = _sizeAction.getMagnitudeAction().getValue();
+    const auto pointSizeSelectedPoints  = pointSizeMagnitude + _sizeAction.getSourceAction().getOffsetAction().getValue();
+    const auto& mask                    = selectionState.getMask();
+
+    for (const auto& changedIndex : selectionState.getChangedIndices())
+        _pointSizeScalars[changedIndex] = mask[changedIndex] ? pointSizeSelectedPoints : pointSizeMagnitude;
+
+    _pointSizeGeneration = selectionState.getGeneration();
+
+    const auto maximumPointSize = selectionState.getNumSelected() > 0 ? std::max(pointSizeMagnitude, pointSizeSelectedPoints) : pointSizeMagnitude;
+
+    _scatterplotPlugin->getScatterplotWidget().setPointSizeScalars(_pointSizeScalars, static_cast<float>(maximumPointSize));
+}
+
+void PointPlotAction::updateScatterPlotWidgetPointOpacityScalarsForSelection()
+{
+    if (_scatterplotPlugin == nullptr)
+        return;
+
+    const auto& selectionState = _scatterplotPlugin->getSelectionState();
+
+    // The point opacity only depends on the selection when the selection is the source
+    if (!_opacityAction.isSourceSelection()) {
+        _pointOpacityGeneration = selectionState.getGeneration();
+        return;
+    }
+
+    if (!selectionState.hasDeltaSince(_pointOpacityGeneration) || _pointOpacityScalars.size() != selectionState.getNumPoints()) {
+        updateScatterPlotWidgetPointOpacityScalars();
+        return;
+    }
+
+    const auto opacityMagnitude             = 0.01f * _opacityAction.getMagnitudeAction().getValue();
+    const auto opacityOffset                = 0.01f * _opacityAction.getSourceAction().getOffsetAction().getValue();
+    const auto pointOpacitySelectedPoints   = std::min(1.0f, opacityMagnitude + opacityOffset);
+    const auto& mask                        = selectionState.getMask();
+
+    for (const auto& changedIndex : selectionState.getChangedIndices())
+        _pointOpacityScalars[changedIndex] = mask[changedIndex] ? pointOpacitySelectedPoints : opacityMagnitude;
+
+    _pointOpacityGeneration = selectionState.getGeneration();
+
+    _scatterplotPlugin->getScatterplotWidget().setPointOpacityScalars(_pointOpacityScalars);
+}
+
 void PointPlotAction::connectToPublicAction(WidgetAction* publicAction, bool recursive)
 {
     auto publicPointPlotAction = dynamic_cast<PointPlotAction*>(publicAction);
@@ -69,6 +69,12 @@ protected:
     /** Update the scatter plot widget point opacity scalars */
     void updateScatterPlotWidgetPointOpacityScalars();
 
+    /** Update the point size scalars of the points whose selection changed (falls back to a full update when needed) */
+    void updateScatterPlotWidgetPointSizeScalarsForSelection();
+
+    /** Update the point opacity scalars of the points whose selection changed (falls back to a full update when needed) */
+    void updateScatterPlotWidgetPointOpacityScalarsForSelection();
+
 protected: // Linking
 
     /**
@@ -112,6 +118,8 @@ private:
     std::vector<float>      _pointOpacityScalars;       /** Cached point opacity scalars */
     ToggleAction            _focusSelection;            /** Focus selection action */
     std::int32_t            _lastOpacitySourceIndex;    /** Last opacity source index that was selected */
+    std::uint64_t           _pointSizeGeneration;       /** Selection state generation the point size scalars are synchronized with */
+    std::uint64_t           _pointOpacityGeneration;    /** Selection state generation the point opacity scalars are synchronized with */
 
     static constexpr double DEFAULT_POINT_SIZE      = 10.0;     /** Default point size */
     static constexpr double DEFAULT_POINT_OPACITY   = 50.0;     /** Default point opacity */
@@ -1,5 +1,7 @@
 #include "ScatterplotPlugin.h"
 #include "ScatterplotWidget.h"
+#include "SelectionAlgebra.h"
+#include "Explanation/Tracing.h"
 #include "DataHierarchyItem.h"
 #include "Application.h"
 
@@ -27,6 +29,7 @@
 #include <algorithm>
 #include <functional>
 #include <limits>
+#include <numeric>
 #include <set>
 #include <vector>
 #include <iostream>
@@ -43,8 +46,10 @@ ScatterplotPlugin::ScatterplotPlugin(const PluginFactory* factory) :
     _positionSourceDataset(),
     _positions(),
     _numPoints(0),
+    _selectionState(),
     _scatterPlotWidget(new ScatterplotWidget(_explanationModel)),
     _explanationWidget(new ExplanationWidget(_explanationModel)),
+    _interactionScheduler(this),
     _dropWidget(nullptr),
     _settingsAction(this, "Settings"),
     _primaryToolbarAction(this, "Primary Toolbar"),
@@ -97,6 +102,141 @@ ScatterplotPlugin::ScatterplotPlugin(const PluginFactory* factory) :
     connect(&_explanationModel, &ExplanationModel::explanationMetricChanged, this, &ScatterplotPlugin::explanationMetricChanged);
     connect(&_explanationModel, &ExplanationModel::datasetDimensionsChanged, this, &ScatterplotPlugin::datasetDimensionsChanged);
     connect(&_explanationWidget->getBarchart(), &BarChart::dimensionExcluded, &_explanationModel, &ExplanationModel::excludeDimension);
+    connect(&_interactionScheduler, &InteractionScheduler::projectionUpdate, this, &ScatterplotPlugin::processProjectionUpdate);
+    connect(&_interactionScheduler, &InteractionScheduler::radiusUpdate, this, &ScatterplotPlugin::processRadiusUpdate);
+    connect(&_interactionScheduler, &InteractionScheduler::lensUpdate, this, &ScatterplotPlugin::processLensUpdate);
+    connect(&_interactionScheduler, &InteractionScheduler::selectionUpdate, this, &ScatterplotPlugin::processSelectionUpdate);
+
+    // Keep the explanation within the memory budget, a new budget rebuilds the neighbourhoods
+    auto& memoryBudgetAction = _settingsAction.getMiscellaneousAction().getMemoryBudgetAction();
+
+    _explanationModel.getCore().setMemoryBudget(static_cast<std::size_t>(memoryBudgetAction.getValue()) * 1024 * 1024);
+
+    connect(&memoryBudgetAction, &IntegralAction::valueChanged, this, [this](const std::int32_t& value) {
+        _explanationModel.getCore().setMemoryBudget(static_cast<std::size_t>(value) * 1024 * 1024);
+
+        if (_explanationModel.hasDataset())
+            _interactionScheduler.requestRadiusUpdate();
+    });
+
+    // Cap the neighbourhood sizes, a new cap resamples the neighbourhoods
+    auto& neighbourCapAction = _settingsAction.getMiscellaneousAction().getNeighbourCapAction();
+
+    _explanationModel.getCore().setNeighbourCap(neighbourCapAction.getValue());
+
+    connect(&neighbourCapAction, &IntegralAction::valueChanged, this, [this](const std::int32_t& value) {
+        _explanationModel.getCore().setNeighbourCap(value);
+
+        if (_explanationModel.hasDataset())
+            _interactionScheduler.requestRadiusUpdate();
+    });
+
+    // Keep only the top ranked dimensions of every point, the neighbourhoods stay and the points are ranked again
+    auto& topDimensionsAction = _settingsAction.getMiscellaneousAction().getTopDimensionsAction();
+
+    _explanationModel.getCore().setTopK(topDimensionsAction.getValue());
+
+    connect(&topDimensionsAction, &IntegralAction::valueChanged, this, [this](const std::int32_t& value) {
+        _explanationModel.getCore().setTopK(value);
+
+        colorPointsByRanking();
+    });
+
+    // Prune the dimensions that cannot enter the top dimensions, only has an effect with top dimensions set
+    auto& dimensionPruningAction = _settingsAction.getMiscellaneousAction().getDimensionPruningAction();
+
+    _explanationModel.getCore().setDimensionPruning(dimensionPruningAction.isChecked());
+
+    connect(&dimensionPruningAction, &ToggleAction::toggled, this, [this](bool toggled) {
+        _explanationModel.getCore().setDimensionPruning(toggled);
+
+        if (_explanationModel.getCore().getTopK() > 0)
+            colorPointsByRanking();
+    });
+
+    // The thread cap applies from the next computation on, nothing has to be recomputed
+    auto& threadsAction = _settingsAction.getMiscellaneousAction().getThreadsAction();
+
+    _explanationModel.getCore().setNumThreads(threadsAction.getValue());
+
+    connect(&threadsAction, &IntegralAction::valueChanged, this, [this](const std::int32_t& value) {
+        _explanationModel.getCore().setNumThreads(value);
+    });
+
+    // Landmarks replace the exact explanation of every point by an interpolation when set
+    auto& miscellaneousAction = _settingsAction.getMiscellaneousAction();
+
+    const auto updateLandmarkParameters = [this]() -> void {
+        auto& miscellaneousAction = _settingsAction.getMiscellaneousAction();
+
+        LandmarkParameters parameters;
+        parameters.numLandmarks = miscellaneousAction.getLandmarksAction().getValue();
+        parameters.selection = miscellaneousAction.getLandmarkSelectionAction().getCurrentIndex() == 0 ? LandmarkSelection::RANDOM : LandmarkSelection::FARTHEST_POINT;
+        parameters.interpolation = miscellaneousAction.getLandmarkInterpolationAction().getCurrentIndex() == 0 ? LandmarkInterpolation::NEAREST : LandmarkInterpolation::INVERSE_DISTANCE;
+
+        _explanationModel.getCore().setLandmarkParameters(parameters);
+
+        if (_explanationModel.hasDataset())
+            _interactionScheduler.requestRadiusUpdate();
+    };
+
+    updateLandmarkParameters();
+
+    connect(&miscellaneousAction.getLandmarksAction(), &IntegralAction::valueChanged, this, updateLandmarkParameters);
+    connect(&miscellaneousAction.getLandmarkSelectionAction(), &OptionAction::currentIndexChanged, this, updateLandmarkParameters);
+    connect(&miscellaneousAction.getLandmarkInterpolationAction(), &OptionAction::currentIndexChanged, this, updateLandmarkParameters);
+
+    // Density-adaptive radii replace the global radius by a per-point radius at the k-th neighbour distance
+    const auto updateAdaptiveRadius = [this]() -> void {
+        auto& miscellaneousAction = _settingsAction.getMiscellaneousAction();
+
+        _explanationModel.getCore().setAdaptiveRadius(miscellaneousAction.getAdaptiveNeighboursAction().getValue(), miscellaneousAction.getAdaptiveRadiusScaleAction().getValue());
+
+        if (_explanationModel.hasDataset())
+            _interactionScheduler.requestRadiusUpdate();
+    };
+
+    updateAdaptiveRadius();
+
+    connect(&miscellaneousAction.getAdaptiveNeighboursAction(), &IntegralAction::valueChanged, this, updateAdaptiveRadius);
+    connect(&miscellaneousAction.getAdaptiveRadiusScaleAction(), &DecimalAction::valueChanged, this, updateAdaptiveRadius);
+
+    // Live explanations follow iterating embeddings at most once per update interval
+    auto& liveUpdateIntervalAction = miscellaneousAction.getLiveUpdateIntervalAction();
+    auto& liveUpdateToleranceAction = miscellaneousAction.getLiveUpdateToleranceAction();
+
+    _interactionScheduler.setProjectionInterval(liveUpdateIntervalAction.getValue());
+    _explanationModel.getCore().setStreamingTolerance(liveUpdateToleranceAction.getValue());
+
+    connect(&liveUpdateIntervalAction, &IntegralAction::valueChanged, this, [this](const std::int32_t& value) {
+        _interactionScheduler.setProjectionInterval(value);
+    });
+
+    connect(&liveUpdateToleranceAction, &DecimalAction::valueChanged, this, [this](const float& value) {
+        _explanationModel.getCore().setStreamingTolerance(value);
+    });
+
+    // Catch up with the positions that changed while the live explanation was off
+    connect(&miscellaneousAction.getLiveExplanationAction(), &ToggleAction::toggled, this, [this](bool toggled) {
+        if (toggled && _explanationModel.hasDataset())
+            _interactionScheduler.requestProjectionUpdate();
+    });
+
+    // Precomputing all slider positions replaces the per-position recompute, leaving the mode restores it
+    connect(_explanationWidget->getMultiScaleCheckBox(), &QCheckBox::toggled, this, [this](bool checked) {
+        if (!checked)
+            _explanationModel.getCore().clearMultiScale();
+
+        if (_explanationModel.hasDataset())
+            _interactionScheduler.requestRadiusUpdate();
+    });
+
+    // Rank the current selection again with the other ranking
+    connect(_explanationWidget->getLocalPCACheckBox(), &QCheckBox::toggled, this, [this]() {
+        if (_explanationModel.hasDataset())
+            _interactionScheduler.requestSelectionUpdate();
+    });
+
     //connect(_explanationWidget->getRankingComboBox(), &QComboBox::currentIndexChanged, this, &ScatterplotPlugin::dimensionRankingChanged);
     //connect(_explanationWidget->getVarianceColoringButton(), &QPushButton::pressed, this, &ScatterplotPlugin::colorByVariance);
     //connect(_explanationWidget->getValueColoringButton(), &QPushButton::pressed, this, &ScatterplotPlugin::colorByValue);
@@ -156,8 +296,13 @@ void ScatterplotPlugin::init()
     // Load points when the pointer to the position dataset changes
     connect(&_positionDataset, &Dataset<Points>::changed, this, &ScatterplotPlugin::positionDatasetChanged);
 
-    // Update points when the position dataset data changes
-    connect(&_positionDataset, &Dataset<Points>::dataChanged, this, &ScatterplotPlugin::updateData);
+    // Update points when the position dataset data changes, a live explanation follows the new positions
+    connect(&_positionDataset, &Dataset<Points>::dataChanged, this, [this]() {
+        updateData();
+
+        if (_settingsAction.getMiscellaneousAction().getLiveExplanationAction().isChecked() && _explanationModel.hasDataset())
+            _interactionScheduler.requestProjectionUpdate();
+    });
 
     // Update point selection when the position dataset data changes
     connect(&_positionDataset, &Dataset<Points>::dataSelectionChanged, this, &ScatterplotPlugin::updateSelection);
@@ -169,42 +314,9 @@ void ScatterplotPlugin::onDataEvent(mv::DatasetEvent* dataEvent)
     {
         if (dataEvent->getDataset() == _positionDataset)
         {
+            // Selection events (possibly broadcast by linked views) are coalesced to one explanation update per frame
             if (_positionDataset->isDerivedData())
-            {
-                mv::Dataset<Points> sourceDataset = _positionDataset->getSourceDataset<Points>();
-                mv::Dataset<Points> selection = sourceDataset->getSelection();
-
-                std::vector<float> dimRanking(_explanationModel.getDataset().numDimensions());
-
-                if (selection->indices.size() > 0)
-                {
-                    _explanationModel.computeDimensionRanks(dimRanking, selection->indices);
-                }
-
-                _explanationWidget->getBarchart().setRanking(dimRanking, selection->indices);
-                //std::vector<float> importantDims;
-                //QImage image = _explanation.computeEigenImage(selection->indices, importantDims);
-
-                //_explanationWidget->getBarchart().setRanking(dimRanking, selection->indices);
-                //_explanationWidget->getImageWidget().setImage(image);
-
-                //image.save(QString("eigImage%1.png").arg(0));
-                //////////////////
-                //std::vector<float> pixels(numDimensions, 0);
-                //for (int i = 0; i < eigenVectors.size(); i++)
-                //{
-                //    const std::vector<float>& eigenVector = eigenVectors[i];
-                //    
-                //    QImage image(28, 28, QImage::Format::Format_ARGB32);
-                //    for (int d = 0; d < numDimensions; d++)
-                //    {
-                //        int value = (int) (fabs(eigenVector[d]) * 255 * (sortedEigenValues[sortedIndices[i]] / eigenValueSum) * 10);
-                //        image.setPixel(d % 28, d / 28, qRgba(value, value, value, 255));
-                //    }
-                //    image.save(QString("eigImage%1.png").arg(i));
-                //}
-                //std::cout << "Saved eigen vectors" << std::endl;
-            }
+                _interactionScheduler.requestSelectionUpdate();
         }
     }
 }
@@ -289,13 +401,105 @@ void ScatterplotPlugin::neighbourhoodRadiusValueChanged(int value)
 {
     _scatterPlotWidget->setNeighbourhoodRadius(value / 100.0f);
 
+    _interactionScheduler.requestRadiusUpdate();
+}
+
+void ScatterplotPlugin::processProjectionUpdate()
+{
+    if (!_positionDataset.isValid() || !_explanationModel.hasDataset())
+        return;
+
+    TRACE_SCOPE("ScatterplotPlugin::processProjectionUpdate");
+
+    // A different number of points is new data rather than a new projection
+    if (!_explanationModel.updateProjection(_positionDataset))
+    {
+        positionDatasetChanged();
+        return;
+    }
+
+    const StreamingUpdate& streamingUpdate = _explanationModel.getCore().getLastStreamingUpdate();
+
+    if (streamingUpdate.numMoved == 0 && !streamingUpdate.fullRecompute)
+        return;
+
+    // The local statistics were updated together with the neighbourhoods
+    colorPointsByRanking(false);
+}
+
+void ScatterplotPlugin::processRadiusUpdate()
+{
+    TRACE_SCOPE("ScatterplotPlugin::processRadiusUpdate");
+
+    // Cluster explanations do not depend on the radius
+    if (colorPointsByCluster())
+        return;
+
+    // Landmark explanations find the neighbourhoods of the landmarks only
+    if (colorPointsByLandmarks())
+        return;
+
+    // With all slider positions precomputed only the colors are swapped
+    if (_explanationWidget->getMultiScaleCheckBox()->isChecked() && colorPointsByScaleLevel())
+        return;
+
+    const float neighbourhoodRadius = _explanationWidget->getRadiusSlider()->value() / 100.0f;
+
     int xDim = _settingsAction.getPositionAction().getDimensionX();
     int yDim = _settingsAction.getPositionAction().getDimensionY();
-    _explanationModel.recomputeNeighbourhood(value / 100.0f, xDim, yDim);
+    _explanationModel.recomputeNeighbourhood(neighbourhoodRadius, xDim, yDim);
 
     colorPointsByRanking();
 }
 
+void ScatterplotPlugin::processLensUpdate()
+{
+    if (!_positionDataset.isValid())
+        return;
+
+    TRACE_SCOPE("ScatterplotPlugin::processLensUpdate");
+
+    // Create vector for target selection indices
+    std::vector<std::uint32_t> targetSelectionIndices;
+    computeLensSelection(targetSelectionIndices);
+
+    // Apply the selection indices
+    _positionDataset->setSelectionIndices(targetSelectionIndices);
+
+    // Notify others that the selection changed (requests the selection update in the same batch)
+    events().notifyDatasetDataSelectionChanged(_positionDataset->getSourceDataset<Points>());
+}
+
+void ScatterplotPlugin::processSelectionUpdate()
+{
+    if (!_positionDataset.isValid() || !_positionDataset->isDerivedData())
+        return;
+
+    TRACE_SCOPE("ScatterplotPlugin::processSelectionUpdate");
+
+    mv::Dataset<Points> sourceDataset = _positionDataset->getSourceDataset<Points>();
+    mv::Dataset<Points> selection = sourceDataset->getSelection();
+
+    std::vector<float> dimRanking(_explanationModel.getDataset().numDimensions());
+
+    // The core stores the points in its own order
+    std::vector<unsigned int> selectionIndices = _explanationModel.toInternalIndices(selection->indices);
+
+    if (selectionIndices.size() > 0)
+    {
+        // Local PCA starts from the components of the previous selection, which converges quickly for a moving lens
+        if (_explanationWidget->getLocalPCACheckBox()->isChecked())
+            _explanationModel.computeLocalPCARanks(dimRanking, selectionIndices);
+        else
+            _explanationModel.computeDimensionRanks(dimRanking, selectionIndices);
+    }
+
+    // The model keeps the statistics of the selection it ranked last
+    _explanationWidget->getBarchart().setRanking(dimRanking, selectionIndices, _explanationModel.getSelectionStatistics());
+
+    _explanationWidget->update();
+}
+
 void ScatterplotPlugin::neighbourhoodRadiusSliderPressed()
 {
     _scatterPlotWidget->drawNeighbourhoodRadius(true);
@@ -313,22 +517,185 @@ void ScatterplotPlugin::explanationMetricChanged()
 
 void ScatterplotPlugin::datasetDimensionsChanged()
 {
-    std::cout << "Dim excluded" << std::endl;
     colorPointsByRanking();
 }
 
-void ScatterplotPlugin::colorPointsByRanking()
+void ScatterplotPlugin::colorPointsByRanking(bool updateMetrics)
 {
     if (!_explanationModel.hasDataset())
         return;
 
-    _explanationModel.recomputeMetrics();
+    if (colorPointsByCluster())
+        return;
+
+    if (colorPointsByLandmarks())
+        return;
+
+    if (_explanationWidget->getMultiScaleCheckBox()->isChecked() && colorPointsByScaleLevel())
+        return;
+
+    TRACE_SCOPE("ScatterplotPlugin::colorPointsByRanking");
+
+    if (updateMetrics)
+        _explanationModel.recomputeMetrics();
+
+    // Very high-dimensional data only keeps the top ranked dimensions of every point, there is no rank matrix
+    if (_explanationModel.getCore().hasTopRanks())
+    {
+        const TopRanks& topRanks = _explanationModel.getCore().getTopRanks();
+
+        _explanationModel.recomputeColorMapping(topRanks);
+
+        rankSelection();
+
+        setPointColors(topRanks.getTopDimensions(), _explanationModel.computeConfidences(topRanks));
+
+        updateMemoryUsage();
+
+        _explanationWidget->updateSamplingError(_explanationModel.getCore().getSamplingError());
+
+        return;
+    }
 
     Eigen::ArrayXXf dimRanking;
     _explanationModel.computeDimensionRanks(dimRanking);
 
     _explanationModel.recomputeColorMapping(dimRanking);
 
+    rankSelection();
+
+    std::vector<float> confidences = _explanationModel.computeConfidences(dimRanking);
+
+    // Build vector of top ranked dimensions
+    std::vector<int> topRankedDims;
+    _explanationModel.computeTopRankedDimensions(dimRanking, topRankedDims);
+
+    setPointColors(topRankedDims, confidences);
+
+    updateMemoryUsage();
+
+    _explanationWidget->updateSamplingError(_explanationModel.getCore().getSamplingError());
+}
+
+bool ScatterplotPlugin::colorPointsByScaleLevel()
+{
+    TRACE_SCOPE("ScatterplotPlugin::colorPointsByScaleLevel");
+
+    ExplanationCore& core = _explanationModel.getCore();
+
+    // The levels are dropped by the core when the data, metric or excluded dimensions change
+    if (core.getMultiScale().isEmpty())
+    {
+        const QSlider* radiusSlider = _explanationWidget->getRadiusSlider();
+
+        std::vector<float> radii;
+        for (int value = radiusSlider->minimum(); value <= radiusSlider->maximum(); value++)
+            radii.push_back(value / 100.0f);
+
+        int xDim = _settingsAction.getPositionAction().getDimensionX();
+        int yDim = _settingsAction.getPositionAction().getDimensionY();
+
+        if (!core.recomputeMultiScale(radii, xDim, yDim))
+            return false;
+    }
+
+    const MultiScaleExplanation& multiScale = core.getMultiScale();
+    const ScaleLevel& level = multiScale.getLevel(multiScale.findLevel(_explanationWidget->getRadiusSlider()->value() / 100.0f));
+
+    _explanationModel.applyScaleLevelColors(level);
+
+    rankSelection();
+
+    std::vector<int> topRankedDims(level.topDimensions.begin(), level.topDimensions.end());
+
+    std::vector<float> confidences(topRankedDims.size());
+    for (int i = 0; i < confidences.size(); i++)
+        confidences[i] = level.getConfidence(i);
+
+    setPointColors(topRankedDims, confidences);
+
+    updateMemoryUsage();
+
+    // The levels are not sampled
+    _explanationWidget->updateSamplingError(SamplingError());
+
+    return true;
+}
+
+bool ScatterplotPlugin::colorPointsByCluster()
+{
+    if (!_explanationModel.hasClusters())
+        return false;
+
+    TRACE_SCOPE("ScatterplotPlugin::colorPointsByCluster");
+
+    if (!_explanationModel.recomputeClusterExplanation())
+        return false;
+
+    rankSelection();
+
+    std::vector<int> topRankedDims;
+    std::vector<float> confidences;
+    _explanationModel.getCore().getClusterExplanation().broadcast(topRankedDims, confidences);
+
+    setPointColors(topRankedDims, confidences);
+
+    updateMemoryUsage();
+
+    // Clusters are explained from all their members
+    _explanationWidget->updateSamplingError(SamplingError());
+
+    return true;
+}
+
+bool ScatterplotPlugin::colorPointsByLandmarks()
+{
+    if (!_explanationModel.getCore().hasLandmarks())
+        return false;
+
+    TRACE_SCOPE("ScatterplotPlugin::colorPointsByLandmarks");
+
+    const float neighbourhoodRadius = _explanationWidget->getRadiusSlider()->value() / 100.0f;
+
+    int xDim = _settingsAction.getPositionAction().getDimensionX();
+    int yDim = _settingsAction.getPositionAction().getDimensionY();
+
+    if (!_explanationModel.recomputeLandmarkExplanation(neighbourhoodRadius, xDim, yDim))
+        return false;
+
+    rankSelection();
+
+    const LandmarkExplanation& landmarkExplanation = _explanationModel.getCore().getLandmarkExplanation();
+
+    setPointColors(landmarkExplanation.getTopDimensions(), landmarkExplanation.getConfidences());
+
+    updateMemoryUsage();
+
+    // The landmark neighbourhoods are not strided, the approximation quality is reported instead
+    _explanationWidget->updateSamplingError(SamplingError());
+
+    return true;
+}
+
+void ScatterplotPlugin::updateExplanationClusters()
+{
+    if (!_explanationModel.hasDataset())
+        return;
+
+    DatasetsAction& datasetsAction = _settingsAction.getDatasetsAction();
+
+    mv::Dataset<Clusters> clusters = datasetsAction.getClusterDatasetPickerAction().getCurrentDataset();
+
+    if (datasetsAction.getExplainClustersAction().isChecked() && clusters.isValid())
+        _explanationModel.setClusters(clusters, _positionDataset);
+    else
+        _explanationModel.clearClusters();
+
+    _interactionScheduler.requestRadiusUpdate();
+}
+
+void ScatterplotPlugin::rankSelection()
+{
     mv::Dataset<Points> sourceDataset = _positionDataset->getSourceDataset<Points>();
     mv::Dataset<Points> selection = sourceDataset->getSelection();
     
@@ -338,63 +705,104 @@ void ScatterplotPlugin::colorPointsByRanking()
         mv::Dataset<Points> sourceDataset = _positionDataset->getSourceDataset<Points>();
         if (sourceDataset->isFull())
         {
+            std::vector<unsigned int> selectionIndices = _explanationModel.toInternalIndices(selection->indices);
+
             std::vector<float> dimRanking(sourceDataset->getNumDimensions());
-            _explanationModel.computeDimensionRanks(dimRanking, selection->indices);
-            _explanationWidget->getBarchart().setRanking(dimRanking, selection->indices);
+            _explanationModel.computeDimensionRanks(dimRanking, selectionIndices);
+            _explanationWidget->getBarchart().setRanking(dimRanking, selectionIndices, _explanationModel.getSelectionStatistics());
         }
         else
         {
             std::vector<unsigned int> localSelectionIndices;
             sourceDataset->getLocalSelectionIndices(localSelectionIndices);
 
+            localSelectionIndices = _explanationModel.toInternalIndices(localSelectionIndices);
+
             std::vector<float> dimRanking(sourceDataset->getNumDimensions());
             _explanationModel.computeDimensionRanks(dimRanking, localSelectionIndices);
-            _explanationWidget->getBarchart().setRanking(dimRanking, localSelectionIndices);
+            _explanationWidget->getBarchart().setRanking(dimRanking, localSelectionIndices, _explanationModel.getSelectionStatistics());
         }
     }
+}
 
-    std::vector<float> confidences = _explanationModel.computeConfidences(dimRanking);
-
-    // Build vector of top ranked dimensions
-    std::vector<int> topRankedDims(dimRanking.rows());
-    
-    const DataTable& dataset = _explanationModel.getDataset();
-    for (int i = 0; i < dimRanking.rows(); i++)
-    {
-        std::vector<int> indices(dimRanking.cols());
-        std::iota(indices.begin(), indices.end(), 0); //Initializing
-
-        if (_explanationModel.currentMetric() == Explanation::Metric::VARIANCE)
-            std::sort(indices.begin(), indices.end(), [&](int a, int b) {return dimRanking(i, a) < dimRanking(i, b); });
-        else
-            std::sort(indices.begin(), indices.end(), [&](int a, int b) {return dimRanking(i, a) > dimRanking(i, b); });
-
-        int j = 0;
-        while (dataset.isExcluded(indices[j]) && j < dataset.numDimensions()-1) { j++; }
-        topRankedDims[i] = indices[j];
-    }
-
+void ScatterplotPlugin::setPointColors(const std::vector<int>& topRankedDims, const std::vector<float>& confidences)
+{
     // Color points by dimension ranking
     const std::vector<QColor>& colorMapping = _explanationModel.getColorMapping();
 
+    // The results are in the order of the core, the colors in the order of the dataset
+    const PointOrder& pointOrder = _explanationModel.getPointOrder();
+
     std::vector<Vector3f> colorData(topRankedDims.size());
     for (int i = 0; i < topRankedDims.size(); i++)
     {
         int dim = topRankedDims[i];
         float confidence = confidences[i];
 
-        if (dim < colorMapping.size())
+        if (dim >= 0 && dim < colorMapping.size())
         {
             QColor color = colorMapping[dim];
-            colorData[i] = Vector3f(color.redF() * confidence, color.greenF() * confidence, color.blueF() * confidence);
+            colorData[pointOrder.toOriginal(i)] = Vector3f(color.redF() * confidence, color.greenF() * confidence, color.blueF() * confidence);
         }
         else
-            colorData[i] = Vector3f(1.0f * confidence, 0.2f * confidence, 0.2f * confidence);
+            colorData[pointOrder.toOriginal(i)] = Vector3f(1.0f * confidence, 0.2f * confidence, 0.2f * confidence);
     }
 
     _scatterPlotWidget->setColors(colorData);
 }
 
+void ScatterplotPlugin::updateMemoryUsage()
+{
+    const ExplanationCore& core = _explanationModel.getCore();
+    const MemoryUsage memoryUsage = core.getMemoryUsage();
+
+    const auto toMegabytes = [](std::size_t bytes) -> QString {
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+    };
+
+    QString summary = toMegabytes(memoryUsage.total());
+
+    if (core.getNeighbourhoodStride() > 1)
+        summary += QString(" (neighbourhoods sampled 1/%1)").arg(core.getNeighbourhoodStride());
+
+    _settingsAction.getMiscellaneousAction().getMemoryUsageAction().setString(summary);
+
+    // Every recolor gets here (slider ticks, live updates), the breakdown is only logged when it changed
+    if (memoryUsage.total() == _loggedMemoryUsage && core.getNeighbourhoodStride() == _loggedNeighbourhoodStride)
+        return;
+
+    _loggedMemoryUsage = memoryUsage.total();
+    _loggedNeighbourhoodStride = core.getNeighbourhoodStride();
+
+    qDebug() << "Explanation memory:" << toMegabytes(memoryUsage.total())
+             << "- dataset" << toMegabytes(memoryUsage.dataset)
+             << "- neighbourhoods" << toMegabytes(memoryUsage.neighbourhoods)
+             << "- confidence neighbourhoods" << toMegabytes(memoryUsage.confidenceNeighbourhoods)
+             << "- local statistics" << toMegabytes(memoryUsage.localStatistics)
+             << "- rank matrix" << toMegabytes(memoryUsage.rankMatrix)
+             << "- top ranks" << toMegabytes(memoryUsage.topRanks)
+             << "- multi-scale levels" << toMegabytes(memoryUsage.multiScale)
+             << "- clusters" << toMegabytes(memoryUsage.clusters)
+             << "- landmarks" << toMegabytes(memoryUsage.landmarks)
+             << "- adaptive radii" << toMegabytes(memoryUsage.adaptiveRadii);
+
+    const std::vector<float>& landmarkQuality = core.getLandmarkExplanation().getQuality();
+
+    if (core.hasLandmarks() && !landmarkQuality.empty())
+        qDebug() << "Explanation interpolated from" << core.getLandmarkExplanation().numLandmarks() << "landmarks, mean approximation quality"
+                 << std::accumulate(landmarkQuality.begin(), landmarkQuality.end(), 0.0) / landmarkQuality.size();
+
+    const SamplingError& samplingError = core.getSamplingError();
+
+    if (samplingError.numSampledPoints > 0)
+        qDebug() << "Neighbourhoods of" << samplingError.numSampledPoints << "points sampled, relative standard error"
+                 << samplingError.meanError << "mean" << samplingError.maxError << "max";
+
+    if (core.getNeighbourhoodStride() > 1)
+        qWarning() << "Exact neighbourhoods need an estimated" << toMegabytes(core.getEstimatedNeighbourhoodMemory())
+                   << "which exceeds the memory budget, neighbourhoods are sampled with stride" << core.getNeighbourhoodStride();
+}
+
 void ScatterplotPlugin::loadData(const Datasets& datasets)
 {
     // Exit if there is nothing to load
@@ -465,49 +873,26 @@ void ScatterplotPlugin::selectPoints()
     // Selection should be subtracted when the selection process was aborted by the user (e.g. by pressing the escape key)
     const auto selectionModifier = _scatterPlotWidget->getPixelSelectionTool().isAborted() ? PixelSelectionModifierType::Subtract : _scatterPlotWidget->getPixelSelectionTool().getModifier();
 
+    // Combine the target selection with the current selection (result is sorted and unique)
     switch (selectionModifier)
     {
         case PixelSelectionModifierType::Replace:
+        {
+            selection::makeSortedUnique(targetSelectionIndices);
             break;
+        }
 
+        // Add points to the current selection
         case PixelSelectionModifierType::Add:
-        case PixelSelectionModifierType::Subtract:
         {
-            // Get reference to the indices of the selection set
-            auto& selectionSetIndices = selectionSet->indices;
-
-            // Create a set from the selection set indices
-            QSet<std::uint32_t> set(selectionSetIndices.begin(), selectionSetIndices.end());
-
-            switch (selectionModifier)
-            {
-                // Add points to the current selection
-                case PixelSelectionModifierType::Add:
-                {
-                    // Add indices to the set 
-                    for (const auto& targetIndex : targetSelectionIndices)
-                        set.insert(targetIndex);
-
-                    break;
-                }
-
-                // Remove points from the current selection
-                case PixelSelectionModifierType::Subtract:
-                {
-                    // Remove indices from the set 
-                    for (const auto& targetIndex : targetSelectionIndices)
-                        set.remove(targetIndex);
-
-                    break;
-                }
-
-                default:
-                    break;
-            }
-
-            // Convert set back to vector
-            targetSelectionIndices = std::vector<std::uint32_t>(set.begin(), set.end());
+            targetSelectionIndices = selection::combine(selectionSet->indices, targetSelectionIndices, selection::Operation::Add);
+            break;
+        }
 
+        // Remove points from the current selection
+        case PixelSelectionModifierType::Subtract:
+        {
+            targetSelectionIndices = selection::combine(selectionSet->indices, targetSelectionIndices, selection::Operation::Subtract);
             break;
         }
 
@@ -538,6 +923,8 @@ void ScatterplotPlugin::positionDatasetChanged()
     if (!_positionDataset.isValid())
         return;
 
+    TRACE_SCOPE("ScatterplotPlugin::positionDatasetChanged");
+
     ////// Print dataset
     //std::fstream fs;
     //fs.open("spam.2d", std::fstream::out);
@@ -584,6 +971,9 @@ void ScatterplotPlugin::positionDatasetChanged()
     _explanationModel.setDataset(_positionDataset->getSourceDataset<Points>(), _positionDataset);
     _explanationModel.recomputeNeighbourhood(0.1f, xDim, yDim);
 
+    // The clusters are dropped with the previous data, map them to the new points
+    updateExplanationClusters();
+
     colorPointsByRanking();
 
     _explanationWidget->getBarchart().update();
@@ -678,6 +1068,11 @@ void ScatterplotPlugin::updateData()
         // Extract 2-dimensional points from the data set based on the selected dimensions
         calculatePositions(*_positionDataset);
 
+        // Reset the selection state for the (possibly changed) set of points
+        std::vector<std::uint32_t> localGlobalIndices;
+        _positionDataset->getGlobalIndices(localGlobalIndices);
+        _selectionState.reset(localGlobalIndices);
+
         // Pass the 2D points to the scatter plot widget
         _scatterPlotWidget->setData(&_positions);
 
@@ -685,6 +1080,7 @@ void ScatterplotPlugin::updateData()
     }
     else {
         _positions.clear();
+        _selectionState.reset({});
         _scatterPlotWidget->setData(&_positions);
     }
 }
@@ -701,17 +1097,10 @@ void ScatterplotPlugin::updateSelection()
 
     auto selection = _positionDataset->getSelection<Points>();
 
-    std::vector<bool> selected;
-    std::vector<char> highlights;
-
-    _positionDataset->selectedLocalIndices(selection->indices, selected);
+    // Only the points whose selection status changed are touched, the mask doubles as highlight buffer
+    _selectionState.update(selection->indices);
 
-    highlights.resize(_positionDataset->getNumPoints(), 0);
-
-    for (int i = 0; i < selected.size(); i++)
-        highlights[i] = selected[i] ? 1 : 0;
-
-    _scatterPlotWidget->setHighlights(highlights, static_cast<std::int32_t>(selection->indices.size()));
+    _scatterPlotWidget->setHighlights(_selectionState.getMask(), static_cast<std::int32_t>(_selectionState.getNumSelected()));
 }
 
 std::uint32_t ScatterplotPlugin::getNumberOfPoints() const
@@ -729,6 +1118,7 @@ void ScatterplotPlugin::setXDimension(const std::int32_t& dimensionIndex)
     int xDim = _settingsAction.getPositionAction().getDimensionX();
     int yDim = _settingsAction.getPositionAction().getDimensionY();
     _explanationModel.recomputeNeighbourhood(0.1f, xDim, yDim);
+    _explanationModel.getCore().clearMultiScale();
 
     colorPointsByRanking();
 
@@ -742,6 +1132,7 @@ void ScatterplotPlugin::setYDimension(const std::int32_t& dimensionIndex)
     int xDim = _settingsAction.getPositionAction().getDimensionX();
     int yDim = _settingsAction.getPositionAction().getDimensionY();
     _explanationModel.recomputeNeighbourhood(0.1f, xDim, yDim);
+    _explanationModel.getCore().clearMultiScale();
 
     colorPointsByRanking();
 
@@ -783,6 +1174,9 @@ void ScatterplotPlugin::computeLensSelection(std::vector<std::uint32_t>& targetS
         if (sqrt(diff.x() * diff.x() + diff.y() * diff.y()) < _selectionRadius)
             targetSelectionIndices.push_back(localGlobalIndices[i]);
     }
+
+    // Downstream consumers rely on sorted selection indices
+    selection::makeSortedUnique(targetSelectionIndices);
 }
 
 bool ScatterplotPlugin::eventFilter(QObject* target, QEvent* event)
@@ -802,18 +1196,8 @@ bool ScatterplotPlugin::eventFilter(QObject* target, QEvent* event)
 
             if (_positionDataset.isValid())
             {
-                mv::Dataset<Points> sourceDataset = _positionDataset->getSourceDataset<Points>();
-                if (sourceDataset->isFull())
-                {
-                    _explanationWidget->getBarchart().computeOldMetrics(_positionDataset->getSelection()->getSelectionIndices());
-                }
-                else
-                {
-                    std::vector<unsigned int> localSelectionIndices;
-                    sourceDataset->getLocalSelectionIndices(localSelectionIndices);
-
-                    _explanationWidget->getBarchart().computeOldMetrics(localSelectionIndices);
-                }
+                // The bar chart shows the current selection, which becomes the reference
+                _explanationWidget->getBarchart().computeOldMetrics();
 
                 _explanationWidget->getBarchart().showDifferentialValues(true);
 
@@ -913,17 +1297,8 @@ bool ScatterplotPlugin::eventFilter(QObject* target, QEvent* event)
         if (!_positionDataset.isValid())
             return QObject::eventFilter(target, event);
 
-        // Create vector for target selection indices
-        std::vector<std::uint32_t> targetSelectionIndices;
-        computeLensSelection(targetSelectionIndices);
-
-        // Apply the selection indices
-        _positionDataset->setSelectionIndices(targetSelectionIndices);
-
-        // Notify others that the selection changed
-        events().notifyDatasetDataSelectionChanged(_positionDataset->getSourceDataset<Points>());
-
-        _explanationWidget->update();
+        // The lens selection is recomputed at most once per frame
+        _interactionScheduler.requestLensUpdate();
 
         break;
     }
@@ -940,17 +1315,8 @@ bool ScatterplotPlugin::eventFilter(QObject* target, QEvent* event)
         if (!_positionDataset.isValid())
             return QObject::eventFilter(target, event);
 
-        // Create vector for target selection indices
-        std::vector<std::uint32_t> targetSelectionIndices;
-        computeLensSelection(targetSelectionIndices);
-
-        // Apply the selection indices
-        _positionDataset->setSelectionIndices(targetSelectionIndices);
-
-        // Notify others that the selection changed
-        events().notifyDatasetDataSelectionChanged(_positionDataset->getSourceDataset<Points>());
-
-        _explanationWidget->update();
+        // The lens selection is recomputed at most once per frame
+        _interactionScheduler.requestLensUpdate();
 
         break;
     }
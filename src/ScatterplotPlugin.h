@@ -9,6 +9,8 @@
 #include "Common.h"
 
 #include "SettingsAction.h"
+#include "SelectionState.h"
+#include "InteractionScheduler.h"
 
 #include <ClusterData/ClusterData.h>
 #include <actions/HorizontalToolbarAction.h>
@@ -51,7 +53,33 @@ public:
     /** Get number of points in the position dataset */
     std::uint32_t getNumberOfPoints() const;
 
-    void colorPointsByRanking();
+    /**
+     * Color the points by their top ranked dimensions
+     * @param updateMetrics Whether to recompute the local statistics, not needed when a streaming update kept them current
+     */
+    void colorPointsByRanking(bool updateMetrics = true);
+
+    /**
+     * Color the points by the precomputed multi-scale level closest to the radius slider,
+     * computing the levels of all slider positions first when they are missing
+     * @return Whether the points were colored, false when the metric has no multi-scale explanation
+     */
+    bool colorPointsByScaleLevel();
+
+    /**
+     * Color the points by the explanation of the cluster they belong to
+     * @return Whether the points were colored, false when there are no clusters to explain
+     */
+    bool colorPointsByCluster();
+
+    /**
+     * Color the points by the explanation interpolated from the landmarks
+     * @return Whether the points were colored, false without landmarks or when the metric has no landmark explanation
+     */
+    bool colorPointsByLandmarks();
+
+    /** Explain the picked clusters when cluster explanation is enabled, otherwise return to the radius neighbourhoods */
+    void updateExplanationClusters();
 
 private: // Initialization
     void initializeDropWidget();
@@ -108,12 +136,36 @@ public:
 
     SettingsAction& getSettingsAction() { return _settingsAction; }
 
+    /** Get reference to the shared selection state of the position dataset */
+    SelectionState& getSelectionState() { return _selectionState; }
+
 private:
     void updateData();
     void calculatePositions(const Points& points);
     void updateSelection();
     void computeLensSelection(std::vector<std::uint32_t>& targetSelectionIndices);
 
+    /** Stream the changed positions into the explanation and recolor (invoked by the interaction scheduler, rate-limited) */
+    void processProjectionUpdate();
+
+    /** Recompute the neighbourhoods and colors for the current radius slider value (invoked by the interaction scheduler) */
+    void processRadiusUpdate();
+
+    /** Select the points under the lens and notify others (invoked by the interaction scheduler) */
+    void processLensUpdate();
+
+    /** Rank the dimensions of the current selection and update the explanation widget (invoked by the interaction scheduler) */
+    void processSelectionUpdate();
+
+    /** Rank the dimensions of the current selection (if any) and show them in the bar chart */
+    void rankSelection();
+
+    /** Color every point by its top ranked dimension, darkened by its confidence */
+    void setPointColors(const std::vector<int>& topRankedDims, const std::vector<float>& confidences);
+
+    /** Report the memory held by the explanation in the miscellaneous settings and the log */
+    void updateMemoryUsage();
+
     bool eventFilter(QObject* target, QEvent* event);
 
 public: // Serialization
@@ -135,6 +187,7 @@ private:
     Dataset<Points>                 _positionSourceDataset;     /** Smart pointer to source of the points dataset for point position (if any) */
     std::vector<mv::Vector2f>     _positions;                 /** Point positions */
     unsigned int                    _numPoints;                 /** Number of point positions */
+    SelectionState                  _selectionState;            /** Selection mask and delta shared by the selection consumers */
     
     
 protected:
@@ -144,6 +197,7 @@ protected:
 
     ExplanationModel            _explanationModel;
     ExplanationWidget*          _explanationWidget;
+    InteractionScheduler        _interactionScheduler;      /** Coalesces lens, slider and selection requests to one update per frame */
 
     HorizontalToolbarAction    _primaryToolbarAction;
     HorizontalToolbarAction    _secondaryToolbarAction;
@@ -156,6 +210,9 @@ protected:
     QPoint _lastMousePos;
 
     bool _mousePressed = false;
+
+    std::size_t _loggedMemoryUsage = 0;     /** Total explanation memory when the breakdown was last logged */
+    int _loggedNeighbourhoodStride = 1;     /** Neighbourhood sampling stride when the breakdown was last logged */
 };
 
 // =============================================================================
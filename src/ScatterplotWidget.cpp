@@ -209,6 +209,14 @@ void ScatterplotWidget::setPointSizeScalars(const std::vector<float>& pointSizeS
     update();
 }
 
+void ScatterplotWidget::setPointSizeScalars(const std::vector<float>& pointSizeScalars, float maximumPointSize)
+{
+    _pointRenderer.setSizeChannelScalars(pointSizeScalars);
+    _pointRenderer.setPointSize(maximumPointSize);
+
+    update();
+}
+
 void ScatterplotWidget::setPointOpacityScalars(const std::vector<float>& pointOpacityScalars)
 {
     _pointRenderer.setOpacityChannelScalars(pointOpacityScalars);
@@ -76,6 +76,13 @@ public:
      */
     void setPointSizeScalars(const std::vector<float>& pointSizeScalars);
 
+    /**
+     * Set point size scalars with a known maximum, which avoids a pass over the scalars
+     * @param pointSizeScalars Point size scalars
+     * @param maximumPointSize Largest value in \p pointSizeScalars
+     */
+    void setPointSizeScalars(const std::vector<float>& pointSizeScalars, float maximumPointSize);
+
     /**
      * Set point opacity scalars
      * @param pointOpacityScalars Point opacity scalars (assume the values are normalized)
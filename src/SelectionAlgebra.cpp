@@ -0,0 +1,145 @@
+#include "SelectionAlgebra.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    using Indices = std::vector<std::uint32_t>;
+
+    int countTrailingZeros(std::uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    /** Rough number of operations needed to bring the indices in sorted order */
+    double sortCost(const Indices& indices, bool sorted)
+    {
+        if (sorted || indices.size() < 2)
+            return 0;
+
+        return indices.size() * std::log2(static_cast<double>(indices.size()));
+    }
+
+    Indices sortedCopy(const Indices& indices, bool sorted)
+    {
+        Indices copy(indices);
+
+        if (!sorted)
+            std::sort(copy.begin(), copy.end());
+
+        copy.erase(std::unique(copy.begin(), copy.end()), copy.end());
+
+        return copy;
+    }
+
+    Indices combineDense(const Indices& existing, const Indices& target, selection::Operation operation, std::size_t universe)
+    {
+        std::vector<std::uint64_t> words((universe + 63) / 64, 0);
+
+        for (const auto index : existing)
+            words[index >> 6] |= std::uint64_t(1) << (index & 63);
+
+        if (operation == selection::Operation::Add)
+        {
+            for (const auto index : target)
+                words[index >> 6] |= std::uint64_t(1) << (index & 63);
+        }
+        else
+        {
+            for (const auto index : target)
+                words[index >> 6] &= ~(std::uint64_t(1) << (index & 63));
+        }
+
+        Indices result;
+        result.reserve(operation == selection::Operation::Add ? existing.size() + target.size() : existing.size());
+
+        for (std::size_t w = 0; w < words.size(); w++)
+        {
+            std::uint64_t word = words[w];
+
+            while (word != 0)
+            {
+                result.push_back(static_cast<std::uint32_t>(w * 64 + countTrailingZeros(word)));
+                word &= word - 1;
+            }
+        }
+
+        return result;
+    }
+
+    Indices combineSparse(const Indices& existing, bool existingSorted, const Indices& target, bool targetSorted, selection::Operation operation)
+    {
+        const Indices a = sortedCopy(existing, existingSorted);
+        const Indices b = sortedCopy(target, targetSorted);
+
+        Indices result;
+        result.reserve(operation == selection::Operation::Add ? a.size() + b.size() : a.size());
+
+        if (operation == selection::Operation::Add)
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+        else
+            std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+
+        return result;
+    }
+}
+
+namespace selection {
+
+void makeSortedUnique(std::vector<std::uint32_t>& indices)
+{
+    if (!std::is_sorted(indices.begin(), indices.end()))
+        std::sort(indices.begin(), indices.end());
+
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+std::vector<std::uint32_t> combine(const std::vector<std::uint32_t>& existing, const std::vector<std::uint32_t>& target, Operation operation)
+{
+    if (operation == Operation::Replace)
+    {
+        Indices result(target);
+        makeSortedUnique(result);
+        return result;
+    }
+
+    if (operation == Operation::Subtract && (existing.empty() || target.empty()))
+    {
+        Indices result(existing);
+        makeSortedUnique(result);
+        return result;
+    }
+
+    // The index range determines the size of the bitset
+    std::uint32_t maxIndex = 0;
+    for (const auto index : existing) maxIndex = std::max(maxIndex, index);
+    for (const auto index : target) maxIndex = std::max(maxIndex, index);
+
+    const std::size_t universe = static_cast<std::size_t>(maxIndex) + 1;
+
+    const bool existingSorted   = std::is_sorted(existing.begin(), existing.end());
+    const bool targetSorted     = std::is_sorted(target.begin(), target.end());
+
+    // Both approaches touch every input index once, they differ in the bitset scan versus sorting the inputs
+    const double denseCost  = universe / 64.0;
+    const double sparseCost = sortCost(existing, existingSorted) + sortCost(target, targetSorted);
+
+    if (denseCost < sparseCost)
+        return combineDense(existing, target, operation, universe);
+
+    return combineSparse(existing, existingSorted, target, targetSorted, operation);
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace selection {
+
+/** Set operation used to combine an existing selection with a target selection */
+enum class Operation
+{
+    Replace,    /** Result is the target selection */
+    Add,        /** Result is the union of the existing and target selection */
+    Subtract    /** Result is the existing selection minus the target selection */
+};
+
+/**
+ * Combine the \p existing selection with the \p target selection using \p operation.
+ *
+ * Depending on the density of the selections relative to the range of indices, the
+ * combination is either done with a dense bitset over the index range or with a linear
+ * merge of the sorted index vectors. Either way the result is sorted in ascending order
+ * and contains no duplicates, so downstream consumers can rely on that.
+ *
+ * @param existing Indices of the current selection (need not be sorted)
+ * @param target Indices to add to or subtract from the current selection (need not be sorted)
+ * @param operation Set operation to apply
+ * @return Sorted, unique combined selection indices
+ */
+std::vector<std::uint32_t> combine(const std::vector<std::uint32_t>& existing, const std::vector<std::uint32_t>& target, Operation operation);
+
+/**
+ * Sort \p indices in ascending order and remove duplicates, skipping the sort when they already are
+ * @param indices Selection indices to normalize in place
+ */
+void makeSortedUnique(std::vector<std::uint32_t>& indices);
+
+}
@@ -0,0 +1,95 @@
+#include "SelectionState.h"
+#include "SelectionAlgebra.h"
+
+#include <algorithm>
+#include <iterator>
+
+SelectionState::SelectionState(QObject* parent) :
+    QObject(parent),
+    _mask(),
+    _selectedIndices(),
+    _changedIndices(),
+    _globalToLocal(),
+    _generation(0),
+    _deltaBaseGeneration(0),
+    _deltaValid(false)
+{
+}
+
+void SelectionState::reset(const std::vector<std::uint32_t>& localGlobalIndices)
+{
+    const auto numPoints = localGlobalIndices.size();
+
+    _mask.assign(numPoints, 0);
+    _selectedIndices.clear();
+    _changedIndices.clear();
+    _globalToLocal.clear();
+
+    // Only keep a global to local mapping if the global indices are not the identity
+    bool identity = true;
+    for (std::uint32_t i = 0; i < numPoints; i++)
+    {
+        if (localGlobalIndices[i] != i)
+        {
+            identity = false;
+            break;
+        }
+    }
+
+    if (!identity && numPoints > 0)
+    {
+        const auto maxGlobalIndex = *std::max_element(localGlobalIndices.begin(), localGlobalIndices.end());
+
+        _globalToLocal.assign(static_cast<std::size_t>(maxGlobalIndex) + 1, -1);
+
+        for (std::uint32_t i = 0; i < numPoints; i++)
+            _globalToLocal[localGlobalIndices[i]] = static_cast<std::int32_t>(i);
+    }
+
+    _generation++;
+    _deltaValid = false;
+}
+
+void SelectionState::update(const std::vector<std::uint32_t>& globalSelectionIndices)
+{
+    const auto numPoints = static_cast<std::uint32_t>(_mask.size());
+
+    // Convert to sorted local indices
+    std::vector<std::uint32_t> selectedIndices;
+    selectedIndices.reserve(globalSelectionIndices.size());
+
+    if (_globalToLocal.empty())
+    {
+        for (const auto globalIndex : globalSelectionIndices)
+            if (globalIndex < numPoints)
+                selectedIndices.push_back(globalIndex);
+    }
+    else
+    {
+        for (const auto globalIndex : globalSelectionIndices)
+        {
+            if (globalIndex >= _globalToLocal.size() || _globalToLocal[globalIndex] < 0)
+                continue;
+
+            selectedIndices.push_back(static_cast<std::uint32_t>(_globalToLocal[globalIndex]));
+        }
+    }
+
+    selection::makeSortedUnique(selectedIndices);
+
+    // The changed points are the symmetric difference of the old and new selection
+    _changedIndices.clear();
+    std::set_symmetric_difference(_selectedIndices.begin(), _selectedIndices.end(), selectedIndices.begin(), selectedIndices.end(), std::back_inserter(_changedIndices));
+
+    for (const auto index : _changedIndices)
+        _mask[index] = _mask[index] ? 0 : 1;
+
+    _selectedIndices = std::move(selectedIndices);
+
+    _deltaBaseGeneration    = _generation;
+    _deltaValid             = true;
+
+    _generation++;
+
+    emit changed();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QObject>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Selection state class
+ *
+ * Shared, incrementally updated view on the selection of the position dataset. It holds
+ * a per-point selection mask (in local point indices) together with the indices of the
+ * points whose selection status changed in the last update. Consumers such as the
+ * highlight, point size and point opacity buffers use the delta to update only the
+ * changed points instead of rebuilding N-length buffers on every selection change.
+ */
+class SelectionState : public QObject
+{
+    Q_OBJECT
+
+public:
+    SelectionState(QObject* parent = nullptr);
+
+    /**
+     * Reset the state for a (new) set of points, clearing the selection
+     * @param localGlobalIndices Mapping from local point indices to global point indices
+     */
+    void reset(const std::vector<std::uint32_t>& localGlobalIndices);
+
+    /**
+     * Update the selection and compute the changed points with respect to the previous selection
+     * @param globalSelectionIndices Global indices of the selected points
+     */
+    void update(const std::vector<std::uint32_t>& globalSelectionIndices);
+
+    /** Get number of points */
+    std::uint32_t getNumPoints() const { return static_cast<std::uint32_t>(_mask.size()); }
+
+    /** Get number of selected points */
+    std::uint32_t getNumSelected() const { return static_cast<std::uint32_t>(_selectedIndices.size()); }
+
+    /** Get selection mask, one entry per local point index (1 when selected, 0 otherwise) */
+    const std::vector<char>& getMask() const { return _mask; }
+
+    /** Get sorted local indices of the selected points */
+    const std::vector<std::uint32_t>& getSelectedIndices() const { return _selectedIndices; }
+
+    /** Get sorted local indices of the points whose selection status changed in the last update */
+    const std::vector<std::uint32_t>& getChangedIndices() const { return _changedIndices; }
+
+    /** Get the generation of the state, incremented on every update and reset */
+    std::uint64_t getGeneration() const { return _generation; }
+
+    /**
+     * Establish whether the changed indices describe the difference with the state at \p generation,
+     * if not (e.g. a consumer missed an update or the state was reset) the consumer needs a full rebuild
+     * @param generation Generation the consumer last synchronized with
+     * @return Whether the delta can be applied on top of \p generation
+     */
+    bool hasDeltaSince(std::uint64_t generation) const { return _deltaValid && _deltaBaseGeneration == generation; }
+
+signals:
+
+    /** Signals that the selection state was updated */
+    void changed();
+
+private:
+    std::vector<char>           _mask;                  /** Selection mask in local point indices */
+    std::vector<std::uint32_t>  _selectedIndices;       /** Sorted local indices of the selected points */
+    std::vector<std::uint32_t>  _changedIndices;        /** Sorted local indices of the points changed in the last update */
+    std::vector<std::int32_t>   _globalToLocal;         /** Mapping from global to local point indices (empty when identity) */
+    std::uint64_t               _generation;            /** Current generation */
+    std::uint64_t               _deltaBaseGeneration;   /** Generation the changed indices are relative to */
+    bool                        _deltaValid;            /** Whether the changed indices are usable */
+};